@@ -0,0 +1,190 @@
+//
+// Benchmark Attribute::dump_in_mapped() against Attribute::dump_in() on a large att file,
+// and check that both build the same tree, for that file and for a file of tricky cases.
+//
+// Usage: attloadbench [file.att]
+//
+// Without a file, a document of about 45 MB is generated in /tmp, and removed after.
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ attloadbench.cc -I/usr/include/freetype2 -llaxkit -lX11 -lXft -lm -lpng -lcups -o attloadbench
+
+
+#include <lax/attributes.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+
+using namespace Laxkit;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Quoting, escapes, comments, multiline values, and raw blocks.
+static const char *tricky_att =
+	"# comment at start\n"
+	"name1 value1\n"
+	"name2   \"quoted value with \\\"escapes\\\" inside\"   # trailing comment\n"
+	"  sub1 a # c\n"
+	"      subdeep x\n"
+	"    sub2 \"not # a comment\"\n"
+	"  sub3\n"
+	"\"quoted name\" val\n"
+	"'single q' v2 \"x\"\n"
+	"esc\\ aped value\n"
+	"multi \\\n"
+	"  line one\n"
+	"  line two # cut\n"
+	"   indented more\n"
+	"  .\n"
+	"  \\.\n"
+	"after multi\n"
+	"raw << END\n"
+	"  raw text # not cut\n"
+	"    more\n"
+	"  END\n"
+	"back 1\n"
+	"rawzero < STOP\n"
+	"anything\n"
+	"STOP\n"
+	"tab\tseparated\tvalue\n"
+	"empty \"\"\n"
+	"q2 \"a\" \"b\"\n"
+	"    \n"
+	"last\n"
+	"blk \\\n"
+	"    first\n"
+	"      deeper kept\n"
+	"    .\n"
+	"    \\.\n"
+	"    x\\\\y # cmt\n"
+	"  shallower\n"
+	"next 1\n"
+	"onlydot \\\n"
+	"  .\n"
+	"after 2\n"
+	"bs \\\n"
+	"  \\\\\\\\x\n"
+	"  \\\\y\n";
+
+//! Write a document shaped like a big Laidout file: pages of path objects with "points \" blocks.
+static void WriteBigFile(const char *file, int numpages)
+{
+	FILE *f = fopen(file, "w");
+	if (!f) return;
+	srand(1);
+	for (int p=0; p<numpages; p++) {
+		fprintf(f, "page %d\n  name \"Page %d\"\n  layer\n", p, p);
+		for (int o=0; o<500; o++) {
+			fprintf(f, "    object PathsData obj%d_%d\n", p, o);
+			fprintf(f, "      matrix %g 0 0 1 %g %g\n", rand()/(double)RAND_MAX, rand()%500+.5, rand()%500+.25);
+			fprintf(f, "      linestyle\n        width 0.5\n        color 1 0 0 1  # red\n");
+			fprintf(f, "      path\n        points \\\n");
+			for (int c=0; c<6; c++) {
+				fprintf(f, "          %.4f,%.4f %.4f,%.4f\n", rand()%10000/100., rand()%10000/100., rand()%10000/100., rand()%10000/100.);
+			}
+			fprintf(f, "        closed yes\n      tags \"a\" \"b\"\n");
+		}
+	}
+	fclose(f);
+}
+
+static long CountNodes(Attribute *att)
+{
+	long n = 1;
+	for (int c=0; c<att->attributes.n; c++) n += CountNodes(att->attributes.e[c]);
+	return n;
+}
+
+static bool Same(const char *a, const char *b)
+{
+	if (!a || !b) return a == b;
+	return strcmp(a,b) == 0;
+}
+
+//! Return 0 if the trees match, else 1 after printing where they differ.
+static int Compare(Attribute *a, Attribute *b, int depth)
+{
+	if (!Same(a->name, b->name) || !Same(a->value, b->value) || a->attributes.n != b->attributes.n) {
+		printf("  differ at depth %d: [%s]=[%s] (%d kids) vs [%s]=[%s] (%d kids)\n", depth,
+				a->name ? a->name : "(null)", a->value ? a->value : "(null)", a->attributes.n,
+				b->name ? b->name : "(null)", b->value ? b->value : "(null)", b->attributes.n);
+		return 1;
+	}
+	for (int c=0; c<a->attributes.n; c++) {
+		if (Compare(a->attributes.e[c], b->attributes.e[c], depth+1)) return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int errors = 0;
+
+	 //edge cases
+	char tricky[] = "/tmp/attloadbench-tricky.att";
+	FILE *f = fopen(tricky, "w");
+	if (f) { fputs(tricky_att, f); fclose(f); }
+	Attribute a, b;
+	a.dump_in(tricky);
+	b.dump_in_mapped(tricky);
+	if (Compare(&a, &b, 0)) errors++;
+	printf("tricky cases: %s, %ld nodes\n", errors ? "DIFFERENT" : "same", CountNodes(&a));
+	unlink(tricky);
+
+	 //editing a mapped tree must not touch the mapping
+	if (b.attributes.n) {
+		b.attributes.e[0]->Value("edited");
+		b.attributes.e[0]->Name("renamed");
+		b.attributes.remove(b.attributes.n-1);
+		b.push("new", "value");
+		Attribute *dup = b.duplicateAtt();
+		if (!Same(dup->attributes.e[0]->value, "edited")) errors++;
+		delete dup;
+	}
+
+	 //big file
+	const char *file = (argc > 1 ? argv[1] : nullptr);
+	char generated[] = "/tmp/attloadbench-big.att";
+	if (!file) {
+		printf("writing %s...\n", generated);
+		WriteBigFile(generated, 200);
+		file = generated;
+	}
+
+	double t = now();
+	Attribute *plain = new Attribute;
+	plain->dump_in(file);
+	double t_load = now() - t;
+
+	t = now();
+	Attribute *mapped = new Attribute;
+	mapped->dump_in_mapped(file);
+	double t_mapped = now() - t;
+
+	int differ = Compare(plain, mapped, 0);
+	if (differ) errors++;
+	printf("%s: %ld nodes, trees %s\n", file, CountNodes(plain), differ ? "DIFFERENT" : "same");
+
+	t = now();
+	delete plain;
+	double t_free = now() - t;
+
+	t = now();
+	delete mapped;
+	double t_freemapped = now() - t;
+
+	printf("  dump_in():        load %.3fs, free %.3fs\n", t_load, t_free);
+	printf("  dump_in_mapped(): load %.3fs, free %.3fs\n", t_mapped, t_freemapped);
+
+	if (file == generated) unlink(generated);
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
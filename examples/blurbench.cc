@@ -0,0 +1,159 @@
+//
+// Benchmark ThreadedImageProcessor::GaussianBlur() against the plain ImageProcessor,
+// and compare the pixels each produces, for 8 and 16 bit channels and the box blur
+// used for big radii.
+//
+// Usage: blurbench [image width] [image height]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ blurbench.cc -I/usr/include/freetype2 -llaxkit -lX11 -lXft -lm -lpng -lcups -o blurbench
+
+
+#include <lax/imageprocessor-threaded.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+using namespace Laxkit;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv)
+{
+	int BW = (argc > 1 ? atoi(argv[1]) : 2048);
+	int BH = (argc > 2 ? atoi(argv[2]) : 2048);
+	if (BW < 1 || BH < 1) {
+		fprintf(stderr, "Usage: %s [image width] [image height]\n", argv[0]);
+		return 1;
+	}
+
+	ThreadedImageProcessor *proc = new ThreadedImageProcessor;
+	ImageProcessor base;
+	int errors = 0;
+	srand(3);
+
+	 //compare with the plain blur, away from the borders of expanded images
+	int W = 301, H = 207, pad = 200;
+	unsigned char *img = new unsigned char[W*H*4];
+	unsigned char *a   = new unsigned char[(W+pad)*(H+pad)*4];
+	unsigned char *b   = new unsigned char[(W+pad)*(H+pad)*4];
+	for (int c=0; c<W*H*4; c++) img[c] = rand()%256;
+
+	for (int radius : {1,3,8,20}) {
+		for (int expand=0; expand<2; expand++) {
+			for (char which : {'x','y','b'}) {
+				memset(a, 0, (W+pad)*(H+pad)*4);
+				memset(b, 0, (W+pad)*(H+pad)*4);
+				base .GaussianBlur(radius, which, img, W,H, a, expand, 8, 4, 0);
+				proc->GaussianBlur(radius, which, img, W,H, b, expand, 8, 4, 0);
+
+				int ow = W + (expand && which != 'y' ? 2*radius : 0);
+				int oh = H + (expand && which != 'x' ? 2*radius : 0);
+				int maxdiff = 0;
+				for (int y=0; y<oh; y++) {
+					for (int x=0; x<ow; x++) {
+						if (expand && which != 'y' && (x < radius || x >= ow-radius)) continue;
+						if (expand && which != 'x' && (y < radius || y >= oh-radius)) continue;
+						for (int ch=0; ch<4; ch++) {
+							int i = (y*ow+x)*4+ch;
+							int d = abs(a[i]-b[i]);
+							if (d > maxdiff) maxdiff = d;
+						}
+					}
+				}
+				 //each pass may round differently by one level
+				if (maxdiff > (which == 'b' ? 2 : 1)) errors++;
+				printf("radius %2d, expand %d, %c: max difference %d\n", radius, expand, which, maxdiff);
+			}
+		}
+	}
+	delete[] img;
+	delete[] a;
+	delete[] b;
+
+	 //16 bit: blur of v*257 should be 257 * blur of v
+	{
+		unsigned short *in16  = new unsigned short[W*H];
+		unsigned short *out16 = new unsigned short[W*H];
+		unsigned char *in8  = new unsigned char[W*H];
+		unsigned char *out8 = new unsigned char[W*H];
+		for (int c=0; c<W*H; c++) { in8[c] = rand()%256; in16[c] = in8[c]*257; }
+		proc->GaussianBlur(6, 'b', in8, W,H, out8, false, 8, 1, 0);
+		proc->GaussianBlur(6, 'b', (unsigned char*)in16, W,H, (unsigned char*)out16, false, 16, 1, 0);
+		int maxdiff = 0;
+		for (int c=0; c<W*H; c++) {
+			int d = abs((int)(out16[c]/257. + .5) - out8[c]);
+			if (d > maxdiff) maxdiff = d;
+		}
+		if (maxdiff > 1) errors++;
+		printf("16 bit vs 8 bit: max difference %d\n", maxdiff);
+		delete[] in16;
+		delete[] out16;
+		delete[] in8;
+		delete[] out8;
+	}
+
+	 //box cascade vs the true kernel at a big radius, on a checkerboard
+	{
+		int w = 600, h = 400;
+		unsigned char *in = new unsigned char[w*h];
+		unsigned char *o1 = new unsigned char[w*h];
+		unsigned char *o2 = new unsigned char[w*h];
+		for (int y=0; y<h; y++) for (int x=0; x<w; x++) in[y*w+x] = ((x/40 + y/40)%2) * 255;
+
+		int old_box = proc->box_radius;
+		proc->box_radius = 1000;
+		proc->GaussianBlur(45, 'b', in, w,h, o1, false, 8, 1, 0);
+		proc->box_radius = 24;
+		proc->GaussianBlur(45, 'b', in, w,h, o2, false, 8, 1, 0);
+		proc->box_radius = old_box;
+
+		int maxdiff = 0;
+		double mean = 0;
+		for (int c=0; c<w*h; c++) {
+			int d = abs(o1[c]-o2[c]);
+			mean += d;
+			if (d > maxdiff) maxdiff = d;
+		}
+		mean /= w*h;
+		if (maxdiff > 8 || mean > 2) errors++;
+		printf("box vs gaussian, radius 45: max difference %d, mean %.2f\n", maxdiff, mean);
+		delete[] in;
+		delete[] o1;
+		delete[] o2;
+	}
+
+	 //timing, both passes
+	printf("\n%dx%d, 8 bit, both passes:\n", BW,BH);
+	unsigned char *big = new unsigned char[(long)BW*BH*4];
+	unsigned char *out = new unsigned char[(long)BW*BH*4];
+	for (long c=0; c<(long)BW*BH*4; c++) big[c] = rand()%256;
+
+	for (int numchannels : {1,4}) {
+		for (int radius : {3,10,30,80}) {
+			double t = now();
+			base.GaussianBlur(radius, 'b', big, BW,BH, out, false, 8, numchannels, 0);
+			double told = now() - t;
+
+			t = now();
+			proc->GaussianBlur(radius, 'b', big, BW,BH, out, false, 8, numchannels, 0);
+			double tnew = now() - t;
+
+			printf("  %d channel%s, radius %2d:  ImageProcessor %.3fs,  ThreadedImageProcessor %.3fs  (%.1fx)\n",
+					numchannels, numchannels == 1 ? " " : "s", radius, told, tnew, told/tnew);
+		}
+	}
+	delete[] big;
+	delete[] out;
+	proc->dec_count();
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,173 @@
+//
+// Check the damage region kept by anXWindow for partial repaints: merging and clamping of
+// Invalidate(x,y,w,h) rectangles, Expose tracking, falling back to a full repaint, and that
+// any other way of asking for a redraw, like setting needtodraw directly, repaints everything.
+// Also times building a damage region. No X connection is needed.
+//
+// Usage: damagebench
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ damagebench.cc -I/usr/include/freetype2 -llaxkit -lX11 -lXft -lm -lpng -lcups -o damagebench
+
+
+#include <lax/anxapp.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+using namespace Laxkit;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static anXApp *theapp = nullptr;
+
+//! A window that records whether its last Refresh() was partial.
+class DamageWindow : public anXWindow
+{
+  public:
+	int refreshes;
+	bool last_partial;
+	IntRectangle last_bounds;
+
+	DamageWindow(int w, int h)
+	  : anXWindow(nullptr, "damage","damage", 0, 0,0,w,h,0, nullptr,0,nullptr)
+	{
+		refreshes = 0;
+		last_partial = false;
+		win_on = 1;
+		app = theapp;
+	}
+
+	virtual void Refresh()
+	{
+		refreshes++;
+		last_partial = PartialDamage();
+		DamageBounds(&last_bounds);
+		needtodraw = 0;
+	}
+
+	 //how a widget would ask for a redraw without using Invalidate()
+	void SetDirectly(int v) { needtodraw = v; }
+	void OrDirectly(int v) { needtodraw |= v; }
+};
+
+class DamageApp : public anXApp
+{
+  public:
+	int Pass() { return refreshdirty(); }
+	void AddTop(anXWindow *w) { topwindows.push(w); }
+};
+
+static int errors = 0;
+
+static void Check(bool ok, const char *what)
+{
+	if (!ok) errors++;
+	printf("  %-60s %s\n", what, ok ? "ok" : "FAILED");
+}
+
+int main(int argc, char **argv)
+{
+	DamageApp *app = new DamageApp;
+	theapp = app;
+	DamageWindow *win = new DamageWindow(1000, 800);
+	app->AddTop(win);
+	app->Pass(); //initial full draw
+
+	const IntRectangle *r;
+
+	win->Invalidate(10,10, 20,20);
+	Check(win->PartialDamage() && win->NumDamageRects() == 1, "one Invalidate(x,y,w,h) is partial");
+
+	win->Invalidate(25,25, 20,20);
+	r = win->DamageRect(0);
+	Check(win->NumDamageRects() == 1 && r->x == 10 && r->y == 10 && r->width == 35 && r->height == 35,
+			"overlapping rectangles merge");
+
+	win->Invalidate(500,500, 10,10);
+	Check(win->NumDamageRects() == 2, "separate rectangles stay separate");
+
+	app->Pass();
+	Check(win->last_partial && win->last_bounds.x == 10 && win->last_bounds.width == 500,
+			"Refresh() sees the partial region");
+	Check(!win->Needtodraw() && !win->PartialDamage(), "damage cleared after refresh");
+
+	win->Invalidate(-50,-50, 60,60);
+	r = win->DamageRect(0);
+	Check(r && r->x == 0 && r->y == 0 && r->width == 10 && r->height == 10, "rectangles are clamped to the window");
+	app->Pass();
+
+	win->Invalidate(2000,2000, 10,10);
+	Check(!win->Needtodraw(), "rectangle outside the window is ignored");
+
+	 //anything else means the whole window
+	win->Invalidate(10,10, 20,20);
+	win->SetDirectly(1);
+	Check(win->Needtodraw() && !win->PartialDamage(), "needtodraw=1 after Invalidate(x,y,w,h) is full");
+	app->Pass();
+	Check(!win->last_partial, "  ...and Refresh() repaints everything");
+
+	win->Invalidate(10,10, 20,20);
+	win->OrDirectly(2);
+	Check(!win->PartialDamage(), "needtodraw|=2 after Invalidate(x,y,w,h) is full");
+	app->Pass();
+
+	win->Invalidate(10,10, 20,20);
+	win->Needtodraw(1);
+	Check(!win->PartialDamage(), "Needtodraw(1) after Invalidate(x,y,w,h) is full");
+	app->Pass();
+
+	win->SetDirectly(1);
+	win->Invalidate(10,10, 20,20);
+	Check(!win->PartialDamage(), "Invalidate(x,y,w,h) does not shrink a pending full repaint");
+	app->Pass();
+
+	win->Invalidate(10,10, 20,20);
+	win->Invalidate();
+	Check(!win->PartialDamage() && win->NumDamageRects() == 0, "Invalidate() is full");
+	app->Pass();
+
+	 //fall back to full when there are too many, or they cover most of the window
+	for (int c=0; c<17; c++) win->Invalidate(c*50,0, 10,10);
+	Check(!win->PartialDamage(), "17 rectangles is full");
+	app->Pass();
+	win->Invalidate(0,0, 1000,700);
+	Check(!win->PartialDamage(), "covering 7/8 of the window is full");
+	app->Pass();
+
+	 //expose events
+	ScreenEventData expose(100,100, 50,50);
+	win->ExposeChange(&expose);
+	r = win->DamageRect(0);
+	Check(win->PartialDamage() && r->x == 100 && r->width == 50, "expose is partial once Invalidate(x,y,w,h) was used");
+	app->Pass();
+
+	DamageWindow *plain = new DamageWindow(1000, 800);
+	app->AddTop(plain);
+	app->Pass();
+	plain->ExposeChange(&expose);
+	Check(plain->Needtodraw() && !plain->PartialDamage(), "expose is full for windows that never used it");
+	app->Pass();
+
+	 //timing: a few small changes per frame, like hover highlights and a blinking cursor
+	int frames = 200000;
+	double t = now();
+	for (int c=0; c<frames; c++) {
+		win->Invalidate((c*37)%900,(c*53)%700, 40,20);
+		win->Invalidate((c*37)%900+30,(c*53)%700+10, 40,20);
+		win->Invalidate(500,(c*11)%700, 2,16);
+		app->Pass();
+	}
+	t = now() - t;
+	printf("\n%d frames of 3 Invalidate(x,y,w,h) and a refresh pass: %.3f us/frame\n", frames, t/frames*1e6);
+	Check(win->refreshes > frames && win->last_partial, "frames were partial");
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+//
+// Benchmark VoronoiData::UpdateTriangulation(), which repairs a triangulation with edge flips
+// after points move, against rebuilding it with Triangulate(), during barycentric relaxation.
+// Each repaired triangulation is checked to be the same as the rebuilt one.
+//
+// Usage: delaunaybench [number of points] [iterations]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ delaunaybench.cc -I/usr/include/freetype2 -llaxinterfaces -llaxkit \
+//         -lX11 -lXft -lm -lpng -lcups -o delaunaybench
+
+
+#include <lax/interfaces/delaunayinterface.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <set>
+#include <tuple>
+
+using namespace Laxkit;
+using namespace LaxInterfaces;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double rnd()
+{
+	return rand()/(double)RAND_MAX;
+}
+
+//! Return the triangles as (smallest index, next, next), so the same triangulation gives the same set.
+static std::set<std::tuple<int,int,int>> TriangleSet(VoronoiData *data)
+{
+	std::set<std::tuple<int,int,int>> tris;
+	for (int c=0; c<data->triangles.n; c++) {
+		IndexTriangle &t = data->triangles.e[c];
+		int p[3] = { t.p1, t.p2, t.p3 };
+		int m = (p[0] < p[1] ? (p[0] < p[2] ? 0 : 2) : (p[1] < p[2] ? 1 : 2));
+		tris.insert(std::make_tuple(p[m], p[(m+1)%3], p[(m+2)%3]));
+	}
+	return tris;
+}
+
+//! Return how many triangles have a point strictly inside their circumcircle.
+static int EmptyCircleViolations(VoronoiData *data)
+{
+	int bad = 0;
+	for (int c=0; c<data->triangles.n; c++) {
+		IndexTriangle &t = data->triangles.e[c];
+		double r2 = (data->points.e[t.p1]->p - t.circumcenter).norm2();
+		for (int p=0; p<data->points.n; p++) {
+			if (p == t.p1 || p == t.p2 || p == t.p3) continue;
+			if ((data->points.e[p]->p - t.circumcenter).norm2() < r2*(1-1e-9)) { bad++; break; }
+		}
+	}
+	return bad;
+}
+
+static VoronoiData *NewData(int numpoints)
+{
+	VoronoiData *data = new VoronoiData;
+	data->show_voronoi = data->show_delaunay = true;
+	srand(42);
+	for (int c=0; c<numpoints; c++) data->AddPoint(flatpoint(rnd(), rnd()));
+	data->Rebuild();
+	return data;
+}
+
+int main(int argc, char **argv)
+{
+	int numpoints = (argc > 1 ? atoi(argv[1]) : 20000);
+	int iters     = (argc > 2 ? atoi(argv[2]) : 10);
+	if (numpoints < 3 || iters < 1) {
+		fprintf(stderr, "Usage: %s [number of points] [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	 //whole relaxation, as VoronoiInterface does it
+	VoronoiData *relaxed = NewData(numpoints);
+	double t_relax = now();
+	relaxed->RelaxBarycenter(iters, 1.0, DoubleBBox(0,1,0,1));
+	t_relax = now() - t_relax;
+	relaxed->dec_count();
+
+	 //same steps, but time repairing and rebuilding separately, and compare them
+	VoronoiData *updated = NewData(numpoints);
+	VoronoiData *rebuilt = NewData(numpoints);
+	int errors = 0, fallbacks = 0;
+	double t_update = 0, t_rebuild = 0, t;
+
+	for (int i=0; i<iters; i++) {
+		int is_inf;
+		for (int c=0; c<numpoints; c++) {
+			flatpoint b = updated->BarycenterRegion(c, &is_inf);
+			if (b.info || !updated->regions.e[c].tris.n) continue;
+			updated->points.e[c]->p = b;
+			rebuilt->points.e[c]->p = b;
+		}
+		updated->InvalidateIndex();
+		rebuilt->InvalidateIndex();
+
+		t = now();
+		if (!updated->UpdateTriangulation()) { updated->Triangulate(); fallbacks++; }
+		t_update += now() - t;
+
+		t = now();
+		rebuilt->Triangulate();
+		t_rebuild += now() - t;
+
+		if (TriangleSet(updated) != TriangleSet(rebuilt)) {
+			errors++;
+			printf("iteration %d: triangulations differ\n", i);
+		}
+		updated->RebuildVoronoi(false);
+	}
+
+	printf("%d points, %d triangles, %d relax iterations\n", numpoints, updated->triangles.n, iters);
+	printf("  RelaxBarycenter():     %.4fs per iteration\n", t_relax/iters);
+	printf("  Triangulate():         %.4fs per iteration\n", t_rebuild/iters);
+	printf("  UpdateTriangulation(): %.4fs per iteration, fell back to Triangulate() %d times\n",
+			t_update/iters, fallbacks);
+
+	 //pulling a hull point inside its hull neighbors changes the hull, which flips alone cannot fix
+	int left = 0, prev = -1, next = -1;
+	for (int c=1; c<numpoints; c++) if (updated->points.e[c]->p.x < updated->points.e[left]->p.x) left = c;
+	for (int c=0; c<updated->triangles.n; c++) {
+		IndexTriangle &tri = updated->triangles.e[c];
+		int p[3] = { tri.p1, tri.p2, tri.p3 };
+		for (int k=0; k<3; k++) {
+			if (tri.t[k] >= 0) continue; //not a hull edge
+			if (p[k] == left) next = p[(k+1)%3];
+			if (p[(k+1)%3] == left) prev = p[k];
+		}
+	}
+	if (prev >= 0 && next >= 0) {
+		flatpoint mid = (updated->points.e[prev]->p + updated->points.e[next]->p) / 2;
+		updated->points.e[left]->p = mid + (flatpoint(.5,.5) - mid) * 1e-3;
+		updated->InvalidateIndex();
+		if (updated->UpdateTriangulation()) {
+			errors++;
+			printf("UpdateTriangulation() accepted a changed hull\n");
+		}
+	}
+	updated->Rebuild();
+
+	 //Map() with an arbitrary function must still leave a Delaunay triangulation
+	updated->Map([](const flatpoint &p, flatpoint &newp) {
+			newp = flatpoint(p.x + .3*p.y*p.y, p.y - .2*p.x);
+			return 1;
+		});
+	int bad = EmptyCircleViolations(updated);
+	if (bad) errors++;
+	printf("after Map(): %d triangles fail the empty circle test\n", bad);
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	updated->dec_count();
+	rebuilt->dec_count();
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,156 @@
+//
+// Benchmark EngraverPointGroup::Trace(), which also updates the dash cache, on a big fill
+// whose lines were grown a point at a time across all lines, before and after
+// EngraverPointGroup::CompactLines(). Also checks that compacting gives the same trace,
+// and that the line ends held by a grow_cache are moved with the lines.
+//
+// Usage: engraverbench [number of lines] [points per line]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ engraverbench.cc -I/usr/include/freetype2 -llaxinterfaces -llaxkit \
+//         -lX11 -lXft -lm -lpng -lcups -o engraverbench
+
+
+#include <lax/interfaces/engraverfilldata.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+
+using namespace Laxkit;
+using namespace LaxInterfaces;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Sum up the traced cache so that two traces can be compared.
+static double CacheChecksum(EngraverPointGroup *group, long *npoints_ret)
+{
+	double sum = 0;
+	long n = 0;
+	for (int c=0; c<group->lines.n; c++) {
+		for (LinePointCache *lc = group->lines.e[c]->cache; lc; lc = lc->next) {
+			sum += lc->p.x * lc->weight + lc->on + lc->dashon;
+			n++;
+		}
+	}
+	*npoints_ret = n;
+	return sum;
+}
+
+static double TimeTrace(EngraverPointGroup *group, const char *label, double *checksum_ret, long *npoints_ret)
+{
+	double best = -1;
+	for (int c=0; c<3; c++) {
+		double t = now();
+		group->Trace(NULL);
+		t = now() - t;
+		if (best < 0 || t < best) best = t;
+	}
+	*checksum_ret = CacheChecksum(group, npoints_ret);
+	printf("  Trace + UpdateDashCache, %s:  %.3fs\n", label, best);
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	int nlines = (argc > 1 ? atoi(argv[1]) : 500);
+	int npts   = (argc > 2 ? atoi(argv[2]) : 1000);
+	if (nlines < 1 || npts < 2) {
+		fprintf(stderr, "Usage: %s [number of lines] [points per line]\n", argv[0]);
+		return 1;
+	}
+
+	int errors = 0;
+	EngraverPointGroup *group = new EngraverPointGroup(NULL, -1, "bench", PGROUP_Linear,
+								flatpoint(.5,.5), flatpoint(1,0), NULL,NULL,NULL,NULL);
+	group->dashes->zero_threshhold   = .02;
+	group->dashes->broken_threshhold = .07;
+	group->dashes->dash_length       = 2;
+	group->dashes->dash_randomness   = .3;
+	group->dashes->randomseed        = 5;
+
+	 //trace from a sample of wavy gray
+	SomeData *object = new SomeData(0,10,0,10);
+	TraceObject *trace = new TraceObject;
+	trace->type = TraceObject::TRACE_Snapshot;
+	trace->object = object;
+	trace->samplew = trace->sampleh = 512;
+	trace->trace_sample_cache = new unsigned char[512*513*4];
+	for (int y=0; y<513; y++) {
+		for (int x=0; x<512; x++) {
+			unsigned char *p = trace->trace_sample_cache + 4*(y*512+x);
+			p[0] = p[1] = p[2] = 128 + 127*sin(x*.05)*cos(y*.037);
+			p[3] = (x > 20 && x < 500) ? 255 : 0;
+		}
+	}
+	group->trace->traceobject = trace;
+
+	 //grow all lines a point at a time, the way growing lines does, so each line is spread through memory
+	double t = now();
+	LinePoint **ends = new LinePoint*[nlines];
+	for (int i=0; i<npts; i++) {
+		for (int c=0; c<nlines; c++) {
+			LinePoint *lp = new LinePoint(i/(double)npts, c/(double)nlines, .05);
+			lp->p = flatpoint(10.*i/npts, 10.*(c+.5)/nlines + .02*sin(i*.1));
+			if (i == 0) group->lines.push(lp);
+			else { ends[c]->next = lp; lp->prev = ends[c]; }
+			ends[c] = lp;
+		}
+	}
+	printf("%d lines x %d points, built in %.3fs\n", nlines, npts, now()-t);
+
+	 //pretend some lines are still growing
+	group->grow_cache = new GrowContext();
+	for (int c=0; c<nlines; c+=7) {
+		StarterPoint *sp = new StarterPoint(flatpoint(), 3, .05, 0, c);
+		delete sp->line;
+		sp->line = sp->first = group->lines.e[c];
+		sp->last = ends[c];
+		group->grow_cache->generators.push(sp);
+	}
+
+	group->UpdateBezCache();
+	double sum_before, sum_after;
+	long n_before, n_after;
+	double scattered = TimeTrace(group, "scattered", &sum_before, &n_before);
+
+	t = now();
+	group->CompactLines();
+	printf("  CompactLines:                       %.3fs\n", now()-t);
+
+	double compacted = TimeTrace(group, "compacted", &sum_after, &n_after);
+	printf("  %.1fx, %ld cache points\n", scattered/compacted, n_after);
+
+	if (n_before != n_after || fabs(sum_before - sum_after) > 1e-6 * fabs(sum_before)) {
+		printf("  compacted trace differs: %ld points, checksum %.6f, was %ld, %.6f\n",
+				n_after, sum_after, n_before, sum_before);
+		errors++;
+	}
+
+	 //growing ends must now be the ends of the moved lines
+	int badends = 0;
+	for (int c=0; c<group->grow_cache->generators.n; c++) {
+		StarterPoint *sp = group->grow_cache->generators.e[c];
+		LinePoint *last = group->lines.e[sp->lineref];
+		while (last->next) last = last->next;
+		if (sp->line != group->lines.e[sp->lineref] || sp->first != sp->line || sp->last != last) badends++;
+	}
+	if (badends) {
+		printf("  %d grow_cache generators point at old line points\n", badends);
+		errors++;
+	}
+
+	t = now();
+	delete group;
+	delete[] ends;
+	printf("  delete:                             %.3fs\n", now()-t);
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+//
+// Benchmark PatchData::renderToBuffer() against the older recursive
+// renderToBufferRecursive(), and compare the pixels each produces.
+//
+// Usage: patchrenderbench [buffer width] [mesh size] [repeats]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ patchrenderbench.cc -I/usr/include/freetype2 -llaxinterfaces -llaxkit \
+//         -lX11 -lXft -lm -lpng -lcups -o patchrenderbench
+
+
+#include <lax/interfaces/colorpatchinterface.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+using namespace Laxkit;
+using namespace LaxInterfaces;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char **argv)
+{
+	int width   = (argc > 1 ? atoi(argv[1]) : 1000);
+	int meshsize= (argc > 2 ? atoi(argv[2]) : 4);
+	int repeats = (argc > 3 ? atoi(argv[3]) : 5);
+	if (width < 1 || meshsize < 1 || repeats < 1) {
+		fprintf(stderr, "Usage: %s [buffer width] [mesh size] [repeats]\n", argv[0]);
+		return 1;
+	}
+
+	 //a mesh of meshsize x meshsize subpatches, with jittered points and random colors
+	ColorPatchData *patch = new ColorPatchData(0,0,100,100, meshsize,meshsize, 0);
+	srand(3);
+	for (int c=0; c < patch->xsize*patch->ysize; c++) {
+		patch->points[c].x += (rand()%100 - 50)/10.;
+		patch->points[c].y += (rand()%100 - 50)/10.;
+	}
+	for (int r=0; r <= patch->ysize/3; r++) {
+		for (int c=0; c <= patch->xsize/3; c++) {
+			patch->SetColor(r,c, rand()%65536, rand()%65536, rand()%65536, 65535);
+		}
+	}
+	patch->FindBBox();
+
+	unsigned char *recursive = new unsigned char[width*width*4];
+	unsigned char *tiled     = new unsigned char[width*width*4];
+
+	double t_recursive = 1e10, t_tiled = 1e10, t;
+	for (int c=0; c<repeats; c++) {
+		t = now();
+		patch->renderToBufferRecursive(recursive, width,width, 0,8,4);
+		t = now() - t;
+		if (t < t_recursive) t_recursive = t;
+
+		t = now();
+		patch->renderToBuffer(tiled, width,width, 0,8,4);
+		t = now() - t;
+		if (t < t_tiled) t_tiled = t;
+	}
+
+	 //compare coverage and color
+	long covered_recursive = 0, covered_tiled = 0, holes = 0, diff = 0;
+	int maxdiff = 0;
+	for (int c=0; c < width*width; c++) {
+		if (recursive[c*4+3]) covered_recursive++;
+		if (tiled[c*4+3]) covered_tiled++;
+		if (recursive[c*4+3] && !tiled[c*4+3]) holes++;
+		for (int k=0; k<4; k++) {
+			int d = abs(recursive[c*4+k] - tiled[c*4+k]);
+			diff += d;
+			if (d > maxdiff) maxdiff = d;
+		}
+	}
+
+	printf("%dx%d buffer, %dx%d mesh, best of %d\n", width,width, meshsize,meshsize, repeats);
+	printf("  renderToBufferRecursive: %8.2f ms\n", t_recursive*1000);
+	printf("  renderToBuffer:          %8.2f ms  (%.1fx)\n", t_tiled*1000, t_recursive/t_tiled);
+	printf("  covered pixels: %ld recursive, %ld tiled, %ld holes\n", covered_recursive, covered_tiled, holes);
+	printf("  mean channel difference %.3f, max %d\n", diff/(4.0*width*width), maxdiff);
+
+	delete[] recursive;
+	delete[] tiled;
+	patch->dec_count();
+	return 0;
+}
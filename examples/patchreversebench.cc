@@ -0,0 +1,154 @@
+//
+// Check accuracy and throughput of PatchData::getPointReverse() and getPointsReverse(),
+// which map points back to mesh coordinates (s,t) with the grid of flattened subpatches.
+// Random (s,t) are mapped forward with getPoint(), then back, on a jittered mesh. These
+// are compared to the plain inSubPatch() search that getPointReverse() used before the grid.
+// Also checks that points outside the mesh are not found, and that the grid follows
+// changes to the mesh.
+//
+// Usage: patchreversebench [number of points] [mesh size]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ patchreversebench.cc -I/usr/include/freetype2 -llaxinterfaces -llaxkit \
+//         -lX11 -lXft -lm -lpng -lcups -o patchreversebench
+
+
+#include <lax/interfaces/patchinterface.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <vector>
+
+using namespace Laxkit;
+using namespace LaxInterfaces;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! How getPointReverse() worked before the lookup grid.
+static flatpoint SearchReverse(PatchData *patch, flatpoint p, int *status_ret)
+{
+	int r=-1, c=-1;
+	double t=-1, s=-1;
+	*status_ret = patch->inSubPatch(p, &r,&c, &t,&s, (patch->maxx-patch->minx)/1000);
+	return flatpoint((c+s)/(patch->xsize/3), (r+t)/(patch->ysize/3));
+}
+
+//! Accumulate errors of st against expected, and of mapping st forward again against xy.
+static void Errors(PatchData *patch, std::vector<flatpoint> &expected, std::vector<flatpoint> &xy,
+				   std::vector<flatpoint> &st, std::vector<int> &status, int n,
+				   int *found, double *st_max, double *st_mean, double *xy_max)
+{
+	*found = 0;
+	*st_max = *st_mean = *xy_max = 0;
+	for (int c=0; c<n; c++) {
+		if (!status[c]) continue;
+		(*found)++;
+		double e = norm(st[c] - expected[c]);
+		*st_mean += e;
+		if (e > *st_max) *st_max = e;
+		double d = norm(patch->getPoint(st[c].x,st[c].y, false) - xy[c]);
+		if (d > *xy_max) *xy_max = d;
+	}
+	if (*found) *st_mean /= *found;
+}
+
+int main(int argc, char **argv)
+{
+	int N        = (argc > 1 ? atoi(argv[1]) : 20000);
+	int meshsize = (argc > 2 ? atoi(argv[2]) : 6);
+	if (N < 1 || meshsize < 1) {
+		fprintf(stderr, "Usage: %s [number of points] [mesh size]\n", argv[0]);
+		return 1;
+	}
+
+	 //a mesh of meshsize x meshsize subpatches, with wavy points
+	PatchData *patch = new PatchData(0,0,100,100, meshsize,meshsize, 0);
+	for (int c=0; c<patch->xsize*patch->ysize; c++) {
+		patch->points[c].x += sin(c*.7)*3;
+		patch->points[c].y += cos(c*1.3)*3;
+	}
+	patch->NeedToUpdateCache(0,-1, 0,-1);
+	patch->FindBBox();
+
+	srand(1);
+	std::vector<flatpoint> expected(N), xy(N), st(N);
+	std::vector<int> status(N);
+	for (int c=0; c<N; c++) {
+		expected[c] = flatpoint(.001 + .998*rand()/(double)RAND_MAX, .001 + .998*rand()/(double)RAND_MAX);
+		xy[c] = patch->getPoint(expected[c].x,expected[c].y, false);
+	}
+
+	int errors = 0;
+	int found;
+	double st_max, st_mean, xy_max;
+
+	printf("%d points on a %dx%d mesh:\n", N, meshsize,meshsize);
+
+	 //the old search is slow, so only do some of the points
+	int nsearch = (N > 2000 ? 2000 : N);
+	double t = now();
+	for (int c=0; c<nsearch; c++) st[c] = SearchReverse(patch, xy[c], &status[c]);
+	double tsearch = now() - t;
+	Errors(patch, expected, xy, st, status, nsearch, &found, &st_max, &st_mean, &xy_max);
+	printf("  inSubPatch search:  %8.3f us/point, found %d of %d, s,t error max %.3g mean %.3g, x,y error max %.3g\n",
+			tsearch/nsearch*1e6, found, nsearch, st_max, st_mean, xy_max);
+
+	t = now();
+	patch->UpdateReverseCache();
+	double tgrid = now() - t;
+
+	t = now();
+	for (int c=0; c<N; c++) st[c] = patch->getPointReverse(xy[c].x,xy[c].y, &status[c]);
+	double tsingle = now() - t;
+	Errors(patch, expected, xy, st, status, N, &found, &st_max, &st_mean, &xy_max);
+	printf("  getPointReverse:    %8.3f us/point, found %d of %d, s,t error max %.3g mean %.3g, x,y error max %.3g\n",
+			tsingle/N*1e6, found, N, st_max, st_mean, xy_max);
+	if (found != N || st_max > 1e-6) errors++;
+
+	t = now();
+	patch->getPointsReverse(N, xy.data(), st.data(), status.data());
+	double tbatch = now() - t;
+	Errors(patch, expected, xy, st, status, N, &found, &st_max, &st_mean, &xy_max);
+	printf("  getPointsReverse:   %8.3f us/point, found %d of %d, s,t error max %.3g\n",
+			tbatch/N*1e6, found, N, st_max);
+	if (found != N || st_max > 1e-6) errors++;
+
+	printf("  building the grid:  %8.3f ms\n", tgrid*1e3);
+	printf("  speedup over search: %.0fx single, %.0fx batch\n",
+			(tsearch/nsearch) / (tsingle/N), (tsearch/nsearch) / (tbatch/N));
+
+	 //points outside the mesh must not be found
+	int outside = 0;
+	for (int c=0; c<N; c++) {
+		int in;
+		patch->getPointReverse(150 + c%50, -20 - c%30, &in);
+		outside += in;
+	}
+	printf("  points outside found: %d\n", outside);
+	if (outside) errors++;
+
+	 //move a point, the grid must be rebuilt
+	patch->points[patch->xsize*4 + 4].x += 10;
+	patch->NeedToUpdateCache(0,-1, 0,-1);
+	int moved_ok = 1;
+	for (int c=0; c<100; c++) {
+		flatpoint p = patch->getPoint(expected[c].x,expected[c].y, false);
+		int in;
+		flatpoint r = patch->getPointReverse(p.x,p.y, &in);
+		if (!in || norm(r - expected[c]) > 1e-6) moved_ok = 0;
+	}
+	printf("  after moving a point: %s\n", moved_ok ? "ok" : "FAILED");
+	if (!moved_ok) errors++;
+
+	patch->dec_count();
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
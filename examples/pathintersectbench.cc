@@ -0,0 +1,129 @@
+//
+// Benchmark the grid broad phase bez_overlap_pairs() used by PathsData::AddAtIntersections(),
+// and check it finds exactly the same pairs as comparing every segment's bounds with every other.
+//
+// Usage: pathintersectbench [max segments]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ pathintersectbench.cc -I/usr/include/freetype2 -llaxinterfaces -llaxkit \
+//         -lX11 -lXft -lm -lpng -lcups -o pathintersectbench
+
+
+#include <lax/bezutils.h>
+#include <lax/interfaces/pathinterface.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <set>
+#include <utility>
+
+using namespace Laxkit;
+using namespace LaxInterfaces;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double rnd()
+{
+	return rand()/(double)RAND_MAX;
+}
+
+int main(int argc, char **argv)
+{
+	int maxsegments = (argc > 1 ? atoi(argv[1]) : 100000);
+	int errors = 0;
+	srand(1);
+
+	for (int n = 1000; n <= maxsegments; n *= 10) {
+		 //rows of short wavy segments, like engraving lines
+		NumStack<flatpoint> points;
+		int rows = (int)sqrt(n);
+		for (int c=0; c<n; c++) {
+			int row = c%rows, k = c/rows;
+			flatpoint a(k*10, row*10 + 5*sin(k*.3));
+			flatpoint b(k*10 + 10, row*10 + 5*sin((k+1)*.3) + rnd()*12);
+			points.push(a);
+			points.push(a + flatpoint(3, rnd()*4-2));
+			points.push(b - flatpoint(3, rnd()*4-2));
+			points.push(b);
+		}
+
+		NumStack<int> pairs;
+		double t = now();
+		bez_overlap_pairs(points.e, n, pairs);
+		double t_grid = now() - t;
+
+		 //exact tests on the candidate pairs
+		flatpoint pts[10];
+		double t1[9], t2[9];
+		long hits = 0;
+		t = now();
+		for (int c=0; c<pairs.n; c+=2) {
+			const flatpoint *s1 = points.e + 4*pairs.e[c], *s2 = points.e + 4*pairs.e[c+1];
+			int num = 0;
+			bez_intersect_bez(s1[0],s1[1],s1[2],s1[3], s2[0],s2[1],s2[2],s2[3], pts,t1,t2,num, 1e-5, 0,0,1,1, 0);
+			hits += num;
+		}
+		double t_exact = now() - t;
+
+		printf("%7d segments: grid %.4fs, %d pairs, exact tests on pairs %.3fs, %ld intersections\n",
+				n, t_grid, pairs.n/2, t_exact, hits);
+
+		 //brute force all pairs of bounds
+		if (n > 10000) continue;
+		DoubleBBox *boxes = new DoubleBBox[n];
+		for (int c=0; c<n; c++) {
+			boxes[c].addtobounds(points.e[4*c]);
+			bez_bbox(points.e[4*c], points.e[4*c+1], points.e[4*c+2], points.e[4*c+3], boxes+c);
+		}
+		std::set<std::pair<int,int>> found, brute;
+		for (int c=0; c<pairs.n; c+=2) {
+			int a = pairs.e[c], b = pairs.e[c+1];
+			if (a > b) std::swap(a,b);
+			if (!found.insert(std::make_pair(a,b)).second) errors++; //duplicate
+		}
+		t = now();
+		for (int a=0; a<n; a++) {
+			for (int b=a+1; b<n; b++) {
+				if (boxes[a].intersect(boxes+b)) brute.insert(std::make_pair(a,b));
+			}
+		}
+		double t_brute = now() - t;
+		delete[] boxes;
+
+		if (found != brute) errors++;
+		printf("                 brute force %.3fs, %d pairs, %s\n", t_brute, (int)brute.size(),
+				found == brute ? "same" : "DIFFERENT");
+	}
+
+	 //a grid of crossing paths must get a vertex added at every crossing in each path
+	PathsData paths;
+	int numlines = 30;
+	for (int c=0; c<numlines; c++) {
+		paths.pushEmpty();
+		paths.append(0., c*10+5.);
+		paths.append(100., c*10+6.);
+		paths.append(320., c*10+5.);
+	}
+	for (int c=0; c<numlines; c++) {
+		paths.pushEmpty();
+		paths.append(c*10+5., -10.);
+		paths.append(c*10+5.5, 150.);
+		paths.append(c*10+5., 320.);
+	}
+	int before = 0, after = 0;
+	for (int c=0; c<paths.paths.n; c++) before += paths.paths.e[c]->NumVertices(nullptr);
+	paths.AddAtIntersections(false, false, -1);
+	for (int c=0; c<paths.paths.n; c++) after += paths.paths.e[c]->NumVertices(nullptr);
+	if (after - before != 2*numlines*numlines) errors++;
+	printf("AddAtIntersections: %d vertices added, expected %d\n", after - before, 2*numlines*numlines);
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+//
+// Benchmark editing a big text with TextEditBaseUtf8, and check its gap buffer and line
+// index against a plain std::string with random edits, undos and redos.
+//
+// Usage: texteditbench [megabytes of text]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ texteditbench.cc -I/usr/include/freetype2 -llaxkit -lX11 -lXft -lm -lpng -lcups -o texteditbench
+
+
+#include <lax/texteditbase-utf8.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+
+using namespace Laxkit;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Expose some internals of the edit for checking.
+class TestEdit : public TextEditBaseUtf8
+{
+  public:
+	TestEdit(const char *text, unsigned long style) : TextEditBaseUtf8(text, style) {}
+	long Length() { return textlen; }
+	char Char(long pos) { return textchar(pos); }
+
+	 //simulate drawing a screen of text after pos
+	void Draw(long pos, long bytes) { MakeContiguous(pos+bytes); }
+
+	 //brute force versions of the indexed lookups, the text itself is checked against a std::string
+	long CountBreaks(long from, long to)
+	{
+		long n=0;
+		for (long c=from; c<=to && c<textlen; c++) if (onlf(c)==1) n++;
+		return n;
+	}
+	long LineStart(long pos)
+	{
+		if (pos>textlen) pos=textlen;
+		while (pos>0 && !onlf(pos-1)) pos--;
+		return pos;
+	}
+};
+
+static int RandomEdits(unsigned long style)
+{
+	const char *pieces[] = { "x", "\n", "\r", "\r\n", "hello\nworld", "\xc3\xa9", "tab\there" };
+	int errors = 0;
+	TestEdit edit("ab\ncd\r\n\nef", style);
+	std::string start = "ab\ncd\r\n\nef";
+	std::string model = start;
+	int numedits = 0;
+
+	srand(5);
+	for (int i=0; i<20000; i++) {
+		long len = edit.Length();
+		long pos = edit.SetCurpos(len ? rand()%(len+1) : 0);
+		int op = rand()%5;
+
+		if (op==0) {
+			edit.inschar('q');
+			model.insert(pos, "q");
+		} else if (op==1 && pos<len) {
+			long next = edit.GetCurpos();
+			edit.SetSelection(pos, pos+1+rand()%3); //SetSelection keeps ends on valid characters
+			long s, e;
+			edit.GetSelection(s, e);
+			if (e>s) {
+				edit.delsel();
+				model.erase(s, e-s);
+			} else edit.SetCurpos(next);
+		} else if (op==2) {
+			const char *str = pieces[rand()%7];
+			edit.insstring(str, rand()%2);
+			model.insert(pos, str);
+		} else if (op==3 && len) {
+			long a = rand()%(len+1), b = a + rand()%20;
+			edit.SetSelection(a, b);
+			long s, e;
+			edit.GetSelection(s, e);
+			if (s>e) { long t=s; s=e; e=t; }
+			const char *str = pieces[rand()%7];
+			if (e>s) {
+				edit.replacesel(str, rand()%2);
+				model.replace(s, e-s, str);
+			} else continue;
+		} else if (op==4) {
+			edit.Draw(pos, rand()%200); //moves the gap
+			continue;
+		} else continue;
+		numedits++;
+
+		if (edit.Length() != (long)model.size()) { errors++; break; }
+		for (int k=0; k<3; k++) {
+			long l = model.size();
+			long p = (l ? rand()%(l+1) : 0);
+			if (p<l && edit.Char(p) != model[p]) errors++;
+			if (edit.WhichLine(p) != (p>0 ? edit.CountBreaks(0, p-1) : 0)) errors++;
+			if (edit.findlinestart(p) != edit.LineStart(p)) errors++;
+		}
+		long l = model.size();
+		if (edit.GetNumLines() != edit.CountBreaks(0, l)) errors++;
+		if (i%500 == 0 && model != edit.GetCText()) errors++;
+	}
+	if (model != edit.GetCText()) errors++;
+
+	 //undo everything, then redo everything
+	std::string end = model;
+	for (int c=0; c<3*numedits && edit.Undo()==0; c++) ;
+	if (start != edit.GetCText()) { errors++; printf("  undo all does not restore the text\n"); }
+	for (int c=0; c<3*numedits && edit.Redo()==0; c++) ;
+	if (end != edit.GetCText()) { errors++; printf("  redo all does not restore the edited text\n"); }
+
+	printf("random edits, %s: %d edits, %ld bytes, %ld lines, %d errors\n",
+			(style&TEXT_CRLF) ? "CRLF" : "LF", numedits, edit.Length(), edit.GetNumLines(), errors);
+	return errors;
+}
+
+int main(int argc, char **argv)
+{
+	long megabytes = (argc > 1 ? atol(argv[1]) : 50);
+
+	int errors = RandomEdits(0) + RandomEdits(TEXT_CRLF);
+
+	std::string text;
+	text.reserve(megabytes*1000000+100);
+	srand(1);
+	while ((long)text.size() < megabytes*1000000) {
+		int n = 20 + rand()%80;
+		for (int c=0; c<n; c++) text += 'a' + rand()%26;
+		text += '\n';
+	}
+
+	double t = now();
+	TestEdit edit(text.c_str(), 0);
+	printf("\n%ld MB text, %ld lines, load %.3fs\n", megabytes, edit.GetNumLines(), now()-t);
+
+	 //typing in the middle, with and without a redraw of the text after the cursor
+	edit.SetCurpos(edit.Length()/2);
+	t = now();
+	for (int c=0; c<5000; c++) edit.inschar(c%60==59 ? '\n' : 'a'+c%26);
+	printf("  typing 5000 chars:                 %.4fs\n", now()-t);
+
+	edit.SetCurpos(edit.Length()/3);
+	t = now();
+	for (int c=0; c<5000; c++) {
+		edit.inschar(c%60==59 ? '\n' : 'a'+c%26);
+		edit.Draw(edit.GetCurpos(), 4000);
+	}
+	printf("  typing 5000 chars, drawing each:   %.4fs\n", now()-t);
+
+	edit.SetCurpos(edit.Length()/4);
+	t = now();
+	for (int c=0; c<5000; c++) edit.delchar(1);
+	printf("  backspacing 5000 chars:            %.4fs\n", now()-t);
+
+	 //paste 1MB at scattered places
+	std::string paste;
+	while (paste.size() < 1000000) paste += "pasted line of text here\n";
+	t = now();
+	for (int c=0; c<5; c++) {
+		edit.SetCurpos(edit.Length()/7*(c+1));
+		edit.insstring(paste.c_str(), 1);
+	}
+	printf("  paste 5 x 1MB:                     %.4fs\n", now()-t);
+
+	 //jump around and type, as with find and replace
+	long sum = 0;
+	t = now();
+	for (int c=0; c<200; c++) {
+		edit.SetCurpos((long)((double)rand()/RAND_MAX*edit.Length()));
+		edit.inschar('z');
+		sum += edit.WhichLine(edit.GetCurpos());
+	}
+	printf("  200 x jump, type, WhichLine:       %.4fs\n", now()-t);
+
+	t = now();
+	const char *all = edit.GetCText();
+	printf("  GetCText() after edits:            %.4fs (%ld bytes)\n", now()-t, (long)strlen(all));
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+//
+// Benchmark the anXApp timer queue with many active timers: adding, the per event loop
+// pass in settimeout(), removing by id, and churn like autoscroll and animation timers.
+// Also checks that short timers still tick, stop, and can be removed from within Idle().
+// No X connection is needed.
+//
+// Usage: timerbench [number of timers]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ timerbench.cc -I/usr/include/freetype2 -llaxkit -lX11 -lXft -lm -lpng -lcups -o timerbench
+
+
+#include <lax/anxapp.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <unistd.h>
+
+using namespace Laxkit;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! Counts ticks. If stop_after>0, returns nonzero from Idle after that many, which removes the timer.
+class Ticker : public EventReceiver
+{
+  public:
+	long ticks;
+	long stop_after;
+	EventReceiver *remove_from; //removetimer(remove_from, remove_timer) on first tick
+	int remove_timer;
+	Ticker(long nstop_after = 0) { ticks = 0; stop_after = nstop_after; remove_from = nullptr; remove_timer = 0; }
+	virtual int Idle(int tid, double delta)
+	{
+		ticks++;
+		if (remove_timer) { anXApp::app->removetimer(remove_from, remove_timer); remove_timer = 0; }
+		return stop_after > 0 && ticks >= stop_after;
+	}
+};
+
+//! Expose the once per event loop pass timer check.
+class TimerApp : public anXApp
+{
+  public:
+	void Pass(timeval *tv) { settimeout(tv); }
+};
+
+int main(int argc, char **argv)
+{
+	int N = (argc > 1 ? atoi(argv[1]) : 10000);
+	if (N < 1) {
+		fprintf(stderr, "Usage: %s [number of timers]\n", argv[0]);
+		return 1;
+	}
+
+	TimerApp *app = new TimerApp;
+	Ticker *idle = new Ticker;
+	std::vector<int> ids;
+	timeval tv;
+	int errors = 0;
+	srand(3);
+
+	 //timers that won't tick during the benchmark, like paused animations
+	double t = now();
+	for (int c=0; c<N; c++) ids.push_back(app->addtimer(idle, 60000 + rand()%20000, 1000 + rand()%5000, -1));
+	double tadd = now() - t;
+
+	int passes = 20000;
+	t = now();
+	for (int c=0; c<passes; c++) app->Pass(&tv);
+	double tpass = now() - t;
+
+	 //remove and add random ones
+	t = now();
+	for (int c=0; c<N; c++) {
+		int i = rand()%N;
+		if (app->removetimer(idle, ids[i]) != 0) errors++;
+		ids[i] = app->addtimer(idle, 60000 + rand()%20000, 1000 + rand()%5000, -1);
+	}
+	double tchurn = now() - t;
+
+	printf("%d timers:\n", N);
+	printf("  addtimer:             %.3f us/timer\n", tadd/N*1e6);
+	printf("  settimeout pass:      %.3f us/pass\n", tpass/passes*1e6);
+	printf("  removetimer+addtimer: %.3f us/timer\n", tchurn/N*1e6);
+
+	 //with all those still active, short timers must behave
+	Ticker *forever = new Ticker;    //ticks until removed by another timer
+	Ticker *limited = new Ticker;    //duration limited
+	Ticker *once    = new Ticker(1); //Idle returns nonzero on first tick
+	Ticker *remover = new Ticker(1); //removes forever's timer
+	int foreverid = app->addtimer(forever, 0, 10, -1);
+	app->addtimer(limited, 0, 10, 150);
+	app->addtimer(once, 0, 10, -1);
+	app->addtimer(remover, 300, 10, -1);
+	remover->remove_from  = forever;
+	remover->remove_timer = foreverid;
+
+	double start = now();
+	while (now() - start < .6) {
+		app->Pass(&tv);
+		 //the next deadline is at most one tick away while short timers run
+		if (forever->ticks == 0 && (tv.tv_sec > 0 || tv.tv_usec > 20000)) errors++;
+		usleep(1000);
+	}
+	long forever_ticks = forever->ticks;
+	for (int c=0; c<50; c++) { app->Pass(&tv); usleep(1000); }
+
+	printf("  ticks: forever %ld, limited %ld, once %ld, remover %ld\n",
+			forever->ticks, limited->ticks, once->ticks, remover->ticks);
+	if (forever->ticks < 10 || forever->ticks != forever_ticks) errors++; //stopped after removal
+	if (limited->ticks < 5 || limited->ticks > 20) errors++;
+	if (once->ticks != 1 || remover->ticks != 1) errors++;
+	if (app->removetimer(forever, foreverid) == 0) errors++; //already gone
+
+	 //remove by id in random order
+	std::shuffle(ids.begin(), ids.end(), std::mt19937(5));
+	t = now();
+	for (int c=0; c<N; c++) if (app->removetimer(idle, ids[c]) != 0) errors++;
+	double tremove = now() - t;
+	printf("  removetimer:          %.3f us/timer\n", tremove/N*1e6);
+
+	app->Pass(&tv);
+	if (tv.tv_sec < 1000) errors++; //no timers left, so no deadline
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+//
+// Stress the anXApp window lookups used to dispatch X events: replay synthetic motion events
+// against a wide and deep window tree, and time findwindow_xlib(), findsubwindow_xlib(),
+// findwindow_by_id() and findEventObj() against a plain walk of the window tree.
+// Also checks the lookups after windows are moved to other parents and after they are deleted.
+// No X connection is needed, windows get made up xlib ids.
+//
+// Usage: windowlookupbench [number of events]
+//
+// After installing the Laxkit, compile this program like this:
+//
+// g++ windowlookupbench.cc -I/usr/include/freetype2 -llaxkit -lX11 -lXft -lm -lpng -lcups -o windowlookupbench
+
+
+#include <lax/anxapp.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+
+using namespace Laxkit;
+
+
+static double now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class LookupWindow;
+
+class LookupApp : public anXApp
+{
+  public:
+	void AddTop(anXWindow *w) { topwindows.push(w); }
+	anXWindow *WalkFind(Window win);
+};
+
+static LookupApp *theapp = nullptr;
+static Window next_xid = 0x400001;
+
+//! A window with a made up xlib id, registered the way anXApp::addwindow() does.
+class LookupWindow : public anXWindow
+{
+  public:
+	LookupWindow(LookupWindow *parent)
+	  : anXWindow(parent, "w","w", 0, 0,0,10,10,0, nullptr,0,nullptr)
+	{
+		app = theapp;
+		xlib_window = next_xid++;
+		win_on = 1;
+		theapp->xlib_windows[xlib_window] = this;
+		if (parent) {
+			parent->_kids.push(this);
+			dec_count(); //parent owns it now, as after anXApp::addwindow()
+		}
+	}
+
+	LookupWindow *Kid(int i) { return (LookupWindow*)_kids.e[i]; }
+
+	 //how lookups worked before the maps, searching every window
+	anXWindow *WalkFind(Window win)
+	{
+		if (xlib_window == win) return this;
+		for (int c=0; c<_kids.n; c++) {
+			anXWindow *found = Kid(c)->WalkFind(win);
+			if (found) return found;
+		}
+		return nullptr;
+	}
+
+	 //what anXApp::reparent() does before telling X
+	void MoveTo(LookupWindow *newparent)
+	{
+		LookupWindow *oldparent = (LookupWindow*)win_parent;
+		inc_count();
+		oldparent->_kids.remove(oldparent->_kids.findindex(this));
+		win_parent = newparent;
+		newparent->_kids.push(this);
+		dec_count();
+	}
+
+	 //deletes kid and its subtree, if nothing else refers to them
+	void Drop(anXWindow *kid) { _kids.remove(_kids.findindex(kid)); }
+};
+
+anXWindow *LookupApp::WalkFind(Window win)
+{
+	for (int c=0; c<topwindows.n; c++) {
+		anXWindow *found = ((LookupWindow*)topwindows.e[c])->WalkFind(win);
+		if (found) return found;
+	}
+	return nullptr;
+}
+
+int main(int argc, char **argv)
+{
+	int N = (argc > 1 ? atoi(argv[1]) : 200000);
+	if (N < 1) {
+		fprintf(stderr, "Usage: %s [number of events]\n", argv[0]);
+		return 1;
+	}
+
+	LookupApp *app = new LookupApp;
+	theapp = app;
+	int errors = 0;
+
+	 //10 panels of 10 groups of 50 controls, and a chain 30 deep
+	std::vector<LookupWindow*> all, panels;
+	LookupWindow *top = new LookupWindow(nullptr);
+	app->AddTop(top);
+	all.push_back(top);
+	for (int a=0; a<10; a++) {
+		LookupWindow *panel = new LookupWindow(top);
+		all.push_back(panel);
+		panels.push_back(panel);
+		for (int b=0; b<10; b++) {
+			LookupWindow *group = new LookupWindow(panel);
+			all.push_back(group);
+			for (int c=0; c<50; c++) all.push_back(new LookupWindow(group));
+		}
+	}
+	LookupWindow *deep = all.back();
+	for (int c=0; c<30; c++) {
+		deep = new LookupWindow(deep);
+		all.push_back(deep);
+	}
+
+	 //motion events over random windows, and some for windows we don't know about
+	srand(1);
+	std::vector<XEvent> events(N);
+	for (int c=0; c<N; c++) {
+		XEvent &e = events[c];
+		e.xmotion.type   = MotionNotify;
+		e.xmotion.window = (c%50 == 0 ? next_xid + 1000 + c : all[rand()%all.size()]->xlib_window);
+		e.xmotion.x = rand()%10;
+		e.xmotion.y = rand()%10;
+	}
+
+	double t = now();
+	long walkfound = 0;
+	for (int c=0; c<N; c++) walkfound += (app->WalkFind(events[c].xany.window) != nullptr);
+	double twalk = now() - t;
+
+	t = now();
+	long found = 0;
+	for (int c=0; c<N; c++) found += (app->findwindow_xlib(events[c].xany.window) != nullptr);
+	double tfind = now() - t;
+
+	int mismatches = 0;
+	for (int c=0; c<N; c+=7) {
+		if (app->findwindow_xlib(events[c].xany.window) != app->WalkFind(events[c].xany.window)) mismatches++;
+	}
+	if (found != walkfound || mismatches) errors++;
+
+	t = now();
+	long subfound = 0;
+	for (int c=0; c<N; c++) subfound += (app->findsubwindow_xlib(panels[0], events[c].xany.window) != nullptr);
+	double tsub = now() - t;
+
+	std::vector<unsigned long> ids(N);
+	for (int c=0; c<N; c++) ids[c] = all[rand()%all.size()]->object_id;
+	t = now();
+	long idfound = 0;
+	for (int c=0; c<N; c++) idfound += (app->findwindow_by_id(ids[c]) != nullptr);
+	double tid = now() - t;
+	t = now();
+	for (int c=0; c<N; c++) idfound += (app->findEventObj(ids[c]) != nullptr);
+	double tobj = now() - t;
+	if (idfound != 2L*N) errors++;
+
+	printf("%d windows, %d motion events, %ld for known windows:\n", (int)all.size(), N, found);
+	printf("  tree walk:          %.3f us/event\n", twalk/N*1e6);
+	printf("  findwindow_xlib:    %.3f us/event  (%.0fx)\n", tfind/N*1e6, twalk/tfind);
+	printf("  findsubwindow_xlib: %.3f us/event  (%ld under the first panel)\n", tsub/N*1e6, subfound);
+	printf("  findwindow_by_id:   %.3f us/lookup\n", tid/N*1e6);
+	printf("  findEventObj:       %.3f us/lookup\n", tobj/N*1e6);
+	if (mismatches) printf("  %d lookups differ from the tree walk\n", mismatches);
+
+	 //move a group to another panel, subwindow lookups must follow
+	LookupWindow *group = panels[0]->Kid(0);
+	LookupWindow *control = group->Kid(0);
+	group->MoveTo(panels[1]);
+	bool moved = app->findwindow_xlib(control->xlib_window) == control
+			  && app->findsubwindow_xlib(panels[0], control->xlib_window) == nullptr
+			  && app->findsubwindow_xlib(panels[1], control->xlib_window) == control
+			  && app->find_subwindow_by_id(panels[1], control->object_id) == control;
+	printf("  lookups after moving a group: %s\n", moved ? "ok" : "FAILED");
+	if (!moved) errors++;
+
+	 //delete that group with its controls
+	Window gone_xid = control->xlib_window;
+	unsigned long gone_id = control->object_id;
+	anXApp::app = app; //so destructors remove themselves from the maps
+	panels[1]->Drop(group);
+	bool dropped = app->findwindow_xlib(gone_xid) == nullptr
+				&& app->findwindow_by_id(gone_id) == nullptr
+				&& app->findEventObj(gone_id) == nullptr
+				&& app->findwindow_xlib(deep->xlib_window) == deep;
+	printf("  lookups after deleting a group: %s\n", dropped ? "ok" : "FAILED");
+	if (!dropped) errors++;
+
+	printf("%s\n", errors ? "FAILED" : "ok");
+	return errors ? 1 : 0;
+}
@@ -139,16 +139,16 @@ void anObject::touchContents()
  */
 int anObject::inc_count()
 {
-	_count++;
+	int c = ++_count;
 
 	DBG if (CHECK > 0 && object_id == CHECK) {
 	DBG 	cerr <<object_id<<" inc_count Agh!"<<endl;
 	DBG }
 	DBG if (!suppress_debug) {
-	DBG   cerr <<"refcounted anobject inc count, now: "<<_count<<endl;
-	DBG   cerr<<whattype()<<" "<<object_id<<" inc counted: "<<_count<<"  "<<(object_idstr?object_idstr:"(?)")<<endl;
+	DBG   cerr <<"refcounted anobject inc count, now: "<<c<<endl;
+	DBG   cerr<<whattype()<<" "<<object_id<<" inc counted: "<<c<<"  "<<(object_idstr?object_idstr:"(?)")<<endl;
 	DBG }
-	return _count; 
+	return c;
 }
 
 //! Decrement the count of the data, deleting if count is less than or equal to 0.
@@ -159,22 +159,23 @@ int anObject::inc_count()
  */
 int anObject::dec_count()
 {
-	_count--;
+	 //other threads might delete this as soon as the count goes down, so say so first
 	DBG if (!suppress_debug) {
-	DBG   cerr <<"refcounted anobject "<<object_id<<" dec count, now: "<<_count<<(_count==0?", deleting":"")<<endl;
-	DBG   cerr<<(whattype() ? whattype() : "(no whattype)")<<" "<<object_id<<" dec counted: "<<_count<<"  "<<(object_idstr?object_idstr:"(?)")<<endl;
+	DBG   int c = _count-1;
+	DBG   cerr <<"refcounted anobject "<<object_id<<" dec count, now: "<<c<<(c==0?", deleting":"")<<endl;
+	DBG   cerr<<(whattype() ? whattype() : "(no whattype)")<<" "<<object_id<<" dec counted: "<<c<<"  "<<(object_idstr?object_idstr:"(?)")<<endl;
 	DBG }
 	DBG if (CHECK > 0 && object_id == CHECK) {
 	DBG 	cerr <<object_id<<" inc_count Agh!"<<endl;
 	DBG }
 
-	if (_count<=0) {
+	int c = --_count;
+	if (c<=0) {
 		int yesdelete=1;
-		int c=_count;
 		if (yesdelete) delete this;
 		return c;
 	}
-	return _count; 
+	return c;
 }
 
 /*! Return the id of the object. If NULL, then create a default one and return that.
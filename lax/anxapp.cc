@@ -22,8 +22,10 @@
 
 
 #include <fstream>
+#include <algorithm>
 #include <unistd.h>
 #include <sys/select.h>
+#include <sys/eventfd.h>
 #include <fcntl.h>
 #include <cerrno>
 
@@ -191,6 +193,8 @@ TimerInfo::TimerInfo(EventReceiver *nwin,int duration,int firstt,int tickt,int n
 	win=nwin;
 	id=nid;
 	info=ninfo;
+	heap_index=-1;
+	removed=false;
 	if (tickt<=0) tickt=100;
 	tms tms_;
 	clock_t curtime = times(&tms_);
@@ -253,6 +257,134 @@ int TimerInfo::checktime(clock_t tm)
 }
 
 
+//! Whether the next tick would be after endtime.
+bool TimerInfo::expired()
+{
+	return endtime != -1 && nexttime > endtime;
+}
+
+
+//-------------------------- TimerQueue ----------------------------------------
+/*! \class TimerQueue
+ * \brief Storage for anXApp timers.
+ *
+ * Timers are kept in a binary min-heap on TimerInfo::nexttime, so the next deadline is
+ * always Top(), and adding or removing is O(log n). There is also a map from timer id,
+ * for removetimer() and modifytimer().
+ *
+ * While a timer's Idle() is being called, anXApp::settimeout() Detach()es it from the heap.
+ * If it is Remove()'d during that time, it is only flagged as removed, and the caller of
+ * Detach() is responsible for deleting it.
+ */
+
+TimerQueue::~TimerQueue()
+{
+	Flush();
+}
+
+void TimerQueue::Flush()
+{
+	for (auto &it : ids) delete it.second;
+	ids.clear();
+	heap.clear();
+}
+
+TimerInfo *TimerQueue::Find(int id)
+{
+	auto it = ids.find(id);
+	if (it == ids.end()) return nullptr;
+	return it->second;
+}
+
+void TimerQueue::swap(int a, int b)
+{
+	TimerInfo *t = heap[a];
+	heap[a] = heap[b];
+	heap[b] = t;
+	heap[a]->heap_index = a;
+	heap[b]->heap_index = b;
+}
+
+void TimerQueue::siftup(int i)
+{
+	while (i > 0) {
+		int parent = (i-1)/2;
+		if (!earlier(i, parent)) break;
+		swap(i, parent);
+		i = parent;
+	}
+}
+
+void TimerQueue::siftdown(int i)
+{
+	int num = heap.size();
+	while (1) {
+		int child = 2*i+1;
+		if (child >= num) break;
+		if (child+1 < num && earlier(child+1, child)) child++;
+		if (!earlier(child, i)) break;
+		swap(i, child);
+		i = child;
+	}
+}
+
+//! Add a new timer. The queue takes possession of timer.
+void TimerQueue::Push(TimerInfo *timer)
+{
+	ids[timer->id] = timer;
+	Reinsert(timer);
+}
+
+//! Put a Detach()'d timer back in the heap, such as after its nexttime changes.
+void TimerQueue::Reinsert(TimerInfo *timer)
+{
+	timer->heap_index = heap.size();
+	heap.push_back(timer);
+	siftup(timer->heap_index);
+}
+
+//! Take timer out of the heap, but still keep it findable by id.
+void TimerQueue::Detach(TimerInfo *timer)
+{
+	int i = timer->heap_index;
+	if (i < 0) return;
+
+	int last = heap.size()-1;
+	if (i != last) {
+		swap(i, last);
+		heap.pop_back();
+		siftdown(i);
+		siftup(i);
+	} else heap.pop_back();
+	timer->heap_index = -1;
+}
+
+//! Remove and delete timer, or just flag it as removed if it is currently detached.
+/*! Return 0 for success, or 1 for not found.
+ */
+int TimerQueue::Remove(TimerInfo *timer)
+{
+	auto it = ids.find(timer->id);
+	if (it == ids.end() || it->second != timer) return 1;
+	ids.erase(it);
+
+	if (timer->heap_index >= 0) {
+		Detach(timer);
+		delete timer;
+	} else timer->removed = true;
+	return 0;
+}
+
+//! Remove all timers for which which(timer) returns true. Return the number removed.
+int TimerQueue::RemoveIf(std::function<bool (TimerInfo *timer)> which)
+{
+	std::vector<TimerInfo*> toremove;
+	for (auto &it : ids) if (which(it.second)) toremove.push_back(it.second);
+	for (unsigned int c=0; c<toremove.size(); c++) Remove(toremove[c]);
+	return toremove.size();
+}
+
+
 //-------------------------- aDrawable ----------------------------------------
 /*! \class aDrawable
  * \brief Class to facilitate various double buffer and in-memory pixmap rendering.
@@ -326,8 +458,8 @@ anXApp *anXApp::app=NULL;
  * Windows are pushed onto here from destroywindow(), and they are actually deleted
  * from destroyqueued().
  */
-/*! \var PtrStack<TimerInfo> anXApp::timers
- * \brief Stack of timers.
+/*! \var TimerQueue anXApp::timers
+ * \brief Active timers, in a heap ordered by next tick time.
  */
 
 /*! \var int anXApp::tooltips
@@ -479,6 +611,12 @@ anXApp::anXApp()
 	donotusex     = false;
 	devicemanager = nullptr;
 	maxtimeout    = 0;  // override timeout when bump() doesn't work. microseconds
+	fdwatch_depth = 0;
+	refresh_pass  = 0;
+
+	 //written to by SendMessage() and bump() to break run() out of select()
+	bump_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (bump_fd < 0) { DBG cerr << "could not create bump eventfd, falling back to X bump"<<endl; }
 
 	default_language = newstr("");
 
@@ -555,6 +693,7 @@ anXApp::~anXApp()
 	if (screeninfo) delete screeninfo;
 
 	pthread_mutex_destroy(&event_mutex);
+	if (bump_fd >= 0) ::close(bump_fd);
 
 	if (anXApp::app == this) anXApp::app = nullptr;
 }
@@ -1126,6 +1265,9 @@ int anXApp::close()
 		}
 #endif //_LAX_PLATFORM_XLIB
 	}
+#ifdef _LAX_PLATFORM_XLIB
+	xlib_windows.clear();
+#endif //_LAX_PLATFORM_XLIB
 
 	dialogs.flush();
 
@@ -1437,6 +1579,7 @@ void anXApp::resetkids(anXWindow *w)
 	GetDefaultDisplayer()->ClearDrawable(w);
 
 #ifdef _LAX_PLATFORM_XLIB
+	xlib_ForgetWindow(w);
 	w->xlib_backbuffer = 0;
 	w->xlib_window = 0;
 #endif //_LAX_PLATFORM_XLIB
@@ -1491,10 +1634,10 @@ int anXApp::destroywindow(anXWindow *w)
 	if (c>=0) dialogs.pop(c); // dialog is always a toplevel window
 
 	 //remove all timers associated with w and its children
-	for (int c=0; c<timers.n; c++) {
-		if (dynamic_cast<anXWindow*>(timers.e[c]->win)==w || IsWindowChild(w,dynamic_cast<anXWindow*>(timers.e[c]->win)))
-			{ timers.remove(c); c--; }
-	}
+	timers.RemoveIf([w](TimerInfo *timer) {
+			anXWindow *win = dynamic_cast<anXWindow*>(timer->win);
+			return win==w || IsWindowChild(w,win);
+		});
 
 
 	 // cannot delete w here, since this function is most likely called from within w, must stack to delete
@@ -1753,64 +1896,45 @@ int eventscreen(int e_type,unsigned long mask)
  */
 int anXApp::RegisterEventReceiver(EventReceiver *ev)
 {
-	int s=0, e=eventreceivers.n-1, m;
-
-	if (eventreceivers.n==0) { eventreceivers.push(ev,0); return 0; }
-
-	 //push sorted by object id for easy binary search later
-	if (ev->object_id<eventreceivers.e[0]->object_id) { eventreceivers.push(ev,0,0); return 0; }
-	if (ev->object_id>eventreceivers.e[e]->object_id) { eventreceivers.push(ev,0,-1); return 0; }
-	if (ev->object_id==eventreceivers.e[0]->object_id || ev->object_id==eventreceivers.e[e]->object_id)
-		return 0; //already there!
-
-	while (s!=e) {
-		m=(s+e)/2;
-		 //s and e have already been checked against
-		if (m==s || m==e) { eventreceivers.push(ev,0,s+1); return 0; }
-
-		if (ev->object_id==eventreceivers.e[m]->object_id) return 0; //already there!
-		if (ev->object_id<eventreceivers.e[m]->object_id) { e=m; continue; }
-		s=m;
-	}
-
+	eventreceivers.emplace(ev->object_id, ev); //does nothing if already there
 	return 0;
 }
 
+/*! Return 1 if e was removed, else 0.
+ */
 int anXApp::UnregisterEventReceiver(EventReceiver *e)
 {
 	removetimer(e,0);
-	return eventreceivers.remove(eventreceivers.findindex(e));
+	auto it = eventreceivers.find(e->object_id);
+	if (it == eventreceivers.end() || it->second != e) return 0;
+	eventreceivers.erase(it);
+	return 1;
 }
 
-//! Return the object with id in eventreceivers stack.
+//! Return the object with id in eventreceivers.
 EventReceiver *anXApp::findEventObj(unsigned long id)
 {
-	int s=0, e=eventreceivers.n-1, m=0;
-	if (e<0) return NULL;
-
-	if (eventreceivers.e[s]->object_id==id) return eventreceivers.e[s];
-	if (eventreceivers.e[e]->object_id==id) return eventreceivers.e[e];
-
-	if (eventreceivers.e[s]->object_id>id) return NULL;
-	if (eventreceivers.e[e]->object_id<id) return NULL;
-
-	while (s<e) {
-		m=(s+e)/2;
-		if (eventreceivers.e[m]->object_id==id) return eventreceivers.e[m];
-
-		if (eventreceivers.e[m]->object_id>id) e=m;
-		else if (s==m) break;
-		else s=m;
-	}
-	return NULL;
+	auto it = eventreceivers.find(id);
+	if (it == eventreceivers.end()) return NULL;
+	return it->second;
 }
 
 //! Force dealing with any pending messages.
 /*! Sometimes messages sent via SendMessage() do not also make the application actually deal
  * with those messages.
+ *
+ * This writes to bump_fd, an eventfd that run() always includes in its select(), so it is safe
+ * to call from any thread. If the eventfd could not be created, then fall back to sending
+ * an X ClientMessage to bump_xid.
  */
 void anXApp::bump()
 {
+	if (bump_fd >= 0) {
+		uint64_t one = 1;
+		if (write(bump_fd, &one, sizeof(one)) == sizeof(one) || errno == EAGAIN) return;
+		 //EAGAIN means the counter is saturated, which still wakes select()
+	}
+
 #ifdef _LAX_PLATFORM_XLIB
 	if (!bump_xid || !dpy) return;
 
@@ -1824,20 +1948,14 @@ void anXApp::bump()
 	XSendEvent(dpy,bump_xid,False,0,&e);
 	XUnlockDisplay(dpy);
 #endif //_LAX_PLATFORM_XLIB
+}
 
-
-// **** This below doesn't work, I don't know how to make a file descriptor that breaks select():
-//	if (bump_fd<=0) {
-//		char path[200];
-//		sprintf(path,"/tmp/.lax-%d",getpid());
-//		bump_fd=open(path,O_RDWR|O_CREAT, S_IRUSR|S_IWUSR);
-//		//unlink(path);
-//	}
-//
-//	 //bump_fd is added to the fds that select() monitors, thus this will break it out of just waiting around
-//	DBG cerr <<"bumping..."<<endl;
-//	write(bump_fd,"0",1);
-//	lseek(bump_fd,0,SEEK_SET);
+//! Reset the bump_fd counter after select() says it is readable.
+void anXApp::clearbump()
+{
+	if (bump_fd < 0) return;
+	uint64_t count;
+	while (read(bump_fd, &count, sizeof(count)) > 0) ;
 }
 
 
@@ -1874,7 +1992,9 @@ void anXApp::ThemeReconfigure(Theme *theme)
  * processdataevents(). If the target window does not exist at that time, the data is
  * deleted.
  *
- * Messages are recorded in a thread safe way with event_mutex.
+ * Messages are recorded in a thread safe way with event_mutex, so this may be called from
+ * worker threads. When the queue was empty, bump() is called so that run() wakes up to
+ * deliver the message right away, instead of waiting for the next X event or timer.
  */
 int anXApp::SendMessage(EventData *data, unsigned long toobj, const char *mes, unsigned long fromobj)//mes=0, sendwindow=0
 {
@@ -1888,6 +2008,7 @@ int anXApp::SendMessage(EventData *data, unsigned long toobj, const char *mes, u
 
 	pthread_mutex_lock(&event_mutex);
 
+	bool wasempty = (dataevents == nullptr);
 	if (dataevente) {
 		dataevente->next=data;
 		dataevente=data;
@@ -1897,6 +2018,8 @@ int anXApp::SendMessage(EventData *data, unsigned long toobj, const char *mes, u
 
 	pthread_mutex_unlock(&event_mutex);
 
+	if (wasempty) bump();
+
 	//DBG cerr <<" ***** anXApp queued message: "<<(data->send_message?data->send_message:lax_event_name(data->type))<<endl;
 
 	return 0;
@@ -2318,6 +2441,7 @@ int anXApp::addwindow(anXWindow *w,char mapit,char absorb_count) // mapit==1, ab
 		return 1;
 	}
 	w->xlib_window=win;
+	xlib_windows[win] = w;
 	DBG cerr <<"addwindow  window XCreated: \""<<w->WindowTitle()<<"\" = "<<w->xlib_window<<endl;
 
 
@@ -2510,6 +2634,7 @@ int anXApp::addwindow(anXWindow *w,char mapit,char absorb_count) // mapit==1, ab
 	if (mapit) {
 		XMapWindow(dpy,w->xlib_window);
 		w->win_on=1;
+		if (w->Needtodraw()) QueueRefresh(w);
 
 //		// ------------------- test extents....
 //		*** sometimes this will return 0s, but still claim success.. maybe delay in time to map tweaks it?
@@ -2547,68 +2672,66 @@ int anXApp::addwindow(anXWindow *w,char mapit,char absorb_count) // mapit==1, ab
 }
 
 //! Find the anXWindow having the given object_id.
+/*! This is a hash lookup in eventreceivers. Only windows that have been addwindow()'d
+ * and not destroyed are returned.
+ */
 anXWindow *anXApp::findwindow_by_id(unsigned long id)
 {
 	if (id==0) return NULL;
-	anXWindow *ww=NULL;
-	for (int c=0; c<topwindows.n; c++) {
-		if (id==topwindows.e[c]->object_id) return topwindows.e[c];
-		ww=find_subwindow_by_id(topwindows.e[c],id);
-		if (ww) return ww;
-	}
-	return NULL;
+	anXWindow *ww = dynamic_cast<anXWindow*>(findEventObj(id));
+	if (!ww || (ww->win_style & ANXWIN_DOOMED)) return NULL;
+#ifdef _LAX_PLATFORM_XLIB
+	if (!ww->xlib_window) return NULL;
+#endif //_LAX_PLATFORM_XLIB
+	return ww;
 }
 
 //! Find the anXWindow having id, and ancestor w
-/*! called from a loop over topwindows in run.
- *
- * Perhaps this should be a window function?
+/*! Same as findwindow_by_id(), but also make sure the window is w or a descendent of w.
  */
 anXWindow *anXApp::find_subwindow_by_id(anXWindow *w,unsigned long id)
 {
+	if (!w) return NULL;
 	if (w->object_id==id) return w;
-	anXWindow *ww=NULL;
-	for (int c=0; c<w->_kids.n; c++) {
-		ww=find_subwindow_by_id(w->_kids.e[c],id);
-		if (ww) return ww;
-	}
+	anXWindow *ww = findwindow_by_id(id);
+	if (ww && IsWindowChild(w,ww)) return ww;
 	return NULL;
 }
 
 
 #ifdef _LAX_PLATFORM_XLIB
 //! Find the anXWindow having win, and ancestor w
-/*! called from a loop over topwindows in run.
- *
- * Perhaps this should be a window function?
+/*! Same as findwindow_xlib(), but also make sure the window is w or a descendent of w.
  */
 anXWindow *anXApp::findsubwindow_xlib(anXWindow *w,Window win)
 {
 	if (!w) return NULL;
 	if (w->xlib_window==win) return w;
-	anXWindow *ww=NULL;
-	for (int c=0; c<w->_kids.n; c++) {
-		ww=findsubwindow_xlib(w->_kids.e[c],win);
-		if (ww) return ww;
-	}
+	anXWindow *ww = findwindow_xlib(win);
+	if (ww && IsWindowChild(w,ww)) return ww;
 	return NULL;
 }
 
 //! Find the anXWindow associated with Window win.
 /*! This can be used by anyone to search all the windows that
- *  anXApp knows about, which are the top level windows, and all
- *  child windows in the anXWindow::_kids stacks.
+ *  anXApp knows about. Windows are added to the xlib_windows map when they
+ *  are created in addwindow(), and removed when they are destroyed, so this is a
+ *  hash lookup rather than a search through all the windows.
  */
 anXWindow *anXApp::findwindow_xlib(Window win)
 {
 	if (win==0) return NULL;
-	anXWindow *ww=NULL;
-	for (int c=0; c<topwindows.n; c++) {
-		if (win==topwindows.e[c]->xlib_window) return topwindows.e[c];
-		ww=findsubwindow_xlib(topwindows.e[c],win);
-		if (ww) return ww;
-	}
-	return NULL;
+	auto it = xlib_windows.find(win);
+	if (it == xlib_windows.end()) return NULL;
+	return it->second;
+}
+
+//! Remove w from the xlib_windows lookup map.
+void anXApp::xlib_ForgetWindow(anXWindow *w)
+{
+	if (!w->xlib_window) return;
+	auto it = xlib_windows.find(w->xlib_window);
+	if (it != xlib_windows.end() && it->second == w) xlib_windows.erase(it);
 }
 #endif //_LAX_PLATFORM_XLIB
 
@@ -2633,35 +2756,28 @@ void anXApp::settimeout(struct timeval *timeout)
 		timeout->tv_sec=2000000000;
 		timeout->tv_usec=0;
 	}
-	if (timers.n==0 && tooltipmaybe.n==0) return;
+	if (timers.n()==0 && tooltipmaybe.n==0) return;
 
 	clock_t currenttime;
 	clock_t earliest=0;
 	currenttime=times(&tmsstruct); // get current time
-    int tid;
-
-	for (int c=0; c<timers.n; c++) {
-        tid = timers.e[c]->id;
-		if (timers.e[c]->checktime(currenttime) < 0) {  //this calls Idle if necessary
-            if (c >= timers.n || tid != timers.e[c]->id) {
-                //likely a window removetimer()'d during Idle, we catch here to be nice to sloppy devs
-                c--;
-                continue;
-            }
-			DBG cerr <<"remove timer (expired) "<<c<<", id: "<<timers.e[c]->id<<endl;
-			timers.remove(c);
-            c--;
-            continue;
+
+	 //only timers at the top of the heap can be due
+	TimerInfo *timer;
+	while ((timer = timers.Top()) != nullptr && timer->nexttime <= currenttime) {
+		timers.Detach(timer);
+		int status = timer->checktime(currenttime); //this calls Idle
+		if (!timer->removed && status >= 0) {
+			timers.Reinsert(timer);
+			continue;
 		}
-        if (c >= timers.n || tid != timers.e[c]->id) {
-            //likely a window removetimer()'d during Idle, we catch here to be nice to sloppy devs
-            c--;
-            continue;
-        }
-
-		if (c==0) earliest=timers.e[0]->nexttime;
-		if (timers.e[c]->nexttime<earliest) earliest=timers.e[c]->nexttime;
+
+		 //expired, or removetimer()'d during Idle
+		DBG cerr <<"remove timer (expired) id: "<<timer->id<<endl;
+		if (!timer->removed) timers.Remove(timer);
+		delete timer;
 	}
+	if (timers.Top()) earliest = timers.Top()->nexttime;
 
 
 	 // tooltip timer, update earliest against possibly many tooltips to pop up...
@@ -2722,8 +2838,8 @@ void anXApp::newToolTip(const char *text,int mouseid, anXWindow *ttwindow)
  *
  * Return 0 for successful run. Return nonzero for unsuccessful, such as when dpy==NULL.
  *
- * \todo must implement other file descriptor input for the call to select. This will allow listening for
- *   unusual input sources like wiimotes or socket communication..
+ * Besides the X connection, select() also watches bump_fd, so messages from SendMessage() in other
+ * threads are dispatched right away, and any file descriptors added with AddFdWatch().
  */
 int anXApp::run()
 {
@@ -2780,8 +2896,7 @@ int anXApp::run()
 		 //immediately pending, and all events processed?
 		 // refresh is recursive loops on the specified window
 		if (anytodraw) {
-			anytodraw=0;
-			for (c=0; c<topwindows.n; c++) anytodraw+=refresh(topwindows.e[c]);
+			anytodraw = refreshdirty();
 			//DBG cerr <<"anytodraw:"<<anytodraw<<endl;
 		}
 		XSync(dpy,False);
@@ -2790,39 +2905,40 @@ int anXApp::run()
 
 		if (dontstop==0 || topwindows.n==0) { dontstop=0; break; }
 
-		 //---- Wait for events or timers
+		 //---- Wait for events, timers, bump_fd, or fdwatches
 		 // man select and select_tut for what this does..
-		 // Currently, just monitors the X channel, later add support for arbitrary fds?
-		 // like an object event pipe?
 		 //
 		 //It is necessary to check for pending here, because anything above might have triggered
 		 //a send event, for instance, and the event will already be pending, but it will not cause
 		 //the X file descriptor to change state..
-		if (!dataevents && !XPending(dpy) && !anytodraw && !todelete.how_many()) {
+		bool wait = (!dataevents && !XPending(dpy) && !anytodraw && !todelete.how_many());
+		if (wait || fdwatches.n) {
 			FD_ZERO(&fdset[0]);
 			FD_ZERO(&fdset[1]);
 			FD_ZERO(&fdset[2]);
+			maxfd = xlibfd;
 			FD_SET(xlibfd,&fdset[0]);
-//			if (bump_fd>0) {
-//				FD_SET(bump_fd,&fdset[0]);
-//				if (bump_fd>maxfd) maxfd=bump_fd;
-//			}
+			if (bump_fd >= 0) {
+				FD_SET(bump_fd,&fdset[0]);
+				if (bump_fd > maxfd) maxfd = bump_fd;
+			}
+			for (c=0; c<fdwatches.n; c++) {
+				if (fdwatches.e[c]->what & LAX_FD_Read)  FD_SET(fdwatches.e[c]->fd, &fdset[0]);
+				if (fdwatches.e[c]->what & LAX_FD_Write) FD_SET(fdwatches.e[c]->fd, &fdset[1]);
+				if (fdwatches.e[c]->fd > maxfd) maxfd = fdwatches.e[c]->fd;
+			}
 			//if (devicemanager && devicemanager->hasFD()) devicemanager->Setfd(&fdset[0],&maxfd);
 
-			//DBG timeout.tv_sec=1;
-			//DBG cerr <<"entering select...."<<endl;
-			//settimeout(&timeout);//****this is done above now
+			 //when there is other work pending, only poll the watched fds
+			if (!wait) { timeout.tv_sec = 0; timeout.tv_usec = 0; }
+
 			//int select(int n, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
 			c=select(maxfd+1, &fdset[0], &fdset[1], &fdset[2], &timeout);
 
-//			if (FD_ISSET(bump_fd,&fdset[0])) {
-//				 //clear the bump file
-//				DBG cerr <<"*** clearing bump"<<endl;
-//				//char buffer[100];
-//				//while (read(bump_fd,buffer,100)>0) ;
-//				ftruncate(bump_fd,0);
-//			}
-
+			if (c > 0) {
+				if (bump_fd >= 0 && FD_ISSET(bump_fd,&fdset[0])) clearbump();
+				if (fdwatches.n) processfdwatches(&fdset[0], &fdset[1]);
+			}
 			//if (c<0) perror("select returned error: ");
 		}
 
@@ -2832,6 +2948,79 @@ int anXApp::run()
 	return 0;
 }
 
+//! Watch fd for readability and/or writability from within run().
+/*! what is a mask of LAX_FD_Read and LAX_FD_Write. When select() says fd is ready, callback(fd, what)
+ * is called from run() in the main thread, with what set to whichever of those is ready.
+ * The callback may call AddFdWatch() or RemoveFdWatch(), including on its own fd.
+ *
+ * If fd is already watched, its flags and callback are replaced.
+ *
+ * Return 0 for success, or nonzero for bad fd or flags. fd must be less than FD_SETSIZE.
+ * This must be called from the main thread.
+ */
+int anXApp::AddFdWatch(int fd, int what, FdWatchCallback callback)
+{
+	if (fd < 0 || fd >= FD_SETSIZE) return 1;
+	if (!(what & (LAX_FD_Read | LAX_FD_Write)) || !callback) return 2;
+
+	for (int c=0; c<fdwatches.n; c++) {
+		if (fdwatches.e[c]->fd == fd && !fdwatches.e[c]->removed) {
+			fdwatches.e[c]->what = what;
+			fdwatches.e[c]->callback = callback;
+			return 0;
+		}
+	}
+	fdwatches.push(new FdWatch(fd, what, callback), 1);
+	return 0;
+}
+
+//! Stop watching fd. The fd is not closed.
+/*! Return 0 for removed, or 1 for not found.
+ * This must be called from the main thread.
+ */
+int anXApp::RemoveFdWatch(int fd)
+{
+	for (int c=0; c<fdwatches.n; c++) {
+		if (fdwatches.e[c]->fd != fd || fdwatches.e[c]->removed) continue;
+
+		 //callbacks are being run, so only mark it, processfdwatches() removes it afterwards
+		if (fdwatch_depth) fdwatches.e[c]->removed = true;
+		else fdwatches.remove(c);
+		return 0;
+	}
+	return 1;
+}
+
+//! Call the callbacks of any fdwatches that select() said are ready.
+/*! Return the number of callbacks called.
+ */
+int anXApp::processfdwatches(fd_set *readfds, fd_set *writefds)
+{
+	int n = 0;
+	int num = fdwatches.n; //ignore any watches added by callbacks until the next select()
+
+	fdwatch_depth++;
+	for (int c=0; c<num; c++) {
+		FdWatch *w = fdwatches.e[c];
+		if (w->removed) continue;
+
+		int what = 0;
+		if ((w->what & LAX_FD_Read)  && FD_ISSET(w->fd, readfds))  what |= LAX_FD_Read;
+		if ((w->what & LAX_FD_Write) && FD_ISSET(w->fd, writefds)) what |= LAX_FD_Write;
+		if (!what) continue;
+
+		FdWatchCallback callback = w->callback; //in case the callback replaces itself
+		callback(w->fd, what);
+		n++;
+	}
+	fdwatch_depth--;
+
+	if (!fdwatch_depth) {
+		for (int c=fdwatches.n-1; c>=0; c--) if (fdwatches.e[c]->removed) fdwatches.remove(c);
+	}
+	return n;
+}
+
 //void anXApp::processTimers()
 //{}
 
@@ -3236,9 +3425,11 @@ int anXApp::addtimer(EventReceiver *win, //!< The window to create the timer for
 	if (!win) return 0;
 	//TimerInfo(anXWindow *nwin,int duration,int firstt,int tickt,int nid,long ninfo);
 	int nid=getUniqueNumber();
-	timers.push(new TimerInfo(win,duration,strt,next,nid,0));
+	TimerInfo *timer = new TimerInfo(win,duration,strt,next,nid,0);
+	if (timer->expired()) delete timer; //would never tick
+	else timers.Push(timer);
 
-	DBG cerr <<"addtimer: "<<win->object_id<<"  id:"<<nid<<"  duration:"<<duration<<"  next:"<<next<< " ms"<<"   numtimers="<<timers.n<<endl;
+	DBG cerr <<"addtimer: "<<win->object_id<<"  id:"<<nid<<"  duration:"<<duration<<"  next:"<<next<< " ms"<<"   numtimers="<<timers.n()<<endl;
 	return nid;
 }
 
@@ -3251,13 +3442,13 @@ int anXApp::modifytimer(EventReceiver *win, int timerid,int next,int duration)
 {
 	if (!win) return 0;
 
-	for (int c=0; c<timers.n; c++) {
-		if (win == timers.e[c]->win && timerid == timers.e[c]->id) {
-			timers.e[c]->Update(next, duration);
-			return 0;
-		}
-	}
-	return -1;
+	TimerInfo *timer = timers.Find(timerid);
+	if (!timer || timer->win != win) return -1;
+
+	 //Update() does not change nexttime, so heap order is unaffected
+	timer->Update(next, duration);
+	if (timer->expired()) timers.Remove(timer);
+	return 0;
 }
 
 //! This removes a timer manually.
@@ -3266,21 +3457,20 @@ int anXApp::modifytimer(EventReceiver *win, int timerid,int next,int duration)
  *  timers here.
  *
  * If timerid==0, then remove any timer of w.
+ *
+ * Return 0 for success, or 1 for no such timer.
  */
 int anXApp::removetimer(EventReceiver *w,int timerid)
 {
-	int c;
-	for (c=0; c<timers.n; c++) {
-		if (w==timers.e[c]->win) {
-			if (timerid>0 && timerid==timers.e[c]->id) break;
-			if (!timerid) { timers.remove(c); c--; }
-		}
+	if (!timerid) {
+		return timers.RemoveIf([w](TimerInfo *timer) { return timer->win == w; }) ? 0 : 1;
 	}
 
-	if (c>=timers.n) return 1;
-	DBG cerr <<"remove timer:"<<timerid<<endl;
-	timers.remove(c);
+	TimerInfo *timer = timers.Find(timerid);
+	if (!timer || timer->win != w) return 1;
 
+	DBG cerr <<"remove timer:"<<timerid<<endl;
+	timers.Remove(timer);
 	return 0;
 }
 
@@ -3311,8 +3501,9 @@ void anXApp::idle(anXWindow *w)
 }
 
 //! Handles refreshing for window w and its children.
-/*! Called from a loop over topwindows in run. Calls w->Refresh() only
+/*! Calls w->Refresh() only
  * if (w->Needtodraw() && w->win_on). The window must clear needtodraw itself.
+ * This walks the whole tree of windows. run() uses refreshdirty() instead.
  *
  * Returns the number of windows saying they still need to be refreshed.
  */
@@ -3322,7 +3513,8 @@ int anXApp::refresh(anXWindow *w)
 	int n=0;
 	if (w->Needtodraw() && w->win_on) {
 		w->Refresh();
-		if (w->Needtodraw()) {
+		if (!w->Needtodraw()) w->ClearDamage();
+		else {
 			DBG cerr <<"Needs to draw: "<<w->WindowTitle()<<" child of "<<(w->win_parent?w->win_parent->WindowTitle():"null")
 			DBG      <<" index: "<<(w->win_parent?w->win_parent->_kids.findindex(w):-1)<<"  "<<w->whattype()<<endl;
 			n++;
@@ -3333,6 +3525,102 @@ int anXApp::refresh(anXWindow *w)
 }
 
 
+//! Add w to the list of windows to check in refreshdirty().
+/*! This is called automatically whenever anXWindow::needtodraw is set to something nonzero,
+ * and when a window gets mapped.
+ */
+void anXApp::QueueRefresh(anXWindow *w)
+{
+	if (!w || w->refresh_queued) return;
+	w->refresh_queued = true;
+	dirtywindows.push_back(w);
+}
+
+//! Remove w from the refresh lists. Called from the anXWindow destructor.
+void anXApp::DequeueRefresh(anXWindow *w)
+{
+	for (unsigned int c=0; c<dirtywindows.size(); c++) {
+		if (dirtywindows[c] == w) { dirtywindows.erase(dirtywindows.begin()+c); break; }
+	}
+	for (unsigned int c=0; c<refreshing.size(); c++) {
+		if (refreshing[c] == w) refreshing[c] = nullptr;
+	}
+	w->refresh_queued = false;
+}
+
+//! Refresh only the windows in dirtywindows, parents before children.
+/*! Windows that are not mapped are dropped from the list. They are queued again when mapped.
+ * Windows whose Needtodraw() depends on more than their own needtodraw, such as ViewportWindow
+ * with its interfaces, rely on those other things queueing the window, as
+ * LaxInterfaces::anInterface::needtodraw does.
+ *
+ * Windows that get queued by another window's Refresh() are drawn in the same pass, as they
+ * would be in a full tree walk. Each window is refreshed at most once per pass.
+ *
+ * Returns the number of windows saying they still need to be refreshed.
+ */
+int anXApp::refreshdirty()
+{
+	if (dirtywindows.empty()) return 0;
+
+	int n = 0;
+	refresh_pass++;
+	std::vector<anXWindow*> keep;
+	std::vector<std::pair<int,anXWindow*>> sorted;
+
+	while (!dirtywindows.empty()) {
+		 //sort by depth, so parents are drawn before kids
+		sorted.clear();
+		for (unsigned int c=0; c<dirtywindows.size(); c++) {
+			anXWindow *w = dirtywindows[c];
+			int depth = 0;
+			for (anXWindow *p = w->win_parent; p; p = p->win_parent) depth++;
+			sorted.push_back(std::pair<int,anXWindow*>(depth, w));
+		}
+		dirtywindows.clear();
+		std::stable_sort(sorted.begin(), sorted.end(),
+				[](const std::pair<int,anXWindow*> &a, const std::pair<int,anXWindow*> &b) { return a.first < b.first; });
+
+		refreshing.clear();
+		for (unsigned int c=0; c<sorted.size(); c++) refreshing.push_back(sorted[c].second);
+
+		for (unsigned int c=0; c<refreshing.size(); c++) {
+			anXWindow *w = refreshing[c];
+			if (!w) continue; //was deleted
+
+			if (w->refresh_pass == refresh_pass) {
+				 //already drawn this pass, check again next time
+				keep.push_back(w);
+				continue;
+			}
+			w->refresh_pass = refresh_pass;
+
+			if (!w->win_on || (w->win_style & ANXWIN_DOOMED)) {
+				w->refresh_queued = false;
+				continue;
+			}
+
+			if (w->Needtodraw()) {
+				w->Refresh();
+				if (!w->Needtodraw()) w->ClearDamage();
+				else {
+					DBG cerr <<"Needs to draw: "<<w->WindowTitle()<<" child of "<<(w->win_parent?w->win_parent->WindowTitle():"null")
+					DBG      <<" index: "<<(w->win_parent?w->win_parent->_kids.findindex(w):-1)<<"  "<<w->whattype()<<endl;
+					n++;
+				}
+			}
+
+			if (w->Needtodraw()) keep.push_back(w);
+			else w->refresh_queued = false;
+		}
+	}
+	refreshing.clear();
+
+	dirtywindows.swap(keep);
+	return n;
+}
+
+
 //! Anything can call app->postmessage when they want to make some status statement.
 /*! Builtin default is to do nothing. (well, write out somewhere in debug version)
  */
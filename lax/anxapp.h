@@ -33,6 +33,10 @@
 
 #include <sys/times.h>
 #include <pthread.h>
+#include <sys/select.h>
+#include <functional>
+#include <vector>
+#include <unordered_map>
 
 #include <lax/anobject.h>
 #include <lax/dump.h>
@@ -132,6 +136,28 @@ class aDrawable
 
 const int AUTOPLACE = -100000;
 
+
+//-------------------------- NeedtodrawFlag ----------------------------------------
+class NeedtodrawFlag
+{
+	int value;
+	anXWindow *window;
+	anXWindow **window_ref; //for flags of things drawn by a window, like interfaces
+	void queue(bool full);
+
+  public:
+	NeedtodrawFlag() { value=0; window=nullptr; window_ref=nullptr; }
+	NeedtodrawFlag(const NeedtodrawFlag &f) { value=f.value; window=nullptr; window_ref=nullptr; }
+	void Owner(anXWindow *nwindow) { window=nwindow; }
+	void Owner(anXWindow **nwindow_ref) { window_ref=nwindow_ref; }
+	operator int() const { return value; }
+	NeedtodrawFlag &operator=(const NeedtodrawFlag &f) { return operator=(f.value); }
+	NeedtodrawFlag &operator=(int v)  { value  = v; if (value) queue(true); return *this; }
+	NeedtodrawFlag &operator|=(int v) { value |= v; if (value) queue(true); return *this; }
+	void Damage(int v) { value |= v; if (value) queue(false); }
+};
+
+
 class anXWindow : virtual public EventReceiver, 
 				  virtual public Tagged,
 				  virtual public DumpUtility,
@@ -205,7 +231,17 @@ class anXWindow : virtual public EventReceiver,
 
  protected:
 	char        *win_tooltip;
-	int          needtodraw;
+	NeedtodrawFlag needtodraw; //setting nonzero queues the window in anXApp::dirtywindows
+
+	 //refresh queue
+	bool         refresh_queued;  //whether in anXApp::dirtywindows
+	unsigned int refresh_pass;
+	friend class NeedtodrawFlag;
+
+	 //damage tracking for partial repaint
+	bool         track_damage;
+	bool         damage_full;
+	std::vector<IntRectangle> damage;
 
 	RefPtrStack<anXWindow> _kids; 
 	virtual int deletekid(anXWindow *w);
@@ -268,6 +304,15 @@ class anXWindow : virtual public EventReceiver,
 	virtual void Needtodraw(int nntd) { needtodraw=nntd; }
 	virtual int  deletenow() { return 1; }
 
+	 //partial repaint
+	virtual void Invalidate();
+	virtual void Invalidate(int x,int y,int w,int h);
+	virtual bool PartialDamage() { return !damage_full && damage.size(); }
+	virtual int  NumDamageRects() { return damage.size(); }
+	virtual const IntRectangle *DamageRect(int i) { return i>=0 && i<(int)damage.size() ? &damage[i] : nullptr; }
+	virtual int  DamageBounds(IntRectangle *box);
+	virtual void ClearDamage();
+
 	 //style functions
 	virtual int SetWinStyle(unsigned int stylebit, int newvalue);
 	virtual int HasWinStyle(unsigned int stylebit);
@@ -278,7 +323,7 @@ class anXWindow : virtual public EventReceiver,
 
 	 //event dispatching functions
 	virtual int Event(const EventData *data,const char *mes);
-	virtual int ExposeChange(ScreenEventData *e) { Needtodraw(1); return 0; }
+	virtual int ExposeChange(ScreenEventData *e);
 
 	virtual int DeviceChange(const DeviceEventData *e) { return 1; }
 	virtual int CharInput(unsigned int ch, const char *buffer,int len,unsigned int state, const LaxKeyboard *kb);
@@ -356,14 +401,65 @@ struct TimerInfo
 	clock_t starttime, lastactualtime;
 	double delta;
 	EventReceiver *win;
+	int heap_index; //position in TimerQueue heap, or -1 if not in it
+	bool removed;   //removed while its Idle() was being called
 	
-	TimerInfo() { info=0; id=0; endtime=firsttick=ticktime=nexttime=0; win=NULL; }
+	TimerInfo() { info=0; id=0; endtime=firsttick=ticktime=nexttime=0; win=NULL; heap_index=-1; removed=false; }
 	TimerInfo(EventReceiver *nwin,int duration,int firstt,int tickt,int nid,long ninfo);
 	int checktime(clock_t tm);
+	bool expired();
 	void Update(int next, int duration);
 };
 
 
+//-------------------------- TimerQueue ----------------------------------------
+class TimerQueue
+{
+  protected:
+	std::vector<TimerInfo*> heap; //binary min-heap on nexttime
+	std::unordered_map<int, TimerInfo*> ids; //all timers, including any detached from heap
+
+	bool earlier(int a, int b) { return heap[a]->nexttime < heap[b]->nexttime; }
+	void swap(int a, int b);
+	void siftup(int i);
+	void siftdown(int i);
+
+  public:
+	TimerQueue() {}
+	~TimerQueue();
+
+	int n() const { return ids.size(); }
+	TimerInfo *Top() { return heap.size() ? heap[0] : nullptr; }
+	TimerInfo *Find(int id);
+	void Push(TimerInfo *timer);
+	void Detach(TimerInfo *timer);
+	void Reinsert(TimerInfo *timer);
+	int Remove(TimerInfo *timer);
+	int RemoveIf(std::function<bool (TimerInfo *timer)> which);
+	void Flush();
+};
+
+
+//-------------------------- FdWatch ----------------------------------------
+enum FdWatchFlags {
+	LAX_FD_Read  = (1<<0),
+	LAX_FD_Write = (1<<1)
+};
+
+typedef std::function<void (int fd, int what)> FdWatchCallback;
+
+struct FdWatch
+{
+	int fd;
+	int what; //mask of FdWatchFlags
+	bool removed;
+	FdWatchCallback callback;
+
+	FdWatch(int nfd, int nwhat, FdWatchCallback ncallback)
+	  : fd(nfd), what(nwhat), removed(false), callback(ncallback) {}
+};
+
+
 //---------------------------- anXApp --------------------------------------
 class anXApp : virtual public anObject
 {
@@ -388,6 +484,7 @@ class anXApp : virtual public anObject
 	//int               default_vscreen;
 	Visual           *vis;
 	Window            bump_xid;
+	std::unordered_map<Window, anXWindow*> xlib_windows; //every anXWindow with an xlib_window
 
 	 //x input method variables *** not mpx compliant, fix me!!
 	LaxDevice        *xim_current_device;
@@ -406,6 +503,7 @@ class anXApp : virtual public anObject
 	virtual GC gc(int scr=0, int id=0);
 	virtual anXWindow *findwindow_xlib(Window win);
 	virtual anXWindow *findsubwindow_xlib(anXWindow *w,Window win);
+	virtual void xlib_ForgetWindow(anXWindow *w);
 	virtual int xlib_ScreenInfo(int screen, int *xx,int *yy, int *width,int *height,int *mmwidth,int *mmheight,int *depth);
 	virtual void reselectForXEvents(anXWindow *win);
 #endif //_LAX_PLATFORM_XLIB
@@ -433,12 +531,17 @@ class anXApp : virtual public anObject
 	RefPtrStack<anXWindow>  topwindows;
 	RefPtrStack<anXWindow>  outclickwatch;
 	RefPtrStack<anXWindow>  todelete;
-	PtrStack<EventReceiver> eventreceivers;
+	std::unordered_map<unsigned long, EventReceiver*> eventreceivers; //by object_id
 	EventData              *dataevents,*dataevente;
-	PtrStack<TimerInfo>     timers;
+	TimerQueue              timers;
 	pthread_mutex_t         event_mutex;
 	int maxtimeout;
-	//int                     bump_fd;
+	int                     bump_fd;
+	PtrStack<FdWatch>       fdwatches;
+	int                     fdwatch_depth;
+	std::vector<anXWindow*> dirtywindows;
+	std::vector<anXWindow*> refreshing;
+	unsigned int            refresh_pass;
 
 	int                     ttcount;
 	PtrStack<LaxDevice>     tooltipmaybe;
@@ -455,11 +558,14 @@ class anXApp : virtual public anObject
 	virtual void resetkids(anXWindow *w);
 	virtual void idle(anXWindow *w);
 	virtual int refresh(anXWindow *w);
+	virtual int refreshdirty();
 	virtual int processdataevents();
 	virtual int processSingleDataEvent(EventReceiver *obj,EventData *ee);
 	virtual int checkOutClicks(EventReceiver *obj,MouseEventData *ee);
 	virtual int managefocus(anXWindow *ww, EventData *ev);
 	virtual void tooltipcheck(EventData *event, anXWindow *ww);
+	virtual void clearbump();
+	virtual int processfdwatches(fd_set *readfds, fd_set *writefds);
 	
   public:
 
@@ -530,6 +636,8 @@ class anXApp : virtual public anObject
 	virtual int UnregisterEventReceiver(EventReceiver *e);
 	virtual int SendMessage(EventData *data, unsigned long toobj=0,
 							const char *mes=0, unsigned long fromobj=0);
+	virtual void QueueRefresh(anXWindow *w);
+	virtual void DequeueRefresh(anXWindow *w);
 
 	 //window management functions
 	virtual int rundialog(anXWindow *ndialog,anXWindow *wingroup=NULL,char absorb_count=1);
@@ -562,6 +670,10 @@ class anXApp : virtual public anObject
 	virtual int modifytimer(EventReceiver *win, int timerid,int next,int duration);
 	virtual int addmousetimer(EventReceiver *win);
 	virtual int removetimer(EventReceiver *w,int timerid);
+
+	 //extra file descriptor sources
+	virtual int AddFdWatch(int fd, int what, FdWatchCallback callback);
+	virtual int RemoveFdWatch(int fd);
 };
 
 
@@ -33,6 +33,7 @@
 
 
 #include <iostream>
+#include <algorithm>
 using namespace std;
 #define DBG 
 
@@ -72,6 +73,33 @@ Drawable aDrawable::xlibDrawable(int which)
 #endif //_LAX_PLATFORM_XLIB
 
 
+//------------------------------------ NeedtodrawFlag -------------------------------------
+/*! \class NeedtodrawFlag
+ * \brief The type of anXWindow::needtodraw.
+ *
+ * This behaves like a plain int, but whenever it is set to something nonzero, the window is
+ * added to anXApp's dirty window list, so that anXApp::refreshdirty() only has to visit windows
+ * that actually need to be redrawn, instead of walking every window each time through the event loop.
+ *
+ * Setting it with = or |= also marks the whole window as damaged, so windows that set needtodraw
+ * directly still get a full repaint even if part of the window was Invalidate()'d before.
+ * Only anXWindow::Invalidate(int,int,int,int) uses Damage() to request a partial repaint.
+ *
+ * Things that are drawn by some window, such as LaxInterfaces::anInterface, can use one too, with
+ * Owner(anXWindow**) pointing at wherever they keep their current window. Setting it then
+ * queues that window, whose Needtodraw() is expected to check with what it draws.
+ * Copies do not keep the owner.
+ */
+
+void NeedtodrawFlag::queue(bool full)
+{
+	anXWindow *w = (window ? window : (window_ref ? *window_ref : nullptr));
+	if (!w) return;
+	if (full) w->damage_full = true;
+	if (!w->refresh_queued && w->app) w->app->QueueRefresh(w);
+}
+
+
 //------------------------------------ anXWindow -------------------------------------
 /*! \class anXWindow
  *  \brief This is the basic window unit for the Laxkit.
@@ -256,12 +284,6 @@ Drawable aDrawable::xlibDrawable(int which)
  *
  * The app retrieves win_tooltip with a call to tooltip(). It does not access win_tooltip directly
  */
-/*! \fn int anXWindow::ExposeChange(ScreenEventData *e)
- * \brief Default behavior on Expose events is to call Needtodraw(1).
- *
- * For smart refreshing, windows would redefine this to record which areas
- * of the window need to be updated. Imlib2, by the way, provides for this via imlib_updates.
- */
 /*! \fn int anXWindow::deletenow()
  * \brief Return whether the window is allowed to be deleted.
  * 
@@ -345,6 +367,12 @@ anXWindow::anXWindow(anXWindow *parnt, const char *nname, const char *ntitle,
 {
 	app = anXApp::app;
 
+	refresh_queued  = false;
+	refresh_pass    = 0;
+	needtodraw.Owner(this);
+	track_damage = false;
+	damage_full  = true;
+
 	win_screen = -1;
 	win_on     = 0;
 	win_active = 0;
@@ -400,6 +428,12 @@ anXWindow::~anXWindow()
 {
 	DBG cerr << " in anxwindow("<<WindowTitle()<<") destructor."<<endl;
 
+	if (refresh_queued && anXApp::app) anXApp::app->DequeueRefresh(this);
+
+#ifdef _LAX_PLATFORM_XLIB
+	if (xlib_window && anXApp::app) anXApp::app->xlib_ForgetWindow(this);
+#endif //_LAX_PLATFORM_XLIB
+
 #ifdef _LAX_PLATFORM_XLIB
 	if (xlib_dnd) delete xlib_dnd;
 	if (xlib_win_hints) XFree(xlib_win_hints);
@@ -544,7 +578,7 @@ void anXWindow::ThemeChanged()
 		}
 	}
 	UIScaleChanged();
-	needtodraw = 1;
+	Invalidate();
 }
 
 /*! Install a custom theme for the window. Its count will be incremented.
@@ -576,7 +610,7 @@ void anXWindow::UIScaleChanged()
 	for (int c=0; c<_kids.n; c++) {
 		_kids.e[c]->UIScaleChanged();
 	}
-	needtodraw = 1;
+	Invalidate();
 }
 
 /*! This is called when ui scale is changed for any reason. For instance, the theme may have
@@ -809,12 +843,24 @@ void anXWindow::SetupBackBuffer()
  * Default is to call <tt>XdbeSwapBuffers(app->dpy,&swapinfo,1)</tt>
  * with <tt>swapinfo.swap_window=window</tt> and <tt>swapinfo.swap_action=XdbeBackground</tt>.
  * If xlib_backbuffer==0, then nothing is done.
+ *
+ * If PartialDamage(), then instead of swapping, only the damaged rectangles are copied
+ * from the back buffer to the window.
  */
 void anXWindow::SwapBuffers()
 {
 #ifdef _LAX_PLATFORM_XLIB
 	 // swap buffers
 	if (xlib_backbuffer) {
+		if (PartialDamage()) {
+			GC gc = app->gc(win_screen >= 0 ? win_screen : 0);
+			for (unsigned int c=0; c<damage.size(); c++) {
+				const IntRectangle &r = damage[c];
+				XCopyArea(app->dpy, xlib_backbuffer, xlib_window, gc, r.x,r.y, r.width,r.height, r.x,r.y);
+			}
+			return;
+		}
+
 		XdbeSwapInfo swapinfo;
 		swapinfo.swap_window=xlib_window;
 		swapinfo.swap_action=XdbeBackground;
@@ -823,6 +869,113 @@ void anXWindow::SwapBuffers()
 #endif //_LAX_PLATFORM_XLIB
 }
 
+//! Mark the whole window as needing to be redrawn.
+void anXWindow::Invalidate()
+{
+	needtodraw |= 1;
+	damage_full = true;
+	damage.clear();
+}
+
+//! Mark only a rectangle of the window, in window coordinates, as needing to be redrawn.
+/*! Calling this turns on damage tracking for the window, so Expose events will also only add
+ * their areas instead of redrawing everything.
+ *
+ * If the only changes since the last Refresh() were made with this function (or Expose events),
+ * then PartialDamage() will return true. The Displayer will then clip to the damaged area in
+ * MakeCurrent(), and SwapBuffers() only copies that area to the screen. Any other way of asking
+ * for a redraw, such as Invalidate(), Needtodraw(1) or setting needtodraw directly, marks the whole
+ * window again.
+ *
+ * Rectangles are merged when they overlap. If there get to be too many, or they cover
+ * most of the window, the whole window is marked.
+ */
+void anXWindow::Invalidate(int x,int y,int w,int h)
+{
+	track_damage = true;
+
+	 //clamp to window
+	if (x < 0) { w += x; x = 0; }
+	if (y < 0) { h += y; y = 0; }
+	if (x+w > win_w) w = win_w-x;
+	if (y+h > win_h) h = win_h-y;
+	if (w <= 0 || h <= 0) return;
+
+	if (needtodraw && damage_full) return; //already redrawing everything
+	needtodraw.Damage(1);
+
+	if (damage_full) {
+		 //nothing was pending, so start a fresh region
+		damage_full = false;
+		damage.clear();
+	}
+
+	IntRectangle r(x,y,w,h);
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (unsigned int c=0; c<damage.size(); c++) {
+			IntRectangle &o = damage[c];
+			if (o.x > r.x+r.width || r.x > o.x+o.width || o.y > r.y+r.height || r.y > o.y+o.height) continue;
+
+			 //touching or overlapping, so replace both with their bounds
+			int x2 = std::max(o.x+o.width,  r.x+r.width);
+			int y2 = std::max(o.y+o.height, r.y+r.height);
+			r.x = std::min(o.x, r.x);
+			r.y = std::min(o.y, r.y);
+			r.width  = x2 - r.x;
+			r.height = y2 - r.y;
+			damage.erase(damage.begin() + c);
+			merged = true;
+			break;
+		}
+	}
+	damage.push_back(r);
+
+	long area = 0;
+	for (unsigned int c=0; c<damage.size(); c++) area += (long)damage[c].width * damage[c].height;
+	if (damage.size() > 16 || area > (long)win_w * win_h * 3/4) Invalidate();
+}
+
+//! Set box to the bounds of the damaged area, and return the number of damage rectangles.
+/*! If the whole window is damaged, box is the whole window and 0 is returned.
+ */
+int anXWindow::DamageBounds(IntRectangle *box)
+{
+	if (!PartialDamage()) {
+		box->set(0,0, win_w,win_h);
+		return 0;
+	}
+
+	int x1 = damage[0].x, y1 = damage[0].y;
+	int x2 = x1+damage[0].width, y2 = y1+damage[0].height;
+	for (unsigned int c=1; c<damage.size(); c++) {
+		x1 = std::min(x1, damage[c].x);
+		y1 = std::min(y1, damage[c].y);
+		x2 = std::max(x2, damage[c].x + damage[c].width);
+		y2 = std::max(y2, damage[c].y + damage[c].height);
+	}
+	box->set(x1,y1, x2-x1,y2-y1);
+	return damage.size();
+}
+
+//! Called from anXApp::refresh() once the window no longer needs to draw.
+void anXWindow::ClearDamage()
+{
+	damage.clear();
+	damage_full = true;
+}
+
+/*! Default behavior on Expose events is to call Needtodraw(1), unless Invalidate(x,y,w,h) has
+ * been used on the window, in which case only the exposed area is invalidated.
+ */
+int anXWindow::ExposeChange(ScreenEventData *e)
+{
+	if (track_damage) Invalidate(e->x, e->y, e->width, e->height);
+	else Needtodraw(1);
+	return 0;
+}
+
 //! Replace the current tooltip, return the current tooltip (after replacing).
 /*! If tooltips are active, the anXApp calls tooltip() to find the tip for this window.
  * Thus, the window can redefine this function if there are multiple tooltips for some reason.
@@ -1046,10 +1199,10 @@ int anXWindow::Grayed(int g)
 {
 	if (g && !(win_style&ANXWIN_GRAYED)) {
 		win_style|=ANXWIN_GRAYED; 
-		needtodraw=1;
+		Invalidate();
 	} else if (!g && (win_style&ANXWIN_GRAYED)) {
 		win_style=(win_style&~ANXWIN_GRAYED); 
-		needtodraw=1;
+		Invalidate();
 	}
 	return Grayed(); 
 }
@@ -1216,7 +1369,7 @@ int anXWindow::Resize(int nw,int nh)
 		if (win_cur_uiscale != old_scale) UIScaleChanged();
 	}
 
-	needtodraw|=1;
+	Invalidate();
 	return 0;
 }
 
@@ -1253,7 +1406,7 @@ int anXWindow::MoveResize(int nx,int ny,int nw,int nh)
 		if (win_cur_uiscale != old_scale) UIScaleChanged();
 	}
 
-	needtodraw|=1;
+	Invalidate();
 	DBG cerr <<"    done MoveResize"<<endl;
 	return 0;
 }
@@ -1609,7 +1762,7 @@ int anXWindow::event(XEvent *e)
 			 // remove override redirect
 			xlib_win_xatts.override_redirect = False;
 			XChangeWindowAttributes(app->dpy,xlib_window,CWOverrideRedirect,&xlib_win_xatts);
-			needtodraw=1;
+			Invalidate();
 			DBG cerr <<"..end ResizeRequest"<<endl;
 		} break;
 
@@ -1619,6 +1772,7 @@ int anXWindow::event(XEvent *e)
 					EventData *d=new EventData(LAX_onMapped,object_id,object_id);
 					app->SendMessage(d,object_id,nullptr,object_id);
 					win_on=1;
+					if (Needtodraw()) app->QueueRefresh(this);
 				}
 			} break;
 
@@ -33,7 +33,11 @@
 
 #include <unistd.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <vector>
 #include <iostream>
 
 #include <lax/debug.h>
@@ -1409,6 +1413,229 @@ void skip_to_next_attribute(IOBuffer &f,int indent)
 }
 
 
+//---------------------------------- AttributeArena -----------------------------------
+/*! \class AttributeArena
+ * \ingroup attributes
+ * \brief Storage for Attribute trees read in with Attribute::dump_in_mapped().
+ *
+ * Holds the file buffers that names and values point into, and blocks of Attribute
+ * nodes, so that reading a big file does not need a separate allocation for every
+ * node, name, and value. The Attribute that did the reading owns the arena, and
+ * deletes it when it is deleted or cleared.
+ */
+class AttributeArena
+{
+  protected:
+	class Buffer
+	{
+	  public:
+		char *data;
+		long size; //allocated size, not including the final '\0'
+		bool mapped;
+	};
+
+	std::vector<Buffer> buffers;
+	std::vector<Attribute*> blocks;
+	int numused; //in last block
+
+  public:
+	Attribute *owner;
+
+	AttributeArena(Attribute *nowner) { owner = nowner; numused = 0; }
+	~AttributeArena();
+	Attribute *NewAttribute();
+	char *MapFile(const char *filename, long *len_ret);
+	bool Contains(const char *str);
+};
+
+#define ATTRIBUTE_ARENA_BLOCK 1024
+
+AttributeArena::~AttributeArena()
+{
+	 //nodes must go before the buffers their strings point to
+	for (auto block : blocks) delete[] block;
+
+	for (auto &buffer : buffers) {
+		if (buffer.mapped) munmap(buffer.data, buffer.size);
+		else delete[] buffer.data;
+	}
+}
+
+//! Return a new blank Attribute, which will be deleted by the arena.
+Attribute *AttributeArena::NewAttribute()
+{
+	if (!blocks.size() || numused == ATTRIBUTE_ARENA_BLOCK) {
+		blocks.push_back(new Attribute[ATTRIBUTE_ARENA_BLOCK]);
+		numused = 0;
+	}
+	Attribute *att = blocks.back() + numused;
+	numused++;
+	att->arena = this;
+	return att;
+}
+
+/*! Return whether str points into one of the file buffers.
+ */
+bool AttributeArena::Contains(const char *str)
+{
+	if (!str) return false;
+	for (auto &buffer : buffers) {
+		if (str >= buffer.data && str <= buffer.data + buffer.size) return true;
+	}
+	return false;
+}
+
+/*! Map a file into memory as a writable, private, '\0' terminated buffer. Writing to it
+ * does not change the file. When the file size is an exact multiple of the page size,
+ * there is no room for the final '\0', and the file is read in normally instead.
+ *
+ * Returns the buffer, or nullptr on error. The length up to the first '\0' is put in len_ret.
+ */
+char *AttributeArena::MapFile(const char *filename, long *len_ret)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return nullptr;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return nullptr;
+	}
+
+	Buffer buffer;
+	buffer.size   = st.st_size;
+	buffer.mapped = false;
+	buffer.data   = nullptr;
+
+	long pagesize = sysconf(_SC_PAGESIZE);
+	if (buffer.size > 0 && (pagesize <= 0 || buffer.size % pagesize != 0)) {
+		 //the rest of the last page is already zero filled
+		void *data = mmap(nullptr, buffer.size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED) {
+			madvise(data, buffer.size, MADV_SEQUENTIAL);
+			buffer.data   = (char*)data;
+			buffer.mapped = true;
+		}
+	}
+
+	if (!buffer.data) {
+		buffer.data = new char[buffer.size + 1];
+		long numread = 0;
+		while (numread < buffer.size) {
+			ssize_t r = read(fd, buffer.data + numread, buffer.size - numread);
+			if (r <= 0) break;
+			numread += r;
+		}
+		buffer.data[numread] = '\0';
+	}
+	close(fd);
+
+	buffers.push_back(buffer);
+	if (len_ret) *len_ret = strlen(buffer.data);
+	return buffer.data;
+}
+
+
+//---------------------------------- AttributeIndex -----------------------------------
+/*! \class AttributeIndex
+ * \ingroup attributes
+ * \brief Lookup of an Attribute's subattributes by name. See Attribute::findIndex().
+ *
+ * This is an open addressing hash of the names, pointing to the first subattribute with
+ * each name, plus a list of the next subattribute with the same name, for each subattribute.
+ */
+class AttributeIndex
+{
+  public:
+	int n;           //attributes.n when built
+	Attribute **e;   //attributes.e when built
+	unsigned int mask;
+	std::vector<int> slots; //index of first subattribute with a name, or -1
+	std::vector<int> next;  //next subattribute with the same name, or -1
+	std::vector<int> last;  //for first subattributes of a name, the last one with that name
+
+	static unsigned int Hash(const char *str);
+	bool IsCurrent(PtrStack<Attribute> &atts) { return n == atts.n && e == atts.e; }
+	void Build(PtrStack<Attribute> &atts);
+	void Add(int c);
+	void Append(PtrStack<Attribute> &atts);
+	int First(const char *name);
+};
+
+//! Subattributes needed before Attribute::findIndex() uses an AttributeIndex.
+#define ATTRIBUTE_INDEX_MIN 16
+
+//! FNV-1a
+unsigned int AttributeIndex::Hash(const char *str)
+{
+	unsigned int h = 2166136261u;
+	for ( ; *str; str++) {
+		h ^= (unsigned char)*str;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+void AttributeIndex::Build(PtrStack<Attribute> &atts)
+{
+	n = atts.n;
+	e = atts.e;
+
+	unsigned int size = 16;
+	while (size < 2 * (unsigned int)n) size <<= 1;
+	mask = size - 1;
+	slots.assign(size, -1);
+	next.assign(n, -1);
+	last.assign(n, -1);
+
+	for (int c=0; c<n; c++) Add(c);
+}
+
+//! Put subattribute c in the index. It must come after any others already added.
+void AttributeIndex::Add(int c)
+{
+	if (!e[c] || !e[c]->name) return;
+
+	unsigned int h = Hash(e[c]->name) & mask;
+	while (slots[h] >= 0 && strcmp(e[slots[h]]->name, e[c]->name)) h = (h+1) & mask;
+
+	if (slots[h] < 0) {
+		slots[h] = c;
+		last[c] = c;
+	} else {
+		int first = slots[h];
+		next[last[first]] = c;
+		last[first] = c;
+	}
+}
+
+/*! Update for a single subattribute pushed onto the end of atts since the index was current.
+ */
+void AttributeIndex::Append(PtrStack<Attribute> &atts)
+{
+	if (2 * (unsigned int)atts.n > mask + 1) {
+		Build(atts);
+		return;
+	}
+	n = atts.n;
+	e = atts.e;
+	next.push_back(-1);
+	last.push_back(-1);
+	Add(n-1);
+}
+
+//! Return index of first subattribute with name, or -1.
+int AttributeIndex::First(const char *name)
+{
+	unsigned int h = Hash(name) & mask;
+	while (slots[h] >= 0) {
+		if (!strcmp(e[slots[h]]->name, name)) return slots[h];
+		h = (h+1) & mask;
+	}
+	return -1;
+}
+
+
 //---------------------------------- Attribute -----------------------------------	
 /*! \class Attribute
  * \ingroup attributes
@@ -1435,6 +1662,15 @@ void skip_to_next_attribute(IOBuffer &f,int indent)
  *
  * Attribute::flags is not natively used by Attribute. It exists to aid other
  * classes to keep a simple hint about what data is contained.
+ *
+ * Lookups by name with find() and friends use an index of the names when there are many
+ * subattributes. push() and remove() keep the index up to date, as does any change to attributes.n.
+ * If you rename subattributes, or rearrange attributes directly, call FlushIndex().
+ *
+ * Attributes read in with dump_in_mapped() live in an AttributeArena, and their name and value
+ * usually point straight into the mapped file. For those, change name and value only with Name() and
+ * Value(), not makestr(), and never delete the subattributes directly. Removing them from
+ * attributes is fine.
  */
 
 
@@ -1446,24 +1682,54 @@ Attribute::Attribute(const char *nn, const char *val,const char *nt)
 	makestr(atttype,nt);
 	comment = nullptr;
 	flags=0;
+	arena = nullptr;
+	name_index = nullptr;
 }
 
 Attribute::~Attribute()
 {
-	delete[] name;
-	delete[] value;
+	delete name_index;
+	if (!arena || !arena->Contains(name))  delete[] name;
+	if (!arena || !arena->Contains(value)) delete[] value;
 	delete[] atttype;
 	delete[] comment;
+	if (arena && arena->owner == this) {
+		attributes.flush();
+		delete arena;
+	}
 }
 
 //! Set name, value, atttype, comment to nullptr and flush attributes.
 void Attribute::clear()
 {
-	delete[] name;    name    = nullptr;
-	delete[] value;   value   = nullptr;
+	Name(nullptr);
+	Value(nullptr);
 	delete[] atttype; atttype = nullptr;
 	delete[] comment; comment = nullptr;
 	attributes.flush();
+	FlushIndex();
+	if (arena && arena->owner == this) {
+		delete arena;
+		arena = nullptr;
+	}
+}
+
+/*! Replace name with a copy of nname. Use this rather than makestr() for attributes
+ * from dump_in_mapped(), since their name might point into the mapped file.
+ */
+void Attribute::Name(const char *nname)
+{
+	if (arena && arena->Contains(name)) name = nullptr;
+	makestr(name, nname);
+}
+
+/*! Replace value with a copy of nvalue. Use this rather than makestr() for attributes
+ * from dump_in_mapped(), since their value might point into the mapped file.
+ */
+void Attribute::Value(const char *nvalue)
+{
+	if (arena && arena->Contains(value)) value = nullptr;
+	makestr(value, nvalue);
 }
 
 /*! Update this->comment. Important: Currently, should not contain newlines.
@@ -1497,17 +1763,11 @@ Attribute *Attribute::duplicateAtt()
 const char *Attribute::findValue(const char *fromname,int *i_ret)
 {
 	if (i_ret) *i_ret=-1;
-	if (!fromname) return nullptr;
-	for (int c=0; c<attributes.n; c++)
-		if (attributes.e[c]->name && !strcmp(attributes.e[c]->name,fromname)) {
-			if (!isblank(attributes.e[c]->value)) {
-				if (i_ret) *i_ret=c;
-				if (!attributes.e[c]->value) return "";
-				return attributes.e[c]->value;
-			}
-			break;
-		}
-	return nullptr;
+	int c = findIndex(fromname);
+	if (c < 0) return nullptr;
+	if (isblank(attributes.e[c]->value)) return nullptr;
+	if (i_ret) *i_ret=c;
+	return attributes.e[c]->value;
 }
 
 //! Convenience function to search for a subattribute, and convert its value to a double.
@@ -1519,16 +1779,11 @@ const char *Attribute::findValue(const char *fromname,int *i_ret)
 double Attribute::findDouble(const char *fromname,int *i_ret)
 {
 	if (i_ret) *i_ret=-1;
-	if (!fromname) return 0;
-	for (int c=0; c<attributes.n; c++)
-		if (attributes.e[c]->name && !strcmp(attributes.e[c]->name,fromname)) {
-			if (!isblank(attributes.e[c]->value)) {
-				if (i_ret) *i_ret=c;
-				return strtod(attributes.e[c]->value, nullptr);
-			}
-			break;
-		}
-	return 0;
+	int c = findIndex(fromname);
+	if (c < 0) return 0;
+	if (isblank(attributes.e[c]->value)) return 0;
+	if (i_ret) *i_ret=c;
+	return strtod(attributes.e[c]->value, nullptr);
 }
 
 //! Convenience function to search for a subattribute, and convert its value to a long.
@@ -1540,16 +1795,11 @@ double Attribute::findDouble(const char *fromname,int *i_ret)
 long Attribute::findLong(const char *fromname,int *i_ret)
 {
 	if (i_ret) *i_ret=-1;
-	if (!fromname) return 0;
-	for (int c=0; c<attributes.n; c++)
-		if (attributes.e[c]->name && !strcmp(attributes.e[c]->name,fromname)) {
-			if (!isblank(attributes.e[c]->value)) {
-				if (i_ret) *i_ret=c;
-				return strtol(attributes.e[c]->value,nullptr,10);
-			}
-			break;
-		}
-	return 0;
+	int c = findIndex(fromname);
+	if (c < 0) return 0;
+	if (isblank(attributes.e[c]->value)) return 0;
+	if (i_ret) *i_ret=c;
+	return strtol(attributes.e[c]->value,nullptr,10);
 }
 
 //! Return the first sub-attribute with the name fromname, or nullptr if not found.
@@ -1557,14 +1807,64 @@ long Attribute::findLong(const char *fromname,int *i_ret)
  */
 Attribute *Attribute::find(const char *fromname,int *i_ret)
 {
-	if (i_ret) *i_ret=-1;
-	if (!fromname) return nullptr;
-	for (int c=0; c<attributes.n; c++)
-		if (attributes.e[c]->name && !strcmp(attributes.e[c]->name,fromname)) {
-			if (i_ret) *i_ret=c;
-			return attributes.e[c];
-		}
-	return nullptr;
+	int c = findIndex(fromname);
+	if (i_ret) *i_ret=c;
+	if (c < 0) return nullptr;
+	return attributes.e[c];
+}
+
+/*! Return the index of the first subattribute named fromname, or -1 if not found.
+ *
+ * When there are many subattributes, this builds an index of their names the first time,
+ * so later lookups do not have to check every subattribute. See also findNext().
+ */
+int Attribute::findIndex(const char *fromname)
+{
+	if (!fromname) return -1;
+
+	if (attributes.n < ATTRIBUTE_INDEX_MIN) {
+		for (int c=0; c<attributes.n; c++)
+			if (attributes.e[c] && attributes.e[c]->name && !strcmp(attributes.e[c]->name,fromname)) return c;
+		return -1;
+	}
+
+	if (!name_index) name_index = new AttributeIndex;
+	if (!name_index->IsCurrent(attributes)) name_index->Build(attributes);
+	return name_index->First(fromname);
+}
+
+/*! Return the index of the next subattribute after index that has the same name, or -1.
+ * Use this to step through all subattributes with some name:
+ * <pre>
+ *   for (int c = att->findIndex("point"); c >= 0; c = att->findNext(c)) {
+ *       ...
+ *   }
+ * </pre>
+ */
+int Attribute::findNext(int index)
+{
+	if (index < 0 || index >= attributes.n || !attributes.e[index] || !attributes.e[index]->name) return -1;
+
+	if (attributes.n < ATTRIBUTE_INDEX_MIN) {
+		const char *nm = attributes.e[index]->name;
+		for (int c=index+1; c<attributes.n; c++)
+			if (attributes.e[c] && attributes.e[c]->name && !strcmp(attributes.e[c]->name,nm)) return c;
+		return -1;
+	}
+
+	if (!name_index) name_index = new AttributeIndex;
+	if (!name_index->IsCurrent(attributes)) name_index->Build(attributes);
+	return name_index->next[index];
+}
+
+/*! Throw away the name index used by findIndex(). It is rebuilt on the next lookup.
+ * Call it yourself if you rename subattributes, or change
+ * the attributes stack directly without changing its size.
+ */
+void Attribute::FlushIndex()
+{
+	delete name_index;
+	name_index = nullptr;
 }
 
 /*! Allow for easier pushing of subatts. Push a new one with given name and value,
@@ -1584,8 +1884,15 @@ Attribute *Attribute::pushSubAtt(const char *nname, const char *nvalue, const ch
  */
 int Attribute::push(Attribute *att,int where)
 { 
-	if (att) return attributes.push(att,1,where); 
-	return -1;
+	if (!att) return -1;
+
+	 //keep the name index when appending, since that is what happens when building up atts
+	bool append = (name_index && name_index->IsCurrent(attributes) && (where < 0 || where >= attributes.n));
+	if (!append) FlushIndex();
+
+	int i = attributes.push(att,1,where);
+	if (append) name_index->Append(attributes);
+	return i;
 }
 
 /*! Push from a possibly non-null terminated char. len must be >= 0.
@@ -1703,6 +2010,7 @@ int Attribute::remove(int index)
 {
 	if (index<0 || index>=attributes.n) return 1;
 	attributes.remove(index);
+	FlushIndex();
 	return 0;
 }
 
@@ -1842,7 +2150,7 @@ char *Attribute::dump_in_indented(IOBuffer &f, int Indent)
 		} else if (!strcmp(tline,"\\.")) {
 			appendstr(str,"."); //line has only "\.", add ".\n"
 		} else {
-			if (c>1 && tline[0]=='\\' && tline[1]=='\\') line++;
+			if (c>1 && tline[0]=='\\' && tline[1]=='\\') tline++;
 			appendstr(str,tline);
 		}
 	}
@@ -2136,8 +2444,8 @@ int Attribute::dump_in(const char *filename, int what)
 		return 1;
 	}
 
-	makestr(name,"file");
-	makestr(value,filename);
+	Name("file");
+	Value(filename);
 	makestr(atttype,nullptr);
 
 	DBG cerr <<"Reading "<<filename<<"...."<<endl;
@@ -2149,6 +2457,274 @@ int Attribute::dump_in(const char *filename, int what)
 	return 0;
 }
 
+/*! Unquote a name in place. Same as QuotedAttribute(), but v must start with a quote,
+ * and the result is written over v.
+ */
+static char *unquote_in_place(char *v, char **endptr)
+{
+	char *sp = v, *p = v;
+	char quote = *p++;
+
+	while (1) {
+		while (*p && *p!='\\' && *p!=quote) *sp++ = *p++;
+		if (*p==quote) { //endquote
+			p++;
+			while (isspace(*p)) p++;
+			break;
+		}
+		if (!*p) break;
+		if (!*(p+1)) { *sp++ = *p++; break; }
+		p++;
+		if (*p=='n') *sp++ = '\n';
+		else if (*p=='t') *sp++ = '\t';
+		else *sp++ = *p;
+		p++;
+	}
+
+	*sp = '\0';
+	*endptr = p;
+	return v;
+}
+
+/*! Return the end of the line, less any comment and trailing whitespace, like cut_comment().
+ */
+static char *trim_att_line(char *line, char *lineend)
+{
+	char escaped = 0, inquote = 0;
+	for (char *s = line; s < lineend; s++) {
+		if (*s == '#' && !escaped && !inquote) { lineend = s; break; }
+		if (*s == '\\') escaped = !escaped;
+		else if (escaped) escaped = 0;
+		if (*s == '"' && !escaped) inquote = !inquote;
+	}
+	while (lineend > line && isspace(lineend[-1])) lineend--;
+	return lineend;
+}
+
+/*! Same as Attribute::dump_in_indented(), but the value is gathered in place, starting at p.
+ * p gets advanced past the lines used.
+ */
+static char *dump_in_indented_buffer(char *&p, char *end, int Indent)
+{
+	char *str = p, *out = p;
+	int firstindent = -1;
+	bool first = true, appended = false;
+
+	while (p < end) {
+		char *line = p;
+		char *lineend = (char*)memchr(p, '\n', end-p);
+		char *next;
+		if (lineend) next = lineend+1;
+		else next = lineend = end;
+		lineend = trim_att_line(line, lineend);
+
+		int indent = 0;
+		while (line + indent < lineend && isspace(line[indent])) indent++;
+		if (line + indent == lineend) break; //blank line ends the value
+		if (indent < Indent) break;
+
+		 //preserve spaces beyond Indent, but pull back if less than first
+		 //indent, but more than Indent
+		if (firstindent < 0) firstindent = indent;
+		if (indent < firstindent) firstindent = indent;
+		else indent = firstindent;
+
+		char *tline = line + indent;
+		long n = lineend - tline;
+		p = next;
+
+		if (!first) { *out++ = '\n'; appended = true; }
+		first = false;
+
+		if (n == 1 && tline[0] == '.') {
+			//do nothing...  line has a single '.' at the beginning, prepend "\n" on next line
+		} else if (n == 2 && tline[0] == '\\' && tline[1] == '.') {
+			*out++ = '.';
+			appended = true;
+		} else {
+			if (n > 1 && tline[0] == '\\' && tline[1] == '\\') { tline++; n--; }
+			memmove(out, tline, n);
+			out += n;
+			appended = true;
+		}
+	}
+
+	if (!appended) return nullptr;
+	*out = '\0';
+	return str;
+}
+
+/*! Parse att format in buf, which must be writable, and have a '\0' at buf[len].
+ * This produces the same tree as Attribute::dump_in(IOBuffer&,int,Attribute**), but names and
+ * values are terminated in place within buf, and new nodes come from arena.
+ * Only values read in with "<< TAG" or "< TAG" get their own allocated strings.
+ *
+ * Returns the number of top level attributes read in.
+ */
+static int dump_in_buffer(Attribute *top, AttributeArena *arena, char *buf, long len)
+{
+	 //used only for "<<" values. This needs to be set up before anything is written to buf.
+	IOBuffer f;
+	f.OpenCString(buf);
+
+	class Level
+	{
+	  public:
+		Attribute *att;
+		int indent;     //min indent of subattributes
+		int firstchild; //index in pending
+	};
+	std::vector<Level> levels;
+	std::vector<Attribute*> pending; //subattributes, not yet pushed onto parents
+
+	 //push pending subattributes of the deepest level, and remove that level
+	auto finish_level = [&]() {
+		Level &level = levels.back();
+		int n = pending.size() - level.firstchild;
+		if (n) {
+			Attribute *att = level.att;
+			att->attributes.Allocate(att->attributes.n + n);
+			for (int c=level.firstchild; c<(int)pending.size(); c++) att->attributes.push(pending[c], LISTS_DELETE_None);
+			pending.resize(level.firstchild);
+		}
+		levels.pop_back();
+	};
+
+	levels.push_back(Level{ top, 0, 0 });
+
+	int numattsread = 0;
+	char *p = buf, *end = buf + len;
+	char *line, *lineend, *next;
+
+	while (p < end) {
+		line = p;
+		lineend = (char*)memchr(p, '\n', end-p);
+		if (lineend) next = lineend+1;
+		else next = lineend = end;
+
+		lineend = trim_att_line(line, lineend);
+
+		int indent = 0;
+		while (line + indent < lineend && isspace(line[indent])) indent++;
+		if (line + indent == lineend) { p = next; continue; } //skip blank line
+
+		while (levels.size() > 1 && indent < levels.back().indent) finish_level();
+
+		*lineend = '\0';
+		p = next;
+
+		Attribute *att = arena->NewAttribute();
+		pending.push_back(att);
+		if (levels.size() == 1) numattsread++;
+
+		char *fld = line + indent;
+		char *val = fld;
+		if (*val == '\'' || *val == '"') {
+			att->name = unquote_in_place(val, &val);
+		} else {
+			while (*val && !isspace(*val)) val++;
+			char *nameend = val;
+			while (isspace(*val)) val++;
+			*nameend = '\0';
+			att->name = fld;
+			removeescapes(att->name);
+		}
+
+		while (isspace(*val)) val++;
+		if (!*val) val = nullptr;
+
+		 //see Attribute::dump_in(IOBuffer&...) for what val can be
+		if (!val) {} // do nothing for null value
+		else if (!strcmp(val,"\\")) {
+			val = dump_in_indented_buffer(p, end, indent+1);
+
+		} else if (!strncmp(val,"<<<",3)) {
+			val += 3;
+			while (isspace(*val)) val++;
+			if (!*val) val = nullptr;
+
+		} else if (!strncmp(val,"<<",2)) {
+			val += 2;
+			while (isspace(*val)) val++;
+			if (*val) {
+				f.SetPos(p - buf);
+				att->value = att->dump_in_until(f, val, indent+1);
+				p = buf + f.Curpos();
+			}
+			val = nullptr;
+
+		} else if (*val=='<') {
+			val++;
+			while (isspace(*val)) val++;
+			if (*val) {
+				f.SetPos(p - buf);
+				att->value = att->dump_in_until(f, val, 0);
+				p = buf + f.Curpos();
+			}
+			val = nullptr;
+
+		} else if (*val=='"') {
+			 // if end of val is a matched quote, remove quotes..
+			int c,
+				e = 0, //e==1 if a backslash is encountered, and must parse next char
+				m = 0, //the number of recognizable chunks, must be 1 at end to remove quotes
+				q = 0; //the position of the last unescaped quote
+			for (c=1; val[c]!='\0'; c++) {
+				if (e) { e = 0; continue; }
+				if (q>0 && !isspace(val[c])) { m = 2; break; }
+				if (val[c]=='\\') e = !e;
+				else if (val[c]=='"') { q = c; m++; }
+			}
+			if (m==1) { // was matched quote, need to unescape quotes now
+				val[q]='\0';
+				val++;
+				char *to = val;
+				for (c=0; val[c]!='\0'; c++) {
+					if (val[c]=='\\' && val[c+1]=='"') c++;
+					*to++ = val[c];
+				}
+				*to = '\0';
+			}
+		}
+		if (val) att->value = val;
+
+		levels.push_back(Level{ att, indent+1, (int)pending.size() });
+	}
+
+	while (levels.size()) finish_level();
+	return numattsread;
+}
+
+/*! Like dump_in(filename), for att files only, but much faster and lighter for big files.
+ *
+ * The file is mapped into memory, and nodes come from an AttributeArena owned by this, rather
+ * than each being allocated separately. Names and values point into the mapped
+ * file, except for values read with "<< TAG" or "< TAG". Before changing them, see Name() and Value().
+ *
+ * Returns 0 for success, otherwise nonzero error.
+ */
+int Attribute::dump_in_mapped(const char *filename)
+{
+	if (!arena) arena = new AttributeArena(this);
+
+	long len = 0;
+	char *buf = arena->MapFile(filename, &len);
+	if (!buf) {
+		DBG cerr <<"Open "<<filename<<" failed."<<endl;
+		if (arena->owner == this && !attributes.n) { delete arena; arena = nullptr; }
+		return 1;
+	}
+
+	Name("file");
+	Value(filename);
+	makestr(atttype,nullptr);
+
+	DBG cerr <<"Reading "<<filename<<"...."<<endl;
+
+	dump_in_buffer(this, arena, buf, len);
+	return 0;
+}
+
 /*! Like dump_in(const char*, Attribute*), but use a string instead of reading
  * in file contents.
  */
@@ -47,6 +47,9 @@ enum AttributeTypes {
 	ATT_MAX
 };
 
+class AttributeArena;
+class AttributeIndex;
+
 class Attribute {
  public:
 	char *name;
@@ -56,12 +59,17 @@ class Attribute {
 	Laxkit::PtrStack<Attribute> attributes;
 
 	unsigned int flags;
+	AttributeArena *arena; // storage for atts read with dump_in_mapped(). Only the att that did the reading owns it.
+	AttributeIndex *name_index; // lazily built lookup of subattributes by name, see findIndex()
 
-	Attribute() { name = value = atttype = comment = nullptr;  flags = 0; }
+	Attribute() { name = value = atttype = comment = nullptr;  flags = 0;  arena = nullptr;  name_index = nullptr; }
 	Attribute(const char *nn, const char *nval, const char *nt=nullptr);
 	virtual ~Attribute();
 	virtual Attribute *duplicateAtt();
 	virtual anObject *duplicate() { return dynamic_cast<anObject*>(duplicateAtt()); }
+	virtual int         findIndex (const char *fromname);
+	virtual int         findNext  (int index);
+	virtual void        FlushIndex();
 	virtual Attribute  *find      (const char *fromname, int *i_ret=nullptr);
 	virtual const char *findValue (const char *fromname, int *i_ret=nullptr);
 	virtual double      findDouble(const char *fromname, int *i_ret=nullptr);
@@ -81,10 +89,13 @@ class Attribute {
 	virtual int remove(int index);
 	virtual void clear();
 	virtual void Comment(const char *ncomment);
+	virtual void Name(const char *nname);
+	virtual void Value(const char *nvalue);
 	virtual int NumAtts() { return attributes.n; }
 	virtual Attribute *Att(int index) { return index >= 0 && index < attributes.n ? attributes.e[index] : nullptr; }
 
 	virtual int   dump_in     (const char *filename, int what=0);
+	virtual int   dump_in_mapped(const char *filename);
 	virtual int   dump_in_str (const char *str);
 	virtual int   dump_in_json(const char *str);
 	virtual int   dump_in_xml (const char *str);
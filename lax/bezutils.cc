@@ -25,6 +25,8 @@
 #include <lax/drawingdefs.h>
 #include <lax/vectors-out.h>
 
+#include <vector>
+#include <algorithm>
 
 #include <lax/debug.h>
 using namespace std;
@@ -622,9 +624,9 @@ int bez_intersect_bez(const flatpoint &p1_1, const flatpoint &c1_1, const flatpo
 			if (i < num_ret) {
 				//DBG cerr <<"--inserting intersection: t1: "<<t1<<" t2: "<<t2<<" pt: "<<p<<endl;
 				for (int cc = num_ret; cc > i; cc--) {
-					point_ret[num_ret] = point_ret[cc-1];
-					t1_ret[num_ret] = t1_ret[cc-1];
-					t2_ret[num_ret] = t2_ret[cc-1];
+					point_ret[cc] = point_ret[cc-1];
+					t1_ret[cc] = t1_ret[cc-1];
+					t2_ret[cc] = t2_ret[cc-1];
 				}
 
 				point_ret[i] = p;
@@ -668,6 +670,135 @@ int bez_intersect_bez(const flatpoint &p1_1, const flatpoint &c1_1, const flatpo
 	return num_ret;
 }
 
+/*! Broad phase for finding which of many boxes might touch each other, such as bounding boxes
+ * of bezier segments before calling bez_intersect_bez() on them.
+ *
+ * For each pair of boxes that overlap or touch, push the pair of indices a,b onto pairs_ret,
+ * with a<b. Pairs are sorted by a, then b. Boxes with invalid bounds are ignored.
+ * pairs_ret is not flushed first. Returns the number of pairs added.
+ *
+ * Boxes are binned into a uniform grid with cells about the size of an average box, and only
+ * boxes that share a cell are compared, which is roughly linear in n for reasonably spread out
+ * boxes. Each pair is reported only from the cell containing the minimum corner of
+ * the pair's overlap, so there is no need to weed out duplicates. Boxes much bigger than
+ * the grid cells are compared directly against all other boxes instead.
+ */
+int bbox_overlap_pairs(const DoubleBBox *boxes, int n, NumStack<int> &pairs_ret)
+{
+	if (!boxes || n < 2) return 0;
+
+	DoubleBBox all;
+	double avg = 0;
+	int numvalid = 0;
+	for (int c=0; c<n; c++) {
+		if (!boxes[c].validbounds()) continue;
+		all.addtobounds(boxes[c].minx, boxes[c].miny);
+		all.addtobounds(boxes[c].maxx, boxes[c].maxy);
+		avg += std::max(boxes[c].maxx - boxes[c].minx, boxes[c].maxy - boxes[c].miny);
+		numvalid++;
+	}
+	if (numvalid < 2) return 0;
+	avg /= numvalid;
+
+	 //cells about the size of an average box, but no more than about 4*n cells total
+	double extent = std::max(all.maxx - all.minx, all.maxy - all.miny);
+	double minsize = extent / (2*sqrt((double)numvalid) + 1);
+	double cellsize = std::max(avg, minsize);
+	if (cellsize <= 0) cellsize = 1;
+	int nx = (int)((all.maxx - all.minx) / cellsize) + 1;
+	int ny = (int)((all.maxy - all.miny) / cellsize) + 1;
+
+	auto cellx = [&](double x) { int i = (int)((x - all.minx) / cellsize); return i < 0 ? 0 : (i >= nx ? nx-1 : i); };
+	auto celly = [&](double y) { int i = (int)((y - all.miny) / cellsize); return i < 0 ? 0 : (i >= ny ? ny-1 : i); };
+	auto touching = [&](int a, int b) {
+		return boxes[a].minx <= boxes[b].maxx && boxes[b].minx <= boxes[a].maxx
+			&& boxes[a].miny <= boxes[b].maxy && boxes[b].miny <= boxes[a].maxy;
+	};
+
+	 //bin the boxes, in compressed rows: cell i holds binned[cellstart[i]..cellstart[i+1]-1]
+	const int maxcells = 16; //boxes spanning more cells than this are checked separately
+	std::vector<int> big;
+	std::vector<int> cellstart(nx*ny + 1, 0);
+	for (int c=0; c<n; c++) {
+		if (!boxes[c].validbounds()) continue;
+		int x1 = cellx(boxes[c].minx), x2 = cellx(boxes[c].maxx);
+		int y1 = celly(boxes[c].miny), y2 = celly(boxes[c].maxy);
+		if ((x2-x1+1) * (y2-y1+1) > maxcells) { big.push_back(c); continue; }
+		for (int y=y1; y<=y2; y++) for (int x=x1; x<=x2; x++) cellstart[y*nx + x + 1]++;
+	}
+	for (int c=0; c<nx*ny; c++) cellstart[c+1] += cellstart[c];
+
+	std::vector<int> binned(cellstart[nx*ny]);
+	std::vector<int> fill(cellstart.begin(), cellstart.end() - 1);
+	std::vector<char> isbig(n, 0);
+	for (int c : big) isbig[c] = 1;
+	for (int c=0; c<n; c++) {
+		if (isbig[c] || !boxes[c].validbounds()) continue;
+		int x1 = cellx(boxes[c].minx), x2 = cellx(boxes[c].maxx);
+		int y1 = celly(boxes[c].miny), y2 = celly(boxes[c].maxy);
+		for (int y=y1; y<=y2; y++) for (int x=x1; x<=x2; x++) binned[fill[y*nx + x]++] = c;
+	}
+
+	std::vector<std::pair<int,int>> found;
+	for (int y=0; y<ny; y++) {
+		for (int x=0; x<nx; x++) {
+			int cell = y*nx + x;
+			for (int i=cellstart[cell]; i<cellstart[cell+1]; i++) {
+				int a = binned[i];
+				for (int j=i+1; j<cellstart[cell+1]; j++) {
+					int b = binned[j];
+					if (!touching(a,b)) continue;
+					 //only report from the cell holding the corner of the overlap
+					if (cellx(std::max(boxes[a].minx, boxes[b].minx)) != x) continue;
+					if (celly(std::max(boxes[a].miny, boxes[b].miny)) != y) continue;
+					found.push_back(a < b ? std::make_pair(a,b) : std::make_pair(b,a));
+				}
+			}
+		}
+	}
+
+	for (int c=0; c<(int)big.size(); c++) {
+		int a = big[c];
+		for (int b=0; b<n; b++) {
+			if (b == a || !boxes[b].validbounds()) continue;
+			if (isbig[b] && b < a) continue; //big-big pairs only once
+			if (!touching(a,b)) continue;
+			found.push_back(a < b ? std::make_pair(a,b) : std::make_pair(b,a));
+		}
+	}
+
+	std::sort(found.begin(), found.end());
+	pairs_ret.Allocate(pairs_ret.n + 2*found.size());
+	for (auto &pair : found) {
+		pairs_ret.push(pair.first);
+		pairs_ret.push(pair.second);
+	}
+	return found.size();
+}
+
+/*! Find which of numsegments cubic bezier segments might intersect each other.
+ * points is a list of 4 points per segment: vertex, control, control, vertex. Segments need not be connected.
+ *
+ * Pairs of segment indices are pushed onto pairs_ret, as per bbox_overlap_pairs(),
+ * which uses the exact segment bounds from bez_bbox(). Each pair should then be checked with
+ * bez_intersect_bez(). Returns the number of pairs.
+ */
+int bez_overlap_pairs(const flatpoint *points, int numsegments, NumStack<int> &pairs_ret)
+{
+	if (!points || numsegments < 2) return 0;
+
+	DoubleBBox *boxes = new DoubleBBox[numsegments];
+	for (int c=0; c<numsegments; c++) {
+		const flatpoint *p = points + 4*c;
+		boxes[c].addtobounds(p[0]);
+		bez_bbox(p[0], p[1], p[2], p[3], boxes + c);
+	}
+
+	int n = bbox_overlap_pairs(boxes, numsegments, pairs_ret);
+	delete[] boxes;
+	return n;
+}
+
 //! From a physical distance, return the corresponding t parameter value.
 /*! Note that this is probably not very reliable for long segments.
  */
@@ -62,6 +62,8 @@ int bez_intersect_bez(const flatpoint &p1_1, const flatpoint &c1_1, const flatpo
 					  const flatpoint &p2_1, const flatpoint &c2_1, const flatpoint &c2_2, const flatpoint &p2_2,
 					flatpoint *point_ret, double *t1_ret, double *t2_ret, int &num_ret, double threshhold, double t1, double t2, double tdiv,
 					int depth, int maxdepth);
+int bbox_overlap_pairs(const Laxkit::DoubleBBox *boxes, int n, NumStack<int> &pairs_ret);
+int bez_overlap_pairs(const flatpoint *points, int numsegments, NumStack<int> &pairs_ret);
 int bez_intersection(flatpoint p1,flatpoint p2, int isline,
 					flatpoint bp1, flatpoint bc1, flatpoint bc2, flatpoint bp2,
 					int resolution, flatpoint *point_ret, double *t_ret);
@@ -21,7 +21,11 @@
 //
 
 #include <lax/bitmaputils.h>
+#include <lax/threadpool.h>
 
+#include <cstring>
+#include <cmath>
+#include <vector>
 
 #include <iostream>
 using namespace std;
@@ -38,11 +42,13 @@ namespace Laxkit {
  *
  * Get a default one with GetDefaultImageProcessor() and 
  * set a new default one with SetDefaultImageProcessor(ImageProcessor *new_processor).
+ *
+ * See ThreadedImageProcessor for one that uses all the cores.
  */
 
 void ImageProcessor::MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, const DoubleBBox &bounds, flatpoint *points, int numpoints, bool flipy)
 {
-	return Laxkit::MakeValueMap(img,mapwidth,mapheight,blur,bounds,points,numpoints,flipy);
+	return Laxkit::MakeValueMap(img,mapwidth,mapheight,blur,bounds,points,numpoints,flipy, this);
 }
 
 int ImageProcessor::GaussianBlur(int radius, char which, unsigned char *img, int orig_width, int orig_height,
@@ -51,6 +57,13 @@ int ImageProcessor::GaussianBlur(int radius, char which, unsigned char *img, int
 	return Laxkit::GaussianBlur(radius,which,img,orig_width,orig_height, blurred,expand,depth,numchannels,channel_mask);
 }
 
+int ImageProcessor::WarpImage(const unsigned char *src, int src_width, int src_height, int src_stride,
+							  unsigned char *dst, int dst_width, int dst_height, int dst_stride,
+							  WarpMapping *mapping, int filter, int supersample)
+{
+	return Laxkit::WarpImage(src,src_width,src_height,src_stride, dst,dst_width,dst_height,dst_stride, mapping,filter,supersample);
+}
+
 
 
 
@@ -97,9 +110,11 @@ void ImageProcessor::SetDefault(ImageProcessor *new_processor)
  *
  * This is done by drawing the initial points on a pixmap, and spreading those values
  * one pixel at a time outward, with the result being a kind of voronoi pattern.
- * This pattern is then blurred by blur pixels vertically and horizontally.
+ * This pattern is then blurred by blur pixels vertically and horizontally, with proc->GaussianBlur()
+ * if proc is not null.
  */
-void MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, const DoubleBBox &bounds, flatpoint *points, int numpoints, bool flipy)
+void MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, const DoubleBBox &bounds, flatpoint *points, int numpoints, bool flipy,
+				  ImageProcessor *proc)
 {
 	 //initialize
 	unsigned char map1[mapwidth*mapheight];
@@ -206,9 +221,8 @@ void MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, con
 
 	 //now blur
 	if (blur>0) {
-		GaussianBlur(blur,'x', m2,mapwidth,mapheight, m1, false, 8, 1,1);
-		GaussianBlur(blur,'y', m1,mapwidth,mapheight, m2, false, 8, 1,1);
-		m1=m2;
+		if (proc) proc->GaussianBlur(blur,'b', m2,mapwidth,mapheight, m1, false, 8, 1,1);
+		else GaussianBlur(blur,'b', m2,mapwidth,mapheight, m1, false, 8, 1,1);
 
 	} else m1=m2;
 
@@ -238,10 +252,13 @@ void MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, con
  * In this case, the boundary outside the original image is taken to be transparent black.
  * If !expand, blurred needs to be the same size as img.
  *
+ * which=='b' does 'x' then 'y' through a temporary image. If expanding, blurred must then
+ * be expanded in both directions.
+ *
  * Return 0 for success, or nonzero for error (like bad inputs).
  */
 int GaussianBlur(int radius, //!< Pixels to blur from to left and right of a given pixel. 0 for no blur on x
-					char which, //!< 'x' or 'y'
+					char which, //!< 'x', 'y', or 'b' for both
 					unsigned char *img    , int orig_width, int orig_height,
 					unsigned char *blurred,
 					bool expand, //!< true to have new image
@@ -256,6 +273,16 @@ int GaussianBlur(int radius, //!< Pixels to blur from to left and right of a giv
 
 	if (!img || !blurred || orig_width<1 || orig_height<1) return 1;
 
+	if (which=='b') {
+		int tmp_width = orig_width + (expand ? 2*radius : 0);
+		unsigned char *tmp = new unsigned char[tmp_width*orig_height*numchannels*(depth==16 ? 2 : 1)];
+		memset(tmp, 0, tmp_width*orig_height*numchannels*(depth==16 ? 2 : 1));
+		int status = GaussianBlur(radius,'x', img,orig_width,orig_height, tmp, expand,depth,numchannels,channel_mask);
+		if (status==0) status = GaussianBlur(radius,'y', tmp,tmp_width,orig_height, blurred, expand,depth,numchannels,channel_mask);
+		delete[] tmp;
+		return status;
+	}
+
 	if (depth==16) depth=2;
 	else depth=1;
 	if (channel_mask==0) channel_mask=~0;
@@ -279,7 +306,7 @@ int GaussianBlur(int radius, //!< Pixels to blur from to left and right of a giv
 	double sigma=radius/3.;
 
 	for (int c=0; c<=radius; c++) {
-		kernel[radius-c-1] = kernel[radius+c] = 1/sqrt(2*M_PI*sigma*sigma) * exp(-c*c/2/sigma/sigma);
+		kernel[radius-c] = kernel[radius+c] = 1/sqrt(2*M_PI*sigma*sigma) * exp(-c*c/2/sigma/sigma);
 	}
 
 	 //normalize the kernel, so all values add to 1.0
@@ -339,7 +366,7 @@ int GaussianBlur(int radius, //!< Pixels to blur from to left and right of a giv
 				//i=y*stride + x*pixwidth; // *** <- this and below can be optimized
 
 				sum=tsum=0;
-				if (!expand && (y<radius || y>orig_height-radius)) dopartial=1;
+				if (!expand && (y<radius || y>=orig_height-radius)) dopartial=1;
 				else dopartial=0;
 				for (int c=-radius; c<=radius; c++) {
 					ii=y + c;
@@ -491,5 +518,270 @@ int GaussianBlur(int radius, //!< Pixels to blur from to left and right of a giv
 // }
 
 
+//---------------------------- WarpMapping --------------------------------------
+/*! \class WarpMapping
+ * \brief Per pixel mapping for WarpImage(), from destination pixels to source pixels.
+ *
+ * Coordinates are continuous pixel coordinates, so pixel (i,j) covers [i,i+1) x [j,j+1),
+ * and its center is at (i+.5, j+.5). Map() and MapRow() must be safe to call from several
+ * threads at once.
+ */
+
+/*! \fn bool WarpMapping::Map(double x,double y, flatpoint &src_ret)
+ * Return in src_ret the source point for destination point (x,y).
+ * Return false if there is no source point, in which case the destination will be transparent.
+ */
+
+/*! Map n points along a row, starting at (x,y) and stepping by dx in x.
+ * Points with no source get src_ret[i].info = -1, else 0.
+ *
+ * The default just calls Map() for each point. Subclasses can step incrementally instead.
+ */
+void WarpMapping::MapRow(double x,double y, double dx, int n, flatpoint *src_ret)
+{
+	for (int c=0; c<n; c++) {
+		src_ret[c].info = Map(x + c*dx, y, src_ret[c]) ? 0 : -1;
+	}
+}
+
+
+/*! \class ProjectiveWarpMapping
+ * \brief A WarpMapping from a 3x3 homography, with incremental stepping along rows.
+ *
+ * Source (u,v) = (m0 x + m1 y + m2, m3 x + m4 y + m5) / (m6 x + m7 y + m8). Points where
+ * the denominator is not positive are taken to be beyond the horizon, and have no source.
+ */
+
+//! nm is a row major 3x3 matrix, or NULL for identity.
+ProjectiveWarpMapping::ProjectiveWarpMapping(const double *nm)
+{
+	if (nm) memcpy(m, nm, 9*sizeof(double));
+	else {
+		memset(m, 0, 9*sizeof(double));
+		m[0] = m[4] = m[8] = 1;
+	}
+}
+
+bool ProjectiveWarpMapping::Map(double x,double y, flatpoint &src_ret)
+{
+	double w = m[6]*x + m[7]*y + m[8];
+	if (w <= 1e-12) return false;
+	src_ret.x = (m[0]*x + m[1]*y + m[2]) / w;
+	src_ret.y = (m[3]*x + m[4]*y + m[5]) / w;
+	return true;
+}
+
+/*! Step the homogeneous coordinates along the row, so each point is just 3 adds and a divide.
+ */
+void ProjectiveWarpMapping::MapRow(double x,double y, double dx, int n, flatpoint *src_ret)
+{
+	double u = m[0]*x + m[1]*y + m[2], du = m[0]*dx;
+	double v = m[3]*x + m[4]*y + m[5], dv = m[3]*dx;
+	double w = m[6]*x + m[7]*y + m[8], dw = m[6]*dx;
+	double iw;
+
+	for (int c=0; c<n; c++) {
+		if (w <= 1e-12) src_ret[c].info = -1;
+		else {
+			iw = 1/w;
+			src_ret[c].x = u*iw;
+			src_ret[c].y = v*iw;
+			src_ret[c].info = 0;
+		}
+		u += du;
+		v += dv;
+		w += dw;
+	}
+}
+
+
+/*! \class AffineWarpMapping
+ * \brief A ProjectiveWarpMapping made from a usual 6 member affine transform, mapping dst pixels to src pixels.
+ */
+
+AffineWarpMapping::AffineWarpMapping(const double *affine)
+{
+	m[0] = affine[0];  m[1] = affine[2];  m[2] = affine[4];
+	m[3] = affine[1];  m[4] = affine[3];  m[5] = affine[5];
+	m[6] = 0;          m[7] = 0;          m[8] = 1;
+}
+
+
+/*! \class FunctionWarpMapping
+ * \brief A WarpMapping that calls an arbitrary function, such as a reverse patch mesh lookup.
+ */
+
+
+//---------------------------- WarpImage --------------------------------------
+
+#define WARP_TILE 64
+
+//! Source pixel (x,y), or NULL for out of bounds.
+static inline const unsigned char *WarpPixel(const unsigned char *src, int w, int h, int stride, int x, int y)
+{
+	if (x<0 || x>=w || y<0 || y>=h) return NULL;
+	return src + y*stride + 4*x;
+}
+
+static inline void WarpSampleNearest(const unsigned char *src, int w, int h, int stride, double u, double v, float *out)
+{
+	const unsigned char *p = WarpPixel(src,w,h,stride, (int)floor(u), (int)floor(v));
+	if (!p) { out[0] = out[1] = out[2] = out[3] = 0; return; }
+	out[0] = p[0];  out[1] = p[1];  out[2] = p[2];  out[3] = p[3];
+}
+
+static inline void WarpSampleBilinear(const unsigned char *src, int w, int h, int stride, double u, double v, float *out)
+{
+	u -= .5;
+	v -= .5;
+	double fu = floor(u), fv = floor(v);
+	int x = fu, y = fv;
+	out[0] = out[1] = out[2] = out[3] = 0;
+	if (x < -1 || x >= w || y < -1 || y >= h) return;
+
+	float fx = u - fu, fy = v - fv;
+	float weights[4] = { (1-fx)*(1-fy), fx*(1-fy), (1-fx)*fy, fx*fy };
+	const unsigned char *p;
+
+	if (x >= 0 && x+1 < w && y >= 0 && y+1 < h) {
+		 //all inside, the usual case
+		const unsigned char *p0 = src + y*stride + 4*x, *p1 = p0 + stride;
+		for (int c=0; c<4; c++)
+			out[c] = weights[0]*p0[c] + weights[1]*p0[c+4] + weights[2]*p1[c] + weights[3]*p1[c+4];
+		return;
+	}
+
+	for (int c=0; c<4; c++) {
+		p = WarpPixel(src,w,h,stride, x + (c&1), y + (c>>1));
+		if (!p) continue;
+		out[0] += weights[c]*p[0];
+		out[1] += weights[c]*p[1];
+		out[2] += weights[c]*p[2];
+		out[3] += weights[c]*p[3];
+	}
+}
+
+//! Catmull-Rom weights for fraction f between pixels 1 and 2.
+static inline void WarpCubicWeights(float f, float *weights)
+{
+	weights[0] = ((-.5f*f + 1)*f - .5f)*f;
+	weights[1] = (1.5f*f - 2.5f)*f*f + 1;
+	weights[2] = ((-1.5f*f + 2)*f + .5f)*f;
+	weights[3] = (.5f*f - .5f)*f*f;
+}
+
+static inline void WarpSampleBicubic(const unsigned char *src, int w, int h, int stride, double u, double v, float *out)
+{
+	u -= .5;
+	v -= .5;
+	double fu = floor(u), fv = floor(v);
+	int x = fu, y = fv;
+	out[0] = out[1] = out[2] = out[3] = 0;
+	if (x < -2 || x > w || y < -2 || y > h) return;
+
+	float wx[4], wy[4], weight;
+	WarpCubicWeights(u - fu, wx);
+	WarpCubicWeights(v - fv, wy);
+	const unsigned char *p;
+
+	if (x >= 1 && x+2 < w && y >= 1 && y+2 < h) {
+		 //all inside, the usual case
+		float row[4];
+		p = src + (y-1)*stride + 4*(x-1);
+		for (int r=0; r<4; r++, p += stride) {
+			for (int c=0; c<4; c++) row[c] = wx[0]*p[c] + wx[1]*p[c+4] + wx[2]*p[c+8] + wx[3]*p[c+12];
+			for (int c=0; c<4; c++) out[c] += wy[r]*row[c];
+		}
+		return;
+	}
+
+	for (int r=0; r<4; r++) {
+		for (int c=0; c<4; c++) {
+			p = WarpPixel(src,w,h,stride, x-1+c, y-1+r);
+			if (!p) continue;
+			weight = wx[c]*wy[r];
+			out[0] += weight*p[0];
+			out[1] += weight*p[1];
+			out[2] += weight*p[2];
+			out[3] += weight*p[3];
+		}
+	}
+}
+
+static inline unsigned char WarpClamp(float v)
+{
+	if (v <= 0) return 0;
+	if (v >= 255) return 255;
+	return (unsigned char)(v + .5f);
+}
+
+/*! Render dst by sampling src through mapping, which maps dst pixel coordinates to src pixel coordinates.
+ * Both images must be 8 bit, 4 channels per pixel, such as the bgra of LaxImage::getImageBuffer().
+ * Strides are bytes per row. Parts of dst that map outside of src become transparent.
+ *
+ * filter is a WarpFilterType:
+ *  - WARP_Nearest  : fast, but aliased
+ *  - WARP_Bilinear : good for mappings that don't shrink much
+ *  - WARP_Bicubic  : Catmull-Rom, sharper for mappings that enlarge
+ *  - WARP_Supersample : supersample x supersample bilinear samples per pixel, for mappings that shrink a lot
+ *
+ * dst is rendered in WARP_TILE square tiles spread over ThreadPool::GetDefault(). Rows of each tile
+ * are mapped at once with WarpMapping::MapRow().
+ *
+ * Return 0 for success, or nonzero for bad inputs.
+ */
+int WarpImage(const unsigned char *src, int src_width, int src_height, int src_stride,
+			  unsigned char *dst, int dst_width, int dst_height, int dst_stride,
+			  WarpMapping *mapping, int filter, int supersample)
+{
+	if (!src || !dst || !mapping || src_width<1 || src_height<1 || dst_width<1 || dst_height<1) return 1;
+	if (filter<0 || filter>=WARP_MAX) filter = WARP_Bilinear;
+	if (filter != WARP_Supersample || supersample<1) supersample = 1;
+
+	int tilesx = (dst_width  + WARP_TILE-1) / WARP_TILE;
+	int tilesy = (dst_height + WARP_TILE-1) / WARP_TILE;
+
+	ThreadPool::GetDefault()->ParallelFor(0, tilesx*tilesy, [&](int tile, int thread) {
+		int x0 = (tile%tilesx) * WARP_TILE;
+		int y0 = (tile/tilesx) * WARP_TILE;
+		int tw = dst_width  - x0;  if (tw > WARP_TILE) tw = WARP_TILE;
+		int th = dst_height - y0;  if (th > WARP_TILE) th = WARP_TILE;
+
+		std::vector<flatpoint> points(tw*supersample);
+		float sum[WARP_TILE*4];
+		float pixel[4];
+		float scale = 1./(supersample*supersample);
+
+		for (int y=y0; y<y0+th; y++) {
+			memset(sum, 0, sizeof(sum));
+
+			for (int sy=0; sy<supersample; sy++) {
+				mapping->MapRow(x0 + .5/supersample, y + (sy+.5)/supersample, 1./supersample, tw*supersample, points.data());
+
+				for (int c=0; c<tw*supersample; c++) {
+					flatpoint &p = points[c];
+					if (p.info < 0) continue;
+
+					if      (filter == WARP_Nearest) WarpSampleNearest (src,src_width,src_height,src_stride, p.x,p.y, pixel);
+					else if (filter == WARP_Bicubic) WarpSampleBicubic (src,src_width,src_height,src_stride, p.x,p.y, pixel);
+					else                             WarpSampleBilinear(src,src_width,src_height,src_stride, p.x,p.y, pixel);
+
+					float *s = sum + 4*(c/supersample);
+					s[0] += pixel[0];
+					s[1] += pixel[1];
+					s[2] += pixel[2];
+					s[3] += pixel[3];
+				}
+			}
+
+			unsigned char *d = dst + y*dst_stride + 4*x0;
+			for (int c=0; c<4*tw; c++) d[c] = WarpClamp(sum[c]*scale);
+		}
+	});
+
+	return 0;
+}
+
+
 } //namespace Laxkit
 
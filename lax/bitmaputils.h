@@ -27,6 +27,8 @@
 #include <lax/anobject.h>
 #include <lax/doublebbox.h>
 
+#include <functional>
+
 
 #include <iostream>
 using namespace std;
@@ -36,9 +38,61 @@ using namespace std;
 namespace Laxkit {
 
 
-void MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, const DoubleBBox &bounds, flatpoint *points, int numpoints, bool flipy);
+class ImageProcessor;
+class WarpMapping;
+
+//goes in WarpImage() filter
+enum WarpFilterType {
+	WARP_Nearest = 0,
+	WARP_Bilinear,
+	WARP_Bicubic,
+	WARP_Supersample,
+	WARP_MAX
+};
+
+void MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, const DoubleBBox &bounds, flatpoint *points, int numpoints, bool flipy,
+				  ImageProcessor *proc=NULL);
 int GaussianBlur(int radius, char which, unsigned char *img, int orig_width, int orig_height,
 					unsigned char *blurred, bool expand, int depth, int numchannels, int channel_mask );
+int WarpImage(const unsigned char *src, int src_width, int src_height, int src_stride,
+			  unsigned char *dst, int dst_width, int dst_height, int dst_stride,
+			  WarpMapping *mapping, int filter, int supersample=3);
+
+
+//---------------------------- WarpMapping --------------------------------------
+class WarpMapping
+{
+  public:
+	virtual ~WarpMapping() {}
+	virtual bool Map(double x,double y, flatpoint &src_ret) = 0;
+	virtual void MapRow(double x,double y, double dx, int n, flatpoint *src_ret);
+};
+
+class ProjectiveWarpMapping : public WarpMapping
+{
+  public:
+	double m[9]; //row major 3x3, dst pixel (x,y,1) -> src pixel homogeneous coordinates
+
+	ProjectiveWarpMapping(const double *nm = NULL);
+	virtual bool Map(double x,double y, flatpoint &src_ret);
+	virtual void MapRow(double x,double y, double dx, int n, flatpoint *src_ret);
+};
+
+class AffineWarpMapping : public ProjectiveWarpMapping
+{
+  public:
+	AffineWarpMapping(const double *affine);
+};
+
+class FunctionWarpMapping : public WarpMapping
+{
+  public:
+	std::function<bool(double x,double y, flatpoint &src_ret)> function;
+
+	FunctionWarpMapping(std::function<bool(double x,double y, flatpoint &src_ret)> nfunction) : function(nfunction) {}
+	virtual bool Map(double x,double y, flatpoint &src_ret) { return function(x,y, src_ret); }
+};
+
 
 //---------------------------- ImageProcessor --------------------------------------
 class ImageProcessor : public anObject
@@ -57,6 +111,9 @@ class ImageProcessor : public anObject
 	virtual void MakeValueMap(unsigned char *img, int mapwidth, int mapheight, int blur, const DoubleBBox &bounds, flatpoint *points, int numpoints, bool flipy);
 	virtual int GaussianBlur(int radius, char which, unsigned char *img, int orig_width, int orig_height,
 					unsigned char *blurred, bool expand, int depth, int numchannels, int channel_mask );
+	virtual int WarpImage(const unsigned char *src, int src_width, int src_height, int src_stride,
+						  unsigned char *dst, int dst_width, int dst_height, int dst_stride,
+						  WarpMapping *mapping, int filter, int supersample=3);
 };
 
 
@@ -0,0 +1,388 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+
+#include <lax/boxtree.h>
+
+#include <iostream>
+using namespace std;
+#define DBG
+
+
+namespace Laxkit {
+
+
+//---------------------------- BoxTree --------------------------------------
+/*! \class BoxTree
+ * \brief A dynamic bounding volume hierarchy of DoubleBBox leaves.
+ *
+ * Each leaf holds a box, and an arbitrary data pointer and int that the tree does
+ * not touch. Add() returns a proxy id that stays valid until Remove().
+ *
+ * Leaf boxes are padded by margin, so small movements passed to Update() usually
+ * need no change to the tree at all. Otherwise the leaf is removed and reinserted,
+ * which is O(log n). The tree is kept balanced with rotations as it changes, so
+ * there is never any need to rebuild from scratch.
+ *
+ * Queries return leaves whose padded boxes match, so callers should do their own exact
+ * tests on the results.
+ */
+
+
+static double BoxPerimeter(const DoubleBBox &box)
+{
+	return 2 * ((box.maxx - box.minx) + (box.maxy - box.miny));
+}
+
+static void BoxUnion(DoubleBBox &box, const DoubleBBox &b1, const DoubleBBox &b2)
+{
+	box.minx = b1.minx < b2.minx ? b1.minx : b2.minx;
+	box.maxx = b1.maxx > b2.maxx ? b1.maxx : b2.maxx;
+	box.miny = b1.miny < b2.miny ? b1.miny : b2.miny;
+	box.maxy = b1.maxy > b2.maxy ? b1.maxy : b2.maxy;
+}
+
+static bool BoxContains(const DoubleBBox &outer, const DoubleBBox &inner)
+{
+	return outer.minx <= inner.minx && outer.maxx >= inner.maxx
+		&& outer.miny <= inner.miny && outer.maxy >= inner.maxy;
+}
+
+static bool BoxOverlaps(const DoubleBBox &b1, const DoubleBBox &b2)
+{
+	return b1.minx <= b2.maxx && b1.maxx >= b2.minx
+		&& b1.miny <= b2.maxy && b1.maxy >= b2.miny;
+}
+
+
+BoxTree::BoxTree()
+{
+	root      = -1;
+	freelist  = -1;
+	numleaves = 0;
+	margin    = .1;
+}
+
+BoxTree::~BoxTree()
+{
+}
+
+/*! Remove all leaves.
+ */
+void BoxTree::Flush()
+{
+	nodes.clear();
+	root      = -1;
+	freelist  = -1;
+	numleaves = 0;
+}
+
+int BoxTree::AllocateNode()
+{
+	int node;
+	if (freelist != -1) {
+		node = freelist;
+		freelist = nodes[node].parent;
+		nodes[node] = Node();
+	} else {
+		node = nodes.size();
+		nodes.push_back(Node());
+	}
+	nodes[node].height = 0;
+	return node;
+}
+
+void BoxTree::FreeNode(int node)
+{
+	nodes[node].parent = freelist;
+	nodes[node].height = -1;
+	nodes[node].data   = nullptr;
+	freelist = node;
+}
+
+void BoxTree::FattenBox(DoubleBBox &box)
+{
+	double w = box.maxx - box.minx, h = box.maxy - box.miny;
+	double pad = margin * (w > h ? w : h);
+	box.minx -= pad;
+	box.maxx += pad;
+	box.miny -= pad;
+	box.maxy += pad;
+}
+
+/*! Add a new leaf, returning its proxy id. box must be valid, as in box.validbounds().
+ */
+int BoxTree::Add(const DoubleBBox &box, void *data, int info)
+{
+	int leaf = AllocateNode();
+	nodes[leaf].box.setbounds(box.minx, box.maxx, box.miny, box.maxy);
+	FattenBox(nodes[leaf].box);
+	nodes[leaf].data = data;
+	nodes[leaf].info = info;
+
+	InsertLeaf(leaf);
+	numleaves++;
+	return leaf;
+}
+
+void BoxTree::Remove(int proxy)
+{
+	if (proxy < 0 || proxy >= (int)nodes.size() || !nodes[proxy].IsLeaf() || nodes[proxy].height < 0) return;
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	numleaves--;
+}
+
+/*! Change the box of a leaf. If box still fits inside the leaf's padded box, nothing happens
+ * and false is returned. Otherwise the leaf is moved within the tree, and true is returned.
+ */
+bool BoxTree::Update(int proxy, const DoubleBBox &box)
+{
+	if (BoxContains(nodes[proxy].box, box)) return false;
+
+	RemoveLeaf(proxy);
+	nodes[proxy].box.setbounds(box.minx, box.maxx, box.miny, box.maxy);
+	FattenBox(nodes[proxy].box);
+	InsertLeaf(proxy);
+	return true;
+}
+
+/*! Find the cheapest sibling for leaf, by the increase in perimeter it would cause, then
+ * splice in a new parent for the two of them.
+ */
+void BoxTree::InsertLeaf(int leaf)
+{
+	if (root == -1) {
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+
+	DoubleBBox leafbox(nodes[leaf].box); //copy, since AllocateNode() may move nodes
+	DoubleBBox combined;
+	int index = root;
+
+	while (!nodes[index].IsLeaf()) {
+		int child1 = nodes[index].child1;
+		int child2 = nodes[index].child2;
+
+		double area = BoxPerimeter(nodes[index].box);
+		BoxUnion(combined, nodes[index].box, leafbox);
+		double combinedarea = BoxPerimeter(combined);
+
+		 //cost of making a new parent here, and the cost pushed down to kids
+		double cost = 2 * combinedarea;
+		double inheritance = 2 * (combinedarea - area);
+
+		double cost1, cost2;
+		BoxUnion(combined, leafbox, nodes[child1].box);
+		if (nodes[child1].IsLeaf()) cost1 = BoxPerimeter(combined) + inheritance;
+		else cost1 = BoxPerimeter(combined) - BoxPerimeter(nodes[child1].box) + inheritance;
+
+		BoxUnion(combined, leafbox, nodes[child2].box);
+		if (nodes[child2].IsLeaf()) cost2 = BoxPerimeter(combined) + inheritance;
+		else cost2 = BoxPerimeter(combined) - BoxPerimeter(nodes[child2].box) + inheritance;
+
+		if (cost < cost1 && cost < cost2) break;
+		index = (cost1 < cost2 ? child1 : child2);
+	}
+
+	int sibling   = index;
+	int oldparent = nodes[sibling].parent;
+	int newparent = AllocateNode();
+	nodes[newparent].parent = oldparent;
+	BoxUnion(nodes[newparent].box, leafbox, nodes[sibling].box);
+	nodes[newparent].height = nodes[sibling].height + 1;
+	nodes[newparent].child1 = sibling;
+	nodes[newparent].child2 = leaf;
+	nodes[sibling].parent   = newparent;
+	nodes[leaf].parent      = newparent;
+
+	if (oldparent != -1) {
+		if (nodes[oldparent].child1 == sibling) nodes[oldparent].child1 = newparent;
+		else nodes[oldparent].child2 = newparent;
+	} else root = newparent;
+
+	 //walk back up fixing heights and boxes
+	index = nodes[leaf].parent;
+	while (index != -1) {
+		index = Balance(index);
+		int child1 = nodes[index].child1;
+		int child2 = nodes[index].child2;
+		nodes[index].height = 1 + (nodes[child1].height > nodes[child2].height ? nodes[child1].height : nodes[child2].height);
+		BoxUnion(nodes[index].box, nodes[child1].box, nodes[child2].box);
+		index = nodes[index].parent;
+	}
+}
+
+void BoxTree::RemoveLeaf(int leaf)
+{
+	if (leaf == root) {
+		root = -1;
+		return;
+	}
+
+	int parent      = nodes[leaf].parent;
+	int grandparent = nodes[parent].parent;
+	int sibling     = (nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1);
+
+	if (grandparent != -1) {
+		if (nodes[grandparent].child1 == parent) nodes[grandparent].child1 = sibling;
+		else nodes[grandparent].child2 = sibling;
+		nodes[sibling].parent = grandparent;
+		FreeNode(parent);
+
+		int index = grandparent;
+		while (index != -1) {
+			index = Balance(index);
+			int child1 = nodes[index].child1;
+			int child2 = nodes[index].child2;
+			BoxUnion(nodes[index].box, nodes[child1].box, nodes[child2].box);
+			nodes[index].height = 1 + (nodes[child1].height > nodes[child2].height ? nodes[child1].height : nodes[child2].height);
+			index = nodes[index].parent;
+		}
+	} else {
+		root = sibling;
+		nodes[sibling].parent = -1;
+		FreeNode(parent);
+	}
+	nodes[leaf].parent = -1;
+}
+
+/*! If node a is imbalanced, rotate a child up to replace it. Returns the index of the node
+ * now at a's old position.
+ */
+int BoxTree::Balance(int iA)
+{
+	Node *A = &nodes[iA];
+	if (A->IsLeaf() || A->height < 2) return iA;
+
+	int iB = A->child1;
+	int iC = A->child2;
+	Node *B = &nodes[iB];
+	Node *C = &nodes[iC];
+
+	int balance = C->height - B->height;
+
+	if (balance > 1 || balance < -1) {
+		 //rotate the taller child up: P is the taller child, Q the shorter
+		int iP = (balance > 1 ? iC : iB);
+		int iQ = (balance > 1 ? iB : iC);
+		Node *P = &nodes[iP];
+		Node *Q = &nodes[iQ];
+
+		int iF = P->child1;
+		int iG = P->child2;
+		Node *F = &nodes[iF];
+		Node *G = &nodes[iG];
+
+		 //swap A and P
+		P->child1 = iA;
+		P->parent = A->parent;
+		A->parent = iP;
+
+		if (P->parent != -1) {
+			if (nodes[P->parent].child1 == iA) nodes[P->parent].child1 = iP;
+			else nodes[P->parent].child2 = iP;
+		} else root = iP;
+
+		 //the taller of P's kids stays with P, the other goes to A
+		int keep = (F->height > G->height ? iF : iG);
+		int give = (F->height > G->height ? iG : iF);
+		P->child2 = keep;
+		if (balance > 1) { A->child2 = give; A->child1 = iQ; }
+		else             { A->child1 = give; A->child2 = iQ; }
+		nodes[give].parent = iA;
+
+		BoxUnion(A->box, Q->box, nodes[give].box);
+		BoxUnion(P->box, A->box, nodes[keep].box);
+
+		A->height = 1 + (Q->height > nodes[give].height ? Q->height : nodes[give].height);
+		P->height = 1 + (A->height > nodes[keep].height ? A->height : nodes[keep].height);
+
+		return iP;
+	}
+
+	return iA;
+}
+
+/*! Call found(proxy, data) for each leaf whose box contains p. If found returns false,
+ * the search stops early. Returns the number of leaves passed to found.
+ */
+int BoxTree::PointQuery(flatpoint p, std::function<bool(int proxy, void *data)> found)
+{
+	if (root == -1) return 0;
+
+	int n = 0;
+	std::vector<int> stack;
+	stack.push_back(root);
+
+	while (stack.size()) {
+		int node = stack.back();
+		stack.pop_back();
+
+		const DoubleBBox &box = nodes[node].box;
+		if (p.x < box.minx || p.x > box.maxx || p.y < box.miny || p.y > box.maxy) continue;
+
+		if (nodes[node].IsLeaf()) {
+			n++;
+			if (!found(node, nodes[node].data)) break;
+		} else {
+			stack.push_back(nodes[node].child1);
+			stack.push_back(nodes[node].child2);
+		}
+	}
+
+	return n;
+}
+
+/*! Call found(proxy, data) for each leaf whose box overlaps box. If found returns false,
+ * the search stops early. Returns the number of leaves passed to found.
+ */
+int BoxTree::BoxQuery(const DoubleBBox &box, std::function<bool(int proxy, void *data)> found)
+{
+	if (root == -1) return 0;
+
+	int n = 0;
+	std::vector<int> stack;
+	stack.push_back(root);
+
+	while (stack.size()) {
+		int node = stack.back();
+		stack.pop_back();
+
+		if (!BoxOverlaps(nodes[node].box, box)) continue;
+
+		if (nodes[node].IsLeaf()) {
+			n++;
+			if (!found(node, nodes[node].data)) break;
+		} else {
+			stack.push_back(nodes[node].child1);
+			stack.push_back(nodes[node].child2);
+		}
+	}
+
+	return n;
+}
+
+
+} //namespace Laxkit
+
@@ -0,0 +1,90 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+#ifndef _LAX_BOXTREE_H
+#define _LAX_BOXTREE_H
+
+
+#include <lax/doublebbox.h>
+
+#include <functional>
+#include <vector>
+
+
+namespace Laxkit {
+
+
+//---------------------------- BoxTree --------------------------------------
+class BoxTree
+{
+  protected:
+	class Node
+	{
+	  public:
+		DoubleBBox box; //fattened box for leaves, union of kids otherwise
+		int parent; //also used as next free node when unused
+		int child1, child2; //-1 for leaves
+		int height; //0 for leaves, -1 for unused nodes
+		void *data;
+		int info;
+		Node() { parent = child1 = child2 = -1; height = -1; data = nullptr; info = 0; }
+		bool IsLeaf() const { return child1 == -1; }
+	};
+
+	std::vector<Node> nodes;
+	int root;
+	int freelist;
+	int numleaves;
+
+	virtual int AllocateNode();
+	virtual void FreeNode(int node);
+	virtual void InsertLeaf(int leaf);
+	virtual void RemoveLeaf(int leaf);
+	virtual int Balance(int node);
+	virtual void FattenBox(DoubleBBox &box);
+
+  public:
+	double margin; //fraction of a box's larger dimension to pad leaf boxes by
+
+	BoxTree();
+	virtual ~BoxTree();
+
+	virtual int Add(const DoubleBBox &box, void *data, int info = 0);
+	virtual void Remove(int proxy);
+	virtual bool Update(int proxy, const DoubleBBox &box);
+	virtual void Flush();
+
+	virtual int NumLeaves() { return numleaves; }
+	virtual int Height() { return root == -1 ? 0 : nodes[root].height; }
+	virtual void *Data(int proxy) { return nodes[proxy].data; }
+	virtual int Info(int proxy) { return nodes[proxy].info; }
+	virtual void Info(int proxy, int newinfo) { nodes[proxy].info = newinfo; }
+	virtual const DoubleBBox &Box(int proxy) { return nodes[proxy].box; }
+
+	virtual int PointQuery(flatpoint p, std::function<bool(int proxy, void *data)> found);
+	virtual int BoxQuery(const DoubleBBox &box, std::function<bool(int proxy, void *data)> found);
+};
+
+
+} //namespace Laxkit
+
+#endif
+
@@ -115,6 +115,7 @@ void DisplayerCairo::base_init()
 	tbufferlen = 0;
 
 	isinternal = 0;
+	damage_clip = false;
 	imagebuffer = nullptr;
 
 #ifdef _LAX_PLATFORM_XLIB
@@ -325,7 +326,10 @@ int DisplayerCairo::MakeCurrent(aDrawable *buffer)
 		cr = nullptr;
 	}
 
-	if (cr && surface && buffer == dr && w == buffer->xlibDrawable()) return 0; //already current!
+	if (cr && surface && buffer == dr && w == buffer->xlibDrawable()) { //already current!
+		ClipToDamage();
+		return 0;
+	}
 
 	dr = buffer;
 	xw = dynamic_cast<anXWindow*>(buffer);
@@ -379,6 +383,8 @@ int DisplayerCairo::MakeCurrent(aDrawable *buffer)
 	}
 
 
+	ClipToDamage();
+
 	cairo_matrix_t m;
 	//transform_identity(ctm);
 	if (real_coordinates) cairo_matrix_init(&m, ctm[0], ctm[1], ctm[2], ctm[3], ctm[4], ctm[5]);
@@ -389,6 +395,32 @@ int DisplayerCairo::MakeCurrent(aDrawable *buffer)
 	return 0;
 }
 
+/*! If the current window only needs part of itself redrawn (see anXWindow::Invalidate()),
+ * then clip to just those areas. Otherwise remove any such clip left from before.
+ */
+void DisplayerCairo::ClipToDamage()
+{
+	if (!cr) return;
+
+	if (xw && xw->PartialDamage()) {
+		cairo_reset_clip(cr);
+		cairo_save(cr);
+		cairo_identity_matrix(cr);
+		cairo_new_path(cr);
+		for (int c=0; c<xw->NumDamageRects(); c++) {
+			const IntRectangle *r = xw->DamageRect(c);
+			cairo_rectangle(cr, r->x,r->y, r->width,r->height);
+		}
+		cairo_restore(cr); //restores matrix, path is kept in device space
+		cairo_clip(cr);
+		damage_clip = true;
+
+	} else if (damage_clip) {
+		cairo_reset_clip(cr);
+		damage_clip = false;
+	}
+}
+
 ////! Find out what type of surface is currently set to be drawn on.
 ///*! 1 for internal surface, 2 for aDrawable, 3 for a back buffer of aDrawable.
 // * 4 for mask.
@@ -1479,6 +1511,40 @@ double DisplayerCairo::textout_line(double x,double y,const char *str,int len,un
 
 	if (!curfont) initFont();
 
+	 //Single layer fonts are drawn from a cached glyph run, except on surfaces like pdf that
+	 //want the actual text too
+	if (laxfont->Layers() == 1 && !cairo_surface_has_show_text_glyphs(cairo_get_target(cr))) {
+		ShapedRun *run = textRun(tbuffer, len);
+		if (run) {
+			unsigned int numglyphs = run->glyphs.size();
+			if (numglyphs > numalloc_glyphs) {
+				delete[] cairo_glyphs;
+				cairo_glyphs = new cairo_glyph_t[numglyphs+10];
+				numalloc_glyphs = numglyphs+10;
+			}
+
+			double ox,oy;
+			if (align & LAX_LEFT) ox = x;
+			else if (align & LAX_RIGHT) ox = x-run->width;
+			else ox = x - run->width/2; //center
+
+			if (align & LAX_TOP) oy = y + curfont_extents.ascent;
+			else if (align & LAX_BOTTOM) oy = y - (curfont_extents.height-curfont_extents.ascent);
+			else if (align & LAX_BASELINE) oy = y;
+			else oy = y - (curfont_extents.height)/2 + curfont_extents.ascent; //center
+
+			for (unsigned int i = 0; i < numglyphs; i++) {
+				cairo_glyphs[i].index = run->glyphs[i].index;
+				cairo_glyphs[i].x     = ox + run->glyphs[i].x;
+				cairo_glyphs[i].y     = oy + run->glyphs[i].y;
+			}
+
+			cairo_show_glyphs(cr, cairo_glyphs, numglyphs);
+			cairo_fill(cr);
+			return run->x_advance;
+		}
+	}
+
 	cairo_text_extents_t extents;
 	cairo_text_extents(cr, tbuffer, &extents);
 
@@ -1529,6 +1595,57 @@ double DisplayerCairo::textout_line(double x,double y,const char *str,int len,un
 	return extents.x_advance;
 }
 
+/*! Return the cached glyph run for the first len bytes of str with the current font and
+ * transform, making it with cairo_scaled_font_text_to_glyphs() if necessary.
+ * See ShapedTextCache for how long the returned run is valid.
+ */
+ShapedRun *DisplayerCairo::textRun(const char *str, int len)
+{
+	if (!cr || !laxfont) return nullptr;
+
+	cairo_matrix_t fm, ctm;
+	cairo_get_font_matrix(cr, &fm);
+	cairo_get_matrix(cr, &ctm);
+	double m[8] = { fm.xx, fm.yx, fm.xy, fm.yy, ctm.xx, ctm.yx, ctm.xy, ctm.yy };
+
+	std::string key;
+	ShapedTextCache::KeyAppend(key, "cairo", 5);
+	ShapedTextCache::KeyFont(key, laxfont);
+	ShapedTextCache::KeyAppend(key, m, sizeof(m));
+	ShapedTextCache::KeyAppend(key, str, len);
+
+	ShapedTextCache *shapecache = ShapedTextCache::GetDefault();
+	ShapedRun *run = shapecache->Find(key);
+	if (run) return run;
+
+	cairo_glyph_t *glyphs = nullptr;
+	int numglyphs = 0;
+	if (cairo_scaled_font_text_to_glyphs(cairo_get_scaled_font(cr), 0,0, str,len, &glyphs,&numglyphs, nullptr,nullptr,nullptr)
+			!= CAIRO_STATUS_SUCCESS)
+		return nullptr;
+
+	cairo_text_extents_t extents;
+	cairo_glyph_extents(cr, glyphs, numglyphs, &extents);
+
+	run = new ShapedRun;
+	run->glyphs.resize(numglyphs);
+	for (int i = 0; i < numglyphs; i++) {
+		GlyphPlace &glyph = run->glyphs[i];
+		glyph.index     = glyphs[i].index;
+		glyph.x         = glyphs[i].x;
+		glyph.y         = glyphs[i].y;
+		glyph.x_advance = (i < numglyphs-1 ? glyphs[i+1].x : extents.x_advance) - glyphs[i].x;
+		glyph.y_advance = (i < numglyphs-1 ? glyphs[i+1].y : extents.y_advance) - glyphs[i].y;
+	}
+	run->x_advance = extents.x_advance;
+	run->y_advance = extents.y_advance;
+	run->width     = extents.width;
+	run->height    = extents.height;
+
+	cairo_glyph_free(glyphs);
+	return shapecache->Add(key, run);
+}
+
 /*! len must specify how many glyphs in glyphs.
  *
  * x,y will be added to the x,y in the glyphs, and those new coordinates will be drawn
@@ -1568,13 +1685,15 @@ double DisplayerCairo::glyphsout(double x,double y, GlyphPlace *glyphs,GlyphPlac
 	}
 
 
-	cairo_text_extents_t extents;
-	cairo_glyph_extents(cr, cairo_glyphs, numglyphs, &extents);
-
 	double ox,oy;
 	if (align&LAX_LEFT) ox=x;
-	else if (align&LAX_RIGHT) ox=x-extents.width;
-	else ox=x-extents.width/2; //center
+	else {
+		 //only need extents when not left aligned
+		cairo_text_extents_t extents;
+		cairo_glyph_extents(cr, cairo_glyphs, numglyphs, &extents);
+		if (align&LAX_RIGHT) ox=x-extents.width;
+		else ox=x-extents.width/2; //center
+	}
 
 	if (align&LAX_TOP) oy=y+curfont_extents.ascent;
 	else if (align&LAX_BOTTOM) oy=y-(curfont_extents.height-curfont_extents.ascent);
@@ -33,6 +33,7 @@
 #include <cairo/cairo-ft.h>
 
 #include <lax/fontmanager-cairo.h>
+#include <lax/shapedtextcache.h>
 #include <lax/displayer.h>
 
 
@@ -44,6 +45,7 @@ class DisplayerCairo : public Displayer
 	char *tbuffer;
 	int tbufferlen;
 	virtual int reallocBuffer(int len);
+	virtual ShapedRun *textRun(const char *str, int len);
 
 	LaxImage *imagebuffer;
 	Display *dpy;  //if any
@@ -80,6 +82,9 @@ class DisplayerCairo : public Displayer
 	double height_over_M;
 	double _textheight; //user value, not a cairo value
 
+	bool damage_clip; //whether cr is clipped to an anXWindow's damage
+	virtual void ClipToDamage();
+
 	void base_init();
 
  public:
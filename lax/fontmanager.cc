@@ -23,11 +23,21 @@
 
 #include <lax/fontmanager.h>
 #include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <string>
+#include <unordered_map>
 
 #include <lax/misc.h>
 #include <lax/anxapp.h>
 #include <lax/strmanip.h>
 #include <lax/fileutils.h>
+#include <lax/freedesktop.h>
+#include <lax/threadpool.h>
 #include <lax/language.h>
 #include <lax/colors.h>
 #include <lax/resourcetypes.h>
@@ -255,6 +265,19 @@ int LaxFont::CopyVariations(LaxFont *from_this)
 	return user_features.size() + variation_data.size();
 }
 
+/*! Append the current variation axis values and user features as raw bytes to key,
+ * for caches of things that depend on them, like ShapedTextCache.
+ */
+void LaxFont::VariationKey(std::string &key)
+{
+	int n = variation_data.size();
+	key.append((const char*)&n, sizeof(n));
+	if (n) key.append((const char*)variation_data.data(), n * sizeof(hb_variation_t));
+	n = user_features.size();
+	key.append((const char*)&n, sizeof(n));
+	if (n) key.append((const char*)user_features.data(), n * sizeof(hb_feature_t));
+}
+
 /*! Default just return this->family.
  */
 const char *LaxFont::Family()
@@ -746,6 +769,11 @@ FontManager::FontManager()
 {
 	fcconfig   = nullptr;
 	ft_library = nullptr;
+
+	use_font_catalog = true;
+	verify_catalog_in_background = false;
+	font_catalog_notify = 0;
+	font_catalog_key = 0;
 }
 
 FontManager::~FontManager()
@@ -818,88 +846,385 @@ static int cmp_fontinfo_file(const void *f1p, const void *f2p)
 }
 
 
-/*! If this->fonts.n>0, then just return &this->fonts.
- * Else populate then return it, based on what FontConfig says is laying around.
+//--------------------------- Font catalog cache ------------------------------------------
+
+/*! \page fontcatalog Font catalog
+ *
+ * Pulling info for every installed font out of fontconfig can take seconds when there are
+ * thousands of fonts, so FontManager::GetFontList() keeps a binary catalog of what it found
+ * in FontManager::FontCatalogFile(). The catalog is keyed on the modification times of the
+ * fontconfig configuration files and of every directory under the configured font directories,
+ * the same way fontconfig decides whether its own caches are stale. It is mapped and used
+ * directly when the key matches, and rewritten after a full scan otherwise.
+ *
+ * The file is a FontCatalogHeader, followed by numfonts FontCatalogRecord, followed by a block of
+ * '\0' terminated strings that records point into. It is only meant to be read by the same build
+ * on the same machine, so everything is native byte order.
  */
-PtrStack<FontDialogFont> *FontManager::GetFontList()
+
+#define FONT_CATALOG_VERSION 1
+
+struct FontCatalogHeader
 {
-	if (fonts.n) return &fonts;
-	
-	if (!fcconfig) GetConfig(); //inits fontconfig
+	char magic[8]; // "LaxFCat"
+	uint32_t version;
+	uint32_t numfonts;
+	uint64_t key;
+	uint64_t strings_size;
+};
 
+struct FontCatalogRecord
+{
+	uint32_t family, style, psname, file, format; //1 + offset into strings, or 0 for null
+	int32_t index;
+	uint8_t has_color;
+	uint8_t variable;
+	uint8_t padding[2];
+};
 
-	DBG cerr <<"Scanning for installed fonts..."<<endl;
+static const char font_catalog_magic[8] = { 'L','a','x','F','C','a','t','\0' };
 
-     // Read in all the fonts, and arrange to make using the list a little more ui friendly
-    FcResult result;
-    FcValue v;
+/*! Read only map of a font catalog file. entries point into the map.
+ */
+class FontCatalogMap
+{
+  public:
+	void *data;
+	size_t size;
+	uint64_t key;
+	std::vector<FontCatalogEntry> entries;
+
+	FontCatalogMap() { data = nullptr; size = 0; key = 0; }
+	~FontCatalogMap() { if (data) munmap(data, size); }
+	int Load(const char *file);
+};
 
-	const char *format = nullptr;
-    FontDialogFont *f = nullptr;
-    FcFontSet *fontset = FcConfigGetFonts(fcconfig, FcSetSystem); //"This font set is owned by the library and must not be modified or freed"
+/*! Map file and fill entries. Returns 0 for success, or nonzero for missing, corrupt, or
+ * wrong version of file.
+ */
+int FontCatalogMap::Load(const char *file)
+{
+	int fd = open(file, O_RDONLY);
+	if (fd < 0) return 1;
 
-    tags.push(new FontTag(-1, FontTag::TAG_Favorite, _("Favorites")));
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size < sizeof(FontCatalogHeader)) {
+		close(fd);
+		return 2;
+	}
+
+	size = st.st_size;
+	data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		data = nullptr;
+		return 3;
+	}
+
+	const FontCatalogHeader *header = (const FontCatalogHeader*)data;
+	if (memcmp(header->magic, font_catalog_magic, sizeof(font_catalog_magic)) != 0
+			|| header->version != FONT_CATALOG_VERSION
+			|| size != sizeof(FontCatalogHeader) + header->numfonts * sizeof(FontCatalogRecord) + header->strings_size)
+		return 4;
+
+	const FontCatalogRecord *records = (const FontCatalogRecord*)(header + 1);
+	const char *strings = (const char*)(records + header->numfonts);
+	uint64_t strings_size = header->strings_size;
+	if (strings_size && strings[strings_size-1] != '\0') return 5;
+
+	bool ok = true;
+	auto str = [&](uint32_t offset) -> const char* {
+		if (offset == 0) return nullptr;
+		if (offset > strings_size) { ok = false; return nullptr; }
+		return strings + offset - 1;
+	};
+
+	entries.resize(header->numfonts);
+	for (unsigned int c = 0; c < header->numfonts; c++) {
+		FontCatalogEntry &entry = entries[c];
+		entry.family    = str(records[c].family);
+		entry.style     = str(records[c].style);
+		entry.psname    = str(records[c].psname);
+		entry.file      = str(records[c].file);
+		entry.format    = str(records[c].format);
+		entry.index     = records[c].index;
+		entry.has_color = records[c].has_color;
+		entry.variable  = records[c].variable;
+	}
+	if (!ok || entries.size() != header->numfonts) {
+		entries.clear();
+		return 6;
+	}
+
+	key = header->key;
+	return 0;
+}
+
+/*! Write entries to file, along with key. The file is written under a temporary name
+ * and renamed over file, so readers always see a whole catalog.
+ * Returns 0 for success or nonzero for error.
+ */
+int FontManager::SaveFontCatalog(const char *file, uint64_t key, std::vector<FontCatalogEntry> &entries)
+{
+	if (!file) return 1;
+
+	 //gather strings, reusing duplicates like family and format names
+	std::string strings;
+	std::unordered_map<std::string, uint32_t> offsets;
+	auto add = [&](const char *str) -> uint32_t {
+		if (!str) return 0;
+		auto found = offsets.find(str);
+		if (found != offsets.end()) return found->second;
+		uint32_t offset = strings.size() + 1;
+		strings.append(str);
+		strings.push_back('\0');
+		offsets[str] = offset;
+		return offset;
+	};
+
+	std::vector<FontCatalogRecord> records(entries.size());
+	for (unsigned int c = 0; c < entries.size(); c++) {
+		FontCatalogRecord &record = records[c];
+		memset(&record, 0, sizeof(record));
+		record.family    = add(entries[c].family);
+		record.style     = add(entries[c].style);
+		record.psname    = add(entries[c].psname);
+		record.file      = add(entries[c].file);
+		record.format    = add(entries[c].format);
+		record.index     = entries[c].index;
+		record.has_color = entries[c].has_color;
+		record.variable  = entries[c].variable;
+	}
+
+	FontCatalogHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, font_catalog_magic, sizeof(font_catalog_magic));
+	header.version      = FONT_CATALOG_VERSION;
+	header.numfonts     = records.size();
+	header.key          = key;
+	header.strings_size = strings.size();
+
+	char *dir = lax_dirname(file, 0);
+	if (dir) check_dirs(dir, true);
+	delete[] dir;
+
+	 //unique per call, since a background refresh might be saving at the same time
+	char tmpfile[strlen(file) + 30];
+	sprintf(tmpfile, "%s.XXXXXX", file);
+	int fd = mkstemp(tmpfile);
+	if (fd < 0) return 2;
+	fchmod(fd, 0644);
+
+	FILE *f = fdopen(fd, "wb");
+	if (!f) {
+		close(fd);
+		unlink(tmpfile);
+		return 2;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+	if (ok && records.size()) ok = fwrite(records.data(), sizeof(FontCatalogRecord), records.size(), f) == records.size();
+	if (ok && strings.size()) ok = fwrite(strings.data(), 1, strings.size(), f) == strings.size();
+	if (fclose(f) != 0) ok = false;
+
+	if (!ok || rename(tmpfile, file) != 0) {
+		unlink(tmpfile);
+		return 3;
+	}
+	return 0;
+}
+
+//! FNV-1a
+static uint64_t font_catalog_hash(uint64_t h, const void *data, size_t len)
+{
+	const unsigned char *d = (const unsigned char*)data;
+	for (size_t c = 0; c < len; c++) {
+		h ^= d[c];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+static uint64_t font_catalog_hash_file(uint64_t h, const char *path, struct stat *st_ret = nullptr)
+{
+	struct stat st;
+	h = font_catalog_hash(h, path, strlen(path));
+	if (stat(path, &st) == 0) {
+		h = font_catalog_hash(h, &st.st_mtim.tv_sec,  sizeof(st.st_mtim.tv_sec));
+		h = font_catalog_hash(h, &st.st_mtim.tv_nsec, sizeof(st.st_mtim.tv_nsec));
+		h = font_catalog_hash(h, &st.st_ino, sizeof(st.st_ino));
+		if (st_ret) *st_ret = st;
+	} else if (st_ret) st_ret->st_mode = 0;
+	return h;
+}
+
+/*! Hash dir and all directories below it. Subdirectories are combined by addition,
+ * so the order readdir() returns them in does not matter.
+ */
+static uint64_t font_catalog_hash_dir(const char *dir, int depth)
+{
+	struct stat st;
+	uint64_t h = font_catalog_hash_file(14695981039346656037ULL, dir, &st);
+	if (!S_ISDIR(st.st_mode) || depth > 16) return h;
+
+	DIR *d = opendir(dir);
+	if (!d) return h;
+
+	uint64_t sub = 0;
+	std::string path;
+	struct dirent *entry;
+	while ((entry = readdir(d))) {
+		if (entry->d_type != DT_DIR && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) continue;
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+
+		path = dir;
+		if (path.back() != '/') path.push_back('/');
+		path.append(entry->d_name);
+		if (entry->d_type != DT_DIR && !(stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))) continue;
+
+		sub += font_catalog_hash_dir(path.c_str(), depth+1);
+	}
+	closedir(d);
+
+	return font_catalog_hash(h, &sub, sizeof(sub));
+}
+
+/*! Return xdg_cache_home()/laxkit/fontcatalog.
+ */
+const char *FontManager::FontCatalogFile()
+{
+	static Utf8String catalog_file;
+	if (catalog_file.IsEmpty()) {
+		catalog_file = xdg_cache_home();
+		catalog_file.Append("/laxkit/fontcatalog");
+	}
+	return catalog_file.c_str();
+}
+
+/*! Return a key that changes whenever fontconfig's configuration files, or any directory
+ * it looks for fonts in, changes. This only loads fontconfig's configuration, not its fonts,
+ * and is safe to call from any thread.
+ */
+uint64_t FontManager::FontCatalogKey()
+{
+	uint64_t h = 14695981039346656037ULL;
+	int version = FONT_CATALOG_VERSION;
+	h = font_catalog_hash(h, &version, sizeof(version));
+	version = FcGetVersion();
+	h = font_catalog_hash(h, &version, sizeof(version));
+
+	FcConfig *config = FcInitLoadConfig();
+	if (!config) return h;
+
+	FcStrList *list = FcConfigGetConfigFiles(config);
+	FcChar8 *str;
+	if (list) {
+		while ((str = FcStrListNext(list))) h = font_catalog_hash_file(h, (const char*)str);
+		FcStrListDone(list);
+	}
+
+	list = FcConfigGetFontDirs(config);
+	if (list) {
+		while ((str = FcStrListNext(list))) {
+			uint64_t dirhash = font_catalog_hash_dir((const char*)str, 0);
+			h = font_catalog_hash(h, &dirhash, sizeof(dirhash));
+		}
+		FcStrListDone(list);
+	}
+
+	FcConfigDestroy(config);
+	if (h == 0) h = 1; //0 means no key
+	return h;
+}
+
+/*! Whether GetFontList() should use the font catalog cache. Default is to use it.
+ *
+ * If verify_in_background, then GetFontList() uses whatever catalog exists without checking
+ * that it is current, and then checks it with RefreshFontCatalog(notify_object).
+ */
+void FontManager::UseFontCatalog(bool use, bool verify_in_background, unsigned long notify_object)
+{
+	use_font_catalog = use;
+	verify_catalog_in_background = verify_in_background;
+	font_catalog_notify = notify_object;
+}
+
+/*! In a ThreadPool job, check whether the font catalog is stale compared to the fonts we have.
+ * If so, scan fonts again with a separate FcConfig and save a new catalog. If notify_object!=0,
+ * then it is sent a SimpleMessage "fontCatalogChanged" with info1 being the new number of fonts.
+ * The current font list is not changed. Receivers can decide whether to restart, or have
+ * the user do so.
+ *
+ * Returns 0 for job started, or nonzero for catalog not in use.
+ */
+int FontManager::RefreshFontCatalog(unsigned long notify_object)
+{
+	if (!use_font_catalog) return 1;
+
+	Utf8String catalog(FontCatalogFile());
+	uint64_t old_key = font_catalog_key;
+
+	ThreadPool::GetDefault()->Submit([catalog, old_key, notify_object]() {
+		uint64_t key = FontCatalogKey();
+		if (key == old_key) return;
+
+		FcConfig *config = FcInitLoadConfigAndFonts();
+		if (!config) return;
+
+		std::vector<FontCatalogEntry> entries;
+		ScanFonts(config, entries);
+		SaveFontCatalog(catalog.c_str(), key, entries);
+		FcConfigDestroy(config);
+
+		if (notify_object && anXApp::app) {
+			anXApp::app->SendMessage(new SimpleMessage(nullptr, entries.size(),0,0,0), notify_object, "fontCatalogChanged", 0);
+		}
+	});
+
+	return 0;
+}
+
+/*! Append info about each font in config to entries. Strings point into config's font patterns.
+ * Safe to call from any thread, as long as config is not used elsewhere at the same time.
+ * Returns number of fonts added.
+ */
+int FontManager::ScanFonts(FcConfig *config, std::vector<FontCatalogEntry> &entries)
+{
+    FcResult result;
+    FcValue v;
+    FcFontSet *fontset = FcConfigGetFonts(config, FcSetSystem); //"This font set is owned by the library and must not be modified or freed"
+	if (!fontset) return 0;
 
+	int n = 0;
     for (int c = 0; c < fontset->nfont; c++) {
          // Usually, for each font family, there are several styles
          // like bold, italic, etc.
         result = FcPatternGet(fontset->fonts[c],FC_FAMILY,0,&v);
         if (result != FcResultMatch) continue;
 
-        f = new FontDialogFont(c);
-        f->fc_pattern = fontset->fonts[c];
-
-        makestr(f->family, (const char *)v.u.s);
+		FontCatalogEntry entry;
+		entry.family = (const char *)v.u.s;
+		entry.fc_pattern = fontset->fonts[c];
 
         result = FcPatternGet(fontset->fonts[c],FC_STYLE,0,&v);
-        if (result == FcResultMatch) makestr(f->style, (const char *)v.u.s);
+        if (result == FcResultMatch) entry.style = (const char *)v.u.s;
 
         result = FcPatternGet(fontset->fonts[c],FC_POSTSCRIPT_NAME,0,&v);
-        if (result == FcResultMatch) makestr(f->psname, (const char *)v.u.s);
+        if (result == FcResultMatch) entry.psname = (const char *)v.u.s;
 
         result = FcPatternGet(fontset->fonts[c],FC_FILE,0,&v);
-        if (result == FcResultMatch) makestr(f->file, (const char *)v.u.s);
+        if (result == FcResultMatch) entry.file = (const char *)v.u.s;
 
         result = FcPatternGet(fontset->fonts[c],FC_INDEX,0,&v);
-        if (result == FcResultMatch) f->index = v.u.i;
+        if (result == FcResultMatch) entry.index = v.u.i;
 
         result = FcPatternGet(fontset->fonts[c],FC_FONTFORMAT,0,&v);
-        if (result == FcResultMatch) format = (const char *)v.u.s; else format = nullptr;
-		if (format != nullptr) {
-			int id = GetTagId(format);
-			if (id == -1) {
-				tags.push(new FontTag(-1, FontTag::TAG_Format, format)); //puts at end 
-				f->id = tags.e[tags.n-1]->id;
-			} else f->id = id;
-			if (id > -1) f->AddTag(id);
-		}
+        if (result == FcResultMatch) entry.format = (const char *)v.u.s;
 
 		result = FcPatternGet(fontset->fonts[c], FC_COLOR, 0, &v);
-		if (result == FcResultMatch) {
-			f->has_color = v.u.b;
-
-			if (f->has_color) {
-				int tag_id = GetTagId(_("Color"));
-				if (tag_id == -1) {
-					tags.push(new FontTag(-1, FontTag::TAG_Color, _("Color"))); //puts at end 
-					tag_id = tags.e[tags.n-1]->id;
-				}
-				if (tag_id > -1) f->AddTag(tag_id);
-			}
-		}
+		if (result == FcResultMatch) entry.has_color = v.u.b;
 
 		result = FcPatternGet(fontset->fonts[c], FC_VARIABLE, 0, &v);
-		if (result == FcResultMatch) {
-			//DBG if (v.u.b) cerr << "TODO! implement FC_VARIABLE retrieval with fontconfig: " << v.u.b << endl;
-			if (v.u.b) {
-				int tag_id = GetTagId(_("Variable"));
-				if (tag_id == -1) {
-					tags.push(new FontTag(-1, FontTag::TAG_Other, _("Variable"))); //puts at end 
-					tag_id = tags.e[tags.n-1]->id;
-				}
-				if (tag_id > -1) f->AddTag(tag_id);
-			}
-		}
+		if (result == FcResultMatch) entry.variable = v.u.b;
 
 		result = FcPatternGet(fontset->fonts[c], FC_FONT_VARIATIONS, 0, &v);
 		if (result == FcResultMatch) {
@@ -913,9 +1238,6 @@ PtrStack<FontDialogFont> *FontManager::GetFontList()
 			DBG cerr << "TODO! implement FC_FONT_FEATURES retrieval with fontconfig: " << (const char *)v.u.s << endl;
 		}
 
-		f->UseFamilyStyleName();
-		//f->UsePSName();
-
         //FC_OUTLINE
         //FC_SCALABLE
         //FC_LANG -> string of languages like "en|es|bs|ch"
@@ -923,6 +1245,115 @@ PtrStack<FontDialogFont> *FontManager::GetFontList()
         //FC_FONTFORMAT
         //FC_FONT_FEATURES
 
+		entries.push_back(entry);
+		n++;
+	}
+
+	return n;
+}
+
+
+/*! If this->fonts.n>0, then just return &this->fonts.
+ * Else populate then return it, based on what FontConfig says is laying around.
+ *
+ * Unless turned off with UseFontCatalog(), what is found is saved to a catalog file, which is
+ * used instead of querying fontconfig as long as no font directories have changed.
+ */
+PtrStack<FontDialogFont> *FontManager::GetFontList()
+{
+	if (fonts.n) return &fonts;
+
+	const char *catalog = (use_font_catalog ? FontCatalogFile() : nullptr);
+	uint64_t key = 0;
+
+	if (catalog) {
+		if (!verify_catalog_in_background) key = FontCatalogKey();
+
+		FontCatalogMap map;
+		if (map.Load(catalog) == 0 && (verify_catalog_in_background || map.key == key)) {
+			DBG cerr <<"Using font catalog "<<catalog<<" with "<<map.entries.size()<<" fonts"<<endl;
+			font_catalog_key = map.key;
+			BuildFontList(map.entries);
+			if (verify_catalog_in_background) RefreshFontCatalog(font_catalog_notify);
+			return &fonts;
+		}
+
+		if (!key) key = FontCatalogKey();
+	}
+
+	if (!fcconfig) GetConfig(); //inits fontconfig
+
+	DBG cerr <<"Scanning for installed fonts..."<<endl;
+
+	std::vector<FontCatalogEntry> entries;
+	ScanFonts(fcconfig, entries);
+
+	if (catalog) {
+		if (SaveFontCatalog(catalog, key, entries) == 0) font_catalog_key = key;
+		else cerr << " *** could not write font catalog "<<catalog<<endl;
+	}
+
+	BuildFontList(entries);
+
+	DBG cerr <<"Done scanning for installed fonts."<<endl;
+
+	return &fonts;
+}
+
+/*! Populate this->fonts and format tags from entries, as from fontconfig or the font catalog.
+ * FontDialogFont::fc_pattern is only set for entries from fontconfig.
+ */
+void FontManager::BuildFontList(std::vector<FontCatalogEntry> &entries)
+{
+	const char *format = nullptr;
+    FontDialogFont *f = nullptr;
+
+    tags.push(new FontTag(-1, FontTag::TAG_Favorite, _("Favorites")));
+
+    for (unsigned int c = 0; c < entries.size(); c++) {
+		FontCatalogEntry &entry = entries[c];
+
+        f = new FontDialogFont(c);
+
+        makestr(f->family, entry.family);
+        if (entry.style)  makestr(f->style,  entry.style);
+        if (entry.psname) makestr(f->psname, entry.psname);
+        if (entry.file)   makestr(f->file,   entry.file);
+        f->index = entry.index;
+        f->fc_pattern = entry.fc_pattern;
+
+        format = entry.format;
+		if (format != nullptr) {
+			int id = GetTagId(format);
+			if (id == -1) {
+				tags.push(new FontTag(-1, FontTag::TAG_Format, format)); //puts at end 
+				f->id = tags.e[tags.n-1]->id;
+			} else f->id = id;
+			if (id > -1) f->AddTag(id);
+		}
+
+		f->has_color = entry.has_color;
+		if (f->has_color) {
+			int tag_id = GetTagId(_("Color"));
+			if (tag_id == -1) {
+				tags.push(new FontTag(-1, FontTag::TAG_Color, _("Color"))); //puts at end 
+				tag_id = tags.e[tags.n-1]->id;
+			}
+			if (tag_id > -1) f->AddTag(tag_id);
+		}
+
+		if (entry.variable) {
+			int tag_id = GetTagId(_("Variable"));
+			if (tag_id == -1) {
+				tags.push(new FontTag(-1, FontTag::TAG_Other, _("Variable"))); //puts at end 
+				tag_id = tags.e[tags.n-1]->id;
+			}
+			if (tag_id > -1) f->AddTag(tag_id);
+		}
+
+		f->UseFamilyStyleName();
+		//f->UsePSName();
+
         DBG cerr <<c<<", found font: Family,style,file: "
         DBG      <<(f->family ? f->family : "null") << ", "
         DBG      <<(f->style ? f->style : "null") << ", "
@@ -964,11 +1395,7 @@ PtrStack<FontDialogFont> *FontManager::GetFontList()
 	//     - maybe diff the files' basenames. if still the same, just say "(file 1)", "(file 2)", etc.
 	
 
-	DBG cerr <<"Done scanning for installed fonts."<<endl;
-
 	RetrieveFontmatrixTags();
-
-	return &fonts;
 }
 
 
@@ -23,6 +23,7 @@
 #define _LAX_FONTMANAGER_H
 
 #include <cstdlib>
+#include <cstdint>
 #include <fontconfig/fontconfig.h>
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -31,6 +32,7 @@
 #include <harfbuzz/hb-ot.h>
 
 #include <vector>
+#include <string>
 
 #include <lax/anobject.h>
 #include <lax/errorlog.h>
@@ -159,6 +161,7 @@ class LaxFont : public Resourceable
 	virtual double GetAxis(int index) const = 0;
 	virtual bool SetFeature(const char *feature, bool active) = 0;
 	virtual int CopyVariations(LaxFont *from_this);
+	virtual void VariationKey(std::string &key);
 
 	virtual int HasColors() { return 0; } //1 for is manual layered font, 2 for colr based, 3 for svg
 	virtual anObject *GetColor() { return color; } //a Color or Palette
@@ -192,7 +195,7 @@ class FontDialogFont
     IntTagged tags;
 	int favorite; //num is rank in fav list, starting with 1. 0 is not favorite
 
-	FcPattern *fc_pattern; //owned by the master list
+	FcPattern *fc_pattern; //owned by the master list. nullptr when the list came from the font catalog
 
 	int variations_state = -1; //-1 for unknown, 0 for none, 1 for already queried
 	std::vector<Utf8String> feature_tags;
@@ -227,6 +230,25 @@ class LayeredDialogFont : public FontDialogFont
     virtual ~LayeredDialogFont() { if (palette) palette->dec_count(); }
 };
 
+//--------------------------- FontCatalogEntry ------------------------------------------
+/*! \struct FontCatalogEntry
+ * Raw font info, as read from fontconfig or the on disk font catalog cache. The strings
+ * point into whatever the entry was read from, and are only valid while that is around.
+ */
+struct FontCatalogEntry
+{
+	const char *family = nullptr;
+	const char *style  = nullptr;
+	const char *psname = nullptr;
+	const char *file   = nullptr;
+	const char *format = nullptr;
+	int index      = 0;
+	bool has_color = false;
+	bool variable  = false;
+	FcPattern *fc_pattern = nullptr; //only when scanned from fontconfig, not saved in the catalog
+};
+
+
 //--------------------------- FontTag ------------------------------------------
 class FontTag
 {
@@ -266,6 +288,13 @@ class FontManager : public anObject
 
 	ResourceDirs dirs; //extra places outside normal fontconfig to look for fonts
 	NumStack<Utf8String> favorites_files;
+
+	bool use_font_catalog;
+	bool verify_catalog_in_background;
+	unsigned long font_catalog_notify;
+	uint64_t font_catalog_key; //key of the catalog fonts came from, or 0
+
+	virtual void BuildFontList(std::vector<FontCatalogEntry> &entries);
 	
   public:
 	PtrStack<FontTag> tags;
@@ -284,6 +313,13 @@ class FontManager : public anObject
 	virtual FcConfig *GetConfig();
 	virtual FT_Library *GetFreetypeLibrary();
 	virtual PtrStack<FontDialogFont> *GetFontList();
+	virtual void UseFontCatalog(bool use, bool verify_in_background = false, unsigned long notify_object = 0);
+	virtual int RefreshFontCatalog(unsigned long notify_object);
+
+	static const char *FontCatalogFile();
+	static uint64_t FontCatalogKey();
+	static int ScanFonts(FcConfig *config, std::vector<FontCatalogEntry> &entries);
+	static int SaveFontCatalog(const char *file, uint64_t key, std::vector<FontCatalogEntry> &entries);
 
 	virtual int AddDir(const char *dir);
 	virtual int DumpInFontList(const char *file, ErrorLog *log);
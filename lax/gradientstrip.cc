@@ -22,6 +22,7 @@
 
 #include <lax/gradientstrip.h>
 #include <lax/displayer.h>
+#include <lax/previewqueue.h>
 #include <lax/attributes.h>
 #include <lax/utf8string.h>
 #include <lax/language.h>
@@ -2398,7 +2399,8 @@ int GradientStrip::RenderPalette(LaxImage *image)
     if (dx<=0) dx=1;
     if (dy<=0) dy=1;
 
-	Displayer *dp = GetDefaultDisplayer();
+	Displayer *dp = PreviewQueue::JobDisplayer();
+	if (!dp) dp = GetDefaultDisplayer();
 	dp->MakeCurrent(image);
 
 	 //render transparency first
@@ -2428,7 +2430,8 @@ int GradientStrip::RenderPalette(LaxImage *image)
 
 int GradientStrip::RenderLinear(LaxImage *image)
 {
-	Displayer *dp = GetDefaultDisplayer();
+	Displayer *dp = PreviewQueue::JobDisplayer();
+	if (!dp) dp = GetDefaultDisplayer();
 	dp->MakeCurrent(image);
 
     double offsets[colors.n];
@@ -186,6 +186,7 @@ class GradientStrip : virtual public Resourceable, virtual public DumpUtility, v
 	virtual void dump_in (FILE *f,int indent,int what,DumpContext *context,Attribute **att);
 	virtual Attribute *dump_out_atts(Attribute *att,int what,DumpContext *context);
 
+	virtual bool CanRenderPreviewAsync() { return true; }
 	virtual int renderToBufferImage(LaxImage *image);
 	virtual int RenderPalette(LaxImage *image);
 	virtual int RenderRadial(LaxImage *image);
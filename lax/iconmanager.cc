@@ -24,6 +24,23 @@
 #include <lax/singletonkeeper.h>
 #include <lax/strmanip.h>
 #include <lax/fileutils.h>
+#include <lax/threadpool.h>
+#include <lax/freedesktop.h>
+#include <lax/utf8string.h>
+#include <lax/anxapp.h>
+
+#include <png.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 #include <lax/debug.h>
 
@@ -31,6 +48,437 @@
 namespace Laxkit {
 
 
+//----------------------------- IconAtlas ---------------------------
+
+/*! \class IconAtlas
+ * Every indexed icon of an IconManager, scaled by the same amount and packed into one
+ * bgra buffer, as made by IconManager::UseAtlas(). The layout is known right away, and
+ * the pixels are filled in by a ThreadPool job. The job shares this, so it outlives the
+ * IconManager if need be. Once finished is true, only the event thread touches it.
+ */
+class IconAtlas
+{
+  public:
+	class Icon
+	{
+	  public:
+		std::string name;
+		std::string file;
+		IntRectangle rect; //where in the atlas, already scaled
+	};
+
+	double scale = 1;
+	int width = 0, height = 0;
+	std::vector<Icon> icons;
+	std::unordered_map<std::string, int> lookup; //name -> index in icons
+	std::string cache_base; //cache files are cache_base.png and cache_base.atlas, or empty for no cache
+	bool from_cache = false;
+
+	 //set by the job
+	unsigned char *data = nullptr; //bgra, not premultiplied, width*4 per row
+	std::vector<std::string> failed; //icons that could not be decoded
+	std::mutex mutex;
+	std::condition_variable finished_changed;
+	std::atomic<bool> cancelled;
+	std::atomic<bool> finished;
+
+	 //event thread only, released by IconManager::DropAtlas()
+	bool installed = false;
+	LaxImage *image = nullptr;
+	std::vector<std::pair<int, LaxImage*>> placeholders; //icon index, image handed out before the pixels were ready
+
+	IconAtlas() { cancelled = false; finished = false; }
+	~IconAtlas() { delete[] data; }
+};
+
+#define ICON_ATLAS_VERSION 1
+
+
+/*! Read a png file into a new[]'d BGRA, non-premultiplied buffer, as expected by
+ * ImageLoader::NewImageFromBuffer(). Safe to call from any thread.
+ * Returns nullptr if file is not a readable png.
+ */
+static unsigned char *load_png_bgra(const char *file, int *width_ret, int *height_ret)
+{
+	FILE *f = fopen(file, "rb");
+	if (!f) return nullptr;
+
+	png_byte sig[8];
+	if (fread(sig, 1, 8, f) != 8 || png_sig_cmp(sig, 0, 8)) {
+		fclose(f);
+		return nullptr;
+	}
+
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info  = png ? png_create_info_struct(png) : nullptr;
+	if (!info) {
+		png_destroy_read_struct(&png, nullptr, nullptr);
+		fclose(f);
+		return nullptr;
+	}
+
+	 //these are changed after setjmp, so must be volatile to survive a longjmp
+	unsigned char *volatile data = nullptr;
+	png_bytep *volatile rows = nullptr;
+
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_read_struct(&png, &info, nullptr);
+		fclose(f);
+		delete[] data;
+		delete[] rows;
+		return nullptr;
+	}
+
+	png_init_io(png, f);
+	png_set_sig_bytes(png, 8);
+	png_read_info(png, info);
+
+	int width  = png_get_image_width(png, info);
+	int height = png_get_image_height(png, info);
+	int color_type = png_get_color_type(png, info);
+	int bit_depth  = png_get_bit_depth(png, info);
+
+	 //everything to 8 bit BGRA
+	if (bit_depth == 16) png_set_strip_16(png);
+	if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+	if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) png_set_expand_gray_1_2_4_to_8(png);
+	bool has_trns = png_get_valid(png, info, PNG_INFO_tRNS);
+	if (has_trns) png_set_tRNS_to_alpha(png);
+	if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png);
+	if (!(color_type & PNG_COLOR_MASK_ALPHA) && !has_trns) png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+	png_set_bgr(png);
+	png_set_interlace_handling(png);
+	png_read_update_info(png, info);
+
+	if (png_get_rowbytes(png, info) != (png_size_t)width*4) png_error(png, "unexpected row size");
+
+	data = new unsigned char[width*height*4];
+	rows = new png_bytep[height];
+	for (int y=0; y<height; y++) rows[y] = data + y*width*4;
+
+	png_read_image(png, rows);
+	png_read_end(png, nullptr);
+
+	png_destroy_read_struct(&png, &info, nullptr);
+	fclose(f);
+	delete[] rows;
+
+	*width_ret  = width;
+	*height_ret = height;
+	return data;
+}
+
+/*! Read only the dimensions from a png file's header.
+ * Returns true for success.
+ */
+static bool png_size(const char *file, int *width_ret, int *height_ret)
+{
+	FILE *f = fopen(file, "rb");
+	if (!f) return false;
+
+	unsigned char head[24];
+	bool ok = fread(head, 1, 24, f) == 24 && !png_sig_cmp(head, 0, 8) && !memcmp(head + 12, "IHDR", 4);
+	fclose(f);
+	if (!ok) return false;
+
+	*width_ret  = (head[16]<<24) | (head[17]<<16) | (head[18]<<8) | head[19];
+	*height_ret = (head[20]<<24) | (head[21]<<16) | (head[22]<<8) | head[23];
+	return *width_ret > 0 && *height_ret > 0;
+}
+
+/*! Write a BGRA, non-premultiplied buffer to a png file. Safe to call from any thread.
+ * Returns 0 for success.
+ */
+static int save_png_bgra(const char *file, const unsigned char *data, int width, int height)
+{
+	FILE *f = fopen(file, "wb");
+	if (!f) return 1;
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info  = png ? png_create_info_struct(png) : nullptr;
+	if (!info) {
+		png_destroy_write_struct(&png, nullptr);
+		fclose(f);
+		return 2;
+	}
+
+	if (setjmp(png_jmpbuf(png))) {
+		png_destroy_write_struct(&png, &info);
+		fclose(f);
+		return 3;
+	}
+
+	png_init_io(png, f);
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+				 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_set_compression_level(png, 1); //it's a cache, favor speed
+	png_write_info(png, info);
+	png_set_bgr(png);
+	for (int y=0; y<height; y++) png_write_row(png, (png_bytep)(data + y*width*4));
+	png_write_end(png, nullptr);
+
+	png_destroy_write_struct(&png, &info);
+	return fclose(f) == 0 ? 0 : 4;
+}
+
+//! Source pixels and their weights for one destination pixel along one axis.
+struct ScaleTaps
+{
+	int first, count, offset; //offset into the weights array
+};
+
+/*! Area average when shrinking, linear interpolation when growing.
+ */
+static void scale_taps(int srcn, int dstn, std::vector<ScaleTaps> &taps, std::vector<float> &weights)
+{
+	double r = (double)srcn / dstn;
+	taps.resize(dstn);
+
+	for (int i=0; i<dstn; i++) {
+		ScaleTaps &t = taps[i];
+		t.offset = weights.size();
+
+		if (r > 1) {
+			double a = i * r, b = (i+1) * r;
+			t.first = (int)a;
+			t.count = std::min(srcn, (int)ceil(b)) - t.first;
+			for (int s = t.first; s < t.first + t.count; s++) {
+				weights.push_back((std::min(b, s+1.) - std::max(a, (double)s)) / r);
+			}
+
+		} else {
+			double center = (i + .5) * r - .5;
+			t.first = (int)floor(center);
+			double f = center - t.first;
+			if (t.first < 0) { t.first = 0; f = 0; }
+			if (t.first >= srcn-1) { t.first = srcn-1; f = 0; }
+			t.count = (f > 0 ? 2 : 1);
+			weights.push_back(1-f);
+			if (f > 0) weights.push_back(f);
+		}
+	}
+}
+
+/*! Scale a BGRA, non-premultiplied src into dst, which has dstride bytes per row.
+ * Filtering is done premultiplied, so transparent pixels don't bleed their color.
+ */
+static void scale_bgra(const unsigned char *src, int sw, int sh, unsigned char *dst, int dstride, int dw, int dh)
+{
+	if (sw == dw && sh == dh) {
+		for (int y=0; y<sh; y++) memcpy(dst + y*dstride, src + y*sw*4, sw*4);
+		return;
+	}
+
+	std::vector<ScaleTaps> xtaps, ytaps;
+	std::vector<float> xweights, yweights;
+	scale_taps(sw, dw, xtaps, xweights);
+	scale_taps(sh, dh, ytaps, yweights);
+
+	std::vector<float> pre(sw*sh*4);
+	for (int i=0; i<sw*sh; i++) {
+		float a = src[i*4+3] / 255.f;
+		pre[i*4+0] = src[i*4+0] * a;
+		pre[i*4+1] = src[i*4+1] * a;
+		pre[i*4+2] = src[i*4+2] * a;
+		pre[i*4+3] = src[i*4+3];
+	}
+
+	 //horizontal, then vertical
+	std::vector<float> rows(dw*sh*4, 0.f);
+	for (int y=0; y<sh; y++) {
+		for (int x=0; x<dw; x++) {
+			ScaleTaps &t = xtaps[x];
+			float *out = &rows[(y*dw + x)*4];
+			for (int c=0; c<t.count; c++) {
+				const float *in = &pre[(y*sw + t.first + c)*4];
+				float w = xweights[t.offset + c];
+				out[0] += in[0]*w; out[1] += in[1]*w; out[2] += in[2]*w; out[3] += in[3]*w;
+			}
+		}
+	}
+
+	for (int y=0; y<dh; y++) {
+		ScaleTaps &t = ytaps[y];
+		unsigned char *out = dst + y*dstride;
+		for (int x=0; x<dw; x++) {
+			float v[4] = { 0,0,0,0 };
+			for (int c=0; c<t.count; c++) {
+				const float *in = &rows[((t.first + c)*dw + x)*4];
+				float w = yweights[t.offset + c];
+				v[0] += in[0]*w; v[1] += in[1]*w; v[2] += in[2]*w; v[3] += in[3]*w;
+			}
+			float a = v[3] / 255.f;
+			for (int c=0; c<3; c++) {
+				float p = (a > 0 ? v[c] / a : 0) + .5f;
+				out[x*4+c] = (p > 255 ? 255 : (unsigned char)p);
+			}
+			out[x*4+3] = (v[3] + .5f > 255 ? 255 : (unsigned char)(v[3] + .5f));
+		}
+	}
+}
+
+//! FNV-1a
+static uint64_t atlas_hash(uint64_t h, const void *data, size_t len)
+{
+	const unsigned char *d = (const unsigned char*)data;
+	for (size_t c = 0; c < len; c++) {
+		h ^= d[c];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/*! Pack rects of atlas->icons, which must already have their width and height,
+ * onto shelves of a roughly square atlas, with a pixel between icons.
+ */
+static void layout_atlas(IconAtlas *atlas)
+{
+	std::vector<int> order(atlas->icons.size());
+	long area = 0;
+	int maxw = 0;
+	for (unsigned int c = 0; c < order.size(); c++) {
+		order[c] = c;
+		IntRectangle &r = atlas->icons[c].rect;
+		area += (long)(r.width+1) * (r.height+1);
+		if (r.width > maxw) maxw = r.width;
+	}
+	std::sort(order.begin(), order.end(), [atlas](int a, int b) {
+		return atlas->icons[a].rect.height > atlas->icons[b].rect.height;
+	});
+
+	int rowwidth = std::max(maxw, (int)ceil(sqrt((double)area) * 1.1));
+	int x = 0, y = 0, shelf = 0;
+	atlas->width = 0;
+	for (int i : order) {
+		IntRectangle &r = atlas->icons[i].rect;
+		if (x > 0 && x + r.width > rowwidth) {
+			y += shelf + 1;
+			x = shelf = 0;
+		}
+		r.x = x;
+		r.y = y;
+		x += r.width;
+		if (x > atlas->width) atlas->width = x;
+		x++;
+		if (r.height > shelf) shelf = r.height;
+	}
+	atlas->height = y + shelf;
+}
+
+/*! Read the layout of a cached atlas. Every icon in atlas must be in it.
+ * Returns 0 for success.
+ */
+static int load_atlas_index(IconAtlas *atlas, const char *file)
+{
+	FILE *f = fopen(file, "r");
+	if (!f) return 1;
+
+	char line[1024];
+	int version = 0, n = 0, found = 0;
+	bool ok = fgets(line, sizeof(line), f) && sscanf(line, "laxkit-icon-atlas %d", &version) == 1 && version == ICON_ATLAS_VERSION
+		   && fgets(line, sizeof(line), f) && sscanf(line, "%d %d %d", &atlas->width, &atlas->height, &n) == 3
+		   && n == (int)atlas->icons.size();
+
+	while (ok && fgets(line, sizeof(line), f)) {
+		int x, y, w, h, pos = 0;
+		if (sscanf(line, "%d %d %d %d %n", &x, &y, &w, &h, &pos) != 4 || pos == 0) { ok = false; break; }
+
+		char *name = line + pos;
+		int len = strlen(name);
+		while (len > 0 && name[len-1] == '\n') name[--len] = '\0';
+
+		auto i = atlas->lookup.find(name);
+		if (i == atlas->lookup.end()) { ok = false; break; }
+		atlas->icons[i->second].rect.set(x, y, w, h);
+		found++;
+	}
+	fclose(f);
+
+	return ok && found == n ? 0 : 2;
+}
+
+/*! Write the atlas png, then its layout, each through a temp file.
+ * Returns 0 for success.
+ */
+static int save_atlas_cache(IconAtlas *atlas, const unsigned char *data)
+{
+	char *dir = lax_dirname(atlas->cache_base.c_str(), 0);
+	if (dir) check_dirs(dir, true);
+	delete[] dir;
+
+	std::string png = atlas->cache_base + ".png";
+	std::string index = atlas->cache_base + ".atlas";
+	std::string tmp = atlas->cache_base + "." + std::to_string(getpid()) + ".tmp";
+
+	if (save_png_bgra(tmp.c_str(), data, atlas->width, atlas->height) != 0 || rename(tmp.c_str(), png.c_str()) != 0) {
+		unlink(tmp.c_str());
+		return 1;
+	}
+
+	FILE *f = fopen(tmp.c_str(), "w");
+	if (!f) return 2;
+	fprintf(f, "laxkit-icon-atlas %d\n%d %d %d\n", ICON_ATLAS_VERSION, atlas->width, atlas->height, (int)atlas->icons.size());
+	for (auto &icon : atlas->icons) {
+		fprintf(f, "%d %d %d %d %s\n", icon.rect.x, icon.rect.y, icon.rect.width, icon.rect.height, icon.name.c_str());
+	}
+	if (fclose(f) != 0 || rename(tmp.c_str(), index.c_str()) != 0) {
+		unlink(tmp.c_str());
+		return 3;
+	}
+	return 0;
+}
+
+/*! Fill in the pixels of atlas, from its cache if it has one, else by decoding and scaling
+ * each icon file, which are then saved to the cache. Safe to call from any thread, as long as
+ * nothing else touches atlas before it is finished.
+ */
+static void fill_atlas(IconAtlas *atlas)
+{
+	unsigned char *data = nullptr;
+	std::vector<std::string> failed;
+
+	if (atlas->from_cache) {
+		int w = 0, h = 0;
+		data = load_png_bgra((atlas->cache_base + ".png").c_str(), &w, &h);
+		if (data && (w != atlas->width || h != atlas->height)) {
+			delete[] data;
+			data = nullptr;
+		}
+	}
+
+	if (!data) {
+		data = new unsigned char[atlas->width * atlas->height * 4](); //all transparent
+		for (auto &icon : atlas->icons) {
+			if (atlas->cancelled) break;
+
+			int w = 0, h = 0;
+			unsigned char *src = load_png_bgra(icon.file.c_str(), &w, &h);
+			if (!src) {
+				failed.push_back(icon.name);
+				continue;
+			}
+			scale_bgra(src, w, h, data + (icon.rect.y * atlas->width + icon.rect.x) * 4, atlas->width * 4,
+					   icon.rect.width, icon.rect.height);
+			delete[] src;
+		}
+
+		if (!atlas->cancelled && failed.empty() && !atlas->cache_base.empty()) {
+			if (save_atlas_cache(atlas, data) != 0) {
+				DBG std::cerr << "IconManager could not save icon atlas "<<atlas->cache_base<<std::endl;
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(atlas->mutex);
+		atlas->data = data;
+		atlas->failed.swap(failed);
+		atlas->finished = true;
+	}
+	atlas->finished_changed.notify_all();
+}
+
+
 //----------------------------- IconManager default ---------------------------
 
 static SingletonKeeper loaderKeeper;
@@ -79,6 +527,7 @@ IconNode::IconNode(const char *nname, int nid, LaxImage *img)
 	id=nid;
 	name=newstr(nname);
 	image=img;
+	from_atlas=false;
 	image->doneForNow();
 }
 
@@ -108,10 +557,28 @@ IconManager::IconManager()
 	  broken(LISTS_DELETE_Array)
 {
 	remember_broken = true;
+	icon_files_dirty = true;
+
+	atlas_scale     = 1;
+	use_atlas_cache = true;
+	atlas_notify    = 0;
 }
 
 IconManager::~IconManager()
 {
+	DropAtlas();
+}
+
+/*! InstallAtlas() on "iconAtlasDone", sent by the job UseAtlas() starts in the background.
+ */
+int IconManager::Event(const EventData *data, const char *mes)
+{
+	if (!strcmp(mes, "iconAtlasDone")) {
+		InstallAtlas();
+		return 0;
+	}
+
+	return EventReceiver::Event(data, mes);
 }
 
 //! Return -1 for fail to load file.
@@ -146,23 +613,76 @@ int IconManager::InstallIcon(const char *nname, int nid, LaxImage *img)
 	return push(node,1,c);
 }
 
+/*! Rebuild icon_files from the contents of each icon path, if paths have changed.
+ * Each directory is read once, instead of trying to load name.png from every path for every icon.
+ */
+void IconManager::UpdateIconIndex()
+{
+	if (!icon_files_dirty) return;
+
+	icon_files.clear();
+	for (int c=0; c<icon_path.n; c++) {
+		DIR *dir = opendir(icon_path.e[c]);
+		if (!dir) continue;
+
+		struct dirent *entry;
+		while ((entry = readdir(dir))) {
+			int len = strlen(entry->d_name);
+			if (len <= 4 || strcmp(entry->d_name + len - 4, ".png")) continue;
+
+			std::string name(entry->d_name, len - 4);
+			if (icon_files.find(name) != icon_files.end()) continue; //earlier paths take precedence
+
+			std::string file(icon_path.e[c]);
+			file += '/';
+			file += entry->d_name;
+			icon_files.emplace(name, file);
+		}
+		closedir(dir);
+	}
+
+	icon_files_dirty = false;
+	DBG std::cerr << "IconManager indexed "<<icon_files.size()<<" icons in "<<icon_path.n<<" paths"<<std::endl;
+}
+
+//! Return index of the installed icon with name, or -1.
+int IconManager::findnode(const char *name)
+{
+	 //rather slow, but then, there won't be a million of them
+	for (int c=0; c<PtrStack<IconNode>::n; c++) {
+		if (strcmp(name, PtrStack<IconNode>::e[c]->name) == 0) return c;
+	}
+	return -1;
+}
+
 //! Search for a icon file "name.png" in all the icon paths.
 /*! Install and return the icon if found, else NULL.
  * 
+ * Files are found through the index built by UpdateIconIndex(). Names with a '/' in them,
+ * which are in subdirectories of a path, are looked for directly.
+ *
  * This function assumes that name is not already in the stack.
  */
 LaxImage *IconManager::findicon(const char *name, bool save_broken)
 {
-	char *path;
 	LaxImage *img=NULL;
-	for (int c=0; c<icon_path.n; c++) {
-		path=newstr(icon_path.e[c]);
-		appendstr(path,"/");
-		appendstr(path,name);
-		appendstr(path,".png");
-		img = ImageLoader::LoadImage(path);
-		delete[] path;
-		if (img) break;
+
+	UpdateIconIndex();
+	auto found = icon_files.find(name);
+	if (found != icon_files.end()) {
+		img = ImageLoader::LoadImage(found->second.c_str());
+
+	} else if (strchr(name, '/')) {
+		char *path;
+		for (int c=0; c<icon_path.n; c++) {
+			path=newstr(icon_path.e[c]);
+			appendstr(path,"/");
+			appendstr(path,name);
+			appendstr(path,".png");
+			img = ImageLoader::LoadImage(path);
+			delete[] path;
+			if (img) break;
+		}
 	}
 
 	if (img) {
@@ -204,20 +724,20 @@ const char *IconManager::Broken(int i)
 	return broken.e[i];
 }
 
-/*! For each name in broken, rescan from current paths.
+/*! For each name in broken, rescan from current paths. This rereads the path directories,
+ * so it will pick up icon files added since the last scan.
  * Return the number that are still broken.
  */
 int IconManager::ScanForBroken()
 {
+	icon_files_dirty = true;
+
 	for (int c=broken.n-1; c>= 0; c--) {
 		LaxImage *img = nullptr;
 
 		//scan existing in case the name snuck into broken list
-		for (int c2=0; c2<PtrStack<IconNode>::n; c2++) {
-			if (strEquals(broken.e[c], PtrStack<IconNode>::e[c2]->name)) {
-				img = PtrStack<IconNode>::e[c2]->image;
-			}
-		}
+		int i = findnode(broken.e[c]);
+		if (i >= 0) img = PtrStack<IconNode>::e[i]->image;
 
 		if (!img) img = findicon(broken.e[c], false);
 		if (img) {
@@ -232,6 +752,7 @@ int IconManager::ScanForBroken()
 //! Return how many icons are currently installed.
 int IconManager::HowMany()
 {
+	InstallAtlas();
 	return PtrStack<IconNode>::n;
 }
 
@@ -247,6 +768,8 @@ Laxkit::LaxImage *IconManager::GetIconByIndex(int index)
 //! Returns the the existing icon with id. The icon's count is incremented.
 Laxkit::LaxImage *IconManager::GetIcon(int id)
 {
+	InstallAtlas();
+
 	 //rather slow, but then, there won't be a million of them
 	for (int c=0; c<PtrStack<IconNode>::n; c++)
 		if (id==PtrStack<IconNode>::e[c]->id)  {
@@ -262,12 +785,39 @@ Laxkit::LaxImage *IconManager::GetIcon(int id)
  */
 Laxkit::LaxImage *IconManager::GetIcon(const char *name)
 {
-	 //rather slow, but then, there won't be a million of them
-	for (int c=0; c<PtrStack<IconNode>::n; c++)
-		if (strcmp(name,PtrStack<IconNode>::e[c]->name)==0) {
-			PtrStack<IconNode>::e[c]->image->inc_count();
-			return PtrStack<IconNode>::e[c]->image;
+	InstallAtlas();
+
+	int c = findnode(name);
+	if (c >= 0) {
+		PtrStack<IconNode>::e[c]->image->inc_count();
+		return PtrStack<IconNode>::e[c]->image;
+	}
+
+	if (atlas) {
+		auto found = atlas->lookup.find(name);
+		if (found != atlas->lookup.end()) {
+			LaxImage *img = nullptr;
+			if (atlas->installed) img = AtlasIcon(found->second);
+			else {
+				 //pixels not ready yet, hand out a blank image that InstallAtlas() fills in
+				IntRectangle &rect = atlas->icons[found->second].rect;
+				img = ImageLoader::NewImage(rect.width, rect.height);
+				if (img) {
+					img->Set(0,0,0,0);
+					img->inc_count();
+					atlas->placeholders.push_back(std::make_pair(found->second, img));
+				}
+			}
+
+			if (img) {
+				c = InstallIcon(name, -1, img);
+				if (c >= 0) PtrStack<IconNode>::e[c]->from_atlas = true;
+				img->inc_count();
+				return img;
+			}
 		}
+	}
+
 	return findicon(name, remember_broken);
 }
 
@@ -287,6 +837,7 @@ void IconManager::AddPath(const char *newpath)
 		if (!strcmp(newpath, icon_path.e[c])) return; //already there!
 	}
 	icon_path.push(newstr(newpath),2,0);
+	icon_files_dirty = true;
 }
 
 /*! Return 0 for success, and removed, or 1 for oldpath not found.
@@ -298,6 +849,7 @@ int IconManager::RemovePath(const char *oldpath)
 	for (int c=0; c<icon_path.n; c++) {
 		if (!strcmp(icon_path.e[c],oldpath)) {
 			icon_path.remove(c);
+			icon_files_dirty = true;
 			return 0;
 		}
 	}
@@ -305,50 +857,284 @@ int IconManager::RemovePath(const char *oldpath)
 }
 
 
-/*! Load in all icons found in the paths. This means all openable image files.
- * Return the number of icons read in.
+/*! Load in all icons found in the paths, which means all name.png files directly in them.
+ * This is UseAtlas(AtlasScale(), false), and then every icon in the atlas is installed.
+ * Return the number of icons installed.
  */
 int IconManager::PreloadAll()
 {
-	//PtrStack<char> icons_to_load(LISTS_DELETE_Array);
-	//PtrStack<char> icon_ids(LISTS_DELETE_Array);
-	
-	char *base;
+	UseAtlas(atlas_scale, false);
+	if (!atlas) return 0;
+
 	int n = 0;
+	for (auto &entry : atlas->lookup) {
+		if (findnode(entry.first.c_str()) >= 0) continue;
 
-	for (int c = 0; c < icon_path.n; c++) {
-		//scan directory recunsively: icon_path.e[c]
-		std::cerr << " *** FINISH ME!!!" <<std::endl;
-		
-		const char *file = "";
-		const char *bname = lax_basename(file);
-		const char *ext = lax_extension(file);
-		if (!bname) continue;
-		if (!ext) ext = bname + strlen(bname);
-
-		makenstr(base, bname, ext-bname);
-	
-		int i = -1;
-		for (int c=0; c<PtrStack<IconNode>::n; c++) {
-			if (strcmp(base, PtrStack<IconNode>::e[c]->name) == 0) {
-				i = c;
-				break;
-			}
+		LaxImage *img = AtlasIcon(entry.second);
+		if (!img) continue;
+		int c = InstallIcon(entry.first.c_str(), -1, img);
+		if (c >= 0) PtrStack<IconNode>::e[c]->from_atlas = true;
+		n++;
+	}
+
+	return n;
+}
+
+/*! Same as UseAtlas(AtlasScale(), true).
+ *
+ * Returns the number of icons in the atlas, or -1 if an atlas is already loading.
+ */
+int IconManager::PreloadInBackground()
+{
+	if (Preloading()) return -1;
+	return UseAtlas(atlas_scale, true);
+}
+
+//! Whether an atlas from UseAtlas() is still waiting for its pixels.
+bool IconManager::Preloading()
+{
+	InstallAtlas();
+	return atlas && !atlas->installed;
+}
+
+/*! Return xdg_cache_home()/laxkit/icons, where UseAtlas() saves pre-scaled atlases.
+ */
+const char *IconManager::AtlasCacheDir()
+{
+	static Utf8String cache_dir;
+	if (cache_dir.IsEmpty()) {
+		cache_dir = xdg_cache_home();
+		cache_dir.Append("/laxkit/icons");
+	}
+	return cache_dir.c_str();
+}
+
+/*! Pack every icon in the paths, scaled by scale, into a single atlas, which is where
+ * GetIcon() gets them from. Icons are only made into LaxImages as they are asked for.
+ * Use the UI scale for icons to be drawn 1:1. Calling again with another scale
+ * replaces the atlas, and icons already made from the old atlas are forgotten, so
+ * windows should get their icons again. Icons added with InstallIcon() are kept.
+ *
+ * Where each icon goes in the atlas is worked out right away, from the png headers.
+ * The pixels are read in a ThreadPool job if in_background, else before returning.
+ * Until they are ready, GetIcon() returns transparent images of the right size, which
+ * are filled in when the job sends the manager "iconAtlasDone" on the event thread, or on the
+ * next GetIcon(), HowMany() or Preloading() after the job is done, if that is sooner or there is no anXApp.
+ * If there is an AtlasNotify() object, it is then sent "iconsLoaded" so it can redraw.
+ *
+ * Unless turned off with UseAtlasCache(), atlases are saved in AtlasCacheDir(), and used
+ * instead of reading every icon as long as no icon files have changed. Changing paths
+ * does not update the atlas until UseAtlas() is called with a new scale.
+ *
+ * Returns the number of icons in the atlas.
+ */
+int IconManager::UseAtlas(double scale, bool in_background)
+{
+	if (scale <= 0) scale = 1;
+
+	if (atlas && atlas->scale == scale) {
+		if (!in_background) WaitForAtlas();
+		return atlas->icons.size();
+	}
+
+	DropAtlas();
+	atlas_scale = scale;
+	UpdateIconIndex();
+	if (icon_files.empty()) return 0;
+
+	std::shared_ptr<IconAtlas> newatlas = std::make_shared<IconAtlas>();
+	newatlas->scale = scale;
+
+	 //the cache key covers the scale, and every file's name, size and modification time
+	std::vector<const std::pair<const std::string, std::string>*> files;
+	for (auto &entry : icon_files) files.push_back(&entry);
+	std::sort(files.begin(), files.end(), [](const std::pair<const std::string, std::string> *a,
+											 const std::pair<const std::string, std::string> *b) { return a->first < b->first; });
+
+	uint64_t key = 14695981039346656037ULL;
+	int version = ICON_ATLAS_VERSION;
+	key = atlas_hash(key, &version, sizeof(version));
+	long milliscale = scale * 1000 + .5;
+	key = atlas_hash(key, &milliscale, sizeof(milliscale));
+
+	for (auto file : files) {
+		struct stat st;
+		if (stat(file->second.c_str(), &st) != 0) continue;
+
+		key = atlas_hash(key, file->first.c_str(), file->first.size() + 1);
+		key = atlas_hash(key, file->second.c_str(), file->second.size() + 1);
+		key = atlas_hash(key, &st.st_size, sizeof(st.st_size));
+		key = atlas_hash(key, &st.st_mtime, sizeof(st.st_mtime));
+
+		newatlas->icons.push_back(IconAtlas::Icon());
+		newatlas->icons.back().name = file->first;
+		newatlas->icons.back().file = file->second;
+	}
+
+	for (unsigned int c = 0; c < newatlas->icons.size(); c++) newatlas->lookup[newatlas->icons[c].name] = c;
+
+	if (use_atlas_cache) {
+		char keystr[20];
+		sprintf(keystr, "/%016llx", (unsigned long long)key);
+		newatlas->cache_base = AtlasCacheDir();
+		newatlas->cache_base += keystr;
+		if (load_atlas_index(newatlas.get(), (newatlas->cache_base + ".atlas").c_str()) == 0) newatlas->from_cache = true;
+	}
+
+	if (!newatlas->from_cache) {
+		 //sizes from the png headers, dropping what is not a png
+		std::vector<IconAtlas::Icon> icons;
+		for (auto &icon : newatlas->icons) {
+			int w, h;
+			if (!png_size(icon.file.c_str(), &w, &h)) continue;
+			icon.rect.width  = std::max(1, (int)(w * scale + .5));
+			icon.rect.height = std::max(1, (int)(h * scale + .5));
+			icons.push_back(icon);
 		}
+		if (icons.empty()) return 0;
+
+		newatlas->icons.swap(icons);
+		newatlas->lookup.clear();
+		for (unsigned int c = 0; c < newatlas->icons.size(); c++) newatlas->lookup[newatlas->icons[c].name] = c;
+		layout_atlas(newatlas.get());
+	}
 
-		if (i >= 0) continue;
+	DBG std::cerr << "IconManager atlas of "<<newatlas->icons.size()<<" icons at scale "<<scale<<", "
+	DBG           << newatlas->width<<"x"<<newatlas->height<<(newatlas->from_cache ? ", from cache" : "")<<std::endl;
 
-		LaxImage *img = ImageLoader::LoadImage(file);
-		if (img) {
-			InstallIcon(base, -1, img);
+	atlas = newatlas;
+	if (in_background) {
+		 //the job tells us when it is done, so we need to be findable even if made before the app
+		unsigned long manager_id = 0;
+		if (anXApp::app) {
+			anXApp::app->RegisterEventReceiver(this);
+			manager_id = object_id;
+		}
+
+		ThreadPool::GetDefault()->Submit([newatlas, manager_id]() {
+			fill_atlas(newatlas.get());
+
+			 //don't touch this past here, the manager might be gone
+			if (manager_id && !newatlas->cancelled && anXApp::app) {
+				anXApp::app->SendMessage(new SimpleMessage(), manager_id, "iconAtlasDone", 0);
+			}
+		});
+	} else {
+		fill_atlas(newatlas.get());
+		InstallAtlas();
+	}
+
+	return newatlas->icons.size();
+}
+
+//! Block until the atlas pixels are ready, then InstallAtlas().
+void IconManager::WaitForAtlas()
+{
+	if (!atlas) return;
+	{
+		std::unique_lock<std::mutex> lock(atlas->mutex);
+		atlas->finished_changed.wait(lock, [this] { return atlas->finished.load(); });
+	}
+	InstallAtlas();
+}
+
+/*! Once the atlas pixels are ready, fill in any placeholder images that GetIcon() handed out.
+ * Icons that turned out to be unreadable are removed from the atlas, so they are looked
+ * for the usual way next time.
+ * Returns the number of placeholders filled in.
+ */
+int IconManager::InstallAtlas()
+{
+	if (!atlas || atlas->installed || !atlas->finished) return 0;
+	atlas->installed = true;
+
+	for (auto &name : atlas->failed) atlas->lookup.erase(name);
+
+	int n = 0;
+	for (auto &placeholder : atlas->placeholders) {
+		IconAtlas::Icon &icon = atlas->icons[placeholder.first];
+		LaxImage *img = (atlas->lookup.count(icon.name) ? AtlasIcon(placeholder.first) : nullptr);
+
+		if (img && img->w() == placeholder.second->w() && img->h() == placeholder.second->h()) {
+			 //both are the same kind of image, so their buffers match
+			unsigned char *from = img->getImageBuffer();
+			unsigned char *to   = placeholder.second->getImageBuffer();
+			memcpy(to, from, img->w() * img->h() * 4);
+			placeholder.second->doneWithBuffer(to);
+			img->doneWithBuffer(from);
 			n++;
+
+		} else {
+			int c = findnode(icon.name.c_str());
+			if (c >= 0 && PtrStack<IconNode>::e[c]->image == placeholder.second) remove(c);
 		}
+
+		if (img) img->dec_count();
+		placeholder.second->dec_count();
 	}
+	atlas->placeholders.clear();
 
-	delete[] base;
+	if (n && atlas_notify && anXApp::app) {
+		anXApp::app->SendMessage(new SimpleMessage(nullptr, n,0,0,0), atlas_notify, "iconsLoaded", 0);
+	}
 	return n;
 }
 
+/*! Forget the atlas, along with installed icons made from it. A job still filling it
+ * is told to stop.
+ */
+void IconManager::DropAtlas()
+{
+	if (!atlas) return;
+
+	atlas->cancelled = true;
+	for (auto &placeholder : atlas->placeholders) placeholder.second->dec_count();
+	atlas->placeholders.clear();
+	if (atlas->image) atlas->image->dec_count();
+	atlas->image = nullptr;
+
+	for (int c = PtrStack<IconNode>::n-1; c >= 0; c--) {
+		if (PtrStack<IconNode>::e[c]->from_atlas) remove(c);
+	}
+
+	atlas.reset();
+}
+
+/*! Return a new LaxImage of the atlas icon at index. The atlas must be installed.
+ */
+LaxImage *IconManager::AtlasIcon(int index)
+{
+	IconAtlas::Icon &icon = atlas->icons[index];
+	LaxImage *img = ImageLoader::NewImageFromBuffer(atlas->data + (icon.rect.y * atlas->width + icon.rect.x) * 4,
+													icon.rect.width, icon.rect.height, atlas->width * 4);
+	if (img) makestr(img->filename, icon.file.c_str());
+	return img;
+}
+
+/*! Return the whole atlas as one image, for drawing icons with AtlasRect(), or nullptr
+ * if there is no atlas or it is not ready yet. The count is not incremented.
+ */
+LaxImage *IconManager::AtlasImage()
+{
+	InstallAtlas();
+	if (!atlas || !atlas->installed) return nullptr;
+
+	if (!atlas->image) atlas->image = ImageLoader::NewImageFromBuffer(atlas->data, atlas->width, atlas->height, atlas->width * 4);
+	return atlas->image;
+}
+
+/*! Return in rect_ret where icon name is in AtlasImage(). This is known before
+ * the atlas pixels are ready. Returns 0 for found, else nonzero.
+ */
+int IconManager::AtlasRect(const char *name, IntRectangle *rect_ret)
+{
+	if (!atlas || !name) return 1;
+
+	auto found = atlas->lookup.find(name);
+	if (found == atlas->lookup.end()) return 2;
+	if (rect_ret) *rect_ret = atlas->icons[found->second].rect;
+	return 0;
+}
 
 
 } //namespace Laxkit
@@ -25,6 +25,12 @@
 
 #include <lax/lists.h>
 #include <lax/laximages.h>
+#include <lax/events.h>
+#include <lax/rectangles.h>
+
+#include <string>
+#include <unordered_map>
+#include <memory>
 
 namespace Laxkit {
 
@@ -36,19 +42,37 @@ class IconNode
 	char *name;
 	int id;
 	Laxkit::LaxImage *image;
+	bool from_atlas; //made from the IconManager's atlas, so it is replaced when the atlas scale changes
 	IconNode(const char *nname, int nid, Laxkit::LaxImage *img);
 	~IconNode();
 };
 
 //----------------------------- IconManager ---------------------------
 
-class IconManager : public Laxkit::anObject, public Laxkit::PtrStack<IconNode>
+class IconAtlas;
+
+class IconManager : public Laxkit::EventReceiver, public Laxkit::PtrStack<IconNode>
 {
   protected:
 	Laxkit::PtrStack<char> icon_path;
 	Laxkit::PtrStack<char> broken; //stack of string ids
 
+	 //name -> file for every name.png in icon_path, first path wins
+	std::unordered_map<std::string, std::string> icon_files;
+	bool icon_files_dirty;
+
+	std::shared_ptr<IconAtlas> atlas; //shared with the background job filling it, if any
+	double atlas_scale;
+	bool use_atlas_cache;
+	unsigned long atlas_notify;
+
 	virtual Laxkit::LaxImage *findicon(const char *name, bool save_broken);
+	virtual int findnode(const char *name);
+	virtual void UpdateIconIndex();
+	virtual Laxkit::LaxImage *AtlasIcon(int index);
+	virtual int InstallAtlas();
+	virtual void WaitForAtlas();
+	virtual void DropAtlas();
 
   public:
 	static IconManager* GetDefault();
@@ -59,6 +83,7 @@ class IconManager : public Laxkit::anObject, public Laxkit::PtrStack<IconNode>
 	IconManager();
 	virtual ~IconManager();
 	virtual const char *whattype() { return "IconManager"; }
+	virtual int Event(const EventData *data, const char *mes);
 
 	virtual int InstallIcon(const char *nname, int nid, const char *file);
 	virtual int InstallIcon(const char *nname, int nid, Laxkit::LaxImage *img);
@@ -72,6 +97,16 @@ class IconManager : public Laxkit::anObject, public Laxkit::PtrStack<IconNode>
 	virtual const char *GetPath(int index);
 	virtual const char *FindPathForFile(const char *filename);
 	virtual int PreloadAll();
+	virtual int PreloadInBackground();
+	virtual bool Preloading();
+
+	static const char *AtlasCacheDir();
+	virtual int UseAtlas(double scale, bool in_background = true);
+	virtual double AtlasScale() { return atlas_scale; }
+	virtual void UseAtlasCache(bool use) { use_atlas_cache = use; }
+	virtual void AtlasNotify(unsigned long object_id) { atlas_notify = object_id; }
+	virtual Laxkit::LaxImage *AtlasImage();
+	virtual int AtlasRect(const char *name, IntRectangle *rect_ret);
 
 	virtual int NumBroken() { return broken.n; }
 	virtual const char *Broken(int i);
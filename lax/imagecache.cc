@@ -0,0 +1,487 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+
+
+#include <lax/imagecache.h>
+#include <lax/anxapp.h>
+#include <lax/fileutils.h>
+#include <lax/strmanip.h>
+
+#include <cstring>
+
+#include <iostream>
+using namespace std;
+#define DBG
+
+
+namespace Laxkit {
+
+
+//---------------------------- ImageCache --------------------------------------
+/*! \class ImageCache
+ * \brief Least recently used cache of decoded images, shared by everything that loads image files.
+ *
+ * When a default cache exists, ImageLoader::LoadImage() goes through it for plain loads, that is,
+ * loads without a preview file. Images are keyed on file path, modification time and size,
+ * subimage index, and format, so editing a file on disk means the next load gets a fresh image.
+ *
+ * Load() returns images with their count incremented, just like ImageLoader::LoadImage().
+ * The cache keeps its own count on each image, so the same LaxImage is handed to everyone
+ * that loads the same file. Since they are shared, do not modify images you get from here.
+ * Crop, or copy the buffer out, instead.
+ *
+ * Load() can also return a reduced level of an image, for drawing at a small size. Each level is
+ * half the size of the one above, made from it with GeneratePreview(), and is cached as its own entry.
+ * MipLevel() says which level is used for a given maximum width and height.
+ *
+ * When the images hold more than MaxBytes() of pixel data, the least recently used images
+ * that nobody else holds are dropped. Images that are still held, but are not being displayed,
+ * are asked to LaxImage::FreePixels() from Trim(), which keeps their metrics, and they reload
+ * from their file on next use. LaxImage::doneForNow() for images that can do this calls DoneForNow()
+ * for the default cache, which sends the cache an "imageCacheTrim" message when over budget,
+ * so this happens as images are drawn.
+ *
+ * Load() and DoneForNow() can be called from any thread. If several threads ask for the same image at
+ * once, only one loads it, and the others wait for that. Counts on images are atomic, so images can be
+ * released from any thread. Pixels are only freed by Trim(), on the event thread. Whether that is safe
+ * while other threads draw an image is up to its FreePixels(). Cairo images lock their surface against
+ * it, so they can be drawn from any thread. Imlib is not thread safe at all, so imlib images must only be
+ * drawn on the event thread.
+ *
+ * Trim() happens when the cache gets an "imageCacheTrim" message, which needs the cache to be registered
+ * with the anXApp. This is done when it is made after the app, or else by GetDefault(true), SetDefault()
+ * or Trim() once there is an app. Until then, DoneForNow() cannot send it, and images that others hold
+ * keep their pixels. When there is no anXApp, DoneForNow() trims right away, so then images must only
+ * be drawn from one thread.
+ * Note that the reduced levels are made with the default Displayer, so those are also event thread only.
+ *
+ * Hits() and Misses() count lookups since the last ResetStats(). Asking for a reduced level
+ * also looks up the full size image. Shared() counts the hits that had to wait for another
+ * thread to finish loading.
+ */
+
+
+ImageCache *ImageCache::default_cache = nullptr;
+
+/*! Return the process wide cache, creating it if necessary and create_if_null.
+ * Note that ImageLoader::LoadImage() only checks for an existing default, so nothing
+ * is cached until something creates one.
+ */
+ImageCache *ImageCache::GetDefault(bool create_if_null)
+{
+	if (!default_cache && create_if_null) {
+		default_cache = new ImageCache;
+	}
+	 //create_if_null is what the event thread asks for, others only peek
+	if (default_cache && create_if_null) default_cache->RegisterWithApp();
+	return default_cache;
+}
+
+/*! If you pass in NULL, it will dec_count the old one.
+ * The count on ncache will be incremented.
+ */
+void ImageCache::SetDefault(ImageCache *ncache)
+{
+	if (ncache == default_cache) return;
+
+	if (default_cache) default_cache->dec_count();
+	default_cache = ncache;
+	if (default_cache) {
+		default_cache->inc_count();
+		default_cache->RegisterWithApp();
+	}
+}
+
+/*! Return which reduced level of a width x height image to use when it will be displayed to fit
+ * within maxw x maxh. This is the smallest level that is still at least as big as needed.
+ * Level 0 is the full image, 1 is half size, 2 is quarter size, and so on.
+ * If maxw or maxh is <= 0, only the other one is used. If both are, return 0.
+ */
+int ImageCache::MipLevel(int width, int height, int maxw, int maxh)
+{
+	if (width <= 0 || height <= 0) return 0;
+
+	double scale = 0;
+	if (maxw > 0) scale = double(maxw)/width;
+	if (maxh > 0 && (scale == 0 || double(maxh)/height < scale)) scale = double(maxh)/height;
+	if (scale <= 0) return 0;
+
+	int level = 0;
+	while (scale <= .5 && (width>>(level+1)) > 0 && (height>>(level+1)) > 0) {
+		scale *= 2;
+		level++;
+	}
+	return level;
+}
+
+ImageCache::ImageCache(long nmax_bytes)
+{
+	max_bytes = nmax_bytes;
+	bytes     = 0;
+	hits      = 0;
+	misses    = 0;
+	shared    = 0;
+	trim_pending = false;
+	registered   = (anXApp::app != nullptr); //EventReceiver registers if it can
+}
+
+/*! Releases the cache's count on every image. Images held elsewhere stay valid.
+ */
+ImageCache::~ImageCache()
+{
+	Flush();
+}
+
+/*! If not done yet, and there is an anXApp, register so that DoneForNow() can send "imageCacheTrim".
+ * Only call this from the event thread.
+ */
+void ImageCache::RegisterWithApp()
+{
+	if (!anXApp::app) return;
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if (registered) return;
+	anXApp::app->RegisterEventReceiver(this);
+	registered = true;
+}
+
+/*! Trim() on "imageCacheTrim", sent by DoneForNow().
+ */
+int ImageCache::Event(const EventData *data, const char *mes)
+{
+	if (!strcmp(mes, "imageCacheTrim")) {
+		Trim();
+		return 0;
+	}
+
+	return EventReceiver::Event(data, mes);
+}
+
+/*! Build the key for file. Returns false if file cannot be stat'd.
+ */
+bool ImageCache::MakeKey(std::string &key, const char *file, int index, int format)
+{
+	struct stat st;
+	if (lax_stat(file, 1, &st) != 0) return false;
+
+	long mtime = st.st_mtim.tv_sec;
+	long mtime_ns = st.st_mtim.tv_nsec;
+	long size = st.st_size;
+
+	key.assign(file, strlen(file) + 1);
+	key.append((const char*)&mtime,    sizeof(mtime));
+	key.append((const char*)&mtime_ns, sizeof(mtime_ns));
+	key.append((const char*)&size,     sizeof(size));
+	key.append((const char*)&index,    sizeof(index));
+	key.append((const char*)&format,   sizeof(format));
+	return true;
+}
+
+/*! Return the image for key, with count incremented, or nullptr if it can't be made.
+ * If key is not cached, and no other thread is making it, call make(), and cache what it returns.
+ * If another thread is making it, wait for that instead.
+ */
+LaxImage *ImageCache::Get(const std::string &key, const std::function<LaxImage*()> &make)
+{
+	{
+		std::unique_lock<std::mutex> lock(cache_mutex);
+		bool waited = false;
+
+		while (true) {
+			auto found = index.find(key);
+			if (found != index.end()) {
+				hits++;
+				if (waited) shared++;
+				if (found->second != entries.begin()) entries.splice(entries.begin(), entries, found->second);
+				LaxImage *image = found->second->image;
+				image->inc_count();
+				return image;
+			}
+
+			if (loading.find(key) == loading.end()) break;
+			loading_done.wait(lock);
+			waited = true;
+		}
+
+		misses++;
+		loading.insert(key);
+	}
+
+	 //the actual loading is done without the lock, since it can be slow, and loaders
+	 //might call doneForNow() on their images
+	LaxImage *image = make();
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	loading.erase(key);
+
+	if (image) {
+		image->inc_count(); //one for the cache, one for the caller
+
+		Entry entry;
+		entry.key   = key;
+		entry.image = image;
+		entry.size  = image->MemoryUsed();
+		entries.push_front(entry);
+		index[key] = entries.begin();
+		images[image] = entries.begin();
+		bytes += entry.size;
+
+		Evict(false);
+	}
+
+	loading_done.notify_all();
+	return image;
+}
+
+/*! Return level of file, loading or making it if necessary.
+ * Reduced levels are made from the level above.
+ */
+LaxImage *ImageCache::LoadLevel(const std::string &basekey, const char *file, int index, int format, int level)
+{
+	std::string key = basekey;
+	key.append((const char*)&level, sizeof(level));
+
+	return Get(key, [&]() -> LaxImage* {
+		if (level == 0) {
+			return ImageLoader::LoadImageUncached(file, nullptr,0,0,nullptr, 0, format, nullptr, true, index);
+		}
+
+		LaxImage *bigger = LoadLevel(basekey, file, index, format, level-1);
+		if (!bigger) return nullptr;
+
+		int width  = bigger->w()/2;
+		int height = bigger->h()/2;
+		if (width  < 1) width  = 1;
+		if (height < 1) height = 1;
+
+		LaxImage *image = GeneratePreview(bigger, width, height, 0);
+		bigger->dec_count();
+		return image;
+	});
+}
+
+/*! Return an image for file, with its count incremented, or nullptr if it could not be loaded.
+ *
+ * If maxw or maxh are > 0, then return the reduced level that will be displayed fitting
+ * in maxw x maxh, as per MipLevel(). Note that its w() and h() are those of the reduced image.
+ *
+ * If file cannot be stat'd, nothing is cached, and this is the same as ImageLoader::LoadImageUncached().
+ */
+LaxImage *ImageCache::Load(const char *file, int index, int maxw, int maxh, int format)
+{
+	if (isblank(file)) return nullptr;
+	if (format <= 0 || format == LAX_IMAGE_DEFAULT) format = default_image_type();
+
+	std::string basekey;
+	if (!MakeKey(basekey, file, index, format)) {
+		return ImageLoader::LoadImageUncached(file, nullptr,0,0,nullptr, 0, format, nullptr, true, index);
+	}
+
+	LaxImage *image = LoadLevel(basekey, file, index, format, 0);
+	if (!image || (maxw <= 0 && maxh <= 0)) return image;
+
+	int level = MipLevel(image->w(), image->h(), maxw, maxh);
+	if (level == 0) return image;
+
+	image->dec_count();
+	return LoadLevel(basekey, file, index, format, level);
+}
+
+//! Remove entry from the cache, releasing the cache's count on its image.
+void ImageCache::Remove(std::list<Entry>::iterator entry)
+{
+	bytes -= entry->size;
+	index.erase(entry->key);
+	images.erase(entry->image);
+	entry->image->dec_count();
+	entries.erase(entry);
+}
+
+/*! Discard least recently used images until under max_bytes. The most recent image is always kept.
+ * Images held elsewhere are not removed, but if drop_pixels, they are asked to FreePixels().
+ * Only do drop_pixels from the event thread. cache_mutex must be locked.
+ */
+void ImageCache::Evict(bool drop_pixels)
+{
+	if (bytes <= max_bytes || entries.size() < 2) return;
+
+	auto entry = entries.end();
+	--entry;
+	while (bytes > max_bytes && entry != entries.begin()) {
+		auto prev = entry;
+		--prev;
+
+		LaxImage *image = entry->image;
+
+		if (image->the_count() == 1) {
+			 //only the cache is using it, and with cache_mutex locked, nothing else can get it
+			Remove(entry);
+
+		} else if (drop_pixels) {
+			 //others might be loading pixels, so only look at those on the event thread
+			long size = image->MemoryUsed();
+			bytes += size - entry->size;
+			entry->size = size;
+
+			if (size > 0 && image->FreePixels() == 0) {
+				entry->size = image->MemoryUsed();
+				bytes -= size - entry->size;
+			}
+		}
+
+		entry = prev;
+	}
+}
+
+/*! Called from LaxImage::doneForNow() when image is no longer being displayed, from whatever
+ * thread drew it. This updates how much memory image is using, and marks it as recently used.
+ * If over the budget, the cache is sent an "imageCacheTrim" message, so that older images are
+ * evicted and have their pixels freed on the event thread. If the cache is not registered with
+ * the app yet, no message is sent, since it would be dropped. Without an anXApp, Trim() is done
+ * right away. Images not in the cache are ignored.
+ */
+void ImageCache::DoneForNow(LaxImage *image)
+{
+	bool send = false;
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex);
+
+		auto found = images.find(image);
+		if (found == images.end()) return;
+
+		auto entry = found->second;
+		long size = image->MemoryUsed();
+		bytes += size - entry->size;
+		entry->size = size;
+		if (entry != entries.begin()) entries.splice(entries.begin(), entries, entry);
+
+		if (bytes <= max_bytes || trim_pending) return;
+
+		if (!anXApp::app) {
+			Evict(true);
+			return;
+		}
+		if (!registered) return;
+		trim_pending = true;
+		send = true;
+	}
+
+	 //outside the lock, since this locks the event queue
+	if (send) anXApp::app->SendMessage(new SimpleMessage(), object_id, "imageCacheTrim", 0);
+}
+
+/*! Remove all images for file, of any age, index, or level. Returns number removed.
+ */
+int ImageCache::Forget(const char *file)
+{
+	if (!file) return 0;
+
+	std::string prefix(file, strlen(file) + 1);
+	std::lock_guard<std::mutex> lock(cache_mutex);
+
+	int n = 0;
+	for (auto entry = entries.begin(); entry != entries.end(); ) {
+		auto next = entry;
+		++next;
+		if (entry->key.compare(0, prefix.size(), prefix) == 0) {
+			Remove(entry);
+			n++;
+		}
+		entry = next;
+	}
+	return n;
+}
+
+/*! Evict and free pixels as necessary to get under MaxBytes().
+ * Only call this from the event thread.
+ */
+void ImageCache::Trim()
+{
+	RegisterWithApp();
+
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	trim_pending = false;
+	Evict(true);
+}
+
+/*! Release all images. Images held elsewhere stay valid, but are no longer shared with new loads.
+ */
+void ImageCache::Flush()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	for (auto &entry : entries) entry.image->dec_count();
+	entries.clear();
+	index.clear();
+	images.clear();
+	bytes = 0;
+}
+
+/*! Set maximum bytes of pixel data to hold, discarding old images if necessary.
+ */
+void ImageCache::MaxBytes(long nmax_bytes)
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	max_bytes = nmax_bytes;
+	Evict(false);
+}
+
+/*! Pixel memory of cached images, as of when each was last loaded, displayed, or evicted.
+ */
+long ImageCache::Bytes()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return bytes;
+}
+
+int ImageCache::NumImages()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return entries.size();
+}
+
+unsigned long ImageCache::Hits()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return hits;
+}
+
+unsigned long ImageCache::Misses()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return misses;
+}
+
+unsigned long ImageCache::Shared()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	return shared;
+}
+
+void ImageCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	hits = misses = shared = 0;
+}
+
+
+} //namespace Laxkit
+
@@ -0,0 +1,106 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+#ifndef _LAX_IMAGECACHE_H
+#define _LAX_IMAGECACHE_H
+
+
+#include <lax/laximages.h>
+#include <lax/events.h>
+
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+
+
+namespace Laxkit {
+
+
+//---------------------------- ImageCache --------------------------------------
+class ImageCache : public EventReceiver
+{
+  private:
+	static ImageCache *default_cache;
+
+  protected:
+	struct Entry {
+		std::string key;
+		LaxImage *image;
+		long size; //image->MemoryUsed() when last checked
+	};
+	std::list<Entry> entries; //most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+	std::unordered_map<LaxImage*, std::list<Entry>::iterator> images;
+	std::unordered_set<std::string> loading; //keys some thread is currently loading
+	bool trim_pending; //an "imageCacheTrim" message is on its way
+	bool registered;   //with anXApp::app, so "imageCacheTrim" can get here
+
+	std::mutex cache_mutex;
+	std::condition_variable loading_done;
+
+	long max_bytes;
+	long bytes;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long shared; //hits that waited on another thread's load
+
+	virtual bool MakeKey(std::string &key, const char *file, int index, int format);
+	virtual LaxImage *Get(const std::string &key, const std::function<LaxImage*()> &make);
+	virtual LaxImage *LoadLevel(const std::string &basekey, const char *file, int index, int format, int level);
+	virtual void Remove(std::list<Entry>::iterator entry);
+	virtual void Evict(bool drop_pixels);
+	virtual void RegisterWithApp();
+
+  public:
+	static ImageCache *GetDefault(bool create_if_null=true);
+	static void SetDefault(ImageCache *ncache);
+	static int MipLevel(int width, int height, int maxw, int maxh);
+
+	ImageCache(long nmax_bytes = 256*1024*1024);
+	virtual ~ImageCache();
+	virtual const char *whattype() { return "ImageCache"; }
+	virtual int Event(const EventData *data, const char *mes);
+
+	virtual LaxImage *Load(const char *file, int index = 0, int maxw = 0, int maxh = 0, int format = LAX_IMAGE_DEFAULT);
+	virtual void DoneForNow(LaxImage *image);
+	virtual int Forget(const char *file);
+	virtual void Trim();
+	virtual void Flush();
+
+	virtual void MaxBytes(long nmax_bytes);
+	virtual long MaxBytes() { return max_bytes; }
+	virtual long Bytes();
+	virtual int NumImages();
+	virtual unsigned long Hits();
+	virtual unsigned long Misses();
+	virtual unsigned long Shared();
+	virtual void ResetStats();
+};
+
+
+} //namespace Laxkit
+
+#endif
+
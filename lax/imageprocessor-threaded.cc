@@ -0,0 +1,345 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+
+#include <lax/imageprocessor-threaded.h>
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+#include <iostream>
+using namespace std;
+#define DBG
+
+
+ //rows are handed to threads in chunks of about this many pixels
+#define BLUR_GRAIN_PIXELS 16384
+
+
+namespace Laxkit {
+
+
+//---------------------------- helpers --------------------------------------
+
+//! out[i] += k*in[i] for i in [0,n).
+static void AddScaled(float *out, const float *in, float k, int n)
+{
+	int i=0;
+
+#if defined(__AVX__)
+	__m256 kk = _mm256_set1_ps(k);
+	for ( ; i+8<=n; i+=8) {
+		_mm256_storeu_ps(out+i, _mm256_add_ps(_mm256_loadu_ps(out+i), _mm256_mul_ps(kk, _mm256_loadu_ps(in+i))));
+	}
+#elif defined(__SSE__)
+	__m128 kk = _mm_set1_ps(k);
+	for ( ; i+4<=n; i+=4) {
+		_mm_storeu_ps(out+i, _mm_add_ps(_mm_loadu_ps(out+i), _mm_mul_ps(kk, _mm_loadu_ps(in+i))));
+	}
+#endif
+
+	for ( ; i<n; i++) out[i] += k*in[i];
+}
+
+//! Running sum box blur of in to out, both len long, box is 2*r+1 wide.
+/*! If partial, then divide by only how many samples are actually in the line, else
+ * treat everything outside as 0.
+ */
+static void BoxLine(const float *in, float *out, int len, int r, bool partial)
+{
+	double sum=0;
+	int count=0;
+	for (int c=0; c<=r && c<len; c++) { sum+=in[c]; count++; }
+
+	double full = 2*r+1;
+	for (int c=0; c<len; c++) {
+		out[c] = sum / (partial ? count : full);
+
+		if (c+r+1 < len) { sum += in[c+r+1]; count++; }
+		if (c-r >= 0)    { sum -= in[c-r];   count--; }
+	}
+}
+
+/*! Widths of 3 box blurs that approximate a gaussian with standard deviation sigma.
+ * Returns box radii in r.
+ */
+static void BoxesForGaussian(double sigma, int *r)
+{
+	int n = 3;
+	double wideal = sqrt(12*sigma*sigma/n + 1);
+	int wl = floor(wideal);
+	if (wl%2==0) wl--;
+	int wu = wl+2;
+
+	double mideal = (12*sigma*sigma - n*wl*wl - 4*n*wl - 3*n) / (-4.*wl - 4);
+	int m = round(mideal);
+
+	for (int c=0; c<n; c++) r[c] = ((c<m ? wl : wu) - 1)/2;
+}
+
+
+//---------------------------- ThreadedImageProcessor --------------------------------------
+/*! \class ThreadedImageProcessor
+ * \brief ImageProcessor that splits its work over a ThreadPool.
+ *
+ * Install with:
+ * \code
+ *   ImageProcessor *proc = new ThreadedImageProcessor;
+ *   ImageProcessor::SetDefault(proc);
+ *   proc->dec_count();
+ * \endcode
+ *
+ * GaussianBlur() here works on float copies of each channel. Horizontal passes are done
+ * a row at a time, with the kernel applied as one multiply-add over the whole row per kernel tap,
+ * using AVX or SSE when the compiler has them enabled. Vertical passes transpose, blur rows, and
+ * transpose back. Radii of box_radius or more use 3 running sum box blurs instead, which costs
+ * the same no matter the radius.
+ */
+
+
+/*! If npool is null, then ThreadPool::GetDefault() is used.
+ */
+ThreadedImageProcessor::ThreadedImageProcessor(ThreadPool *npool)
+{
+	pool = npool;
+	if (pool) pool->inc_count();
+	box_radius = 24;
+}
+
+ThreadedImageProcessor::~ThreadedImageProcessor()
+{
+	if (pool) pool->dec_count();
+}
+
+//! Copy in (width x height) to out (height x width).
+void ThreadedImageProcessor::Transpose(float *in, int width, int height, float *out)
+{
+	const int B = 32;
+	ThreadPool *threads = (pool ? pool : ThreadPool::GetDefault());
+
+	threads->ParallelFor(0, (height+B-1)/B, [&](int by, int thread) {
+		int y0 = by*B, y1 = y0+B;
+		if (y1 > height) y1 = height;
+
+		for (int x0 = 0; x0 < width; x0 += B) {
+			int x1 = x0+B;
+			if (x1 > width) x1 = width;
+
+			for (int y=y0; y<y1; y++) {
+				const float *row = in + (long)y*width;
+				for (int x=x0; x<x1; x++) out[(long)x*height + y] = row[x];
+			}
+		}
+	});
+}
+
+/*! Blur each row of in to out. If expand, out is (width+2*radius) wide, else it is width wide.
+ * Outside the image is taken to be 0. When not expanding, pixels near the edges are normalized
+ * by the part of the kernel that lands on the image.
+ */
+void ThreadedImageProcessor::BlurRows(float *in, int width, int height, float *out, int radius, bool expand)
+{
+	ThreadPool *threads = (pool ? pool : ThreadPool::GetDefault());
+	int owidth = width + (expand ? 2*radius : 0);
+	int grain = BLUR_GRAIN_PIXELS / owidth;
+	if (grain < 1) grain = 1;
+
+	std::vector<std::vector<float> > scratch(threads->NumThreads()+1);
+
+	if (radius >= box_radius) {
+		 //3 pass box blur
+		int boxes[3];
+		BoxesForGaussian(radius/3., boxes);
+
+		threads->ParallelFor(0, height, [&](int y, int thread) {
+			std::vector<float> &buf = scratch[thread];
+			if ((int)buf.size() < 2*owidth) buf.resize(2*owidth);
+			float *line = buf.data(), *tmp = buf.data() + owidth;
+
+			if (expand) {
+				memset(line, 0, owidth*sizeof(float));
+				memcpy(line+radius, in + (long)y*width, width*sizeof(float));
+			} else memcpy(line, in + (long)y*width, width*sizeof(float));
+
+			for (int c=0; c<3; c++) {
+				BoxLine(line, tmp, owidth, boxes[c], !expand);
+				float *t = line; line = tmp; tmp = t;
+			}
+			memcpy(out + (long)y*owidth, line, owidth*sizeof(float));
+		}, grain);
+		return;
+	}
+
+
+	 //create the bell shaped blur kernel
+	int n = 2*radius+1;
+	std::vector<float> kernel(n);
+	double sigma = radius/3.;
+	double sum = 0;
+	std::vector<double> k(n);
+	for (int c=0; c<=radius; c++) {
+		k[radius-c] = k[radius+c] = exp(-c*c/2/sigma/sigma);
+	}
+	for (int c=0; c<n; c++) sum += k[c];
+	for (int c=0; c<n; c++) kernel[c] = k[c]/sum;
+
+	 //when not expanding, edge pixels get divided by the part of the kernel on the image
+	std::vector<float> edgescale;
+	if (!expand) {
+		edgescale.resize(width);
+		for (int x=0; x<width; x++) {
+			if (x >= radius && x < width-radius) { edgescale[x] = 1; continue; }
+			double tsum = 0;
+			for (int c=0; c<n; c++) {
+				int xx = x - radius + c;
+				if (xx >= 0 && xx < width) tsum += kernel[c];
+			}
+			edgescale[x] = 1/tsum;
+		}
+	}
+
+	 //rows are copied into a zero padded line 2*radius wider on each side, so each kernel
+	 //tap is just an offset into it
+	int padlen = width + 4*radius;
+	int base = (expand ? 0 : radius);
+
+	threads->ParallelFor(0, height, [&](int y, int thread) {
+		std::vector<float> &buf = scratch[thread];
+		if ((int)buf.size() < padlen) buf.resize(padlen);
+		float *pad = buf.data();
+
+		memset(pad, 0, 2*radius*sizeof(float));
+		memcpy(pad + 2*radius, in + (long)y*width, width*sizeof(float));
+		memset(pad + 2*radius + width, 0, 2*radius*sizeof(float));
+
+		float *orow = out + (long)y*owidth;
+		memset(orow, 0, owidth*sizeof(float));
+		for (int c=0; c<n; c++) AddScaled(orow, pad + base + c, kernel[c], owidth);
+
+		if (!expand) {
+			for (int x=0; x<radius && x<width; x++) orow[x] *= edgescale[x];
+			for (int x=(width-radius > radius ? width-radius : radius); x<width; x++) orow[x] *= edgescale[x];
+		}
+	}, grain);
+}
+
+/*! Like Laxkit::GaussianBlur(), but parallel and vectorized, and depth can be 8 or 16.
+ * For 16 bit, each channel is a native endian unsigned short.
+ *
+ * which can be 'x', 'y', or 'b' for both. When expanding with 'b', blurred must be
+ * (orig_width + 2*radius, orig_height + 2*radius).
+ *
+ * Channels not in channel_mask are left untouched in blurred.
+ *
+ * Return 0 for success, or nonzero for error (like bad inputs).
+ */
+int ThreadedImageProcessor::GaussianBlur(int radius, char which, unsigned char *img, int orig_width, int orig_height,
+					unsigned char *blurred, bool expand, int depth, int numchannels, int channel_mask )
+{
+	if (!img || !blurred || orig_width<1 || orig_height<1 || numchannels<1) return 1;
+	if (depth!=8 && depth!=16) return 1;
+	if (which!='x' && which!='y' && which!='b') return 1;
+	if (radius < 0) radius = 0;
+	if (channel_mask==0) channel_mask=~0;
+
+	ThreadPool *threads = (pool ? pool : ThreadPool::GetDefault());
+
+	bool dox = (radius>0 && (which=='x' || which=='b'));
+	bool doy = (radius>0 && (which=='y' || which=='b'));
+
+	int new_width  = orig_width  + (expand && (which=='x' || which=='b') ? 2*radius : 0);
+	int new_height = orig_height + (expand && (which=='y' || which=='b') ? 2*radius : 0);
+	int xoff = (new_width-orig_width)/2;
+	int yoff = (new_height-orig_height)/2;
+
+	long maxsize = (long)new_width*new_height;
+	std::vector<float> plane1(maxsize), plane2(maxsize);
+	float maxvalue = (depth==16 ? 65535 : 255);
+
+	for (int ch=0; ch<numchannels; ch++) {
+		if ((channel_mask&(1<<ch))==0) continue;
+
+		float *a = plane1.data(), *b = plane2.data();
+
+		 //unpack channel
+		threads->ParallelFor(0, orig_height, [&](int y, int thread) {
+			float *row = a + (long)y*orig_width;
+			if (depth==16) {
+				const unsigned short *p = (const unsigned short*)img + ((long)y*orig_width*numchannels + ch);
+				for (int x=0; x<orig_width; x++, p+=numchannels) row[x] = *p;
+			} else {
+				const unsigned char *p = img + ((long)y*orig_width*numchannels + ch);
+				for (int x=0; x<orig_width; x++, p+=numchannels) row[x] = *p;
+			}
+		}, BLUR_GRAIN_PIXELS/orig_width + 1);
+
+		int w = orig_width, h = orig_height;
+
+		if (dox) {
+			BlurRows(a, w, h, b, radius, expand);
+			if (expand) w += 2*radius;
+			float *t = a; a = b; b = t;
+		}
+
+		if (doy) {
+			Transpose(a, w, h, b);
+			BlurRows(b, h, w, a, radius, expand);
+			if (expand) h += 2*radius;
+			Transpose(a, h, w, b);
+			float *t = a; a = b; b = t;
+		}
+
+		 //pack channel back
+		threads->ParallelFor(0, new_height, [&](int y, int thread) {
+			const float *row;
+			int yy = y, xo = 0;
+			if (w!=new_width) xo = xoff;    //no x blur, so center in expanded image
+			if (h!=new_height) yy = y-yoff; //no y blur
+			if (yy<0 || yy>=h) return;
+			row = a + (long)yy*w;
+
+			if (depth==16) {
+				unsigned short *p = (unsigned short*)blurred + (((long)y*new_width + xo)*numchannels + ch);
+				for (int x=0; x<w; x++, p+=numchannels) {
+					float v = row[x]+.5;
+					*p = (v<0 ? 0 : v>maxvalue ? maxvalue : v);
+				}
+			} else {
+				unsigned char *p = blurred + (((long)y*new_width + xo)*numchannels + ch);
+				for (int x=0; x<w; x++, p+=numchannels) {
+					float v = row[x]+.5;
+					*p = (v<0 ? 0 : v>maxvalue ? maxvalue : v);
+				}
+			}
+		}, BLUR_GRAIN_PIXELS/new_width + 1);
+	}
+
+	return 0;
+}
+
+
+} //namespace Laxkit
+
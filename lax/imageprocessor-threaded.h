@@ -0,0 +1,57 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+#ifndef _LAX_IMAGEPROCESSOR_THREADED_H
+#define _LAX_IMAGEPROCESSOR_THREADED_H
+
+
+#include <lax/bitmaputils.h>
+#include <lax/threadpool.h>
+
+
+namespace Laxkit {
+
+
+//---------------------------- ThreadedImageProcessor --------------------------------------
+class ThreadedImageProcessor : public ImageProcessor
+{
+  protected:
+	ThreadPool *pool;
+
+	virtual void BlurRows(float *in, int width, int height, float *out, int radius, bool expand);
+	virtual void Transpose(float *in, int width, int height, float *out);
+
+  public:
+	int box_radius; //!< At or above this radius, use a 3 pass box blur instead of the true kernel
+
+	ThreadedImageProcessor(ThreadPool *npool = nullptr);
+	virtual ~ThreadedImageProcessor();
+	virtual const char *whattype() { return "ThreadedImageProcessor"; }
+
+	virtual int GaussianBlur(int radius, char which, unsigned char *img, int orig_width, int orig_height,
+					unsigned char *blurred, bool expand, int depth, int numchannels, int channel_mask );
+};
+
+
+} //namespace Laxkit
+
+#endif
+
@@ -182,6 +182,9 @@ namespace LaxInterfaces {
  */
 /*! \var int anInterface::needtodraw
  * \brief Whether the interface thinks it has to refresh.
+ *
+ * Setting this to something nonzero queues curwindow to be refreshed, whose Needtodraw()
+ * then asks the interface. See Laxkit::NeedtodrawFlag.
  */
 /*! \fn int anInterface::Needtodraw()
  * \brief Must return nonzero if the data needs to be drawn, that is to say Refresh must be called.
@@ -257,6 +260,7 @@ anInterface::anInterface()
 	id              = getUniqueNumber();
 	interface_style = 0;
 	interface_type  = INTERFACE_Tool;
+	needtodraw.Owner(&curwindow);
 	needtodraw      = 1;
 	last_message    = nullptr;
 	last_message_n  = 0;
@@ -85,7 +85,7 @@ class anInterface : virtual public Laxkit::EventReceiver,
 	char *owner_message;
 
 	int primary;
-	int needtodraw; 
+	Laxkit::NeedtodrawFlag needtodraw; //setting nonzero queues curwindow for refreshing
 
 	anInterface();
 	anInterface(int nid);
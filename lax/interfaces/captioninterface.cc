@@ -42,6 +42,7 @@
 #include <lax/laxutils.h>
 #include <lax/fontdialog.h>
 #include <lax/fontmanager.h>
+#include <lax/shapedtextcache.h>
 #include <lax/transformmath.h>
 #include <lax/strmanip.h>
 #include <lax/utf8utils.h>
@@ -344,21 +345,13 @@ int CaptionData::RecacheLine(int linei)
 
 
 
-	 //set up freetype and hb fonts
+	 //set up freetype and shaping
 	FontManager *fontmanager = InterfaceManager::GetDefault()->GetFontManager();
-
-	FT_Face ft_face;
 	FT_Library *ft_library = fontmanager->GetFreetypeLibrary();
-
-	FT_New_Face (*ft_library, font->FontFile(), 0, &ft_face);
-	FT_Set_Char_Size (ft_face, font->Msize()*64, font->Msize()*64, 0, 0);
-
-	hb_font_t *hb_font;
-	hb_font = hb_ft_font_create (ft_face, nullptr);
+	ShapedTextCache *shapecache = ShapedTextCache::GetDefault();
 
 
 	 //figure out direction, language, and script
-	hb_segment_properties_t seg_properties;
 
 
 	 //Figure out direction, if any
@@ -403,130 +396,23 @@ int CaptionData::RecacheLine(int linei)
 			continue;
 		}
 
-		 //create buffer and add text
-		hb_buffer_t *hb_buffer;
-		hb_buffer = hb_buffer_create ();
-		hb_buffer_add_utf8 (hb_buffer, lines.e[c], -1, 0, -1);
-
-
-		 //set direction, language, and script
-		if (dir==HB_DIRECTION_INVALID || hblang==nullptr || hbscript==HB_SCRIPT_UNKNOWN) {
-			 //at least one of these things we know, so we have to manually set again
-			hb_buffer_guess_segment_properties (hb_buffer); //guesses direction, script, language 
-			hb_buffer_get_segment_properties (hb_buffer, &seg_properties);
-
-			if (dir != HB_DIRECTION_INVALID)   seg_properties.direction = dir;      else dir      = seg_properties.direction;
-			if (hblang != nullptr)                seg_properties.language  = hblang;   else hblang   = seg_properties.language;
-			if (hbscript != HB_SCRIPT_UNKNOWN) seg_properties.script    = hbscript; else hbscript = seg_properties.script;
-
-			hb_buffer_set_segment_properties (hb_buffer, &seg_properties);
-
-		} else {
-			 //we know them all so...
-			seg_properties.direction = dir;
-			seg_properties.language  = hblang;
-			seg_properties.script    = hbscript;
-			hb_buffer_set_segment_properties (hb_buffer, &seg_properties);
+		 //shape it, or get the line as already shaped
+		ShapedRun *run = shapecache->Shape(ft_library, font, font->Msize(), dir, hblang, hbscript, lines.e[c], -1);
+		if (!run) {
+			cerr << " *** could not shape with font "<<(font->FontFile() ? font->FontFile() : "(none)")<<endl;
+			linelengths.e[c] = 0;
+			linestats.e[c]->numglyphs = 0;
+			linestats.e[c]->pixlen = 0;
+			linestats.e[c]->needtorecache = false;
+			continue;
 		}
 
+		 //whatever was guessed for this line is used for following lines
+		dir      = run->direction;
+		hblang   = run->language;
+		hbscript = run->script;
 
-		 //set features
-		hb_face_t *hb_face;
-		hb_face = hb_ft_face_create_referenced(ft_face); 
-
-		//*** foreach (feature in feature_string) set for hb_font
-		//hb_ot_layout_language_get_feature_tags()
-		//
-
-		unsigned int lang_index=0;
-		unsigned int script_index=0;
-
-#ifdef HARFBUZZ_BELOW_2_0
-		hb_tag_t script_tag1, script_tag2;
-		hb_ot_tags_from_script(hbscript, &script_tag1, &script_tag2);
-
-		hb_tag_t lang_tag = hb_ot_tag_from_language (hblang);
-		hb_ot_layout_script_find_language (hb_face, HB_OT_TAG_GSUB, script_index, lang_tag, &lang_index);
-
-#else
-		hb_tag_t lang_tag;
-		hb_tag_t script_tag1;
-		unsigned int n_script_tags = 1;
-		unsigned int n_lang_tags = 1;
-
-		hb_ot_tags_from_script_and_language(hbscript, hblang, &n_script_tags, &script_tag1, &n_lang_tags, &lang_tag);
-
-		hb_ot_layout_table_find_script (hb_face, HB_OT_TAG_GSUB, script_tag1, &script_index);
-
-		hb_ot_layout_script_select_language (hb_face, HB_OT_TAG_GSUB, script_index, 1, &lang_tag, &lang_index);
-#endif
-
-		//------getting list of otf features:
-		// unsigned int count = 80;
-		// hb_tag_t myResult[count];
-		// //hb_ot_layout_table_get_feature_tags(hb_font_get_face(hb_font), HB_OT_TAG_GSUB, 0, &count, myResult)
-		// //hb_ot_layout_table_get_feature_tags(hb_font_get_face(hb_font), HB_OT_TAG_GPOS, 0, &count, myResult)
-		// //
-		// //
-		// //- hb_ot_layout_table_get_script_tags() to get all scripts for this font;
-		// //- for each script index get all languages supported for this script with 
-		// //hb_ot_layout_script_get_language_tags();
-		// //- at this point it's two dimensional - (script index, language index), 
-		// //now get feature set for this pair with:
-
-		// hb_ot_layout_language_get_feature_tags(hb_face, HB_OT_TAG_GSUB, script_index, lang_index, 0, &count, myResult);
-		// DBG cerr <<"for font :"<<font->FontFile()<<":"<<endl;
-		// DBG cerr <<" All the GSUB features for cur lang+script:  ";
-		// char tagstr[5]; tagstr[4]='\0';
-		// for (int cc=0; cc<(int)count; cc++) {
-		// 	hb_tag_to_string(myResult[cc], tagstr);
-		// 	DBG cerr <<tagstr<<"  ";
-		// }
-		// DBG cerr << endl;
-		// hb_ot_layout_language_get_feature_tags(hb_face, HB_OT_TAG_GPOS, script_index, lang_index, 0, &count, myResult);
-		// DBG cerr <<" All the GPOS features for cur lang+script:  ";
-		// for (int cc=0; cc<(int)count; cc++) {
-		// 	hb_tag_to_string(myResult[cc], tagstr);
-		// 	DBG cerr <<tagstr<<"  ";
-		// }
-		// DBG cerr << endl;
-
-
-		  //Shape it!
-		hb_shape (hb_font, hb_buffer, nullptr, 0);
-
-
-		 // get positioning
-		 //
-		//struct hb_glyph_info_t {
-		//  hb_codepoint_t codepoint;
-		//  hb_mask_t      mask;
-		//  uint32_t       cluster;
-		//}
-		//
-		//struct hb_glyph_position_t {
-		//  hb_position_t  x_advance;
-		//  hb_position_t  y_advance;
-		//  hb_position_t  x_offset; //shift from current position based on advances
-		//  hb_position_t  y_offset;
-		//}
-		//
-		//hb_segment_properties_t {
-		//  hb_direction_t  direction;
-		//  hb_script_t     script;
-		//  hb_language_t   language;
-		//}
-		//
-		//cairo_glyph_t {
-		//  unsigned long        index;
-		//  double               x;
-		//  double               y;
-		//} 
-		//
-
-		unsigned int numglyphs   = hb_buffer_get_length (hb_buffer); //glyphs wide
-		hb_glyph_info_t *info    = hb_buffer_get_glyph_infos (hb_buffer, nullptr);     //points to inside hb_buffer
-		hb_glyph_position_t *pos = hb_buffer_get_glyph_positions (hb_buffer, nullptr); //points to inside hb_buffer
+		unsigned int numglyphs = run->glyphs.size();
 
 		 // update cache info
 		if (linestats.e[c]->numglyphs < (int)numglyphs) {
@@ -536,48 +422,18 @@ int CaptionData::RecacheLine(int linei)
 		linestats.e[c]->numglyphs = numglyphs;
 
 		GlyphPlace *glyphs = linestats.e[c]->glyphs;
-		double current_x = 0;
-		double current_y = 0;
-		width=0; 
-		double widthy=0;
-
-		DBG cerr <<" computing line: "<<lines.e[c]<<endl;
-		for (unsigned int i = 0; i < numglyphs; i++)
-		{
-			glyphs[i].index     = info[i].codepoint;
-			glyphs[i].cluster   = info[i].cluster;
-			glyphs[i].x_advance = pos[i].x_advance / 64.;
-			glyphs[i].y_advance = pos[i].y_advance / 64.;
-			glyphs[i].x         =   current_x + pos[i].x_offset / 64.;
-			glyphs[i].y         = -(current_y + pos[i].y_offset / 64.);
-			glyphs[i].numchars  = get_num_chars(lines.e[c], -1, glyphs[i].cluster, i==numglyphs-1 ? strlen(lines.e[c]) : glyphs[i+1].cluster);
-
-			width     += pos[i].x_advance / 64.;
-			widthy    += pos[i].y_advance / 64.;
-
-			current_x += pos[i].x_advance / 64.;
-			current_y += pos[i].y_advance / 64.;
-
-			DBG fprintf(stderr, "index: %4d   cluster: %2u   at: %f, %f\n", glyphs[i].index, glyphs[i].cluster, glyphs[i].x, glyphs[i].y);
-			//DBG cerr <<"index: "<<glyphs[i].index<<"  cluster: "<<glyphs[i].cluster<<"  at: "<<glyphs[i].x<<","<<glyphs[i].y<<endl;
-		}
+		for (unsigned int i = 0; i < numglyphs; i++) glyphs[i] = run->glyphs[i];
+		width = run->x_advance;
 
-		DBG cerr <<endl;
+		DBG cerr <<" computing line: "<<lines.e[c]<<", "<<numglyphs<<" glyphs"<<endl;
 
 		linelengths.e[c] = width;
 
 		linestats.e[c]->pixlen = width;
 		linestats.e[c]->needtorecache = false;
-		
-
-		hb_buffer_destroy (hb_buffer);
 
 	} //foreach line
 
-
-	 //cleanup
-	hb_font_destroy (hb_font);
-	FT_Done_Face (ft_face);
 	needtorecache = 0;
 
 	return 0;
@@ -20,7 +20,7 @@
 //    Copyright (C) 2015 by Tom Lechner
 //
 //
-//  ---- Delaunay Triangulation below:
+//  ---- CircumCircle() below:
 //  Adapted from Paul Bourke's C implementation 
 
 
@@ -36,6 +36,11 @@
 #include <lax/colorevents.h>
 #include <lax/language.h>
 
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <cstdint>
+
 
 using namespace Laxkit;
 
@@ -51,6 +56,13 @@ namespace LaxInterfaces {
 //forward declarations...
 int DelaunayTriangulate(flatpoint *pts, int nv, IndexTriangle *tri_ret, int *ntri_ret);
 int DelaunayTriangulate(PointSet::PointObj **pts, int nv, IndexTriangle *tri_ret, int *ntri_ret);
+void LinkTriangles(IndexTriangle *tris, int n);
+int CircumCircle(double xp,double yp,
+				 double x1,double y1,double x2,double y2,double x3,double y3,
+				 double *xc,double *yc,double *rsqr);
+static inline double TriOrient(const flatpoint &a, const flatpoint &b, const flatpoint &c);
+static bool InCircumCircleCW(const flatpoint &a, const flatpoint &b, const flatpoint &c, const flatpoint &d);
+static inline int &TriPoint(IndexTriangle &tri, int k);
 
 
 //------------------------------- Point list generators ---------------------------------
@@ -434,13 +446,18 @@ void VoronoiData::RelaxBarycenter(int iters, double strength, DoubleBBox box)
 		double smallestdist = 1000000;
 		for (int c = 0; c < points.n; c++) {
 			if (barycenters.e[c].info != 0) continue; //leave alone points of infinite regions
+			if (c >= regions.n || regions.e[c].tris.n == 0) continue; //point not in triangulation
 
 			flatpoint v = barycenters.e[c] - points.e[c]->p;
 			double l = v.norm2();
 			if (l < smallestdist) smallestdist = l;
 			points.e[c]->p += v * strength;
 		}
-		RebuildVoronoi(true);
+		InvalidateIndex();
+
+		 //points only moved a little, so usually a few edge flips fix the triangulation
+		if (!UpdateTriangulation()) Triangulate();
+		RebuildVoronoi(false);
 	}
 }
 
@@ -552,50 +569,163 @@ void VoronoiData::Triangulate()
 	DelaunayTriangulate(points.e,points.n, triangles.e,&triangles.n);
 	FindBBox();
 
-	 //reset triangle links
+	LinkTriangles(triangles.e, triangles.n);
+}
+
+/*! Repair the current triangulation after points have moved, by flipping edges until it is
+ * Delaunay again. This is much faster than Triangulate() when points have only moved a little,
+ * as in each step of RelaxBarycenter().
+ *
+ * Only use this when points have moved, not when points have been added or removed.
+ * Edges on the outside of the triangulation are kept as is, so if points have moved such that the
+ * convex hull is different, this returns false.
+ *
+ * Returns false if the triangulation cannot be repaired this way, such as when a triangle has turned
+ * inside out and a single flip does not fix it. In that case, call Triangulate().
+ * Returns true for success, and circumcenters are updated. RebuildVoronoi(false) should be called after.
+ */
+bool VoronoiData::UpdateTriangulation()
+{
+	if (!show_delaunay && !show_voronoi) return false;
+	if (points.n < 3 || triangles.n == 0) return false;
+
+	std::vector<int> stack; //3*triangle + edge, of edges to check
+	stack.reserve(3*triangles.n);
+
+	 //replace old with newtri in tri's neighbor across edge e1..e2
+	auto relink = [&](int tri, int e1, int e2, int old, int newtri) {
+		if (tri < 0) return;
+		IndexTriangle &t = triangles.e[tri];
+		for (int k=0; k<3; k++) {
+			if (t.t[k] == old && TriPoint(t, k) == e2 && TriPoint(t, (k+1)%3) == e1) { t.t[k] = newtri; return; }
+		}
+	};
+
+	 //Flip edge k of triangle ti, if the new triangles would be clockwise, and if delaunay,
+	 //only when the edge is not locally Delaunay. Return 1 for flipped, 0 for not, -1 for broken links.
+	auto flip = [&](int ti, int k, bool delaunay) {
+		IndexTriangle &T = triangles.e[ti];
+		int ui = T.t[k];
+		if (ui < 0) return 0;
+		IndexTriangle &U = triangles.e[ui];
+
+		int a = TriPoint(T, k);
+		int b = TriPoint(T, (k+1)%3);
+		int c = TriPoint(T, (k+2)%3);
+		int j = U.HasCWEdge(b,a);
+		if (!j) return -1;
+		j--;
+		int d = TriPoint(U, (j+2)%3);
+
+		flatpoint &pa = points.e[a]->p, &pb = points.e[b]->p, &pc = points.e[c]->p, &pd = points.e[d]->p;
+		if (delaunay && !InCircumCircleCW(pa, pb, pc, pd)) return 0;
+		if (TriOrient(pa, pd, pc) >= 0 || TriOrient(pb, pc, pd) >= 0) return 0; //quad is not convex
+
+		int n_bc = T.t[(k+1)%3];
+		int n_ca = T.t[(k+2)%3];
+		int n_ad = U.t[(j+1)%3];
+		int n_db = U.t[(j+2)%3];
+
+		 //T,U = (a,b,c),(b,a,d) --> (a,d,c),(b,c,d)
+		T.p1 = a;  T.p2 = d;  T.p3 = c;
+		T.t[0] = n_ad;  T.t[1] = ui;  T.t[2] = n_ca;
+		U.p1 = b;  U.p2 = c;  U.p3 = d;
+		U.t[0] = n_bc;  U.t[1] = ti;  U.t[2] = n_db;
+		relink(n_ad, a, d, ui, ti);
+		relink(n_bc, b, c, ti, ui);
+
+		stack.push_back(3*ti+0);
+		stack.push_back(3*ti+2);
+		stack.push_back(3*ui+0);
+		stack.push_back(3*ui+2);
+		return 1;
+	};
+
+	 //sanity check, and try to fix triangles that points have moved across
+	std::vector<char> used(points.n, 0);
+	std::vector<int> inverted;
 	for (int c=0; c<triangles.n; c++) {
-		triangles.e[c].t[0]=triangles.e[c].t[1]=triangles.e[c].t[2]=-1;
+		IndexTriangle &tri = triangles.e[c];
+		if (tri.p1 < 0 || tri.p1 >= points.n || tri.p2 < 0 || tri.p2 >= points.n || tri.p3 < 0 || tri.p3 >= points.n)
+			return false;
+		used[tri.p1] = used[tri.p2] = used[tri.p3] = 1;
+		if (TriOrient(points.e[tri.p1]->p, points.e[tri.p2]->p, points.e[tri.p3]->p) >= 0) inverted.push_back(c);
+	}
+	for (int c=0; c<points.n; c++) if (!used[c]) return false;
+
+	for (int ti : inverted) {
+		IndexTriangle &tri = triangles.e[ti];
+		if (TriOrient(points.e[tri.p1]->p, points.e[tri.p2]->p, points.e[tri.p3]->p) < 0) continue; //fixed already
+		for (int k=0; k<3; k++) {
+			int status = flip(ti, k, false);
+			if (status < 0) return false;
+			if (status > 0) break;
+		}
 	}
 
-	 //find triangle links
-	IndexTriangle *tri;
-	int e;
+	 //now all triangles must be clockwise
 	for (int c=0; c<triangles.n; c++) {
-		tri=&triangles.e[c];
-
-		 //find triangle connections, the triangle on other side of edges
-		if (tri->t[0]==-1) {
-			for (int c2=c+1; c2<triangles.n; c2++) {
-				e=triangles.e[c2].HasCCWEdge(tri->p1,tri->p2);
-				if (e) {
-					tri->t[0]=c2;
-					triangles.e[c2].t[e-1]=c;
-				}
-			}
-		}
+		IndexTriangle &tri = triangles.e[c];
+		if (TriOrient(points.e[tri.p1]->p, points.e[tri.p2]->p, points.e[tri.p3]->p) >= 0) return false;
+	}
 
-		 //find t2, the triangle on other side of p2-p3 edge
-		if (tri->t[1]==-1) {
-			for (int c2=c+1; c2<triangles.n; c2++) {
-				e=triangles.e[c2].HasCCWEdge(tri->p2,tri->p3);
-				if (e) {
-					tri->t[1]=c2;
-					triangles.e[c2].t[e-1]=c;
-				}
-			}
+	 //Flips never change the outside edges, so those must still be the convex hull of the points.
+	 //They must form one closed loop, turning clockwise (or going straight) at every vertex. Since
+	 //all triangles are clockwise and every point is used, this means the triangles exactly tile the hull.
+	std::vector<int> next(points.n, -1);
+	int numboundary = 0;
+	int start = -1;
+	for (int c=0; c<triangles.n; c++) {
+		IndexTriangle &tri = triangles.e[c];
+		for (int k=0; k<3; k++) {
+			if (tri.t[k] >= 0) continue;
+			int a = TriPoint(tri, k);
+			if (next[a] >= 0) return false; //hull touches itself
+			next[a] = TriPoint(tri, (k+1)%3);
+			numboundary++;
+			start = a;
 		}
+	}
+	if (numboundary < 3) return false;
+
+	int prev = start, cur = next[start];
+	int looplength = 1;
+	while (cur != start) {
+		if (cur < 0 || next[cur] < 0 || looplength >= numboundary) return false;
+		if (TriOrient(points.e[prev]->p, points.e[cur]->p, points.e[next[cur]]->p) > 0) return false; //hull is no longer convex
+		prev = cur;
+		cur = next[cur];
+		looplength++;
+	}
+	if (looplength != numboundary) return false; //more than one loop
+	if (TriOrient(points.e[prev]->p, points.e[start]->p, points.e[next[start]]->p) > 0) return false;
+
+	 //flip edges until every edge is locally Delaunay
+	stack.clear();
+	for (int c=0; c<triangles.n; c++) for (int k=0; k<3; k++) stack.push_back(3*c+k);
+
+	int maxflips = 10*triangles.n + 100;
+	int numflips = 0;
+	while (stack.size()) {
+		int ti = stack.back() / 3;
+		int k  = stack.back() % 3;
+		stack.pop_back();
+
+		int status = flip(ti, k, true);
+		if (status < 0) return false; //links are broken!
+		if (status > 0 && ++numflips > maxflips) return false;
+	}
 
-		 //find t3, the triangle on other side of p3-p1 edge
-		if (tri->t[2]==-1) {
-			for (int c2=c+1; c2<triangles.n; c2++) {
-				e=triangles.e[c2].HasCCWEdge(tri->p3,tri->p1);
-				if (e) {
-					tri->t[2]=c2;
-					triangles.e[c2].t[e-1]=c;
-				}
-			}
-		}
+	double r;
+	for (int c=0; c<triangles.n; c++) {
+		IndexTriangle &tri = triangles.e[c];
+		flatpoint &p1 = points.e[tri.p1]->p, &p2 = points.e[tri.p2]->p, &p3 = points.e[tri.p3]->p;
+		CircumCircle(0,0, p1.x,p1.y, p2.x,p2.y, p3.x,p3.y, &tri.circumcenter.x, &tri.circumcenter.y, &r);
 	}
+
+	FindBBox();
+	DBG cerr << "VoronoiData::UpdateTriangulation: "<<numflips<<" flips"<<endl;
+	return true;
 }
 
 /*! If triangulate_also, call Triangulate() first. Otherwise, assume that has already been called,
@@ -620,6 +750,14 @@ void VoronoiData::RebuildVoronoi(bool triangulate_also)
 	int ntri, curtri;
 	flatpoint v;
 
+	 //first triangle that has each point
+	std::vector<int> firsttri(points.n, -1);
+	for (int c=triangles.n-1; c>=0; c--) {
+		firsttri[triangles.e[c].p1] = c;
+		firsttri[triangles.e[c].p2] = c;
+		firsttri[triangles.e[c].p3] = c;
+	}
+
 	for (int c=0; c<points.n; c++) {
 		region            = &regions.e[c];
 		region->point     = points.e[c]->p;
@@ -627,18 +765,12 @@ void VoronoiData::RebuildVoronoi(bool triangulate_also)
 		region->tris.flush();
 
 		// find a triangle that has the point
-		pos=-1;
-		for (int c2=0; c2<triangles.n; c2++) {
-			pos=triangles.e[c2].Has(c);
-			if (pos) {
-				tri=&triangles.e[c2];
-				region->tris.push(c2);
-				first=c2;
-				curtri=c2;
-				break;
-			}
-		}
-		if (pos<=0) break; //error! no triangle has point!
+		first = firsttri[c];
+		if (first < 0) continue; //no triangle has point, such as a duplicate point
+		tri = &triangles.e[first];
+		pos = tri->Has(c);
+		region->tris.push(first);
+		curtri = first;
 
 		 //find next triangles, going clockwise
 		while (1) {
@@ -728,7 +860,8 @@ int VoronoiData::Map(std::function<int(const flatpoint &p, flatpoint &newp)> adj
 	// 		n++;
 	// 	}
 	// }
-	RebuildVoronoi(true);
+	if (!UpdateTriangulation()) Triangulate();
+	RebuildVoronoi(false);
 	return n;
 }
 
@@ -1337,6 +1470,7 @@ int DelaunayInterface::MouseMove(int x,int y,unsigned int state, const Laxkit::L
 
 	flatpoint d=data->transformPointInverse(screentoreal(x,y))-data->transformPointInverse(screentoreal(lx,ly));
 	data->points.e[curpoint]->p += d;
+	data->InvalidateIndex();
 	Triangulate();
 	data->touchContents();
 
@@ -1712,7 +1846,8 @@ int DelaunayInterface::PerformAction(int action)
 		if (!data) return 0;
 		DoubleBBox box;
 		GetDefaultBBox(box);
-		data->Relax(relax_iters, .5, .1, box);
+		 //only neighbors within 4*mindist push, so big point sets relax in about linear time
+		data->Relax(relax_iters, .5, .1, box, 4*.5);
 		// data->Relax(relax_iters, 1);
 		Triangulate();
 		PostMessage(_("Relaxing..."));
@@ -2040,329 +2175,351 @@ void DelaunayInterface::Triangulate()
 //-----------------------------------------------------------------------------------------
 //-----------------------------------------------------------------------------------------
 //-------------------- Delaunay Triangulation ---------------------------------------------
-//---------------- Adapted from Paul Bourke's C implementation ----------------------------
 //-----------------------------------------------------------------------------------------
 //-----------------------------------------------------------------------------------------
 //-----------------------------------------------------------------------------------------
 
 
 
-//forward declarations...
-int CompareXCoord(const void *v1,const void *v2);
-int CircumCircle(double xp,double yp,
-				 double x1,double y1,double x2,double y2,double x3,double y3,
-				 double *xc,double *yc,double *rsqr);
-int Triangulate(int nv,flatpoint *pxyz,IndexTriangle *v,int *ntri);
+//! Twice the signed area of a,b,c. Negative for clockwise.
+static inline double TriOrient(const flatpoint &a, const flatpoint &b, const flatpoint &c)
+{
+	return (b.x-a.x)*(c.y-a.y) - (b.y-a.y)*(c.x-a.x);
+}
 
+/*! Return true if d is definitely inside the circumcircle of the clockwise triangle a,b,c.
+ * Points on the circle, give or take round off, count as outside, so that
+ * cocircular points (such as in grids) do not cause endless flipping.
+ */
+static bool InCircumCircleCW(const flatpoint &a, const flatpoint &b, const flatpoint &c, const flatpoint &d)
+{
+	double adx = a.x-d.x, ady = a.y-d.y;
+	double bdx = b.x-d.x, bdy = b.y-d.y;
+	double cdx = c.x-d.x, cdy = c.y-d.y;
+	double alift = adx*adx + ady*ady;
+	double blift = bdx*bdx + bdy*bdy;
+	double clift = cdx*cdx + cdy*cdy;
+
+	 //usual incircle determinant is for counterclockwise, so use a,c,b
+	double t1 = alift * (cdx*bdy - cdy*bdx);
+	double t2 = clift * (bdx*ady - bdy*adx);
+	double t3 = blift * (adx*cdy - ady*cdx);
+	double det = t1 + t2 + t3;
+	return det > 1e-12 * (fabs(t1) + fabs(t2) + fabs(t3));
+}
 
+static inline int &TriPoint(IndexTriangle &tri, int k)
+{
+	return k == 0 ? tri.p1 : (k == 1 ? tri.p2 : tri.p3);
+}
 
-/*! tri_ret should be large enough to hold 3*nv triangles. The actual number of triangles is returned in n_ret.
+
+/*! \class DelaunayMesh
+ * Incremental Bowyer-Watson triangulation, used by DelaunayTriangulate().
  *
- * Return 0 for success, 1 for not enough points (need more than 2).
+ * Points are inserted in a spatially coherent order, and each is located by walking
+ * across triangles from the previous insertion, so each insertion only touches a handful
+ * of triangles. Triangles keep links to their neighbors as they are built.
  *
- * Note that the Voronoi diagram is the dual graph of a Delaunay triangulation. The Voronoi
- * cells are all points closest to particular points.
- * It is formed by connecting the centers of all circumcircles of the triangles around each point
- * in a Delaunay triangulation.
+ * Triangles are clockwise, and n[k] is the triangle across edge p[k]..p[k+1].
  */
-int DelaunayTriangulate(flatpoint *pts, int nv, IndexTriangle *tri_ret, int *ntri_ret)
+class DelaunayMesh
 {
-   if (nv < 3) return 1;
-
-   flatpoint p[nv+3];
-   for (int c=0; c<nv; c++) pts[c].info=c;
-   memcpy(p,pts, nv*sizeof(flatpoint));
-
-    //need to order points by x
-   qsort(p,nv,sizeof(flatpoint),CompareXCoord);
-   Triangulate(nv,p, tri_ret,ntri_ret);
-
-    //need to convert indices to what they were before qsort
-   for (int c=0; c<*ntri_ret; c++) {
-	   tri_ret[c].p1 = p[tri_ret[c].p1].info;
-	   tri_ret[c].p2 = p[tri_ret[c].p2].info;
-	   tri_ret[c].p3 = p[tri_ret[c].p3].info;
-   }
+  public:
+	class Tri
+	{
+	  public:
+		int p[3];
+		int n[3];
+		bool alive;
+	};
+
+	class CavityEdge
+	{
+	  public:
+		int a, b, outside, tri;
+	};
+
+	std::vector<flatpoint> pts; //input points, then 3 points of a super triangle
+	std::vector<Tri> tris;
+	std::vector<int> freetris;
+	std::vector<int> cavity;
+	std::vector<char> incavity;
+	std::vector<CavityEdge> boundary;
+	int last;
+
+	int NewTri(int a, int b, int c);
+	int Locate(const flatpoint &p);
+	bool Insert(int i);
+	void Relink(int tri, int a, int b, int newtri);
+	int Build(const flatpoint *points, int nv, IndexTriangle *tri_ret, int *ntri_ret);
+};
 
+int DelaunayMesh::NewTri(int a, int b, int c)
+{
+	int i;
+	if (freetris.size()) {
+		i = freetris.back();
+		freetris.pop_back();
+	} else {
+		i = tris.size();
+		tris.push_back(Tri());
+		incavity.push_back(0);
+	}
+	Tri &t = tris[i];
+	t.p[0] = a; t.p[1] = b; t.p[2] = c;
+	t.n[0] = t.n[1] = t.n[2] = -1;
+	t.alive = true;
+	return i;
+}
 
-   DBG cerr << "DelaunayTriangulate: Formed "<<(*ntri_ret)<<" triangles"<<endl;
-   return 0;
+/*! Walk from the last triangle made toward p. Returns the triangle containing p.
+ */
+int DelaunayMesh::Locate(const flatpoint &p)
+{
+	int t = last;
+	int steps = 0;
+	while (1) {
+		Tri &tri = tris[t];
+		int next = -1;
+		int k0 = steps % 3; //vary start edge so walks cannot cycle on degenerate input
+		for (int i=0; i<3; i++) {
+			int k = (k0 + i) % 3;
+			if (TriOrient(pts[tri.p[k]], pts[tri.p[(k+1)%3]], p) > 0) {
+				next = tri.n[k];
+				break;
+			}
+		}
+		if (next < 0) return t;
+		t = next;
+
+		if (++steps > (int)tris.size()) {
+			 //should not happen, but don't hang on very bad input
+			for (int c=0; c<(int)tris.size(); c++) {
+				if (!tris[c].alive) continue;
+				Tri &tt = tris[c];
+				if (TriOrient(pts[tt.p[0]], pts[tt.p[1]], p) <= 0
+				 && TriOrient(pts[tt.p[1]], pts[tt.p[2]], p) <= 0
+				 && TriOrient(pts[tt.p[2]], pts[tt.p[0]], p) <= 0) return c;
+			}
+			return t;
+		}
+	}
 }
 
-int DelaunayTriangulate(PointSet::PointObj **pts, int nv, IndexTriangle *tri_ret, int *ntri_ret)
+/*! In tri, point the neighbor across edge b..a to newtri.
+ */
+void DelaunayMesh::Relink(int tri, int a, int b, int newtri)
 {
-	if (nv < 3) return 1;
+	if (tri < 0) return;
+	Tri &t = tris[tri];
+	for (int k=0; k<3; k++) {
+		if (t.p[k] == b && t.p[(k+1)%3] == a) { t.n[k] = newtri; return; }
+	}
+}
 
-	flatpoint p[nv+3];
-	for (int c=0; c<nv; c++) {
-		p[c] = pts[c]->p;
-		p[c].info = c;
+/*! Insert pts[i] into the mesh. Returns false if it was a duplicate of an existing point.
+ */
+bool DelaunayMesh::Insert(int i)
+{
+	const flatpoint &p = pts[i];
+	int t = Locate(p);
+	for (int k=0; k<3; k++) if (pts[tris[t].p[k]] == p) return false;
+
+	 //find all triangles whose circumcircle contains p
+	cavity.clear();
+	cavity.push_back(t);
+	incavity[t] = 1;
+	for (int c=0; c<(int)cavity.size(); c++) {
+		Tri &tri = tris[cavity[c]];
+		for (int k=0; k<3; k++) {
+			int nb = tri.n[k];
+			if (nb < 0 || incavity[nb]) continue;
+			Tri &ntri = tris[nb];
+			if (InCircumCircleCW(pts[ntri.p[0]], pts[ntri.p[1]], pts[ntri.p[2]], p)) {
+				incavity[nb] = 1;
+				cavity.push_back(nb);
+			}
+		}
 	}
 
-	//need to order points by x
-	qsort(p,nv,sizeof(flatpoint),CompareXCoord);
-	Triangulate(nv,p, tri_ret,ntri_ret);
+	 //gather the cavity boundary, and make sure p can see all of it, which round off
+	 //can occasionally spoil. If not, shrink the cavity
+	bool ok;
+	do {
+		ok = true;
+		boundary.clear();
+		for (int c=0; c<(int)cavity.size() && ok; c++) {
+			int ct = cavity[c];
+			if (!incavity[ct]) continue;
+			Tri &tri = tris[ct];
+			for (int k=0; k<3; k++) {
+				int nb = tri.n[k];
+				if (nb >= 0 && incavity[nb]) continue;
+				CavityEdge e;
+				e.a = tri.p[k];
+				e.b = tri.p[(k+1)%3];
+				e.outside = nb;
+				e.tri = -1;
+				if (ct != t && TriOrient(pts[e.a], pts[e.b], p) >= 0) {
+					incavity[ct] = 0;
+					ok = false;
+					break;
+				}
+				boundary.push_back(e);
+			}
+		}
+	} while (!ok);
+
+	for (int c=0; c<(int)cavity.size(); c++) {
+		int ct = cavity[c];
+		if (!incavity[ct]) continue;
+		incavity[ct] = 0;
+		tris[ct].alive = false;
+		freetris.push_back(ct);
+	}
 
-	//need to convert indices to what they were before qsort
-	for (int c=0; c<*ntri_ret; c++) {
-	   tri_ret[c].p1 = p[tri_ret[c].p1].info;
-	   tri_ret[c].p2 = p[tri_ret[c].p2].info;
-	   tri_ret[c].p3 = p[tri_ret[c].p3].info;
+	 //fan new triangles from p to the boundary
+	for (auto &e : boundary) {
+		e.tri = NewTri(e.a, e.b, i);
+		tris[e.tri].n[0] = e.outside;
+		Relink(e.outside, e.a, e.b, e.tri);
+	}
+	for (auto &e : boundary) {
+		Tri &tri = tris[e.tri];
+		for (auto &e2 : boundary) {
+			if (e2.a == e.b) tri.n[1] = e2.tri; //across b..p
+			if (e2.b == e.a) tri.n[2] = e2.tri; //across p..a
+		}
 	}
 
-	DBG cerr << "DelaunayTriangulate: Formed "<<(*ntri_ret)<<" triangles"<<endl;
-	return 0;
+	last = boundary.size() ? boundary[0].tri : t;
+	return true;
 }
 
+/*! See DelaunayTriangulate().
+ */
+int DelaunayMesh::Build(const flatpoint *points, int nv, IndexTriangle *tri_ret, int *ntri_ret)
+{
+	*ntri_ret = 0;
+	if (nv < 3) return 1;
 
+	pts.assign(points, points + nv);
+	DoubleBBox box;
+	for (int c=0; c<nv; c++) box.addtobounds(pts[c]);
+
+	 //supertriangle, clockwise, enclosing all the points
+	double dmax = std::max(box.maxx - box.minx, box.maxy - box.miny);
+	if (dmax <= 0) dmax = 1;
+	double xmid = (box.maxx + box.minx) / 2;
+	double ymid = (box.maxy + box.miny) / 2;
+	pts.push_back(flatpoint(xmid - 20 * dmax, ymid - dmax));
+	pts.push_back(flatpoint(xmid, ymid + 20 * dmax));
+	pts.push_back(flatpoint(xmid + 20 * dmax, ymid - dmax));
+
+	tris.clear();
+	freetris.clear();
+	incavity.clear();
+	tris.reserve(2*nv + 10);
+	last = NewTri(nv, nv+1, nv+2);
+
+	 //Insert in a snaking order through strips of about equal numbers of points,
+	 //so that each walk from the previous point is short. Strips are by rank, not
+	 //by coordinate, so a few far away points do not spoil the order.
+	int nstrips = (int)sqrt(nv/2.0);
+	if (nstrips < 1) nstrips = 1;
+	std::vector<int> order(nv);
+	for (int c=0; c<nv; c++) order[c] = c;
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return pts[a].x < pts[b].x; });
+	for (int s=0; s<nstrips; s++) {
+		auto start = order.begin() + (long)nv * s / nstrips;
+		auto end   = order.begin() + (long)nv * (s+1) / nstrips;
+		if (s & 1) std::sort(start, end, [&](int a, int b) { return pts[a].y > pts[b].y; });
+		else       std::sort(start, end, [&](int a, int b) { return pts[a].y < pts[b].y; });
+	}
 
-int CompareXCoord(const void *v1,const void *v2)
-{
-   const flatpoint *p1,*p2;
-   p1 = (const flatpoint*)v1;
-   p2 = (const flatpoint*)v2;
-   if (p1->x < p2->x)
-      return(-1);
-   else if (p1->x > p2->x)
-      return(1);
-   else 
-      return(0); 
-}       
+	for (int c=0; c<nv; c++) Insert(order[c]);
 
+	 //copy out all triangles not touching the supertriangle
+	int ntri = 0;
+	for (int c=0; c<(int)tris.size(); c++) {
+		Tri &t = tris[c];
+		if (!t.alive || t.p[0] >= nv || t.p[1] >= nv || t.p[2] >= nv) continue;
 
-//--------------------------
+		IndexTriangle &tri = tri_ret[ntri++];
+		tri.p1 = t.p[0];
+		tri.p2 = t.p[1];
+		tri.p3 = t.p[2];
+		tri.t[0] = tri.t[1] = tri.t[2] = -1;
 
-class IndexEdge
-{
-  public:
-    int p1,p2;
-};
+		double r;
+		CircumCircle(0,0, pts[t.p[0]].x,pts[t.p[0]].y, pts[t.p[1]].x,pts[t.p[1]].y, pts[t.p[2]].x,pts[t.p[2]].y,
+					 &tri.circumcenter.x, &tri.circumcenter.y, &r);
+	}
+	*ntri_ret = ntri;
+	return 0;
+}
 
 
-/*!
- *    Triangulation subroutine
- *    Takes as input NV vertices in array pxyz
- *    Returned is a list of ntri triangular faces in the array v
- *    These triangles are arranged in a consistent clockwise order.
- *    The triangle array 'v' should be malloced to 3 * nv
- *    The vertex array pxyz must be big enough to hold 3 more points
- *    The vertex array MUST be sorted in increasing x values say
- * 
- *   \code
- *    qsort(p,nv,sizeof(flatpoint),CompareXCoord);
- *       :
- *    int CompareXCoord(void *v1,void *v2)
- *    {
- *       flatpoint *p1,*p2;
- *       p1 = v1;
- *       p2 = v2;
- *       if (p1->x < p2->x)
- *          return(-1);
- *       else if (p1->x > p2->x)
- *          return(1);
- *       else
- *          return(0);
- *    }
- *   \endcode
+/*! tri_ret should be large enough to hold 3*nv triangles. The actual number of triangles is returned in n_ret.
+ * Triangles are clockwise, with circumcenter set. Their t[] are all -1. Use LinkTriangles() to find neighbors.
+ * Duplicate points are left out of the triangulation.
+ *
+ * Return 0 for success, 1 for not enough points (need more than 2).
+ *
+ * Note that the Voronoi diagram is the dual graph of a Delaunay triangulation. The Voronoi
+ * cells are all points closest to particular points.
+ * It is formed by connecting the centers of all circumcircles of the triangles around each point
+ * in a Delaunay triangulation.
  */
-int Triangulate(int nv,flatpoint *pxyz,IndexTriangle *v,int *ntri)
+int DelaunayTriangulate(flatpoint *pts, int nv, IndexTriangle *tri_ret, int *ntri_ret)
 {
-   int *complete = NULL;
-   IndexEdge *edges = NULL;
-   int nedge = 0;
-   int trimax,emax = 200;
-
-   int inside;
-   int i,j,k;
-   double xp,yp,x1,y1,x2,y2,x3,y3,xc,yc,r;
-   double xmin,xmax,ymin,ymax,xmid,ymid;
-   double dx,dy,dmax;
-
-
-   /* Allocate memory for the completeness list, flag for each triangle */
-   trimax = 4 * nv;
-   complete=new int[trimax];
-   if (!complete) return 1;
-
-   /* Allocate memory for the edge list */
-   edges = new IndexEdge[emax]; //reallocated below as needed
-   if (!edges) {
-	   delete[] complete;
-	   return 2;
-   }
+	if (nv < 3) return 1;
 
+	DelaunayMesh mesh;
+	mesh.Build(pts, nv, tri_ret, ntri_ret);
 
-   /*
-      Find the maximum and minimum vertex bounds.
-      This is to allow calculation of the bounding triangle
-   */
-   xmin = pxyz[0].x;
-   ymin = pxyz[0].y;
-   xmax = xmin;
-   ymax = ymin;
-   for (i=1;i<nv;i++) {
-      if (pxyz[i].x < xmin) xmin = pxyz[i].x;
-      if (pxyz[i].x > xmax) xmax = pxyz[i].x;
-      if (pxyz[i].y < ymin) ymin = pxyz[i].y;
-      if (pxyz[i].y > ymax) ymax = pxyz[i].y;
-   }
-   dx = xmax - xmin;
-   dy = ymax - ymin;
-   dmax = (dx > dy) ? dx : dy;
-   xmid = (xmax + xmin) / 2.0;
-   ymid = (ymax + ymin) / 2.0;
-
-   /*
-      Set up the supertriangle
-      This is a triangle which encompasses all the sample points.
-      The supertriangle coordinates are added to the end of the
-      vertex list. The supertriangle is the first triangle in
-      the triangle list.
-   */
-   pxyz[nv+0].x = xmid - 20 * dmax;
-   pxyz[nv+0].y = ymid - dmax;
-   //pxyz[nv+0].z = 0.0;
-   pxyz[nv+1].x = xmid;
-   pxyz[nv+1].y = ymid + 20 * dmax;
-   //pxyz[nv+1].z = 0.0;
-   pxyz[nv+2].x = xmid + 20 * dmax;
-   pxyz[nv+2].y = ymid - dmax;
-   //pxyz[nv+2].z = 0.0;
-   v[0].p1 = nv;
-   v[0].p2 = nv+1;
-   v[0].p3 = nv+2;
-   complete[0] = false;
-   *ntri = 1;
-
-   /*
-      Include each point one at a time into the existing mesh
-   */
-   for (i=0; i<nv; i++) {
-
-      xp = pxyz[i].x;
-      yp = pxyz[i].y;
-      nedge = 0;
-
-      /*
-         Set up the edge buffer.
-         If the point (xp,yp) lies inside the circumcircle then the
-         three edges of that triangle are added to the edge buffer
-         and that triangle is removed.
-      */
-      for (j=0; j<(*ntri); j++) {
-         if (complete[j]) continue;
-
-         x1 = pxyz[v[j].p1].x;
-         y1 = pxyz[v[j].p1].y;
-         x2 = pxyz[v[j].p2].x;
-         y2 = pxyz[v[j].p2].y;
-         x3 = pxyz[v[j].p3].x;
-         y3 = pxyz[v[j].p3].y;
-         inside = CircumCircle(xp,yp,x1,y1,x2,y2,x3,y3,&xc,&yc,&r);
-         if (xc < xp && ((xp-xc)*(xp-xc)) > r)
-				complete[j] = true;
-
-		 v[j].circumcenter.x = xc;
-		 v[j].circumcenter.y = yc;
-
-         if (inside) {
-            /* Check that we haven't exceeded the edge list size */
-            if (nedge+3 >= emax) {
-               emax += 100;
-			   IndexEdge *newedges = new IndexEdge[emax];
-               if (!newedges) {
-				  delete[] edges; 
-				  delete[] complete;
-				  return 3;
-               }
-			   memcpy(newedges,edges, (emax-100)*sizeof(IndexEdge));
-			   delete[] edges;
-			   edges=newedges;
-            }
+	DBG cerr << "DelaunayTriangulate: Formed "<<(*ntri_ret)<<" triangles"<<endl;
+	return 0;
+}
 
-            edges[nedge+0].p1 = v[j].p1;
-            edges[nedge+0].p2 = v[j].p2;
-            edges[nedge+1].p1 = v[j].p2;
-            edges[nedge+1].p2 = v[j].p3;
-            edges[nedge+2].p1 = v[j].p3;
-            edges[nedge+2].p2 = v[j].p1;
-            nedge += 3;
-            v[j] = v[(*ntri)-1];
-            complete[j] = complete[(*ntri)-1];
-            (*ntri)--;
-            j--;
-         }
-      }
+int DelaunayTriangulate(PointSet::PointObj **pts, int nv, IndexTriangle *tri_ret, int *ntri_ret)
+{
+	if (nv < 3) return 1;
 
-      /*
-         Tag multiple edges
-         Note: if all triangles are specified anticlockwise then all
-               interior edges are opposite pointing in direction.
-      */
-      for (j=0; j<nedge-1; j++) {
-         for (k=j+1; k<nedge; k++) {
-            if ((edges[j].p1 == edges[k].p2) && (edges[j].p2 == edges[k].p1)) {
-               edges[j].p1 = -1;
-               edges[j].p2 = -1;
-               edges[k].p1 = -1;
-               edges[k].p2 = -1;
-            }
-            /* Shouldn't need the following, see note above */
-            if ((edges[j].p1 == edges[k].p1) && (edges[j].p2 == edges[k].p2)) {
-               edges[j].p1 = -1;
-               edges[j].p2 = -1;
-               edges[k].p1 = -1;
-               edges[k].p2 = -1;
-            }
-         }
-      }
+	std::vector<flatpoint> p(nv);
+	for (int c=0; c<nv; c++) p[c] = pts[c]->p;
 
-      /*
-         Form new triangles for the current point
-         Skipping over any tagged edges.
-         All edges are arranged in clockwise order.
-      */
-      for (j=0; j<nedge; j++) {
-         if (edges[j].p1 < 0 || edges[j].p2 < 0) continue;
-
-         if ((*ntri) >= trimax) {
-			delete[] edges;
-			delete[] complete;
-            return 4;
-         }
-
-         v[*ntri].p1 = edges[j].p1;
-         v[*ntri].p2 = edges[j].p2;
-         v[*ntri].p3 = i;
-
-		  //need to grab circumcenter, not necessary for delaunay triangles only
-         CircumCircle(0,0,
-				 pxyz[v[*ntri].p1].x,pxyz[v[*ntri].p1].y,
-				 pxyz[v[*ntri].p2].x,pxyz[v[*ntri].p2].y,
-				 pxyz[v[*ntri].p3].x,pxyz[v[*ntri].p3].y,
-				 &xc,&yc,&r);
-		 v[*ntri].circumcenter.x=xc;
-		 v[*ntri].circumcenter.y=yc;
-
-         complete[*ntri] = false;
-         (*ntri)++;
-      }
-   }
+	DelaunayMesh mesh;
+	mesh.Build(p.data(), nv, tri_ret, ntri_ret);
 
-   /*
-      Remove triangles with supertriangle vertices
-      These are triangles which have a vertex number greater than nv
-   */
-   for (i=0; i<(*ntri); i++) {
-      if (v[i].p1 >= nv || v[i].p2 >= nv || v[i].p3 >= nv) {
-         v[i] = v[(*ntri)-1];
-         (*ntri)--;
-         i--;
-      }
-   }
+	DBG cerr << "DelaunayTriangulate: Formed "<<(*ntri_ret)<<" triangles"<<endl;
+	return 0;
+}
+
+/*! Set the t[] links of each triangle to the triangles across each edge, or -1 for none.
+ * Triangles must all have the same winding. This uses a hash of edges, so it is linear in n.
+ */
+void LinkTriangles(IndexTriangle *tris, int n)
+{
+	std::unordered_map<uint64_t, int> edges; //directed edge -> 3*triangle + edge
+	edges.reserve(3*n);
 
+	auto key = [](int a, int b) { return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b; };
 
-   return 0;
+	for (int c=0; c<n; c++) {
+		for (int k=0; k<3; k++) {
+			tris[c].t[k] = -1;
+			edges[key(TriPoint(tris[c], k), TriPoint(tris[c], (k+1)%3))] = 3*c + k;
+		}
+	}
+
+	for (int c=0; c<n; c++) {
+		for (int k=0; k<3; k++) {
+			auto found = edges.find(key(TriPoint(tris[c], (k+1)%3), TriPoint(tris[c], k)));
+			if (found != edges.end()) tris[c].t[k] = found->second / 3;
+		}
+	}
 }
 
 
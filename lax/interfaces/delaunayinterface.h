@@ -109,6 +109,7 @@ class VoronoiData : virtual public LaxInterfaces::SomeData, virtual public Laxki
 
 	virtual void Flush();
 	virtual void Triangulate();
+	virtual bool UpdateTriangulation();
 	virtual void RebuildVoronoi(bool triangulate_also=true);
 	virtual void Rebuild() { Triangulate(); RebuildVoronoi(); }
 
@@ -40,6 +40,7 @@
 #include <lax/filedialog.h>
 #include <lax/utf8string.h>
 #include <lax/popupmenu.h>
+#include <lax/threadpool.h>
 #include <lax/interfaces/freehandinterface.h>
 #include <lax/interfaces/curvemapinterface.h>
 #include <lax/interfaces/somedataref.h>
@@ -47,11 +48,24 @@
 
 using namespace Laxkit;
 
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <new>
+
 #include <iostream>
 using namespace std;
 #define DBG 
 
 
+ //how many nodes LineNodePool allocates at a time
+#define LINENODE_CHUNK 4096
+
+ //size and integer range of the value_to_weight table EngraverPointGroup::Trace() uses
+#define TRACE_LOOKUP_SIZE 4096
+#define TRACE_LOOKUP_MAX  (1<<20)
+
+
 namespace LaxInterfaces {
 
 
@@ -80,10 +94,145 @@ void InstallEngraverObjectTypes(ObjectFactory *factory)
 }
 
 
+//------------------------------------- LineNodePool ------------------------
+
+/*! \class LineNodePool
+ * Slab storage for LinePoint and LinePointCache nodes, since engravings have hundreds of
+ * thousands of them, and Trace(), UpdateDashCache() and friends walk them in line order.
+ *
+ * Nodes are handed out from chunks of LINENODE_CHUNK in address order. AllocateRun() gives
+ * one whole line's worth in one contiguous chunk, which is what EngraverPointGroup::CompactLines() uses.
+ * Each slot has a small header pointing to its chunk, so Trim() can release chunks that have
+ * emptied out.
+ */
+template <class T>
+class LineNodePool
+{
+	struct Chunk {
+		char *mem;
+		int size;
+		int live;
+	};
+	struct Header { //16 bytes, so T stays aligned
+		Chunk *chunk;
+		long used;
+	};
+
+	std::vector<Chunk*> chunks;
+	Header *freelist;
+	size_t slotsize;
+	std::mutex mutex;
+
+	Header *Slot(Chunk *chunk, int i) { return (Header*)(chunk->mem + i*slotsize); }
+	Header *&NextFree(Header *h) { return *(Header**)(h+1); }
+
+	Chunk *NewChunk(int n)
+	{
+		Chunk *chunk = new Chunk;
+		chunk->mem  = new char[n*slotsize];
+		chunk->size = n;
+		chunk->live = 0;
+		for (int c=0; c<n; c++) {
+			Header *h = Slot(chunk,c);
+			h->chunk = chunk;
+			h->used  = 0;
+		}
+		chunks.push_back(chunk);
+		return chunk;
+	}
+
+	 //push free slots of chunk so that they come off in address order
+	void FreeSlots(Chunk *chunk)
+	{
+		for (int c=chunk->size-1; c>=0; c--) {
+			Header *h = Slot(chunk,c);
+			if (h->used) continue;
+			NextFree(h) = freelist;
+			freelist = h;
+		}
+	}
+
+  public:
+	LineNodePool()
+	{
+		freelist = nullptr;
+		slotsize = sizeof(Header) + ((sizeof(T)+15) & ~15);
+	}
+
+	void *Allocate()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!freelist) FreeSlots(NewChunk(LINENODE_CHUNK));
+
+		Header *h = freelist;
+		freelist = NextFree(h);
+		h->used = 1;
+		h->chunk->live++;
+		return h+1;
+	}
+
+	void Free(void *p)
+	{
+		if (!p) return;
+		std::lock_guard<std::mutex> lock(mutex);
+		Header *h = (Header*)p - 1;
+		h->used = 0;
+		h->chunk->live--;
+		NextFree(h) = freelist;
+		freelist = h;
+	}
+
+	//! Put n contiguous, uninitialized slots in slots_ret.
+	void AllocateRun(int n, void **slots_ret)
+	{
+		if (n<=0) return;
+		std::lock_guard<std::mutex> lock(mutex);
+		Chunk *chunk = NewChunk(n);
+		for (int c=0; c<n; c++) {
+			Header *h = Slot(chunk,c);
+			h->used = 1;
+			slots_ret[c] = h+1;
+		}
+		chunk->live = n;
+	}
+
+	//! Release chunks with no live nodes, and rebuild the free list from the rest.
+	void Trim()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		freelist = nullptr;
+		int n = 0;
+		for (unsigned int c=0; c<chunks.size(); c++) {
+			if (chunks[c]->live == 0) {
+				delete[] chunks[c]->mem;
+				delete chunks[c];
+			} else chunks[n++] = chunks[c];
+		}
+		chunks.resize(n);
+		for (int c=n-1; c>=0; c--) FreeSlots(chunks[c]);
+	}
+};
+
+ //these are never deleted, since nodes may outlive any static destruction order
+static LineNodePool<LinePoint> *LinePointPool()
+{
+	static LineNodePool<LinePoint> *pool = new LineNodePool<LinePoint>;
+	return pool;
+}
+
+static LineNodePool<LinePointCache> *LinePointCachePool()
+{
+	static LineNodePool<LinePointCache> *pool = new LineNodePool<LinePointCache>;
+	return pool;
+}
+
+
 //------------------------------------- LinePointCache ------------------------
 
 /*! \class LinePointCache
  * A cache point for use by LinePoint and EngraverFillData.
+ *
+ * These are allocated from a LineNodePool.
  */
 
 LinePointCache::LinePointCache(int ntype)
@@ -118,13 +267,32 @@ LinePointCache::~LinePointCache()
 		prev->next=NULL;
 		prev=NULL;
 	}
-	if (next) {
-		next->prev=NULL;
-		delete next;
+
+	 //chains can be very long, so delete iteratively, not recursively
+	LinePointCache *n=next, *nn;
+	next=NULL;
+	while (n) {
+		nn=n->next;
+		n->prev=n->next=NULL;
+		delete n;
+		n=nn;
 	}
+
 	if (original) original->cache=NULL;
 }
 
+void *LinePointCache::operator new(size_t size)
+{
+	if (size!=sizeof(LinePointCache)) return ::operator new(size);
+	return LinePointCachePool()->Allocate();
+}
+
+void LinePointCache::operator delete(void *p, size_t size)
+{
+	if (size!=sizeof(LinePointCache)) ::operator delete(p);
+	else LinePointCachePool()->Free(p);
+}
+
 LinePoint *LinePointCache::PrevOriginal()
 {
 	LinePointCache *lc=this;
@@ -224,6 +392,8 @@ LinePointCache *LinePointCache::Detach()
  * Between each LinePoint can be any number of cached points, to flesh
  * out and delineate dashes, and sections that are off, but don't fall cleanly
  * on LinePoint boundaries.
+ *
+ * These are allocated from a LineNodePool. See EngraverPointGroup::CompactLines().
  */
 
 LinePoint::LinePoint()
@@ -261,14 +431,33 @@ LinePoint::LinePoint(double ss, double tt, double ww)
 LinePoint::~LinePoint()
 {
 	if (prev) prev->next=NULL;
-	if (next) {
-		next->prev=NULL;
-		delete next;
+
+	 //lines can be very long, so delete iteratively, not recursively
+	LinePoint *n=next, *nn;
+	next=NULL;
+	while (n) {
+		nn=n->next;
+		n->prev=n->next=NULL;
+		delete n;
+		n=nn;
 	}
 
 	if (cache) delete cache;
 }
 
+void *LinePoint::operator new(size_t size)
+{
+	 //the pool only has LinePoint sized slots, so a bigger subclass must use the heap
+	if (size!=sizeof(LinePoint)) return ::operator new(size);
+	return LinePointPool()->Allocate();
+}
+
+void LinePoint::operator delete(void *p, size_t size)
+{
+	if (size!=sizeof(LinePoint)) ::operator delete(p);
+	else LinePointPool()->Free(p);
+}
+
 
 void LinePoint::Clear()
 {
@@ -1409,6 +1598,7 @@ TraceObject::TraceObject()
 
 	samplew=sampleh=0;
 	trace_sample_cache=NULL;
+	trace_value_cache=NULL;
 	cachetime=0;
 
 	 //black and white cache:
@@ -1421,6 +1611,7 @@ TraceObject::~TraceObject()
 	if (object) object->dec_count();
 	delete[] image_file;
 	delete[] trace_sample_cache;
+	delete[] trace_value_cache;
 	delete[] trace_ref_bw;
 }
 
@@ -1549,7 +1740,7 @@ double TraceObject::GetValue(LinePoint *p, double *transform)
 	y=sampleh*(pp.y-object->miny)/(object->maxy-object->miny);
 
 	if (x>=0 && x<samplew && y>=0 && y<sampleh) {
-		i=4*(x+(sampleh-y)*samplew);
+		i=4*(x+(sampleh-1-y)*samplew);
 
 		samplea=trace_sample_cache[i+3];
 		if (samplea==0) return -1; //transparent sample!
@@ -1619,6 +1810,8 @@ void TraceObject::ClearCache(bool obj_too)
 {
 	delete[] trace_sample_cache;
 	trace_sample_cache=NULL;
+	delete[] trace_value_cache;
+	trace_value_cache=NULL;
 	samplew=sampleh=0;
 	cachetime=0;
 
@@ -1723,9 +1916,35 @@ int TraceObject::UpdateCache()
 	cachetime=time(NULL);
 	img->dec_count();
 
+	delete[] trace_value_cache;
+	trace_value_cache=NULL;
+	UpdateValueCache();
+
 	return 0;
 }
 
+/*! Reduce trace_sample_cache to luminance and alpha pairs in trace_value_cache, which is
+ * what EngraverPointGroup::Trace() actually samples.
+ */
+void TraceObject::UpdateValueCache()
+{
+	delete[] trace_value_cache;
+	trace_value_cache=NULL;
+	if (!trace_sample_cache || samplew<=0 || sampleh<=0) return;
+
+	long n=(long)samplew*sampleh;
+	trace_value_cache=new unsigned char[2*n];
+
+	int sample;
+	unsigned char *rgb=trace_sample_cache, *va=trace_value_cache;
+	for (long c=0; c<n; c++, rgb+=4, va+=2) {
+		sample=0.3*rgb[0] + 0.59*rgb[1] + 0.11*rgb[2];
+		if (sample>255) sample=255;
+		va[0]=sample;
+		va[1]=rgb[3];
+	}
+}
+
 
 //------------------------------ EngraverTraceSettings -------------------------------
 
@@ -3232,22 +3451,21 @@ int EngraverPointGroup::Trace(Affine *aa)
 {
 	if (!trace->traceobject) return 1;
 
+	TraceObject *tobj=trace->traceobject;
 
 	 //update cache if necessary
-	if (!trace->traceobject->trace_sample_cache || trace->traceobject->NeedsUpdating())
-		trace->traceobject->UpdateCache();
+	if (!tobj->trace_sample_cache || tobj->NeedsUpdating())
+		tobj->UpdateCache();
+	if (!tobj->trace_value_cache) tobj->UpdateValueCache();
 
-	int samplew=trace->traceobject->samplew;
-	int sampleh=trace->traceobject->sampleh;
+	int samplew=tobj->samplew;
+	int sampleh=tobj->sampleh;
+	unsigned char *values=tobj->trace_value_cache;
 
-	int x,y, i;
-	int sample, samplea;
 	double me[6],mti[6];
-	unsigned char *rgb;
-	flatpoint pp;
-	double a;
 
-	SomeData *to=trace->traceobject->object;
+	SomeData *to=tobj->object;
+	if (to && !values) return 1;
 	if (to) {
 		transform_invert(mti,to->m());
 		if (aa) transform_mult(me, aa->m(),mti);
@@ -3255,45 +3473,69 @@ int EngraverPointGroup::Trace(Affine *aa)
 	} else transform_identity(me);
 
 
-	for (int c=0; c<lines.n; c++) {
+	 //value_to_weight as a table, interpolated between entries
+	CurveInfo *curve=trace->value_to_weight;
+	int lookup[TRACE_LOOKUP_SIZE];
+	curve->MakeLookupTable(lookup, TRACE_LOOKUP_SIZE, 0, TRACE_LOOKUP_MAX);
+	double lxmin=curve->xmin, lxscale=(TRACE_LOOKUP_SIZE-1)/(curve->xmax - curve->xmin);
+	double lymin=curve->ymin, lyscale=(curve->ymax - curve->ymin)/TRACE_LOOKUP_MAX;
+
+	auto value_to_weight = [&](double a) {
+		double i=(a-lxmin)*lxscale;
+		if (!(i>0)) return lymin + lookup[0]*lyscale;
+		if (i>=TRACE_LOOKUP_SIZE-1) return lymin + lookup[TRACE_LOOKUP_SIZE-1]*lyscale;
+		int ii=i;
+		i-=ii;
+		return lymin + (lookup[ii]*(1-i) + lookup[ii+1]*i)*lyscale;
+	};
+
+	 //every sample is one of 256 luminances, so precompute their weights
+	double space=spacing->spacing;
+	double sampleweight[256];
+	for (int c=0; c<256; c++) sampleweight[c] = space * value_to_weight((255-c)/255.);
+
+	double xscale=0, yscale=0, minx=0, miny=0;
+	if (to) {
+		minx=to->minx;
+		miny=to->miny;
+		xscale=samplew/(to->maxx-to->minx);
+		yscale=sampleh/(to->maxy-to->miny);
+	}
+
+
+	 //lines are independent, so split them over threads
+	ThreadPool *threads=ThreadPool::GetDefault();
+	int grain=lines.n/(8*(threads->NumThreads()+1));
+	if (grain<1) grain=1;
+
+	threads->ParallelFor(0, lines.n, [&](int c, int thread) {
 		LinePoint *l=lines.e[c];
+		flatpoint pp;
+		int x,y;
+		unsigned char *va;
 
 		while (l) {
-			pp=transform_point(me,l->p);
-			//pp=l->p;
-			//pp=transform_point(mti,pp);
-
 			if (to) {
-				x=samplew*(pp.x-to->minx)/(to->maxx-to->minx);
-				y=sampleh*(pp.y-to->miny)/(to->maxy-to->miny);
+				pp=transform_point(me,l->p);
+				x=xscale*(pp.x-minx);
+				y=yscale*(pp.y-miny);
 
 				if (x>=0 && x<samplew && y>=0 && y<sampleh) {
-					i=4*(x+(sampleh-y)*samplew);
-					rgb=trace->traceobject->trace_sample_cache+i;
-
-					samplea=rgb[3];
-					sample=0.3*rgb[0] + 0.59*rgb[1] + 0.11*rgb[2];
-					if (sample>255) {
-						sample=255;
-					}
-
-					a=(255-sample)/255.;
-					a=trace->value_to_weight->f(a);
-					l->weight=spacing->spacing*a; // *** this seems off
-					l->on = samplea>0 ? ENGRAVE_On : ENGRAVE_Off;
+					va=values + 2*(x+(sampleh-1-y)*samplew);
+					l->weight=sampleweight[va[0]]; // *** this seems off
+					l->on = va[1]>0 ? ENGRAVE_On : ENGRAVE_Off;
 				} else {
 					l->weight=0;
 					l->on=ENGRAVE_Off;
 				}
 
 			} else { //use current
-				a=spacing->spacing * trace->value_to_weight->f(l->weight_orig/spacing->spacing);
-				l->weight=a;
+				l->weight=space * value_to_weight(l->weight_orig/space);
 			}
 
 			l=l->next;
 		}
-	} //each line
+	}, grain);
 
 	UpdateDashCache();
 	return 0;
@@ -3337,12 +3579,16 @@ void EngraverPointGroup::UpdatePositionCache()
  */
 void EngraverPointGroup::UpdateBezCache()
 {
-	LinePoint *p, *start;
+	 //lines are independent, so split them over threads
+	ThreadPool *threads=ThreadPool::GetDefault();
+	int grain=lines.n/(8*(threads->NumThreads()+1));
+	if (grain<1) grain=1;
 
-	for (int c=0; c<lines.n; c++) {
+	threads->ParallelFor(0, lines.n, [&](int c, int thread) {
+		LinePoint *p, *start;
 		start=p=lines.e[c];
 
-		if (!p) continue;
+		if (!p) return;
 
 		do {
 			p->UpdateBezHandles();
@@ -3352,7 +3598,99 @@ void EngraverPointGroup::UpdateBezCache()
 
 			p=p->next;
 		} while (p && p!=start);
+	}, grain);
+}
+
+/*! Move each line's LinePoints, and then its LinePointCache chain, into their own contiguous
+ * blocks in line order. Lines grown a point at a time across all lines, or chewed up by editing,
+ * end up scattered all over the heap, which makes every pass over them a cache miss per point.
+ *
+ * The StarterPoints in grow_cache are pointed at the moved points. Any other LinePoint or
+ * LinePointCache pointers held from before this are invalid afterwards.
+ */
+void EngraverPointGroup::CompactLines()
+{
+	std::vector<void*> slots;
+	std::vector<LinePoint*> oldpoints;
+	std::vector<LinePointCache*> oldcache;
+	std::unordered_map<LinePoint*, LinePoint*> moved; //old -> new, only when grow_cache needs remapping
+
+	for (int c=0; c<lines.n; c++) {
+		LinePoint *start=lines.e[c];
+		if (!start) continue;
+
+		 //points
+		oldpoints.clear();
+		LinePoint *l=start;
+		do {
+			oldpoints.push_back(l);
+			l=l->next;
+		} while (l && l!=start);
+		bool closed=(l==start);
+
+		int n=oldpoints.size();
+		slots.resize(n);
+		LinePointPool()->AllocateRun(n, slots.data());
+		LinePoint **newpoints=(LinePoint**)slots.data();
+		for (int i=0; i<n; i++) newpoints[i]=::new (slots[i]) LinePoint(*oldpoints[i]);
+		if (grow_cache) for (int i=0; i<n; i++) moved[oldpoints[i]]=newpoints[i];
+
+		for (int i=0; i<n; i++) {
+			l=newpoints[i];
+			l->prev = (i>0   ? newpoints[i-1] : (closed ? newpoints[n-1] : NULL));
+			l->next = (i<n-1 ? newpoints[i+1] : (closed ? newpoints[0]   : NULL));
+			if (l->cache) l->cache->original=l;
+
+			oldpoints[i]->next=oldpoints[i]->prev=NULL;
+			oldpoints[i]->cache=NULL;
+			delete oldpoints[i];
+		}
+		lines.e[c]=start=newpoints[0];
+
+		 //cache
+		LinePointCache *cstart=start->cache, *lc=cstart;
+		if (!cstart) continue;
+
+		oldcache.clear();
+		do {
+			oldcache.push_back(lc);
+			lc=lc->next;
+		} while (lc && lc!=cstart);
+		closed=(lc==cstart);
+
+		n=oldcache.size();
+		slots.resize(n);
+		LinePointCachePool()->AllocateRun(n, slots.data());
+		LinePointCache **newcache=(LinePointCache**)slots.data();
+		for (int i=0; i<n; i++) newcache[i]=::new (slots[i]) LinePointCache(*oldcache[i]);
+
+		for (int i=0; i<n; i++) {
+			lc=newcache[i];
+			lc->prev = (i>0   ? newcache[i-1] : (closed ? newcache[n-1] : NULL));
+			lc->next = (i<n-1 ? newcache[i+1] : (closed ? newcache[0]   : NULL));
+			if (lc->original) lc->original->cache=lc;
+
+			oldcache[i]->next=oldcache[i]->prev=NULL;
+			oldcache[i]->original=NULL;
+			delete oldcache[i];
+		}
+	}
+
+	if (grow_cache) {
+		 //the generators hold the ends of the lines they are growing
+		for (int c=0; c<grow_cache->generators.n; c++) {
+			StarterPoint *sp=grow_cache->generators.e[c];
+			LinePoint **refs[3] = { &sp->line, &sp->first, &sp->last };
+			for (int i=0; i<3; i++) {
+				if (!*refs[i]) continue;
+				auto it=moved.find(*refs[i]);
+				*refs[i] = (it!=moved.end() ? it->second : NULL);
+			}
+		}
 	}
+
+	LinePointPool()->Trim();
+	LinePointCachePool()->Trim();
 }
 
 /*! Update (or create) any additional points added to the lines.
@@ -3968,6 +4306,7 @@ void EngraverPointGroup::Fill(EngraverFillData *data, double nweight)
 		FillRegularLines(data,nweight);
 
 	}
+	CompactLines();
 
 	if (direction->default_weight<0) {
 		direction->default_weight=spacing->spacing/10;
@@ -4830,6 +5169,7 @@ void EngraverPointGroup::GrowLines_Finish()
 	grow_cache->active = false;
 	//delete grow_cache;
 	//grow_cache = nullptr;
+	CompactLines();
 	UpdateDashCache();	
 }
 
@@ -5634,26 +5974,33 @@ SomeData *EngraverFillData::duplicateData(SomeData *dup)
 
 
 /*! Make lines->p be the transformed s,t.
+ * The mesh matrices are updated once, then lines are evaluated in parallel with getPointFromCache().
  */
 void EngraverFillData::Sync(bool asneeded)
 {
-	LinePoint *l;
+	UpdateCache();
+	if (!cache) return;
+
+	ThreadPool *threads=ThreadPool::GetDefault();
 	EngraverPointGroup *group;
 
 	for (int g=0; g<groups.n; g++) {
 		group=groups.e[g];
 
-		for (int c=0; c<group->lines.n; c++) {
-			l=group->lines.e[c];
+		int grain=group->lines.n/(8*(threads->NumThreads()+1));
+		if (grain<1) grain=1;
+
+		threads->ParallelFor(0, group->lines.n, [&](int c, int thread) {
+			LinePoint *l=group->lines.e[c];
 
 			while (l) {
-				if (!asneeded || (asneeded && l->needtosync==1))
-					l->p=getPoint(l->s,l->t, false); // *** note this is hideously inefficient, matrices are not cached with getPoint!!!
+				if (!asneeded || l->needtosync==1)
+					l->p=getPointFromCache(l->s,l->t, false);
 				l->needtosync=0;
 
 				l=l->next;
 			}
-		}
+		}, grain);
 	}
 }
 
@@ -5661,20 +6008,26 @@ void EngraverFillData::Sync(bool asneeded)
  */
 void EngraverFillData::ReverseSync(bool asneeded)
 {
-	LinePoint *l;
-	flatpoint pp;
-	int in=0;
+	UpdateReverseCache();
+	if (!reverse_grid) return;
+
+	ThreadPool *threads=ThreadPool::GetDefault();
 	EngraverPointGroup *group;
 
 	for (int g=0; g<groups.n; g++) {
 		group=groups.e[g];
 
-		for (int c=0; c<group->lines.n; c++) {
-			l=group->lines.e[c];
+		int grain=group->lines.n/(8*(threads->NumThreads()+1));
+		if (grain<1) grain=1;
+
+		threads->ParallelFor(0, group->lines.n, [&](int c, int thread) {
+			LinePoint *l=group->lines.e[c];
+			flatpoint pp;
+			int in=0;
 
 			while (l) {
-				if (!asneeded || (asneeded && l->needtosync==2)) {
-					pp=getPointReverse(l->p.x,l->p.y, &in); // *** note this is hideously inefficient
+				if (!asneeded || l->needtosync==2) {
+					pp=getPointReverseFromCache(l->p.x,l->p.y, &in);
 					if (in) {
 						l->s=pp.x;
 						l->t=pp.y;
@@ -5684,7 +6037,7 @@ void EngraverFillData::ReverseSync(bool asneeded)
 
 				l=l->next;
 			}
-		}
+		}, grain);
 	}
 }
 
@@ -272,6 +272,8 @@ class LinePointCache
 	LinePointCache(int ntype);
 	LinePointCache(LinePointCache *prev);
 	~LinePointCache();
+	static void *operator new(size_t size);
+	static void operator delete(void *p, size_t size);
 	void Add(LinePointCache *np);
 	void AddBefore(LinePointCache *np);
 	LinePointCache *InsertAfter(LinePointCache *np);
@@ -306,6 +308,8 @@ class LinePoint
 	LinePoint();
 	LinePoint(double ss, double tt, double ww);
 	~LinePoint();
+	static void *operator new(size_t size);
+	static void operator delete(void *p, size_t size);
 
 	void Set(double ss,double tt, double nweight) { s=ss; t=tt; needtosync=1; if (nweight>=0) weight=nweight; }
 	void Set(LinePoint *pp);
@@ -367,6 +371,7 @@ class TraceObject : public Laxkit::Resourceable, public Laxkit::DumpUtility
 
 	int samplew, sampleh;
 	unsigned char *trace_sample_cache;
+	unsigned char *trace_value_cache; //luminance,alpha pairs made from trace_sample_cache
 	std::time_t cachetime;
 
 	 //black and white cache:
@@ -385,6 +390,7 @@ class TraceObject : public Laxkit::Resourceable, public Laxkit::DumpUtility
 	double GetValue(LinePoint *p, double *transform);
 	void ClearCache(bool obj_too);
 	int UpdateCache();
+	void UpdateValueCache();
 	int NeedsUpdating();
 
 	void Install(TraceObjectType ntype, SomeData *obj);
@@ -810,6 +816,7 @@ class EngraverPointGroup : public DirectionMap
 	virtual void UpdateBezCache();
 	virtual void UpdatePositionCache();
 	virtual int UpdateDashCache();
+	virtual void CompactLines();
 	virtual void StripDashes();
 
 	virtual void dump_out(FILE *f,int indent,int what,Laxkit::DumpContext *context);
@@ -24,6 +24,7 @@
 #include <lax/interfaces/groupdata.h>
 #include <lax/interfaces/interfacemanager.h>
 #include <lax/interfaces/somedatafactory.h>
+#include <lax/interfaces/somedatatree.h>
 #include <lax/transformmath.h>
 #include <lax/utf8string.h>
 #include <lax/language.h>
@@ -42,6 +43,10 @@ namespace LaxInterfaces {
 
 
 //----------------------------- GroupData ---------------------------------
+
+//! Groups with at least this many kids keep a SomeDataTree of them for pointin().
+#define GROUPDATA_KIDTREE_MIN 32
+
 /*! \class GroupData
  * \brief Holds a collection of other SomeData objects.
  */
@@ -55,6 +60,7 @@ GroupData::GroupData()
 
 	parent = nullptr;
 	proxy_shape = nullptr;
+	kidtree = nullptr;
 
 	//Id(); //makes this->nameid (of SomeData) be something like `whattype()`12343
 }
@@ -65,6 +71,7 @@ GroupData::GroupData()
 GroupData::~GroupData()
 {
 	if (proxy_shape) proxy_shape->dec_count();
+	delete kidtree;
 	
 	//if (clip) clip->dec_count();
 	//if (clip_path) clip_path->dec_count();
@@ -121,6 +128,7 @@ int GroupData::push(LaxInterfaces::SomeData *obj, int where)
 {
 	if (!obj) return -1;
 	obj->SetParent(this);
+	KidsChanged();
 	touchContents();
 	return kids.push(obj,-1,where);
 }
@@ -136,6 +144,7 @@ int GroupData::pushnodup(LaxInterfaces::SomeData *obj)
 	if (!obj) return -1;
 	obj->SetParent(this);
 	int c=kids.pushnodup(obj,-1);
+	KidsChanged();
 	touchContents();
 	return c;
 }
@@ -150,6 +159,7 @@ int GroupData::popp(LaxInterfaces::SomeData *d)
 	if (c>=0) {
 		d->SetParent(NULL);
 	}
+	KidsChanged();
 	touchContents();
 	return c;
 }
@@ -162,6 +172,7 @@ LaxInterfaces::SomeData *GroupData::pop(int which)
 	if (which<0 || which>=kids.n) which=kids.n-1;
 	if (which<0) return NULL;
 	kids.e[which]->SetParent(NULL);
+	KidsChanged();
 	return kids.pop(which);
 }
 
@@ -169,6 +180,7 @@ LaxInterfaces::SomeData *GroupData::pop(int which)
 int GroupData::remove(int i)
 {
 	touchContents();
+	KidsChanged();
 	if (i<0 || i>=kids.n) i=kids.n-1;
 	kids.e[i]->SetParent(NULL);
 	return kids.remove(i);
@@ -186,6 +198,7 @@ int GroupData::slide(int i1,int i2)
 	kids.pop(obj,i1); //does nothing to count 
 	kids.push(obj,-1,i2); //incs count
 	obj->dec_count(); //remove the additional count
+	KidsChanged();
 	touchContents();
 	return 1;
 }
@@ -197,10 +210,19 @@ void GroupData::flush()
 		kids.e[c]->SetParent(NULL);
 	}
 	kids.flush();
+	KidsChanged();
 	touchContents();
 }
 
 
+/*! Call this after adding, removing, or reordering kids directly, rather than through
+ * push(), remove(), and the like, which call it for you.
+ */
+void GroupData::KidsChanged()
+{
+	if (kidtree) kidtree->StackChanged();
+}
+
 //! Append all the bboxes of the objects.
 void GroupData::FindBBox()
 {
@@ -220,6 +242,20 @@ int GroupData::pointin(flatpoint pp,int pin)
 
 	flatpoint p(((pp-origin())*xaxis())/(xaxis()*xaxis()), 
 		        ((pp-origin())*yaxis())/(yaxis()*yaxis()));
+
+	 //for big groups, only ask kids whose bounds are near p
+	if (kids.n >= GROUPDATA_KIDTREE_MIN) {
+		if (!kidtree) kidtree = new SomeDataTree;
+		kidtree->Sync(kids);
+		NumStack<int> candidates;
+		kidtree->FindAt(p, candidates);
+		for (int c=0; c<candidates.n; c++) {
+			if (kids.e[candidates.e[c]]->pointin(p,pin)) return 1;
+		}
+		return 0;
+	}
+
+	if (kidtree) { delete kidtree; kidtree = nullptr; }
 	for (int c=0; c<kids.n; c++) {
 		if (kids.e[c]->pointin(p,pin)) return 1;
 	}
@@ -335,6 +371,7 @@ int GroupData::GroupObjs(int ne, int *which, int *newgroupindex)
 	g->SetParent(this);
 	int index = kids.push(g,-1,where); //incs g
 	g->dec_count(); //remove initial count
+	KidsChanged();
 	FindBBox();
 
 	if (newgroupindex) *newgroupindex = index;
@@ -366,6 +403,7 @@ int GroupData::UnGroup(int which)
 	}
 
 	g->dec_count(); //dec count of now empty group
+	KidsChanged();
 	FindBBox();
 	touchContents();
 	return 0;
@@ -405,6 +443,7 @@ int GroupData::UnGroup(int n,const int *which)
 		d->dec_count();
 	}
 	remove(*which);
+	KidsChanged();
 	FindBBox();
 	touchContents();
 	return 0;
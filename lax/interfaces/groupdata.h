@@ -33,6 +33,8 @@
 namespace LaxInterfaces {
 
 
+class SomeDataTree;
+
 
 //----------------------------- GroupData ---------------------------------
 
@@ -57,6 +59,8 @@ class GroupData :   virtual public Laxkit::Tagged,
 					virtual public LaxInterfaces::SomeData
 {
  protected:
+	SomeDataTree *kidtree; //spatial index of kids for pointin(), only made for large groups
+
  public:
 	SomeData *parent;
 	LaxInterfaces::SomeDataRef *proxy_shape; //a ref to a Resource to represent this object: apply proxy_shape->m(), render proxy_shape
@@ -110,8 +114,9 @@ class GroupData :   virtual public Laxkit::Tagged,
 	virtual LaxInterfaces::SomeData *pop(int which);
 	virtual int popp(LaxInterfaces::SomeData *d);
 	virtual void flush();
-	virtual void swap(int i1,int i2) { kids.swap(i1,i2); }
+	virtual void swap(int i1,int i2) { kids.swap(i1,i2); KidsChanged(); }
 	virtual int slide(int i1,int i2);
+	virtual void KidsChanged();
 
 	virtual int GroupObjs(int n, int *which, int *newgroupindex);
 	virtual int UnGroup(int which);
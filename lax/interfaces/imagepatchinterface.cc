@@ -394,6 +394,30 @@ int ImagePatchData::hasColorData()
 	return idata?1:0;
 }
 
+/*! Copy for a preview job. Unlike duplicateData(), this copies idata instead of loading
+ * the image file again.
+ */
+Laxkit::Previewable *ImagePatchData::PreviewSnapshot()
+{
+	ImagePatchData *p = new ImagePatchData();
+	p->setbounds(minx,maxx,miny,maxy);
+	makestr(p->filename, filename);
+	transform_copy(p->im, im);
+
+	if (idata) {
+		p->idata = new unsigned long[iwidth*iheight];
+		memcpy(p->idata, idata, iwidth*iheight*sizeof(unsigned long));
+		p->idataislocal = 1;
+		p->iwidth  = iwidth;
+		p->iheight = iheight;
+	}
+
+	delete[] p->points; //the constructor's default grid, else duplicateData() leaks it
+	p->points = nullptr;
+	PatchData::duplicateData(p);
+	return p;
+}
+
 int ImagePatchData::renderToBufferImage(Laxkit::LaxImage *image)
 {
 	if (!image) return 1;
@@ -61,6 +61,8 @@ class ImagePatchData : public PatchData
 
 	// from Previewable
 	virtual bool CanRenderPreview() { return true; }
+	virtual bool CanRenderPreviewAsync() { return true; }
+	virtual Laxkit::Previewable *PreviewSnapshot();
 	virtual int renderToBufferImage(Laxkit::LaxImage *image);
 };
 
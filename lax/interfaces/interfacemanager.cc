@@ -24,6 +24,7 @@
 #include <lax/interfaces/aninterface.h>
 #include <lax/language.h>
 #include <lax/singletonkeeper.h>
+#include <lax/previewqueue.h>
 
 
 #include <iostream>
@@ -81,6 +82,10 @@ InterfaceManager::~InterfaceManager()
  */
 Laxkit::Displayer *InterfaceManager::GetPreviewDisplayer()
 {
+	 //preview jobs on worker threads each get their own
+	Displayer *jobdp = PreviewQueue::JobDisplayer();
+	if (jobdp) return jobdp;
+
 	if (!previewer) {
 		previewer=newDisplayer(NULL);
 	}
@@ -150,6 +150,38 @@ LineProfile::~LineProfile()
 	if (angle)   angle  ->dec_count();
 }
 
+/*! Copy the nodes and settings. The cached curves are rebuilt when needed.
+ * Like GradientStrip::duplicate(), the resource name is not copied.
+ */
+anObject *LineProfile::duplicate()
+{
+	LineProfile *p = new LineProfile();
+	p->setbounds(minx,maxx,miny,maxy);
+
+	p->max_height   = max_height;
+	p->defaultwidth = defaultwidth;
+	p->mint         = mint;
+	p->maxt         = maxt;
+	p->wrap         = wrap;
+
+	for (int c=0; c<pathweights.n; c++) {
+		p->pathweights.push(new PathWeightNode(*pathweights.e[c]));
+	}
+	p->needtorecache  = 1;
+	p->nodes_mod_time = nodes_mod_time;
+
+	p->start_type       = start_type;
+	p->end_type         = end_type;
+	p->repeat_mode      = repeat_mode;
+	p->repeat_length    = repeat_length;
+	p->start_rand_width = start_rand_width;
+	p->end_rand_width   = end_rand_width;
+	p->start            = start;
+	p->end              = end;
+
+	return p;
+}
+
 int LineProfile::renderToBufferImage(LaxImage *image)
 {
 	// *** should preview angle too
@@ -70,6 +70,7 @@ class LineProfile : public Laxkit::Resourceable, virtual public Laxkit::Previewa
 	LineProfile();
 	virtual ~LineProfile();
 	virtual const char *whattype() { return "LineProfile"; } 
+	virtual anObject *duplicate();
 	virtual void dump_out(FILE *f,int indent,int what,Laxkit::DumpContext *context);
 	virtual Laxkit::Attribute *dump_out_atts(Laxkit::Attribute *att,int what,Laxkit::DumpContext *context);
 	virtual void dump_in_atts(Laxkit::Attribute *att,int flag,Laxkit::DumpContext *context);
@@ -85,6 +86,7 @@ class LineProfile : public Laxkit::Resourceable, virtual public Laxkit::Previewa
 	//from Previewable:
 	virtual int renderToBufferImage(Laxkit::LaxImage *image);
 	virtual bool CanRenderPreview() { return true; }
+	virtual bool CanRenderPreviewAsync() { return true; }
 };
 
 
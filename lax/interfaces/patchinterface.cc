@@ -31,6 +31,9 @@
 #include <lax/laxutils.h>
 #include <lax/bezutils.h>
 #include <lax/language.h>
+#include <lax/threadpool.h>
+
+#include <vector>
 
 #include <iostream>
 using namespace std;
@@ -326,6 +329,118 @@ flatpoint PatchRenderContext::getPoint(double s,double t)
 }
 
 
+//------------------------------------- PatchReverseGrid ------------------------
+
+/*! \class PatchReverseGrid
+ * \brief Lookup grid used by PatchData::getPointReverse().
+ *
+ * Each subpatch is flattened into subdiv x subdiv quads, and quads are bucketed by their
+ * slightly enlarged bounding boxes into a uniform grid over the whole mesh. A lookup only needs to
+ * check the quads of one cell, and a quad near the point gives a first guess for Newton iterations
+ * on the actual patch.
+ */
+class PatchReverseGrid
+{
+  public:
+	bool needtorebuild;
+	int subdiv;       //quads per subpatch edge
+	int ncols, nrows; //number of subpatches
+	int qcols, qrows; //number of quads, ncols*subdiv by nrows*subdiv
+	std::vector<flatpoint> samples; //(qcols+1) x (qrows+1) points on the mesh, by row
+	DoubleBBox bounds;
+	int gridw, gridh;
+	double cellw, cellh;
+	std::vector<int> cellstart; //index into quads for each cell, plus one past the last cell
+	std::vector<int> quads;     //quad indices, which are (quad row)*qcols + (quad column)
+
+	PatchReverseGrid() { needtorebuild=true; subdiv=8; ncols=nrows=qcols=qrows=gridw=gridh=0; cellw=cellh=1; }
+	int Cell(flatpoint p);
+	void CellRange(DoubleBBox &box, int &x1,int &x2, int &y1,int &y2);
+};
+
+//! Return the cell p is in, or -1 if p is off the grid.
+int PatchReverseGrid::Cell(flatpoint p)
+{
+	if (p.x<bounds.minx || p.x>bounds.maxx || p.y<bounds.miny || p.y>bounds.maxy) return -1;
+
+	int x=(p.x-bounds.minx)/cellw;
+	int y=(p.y-bounds.miny)/cellh;
+	if (x>=gridw) x=gridw-1;
+	if (y>=gridh) y=gridh-1;
+	return y*gridw+x;
+}
+
+//! Return the range of cells box overlaps, clamped to the grid.
+void PatchReverseGrid::CellRange(DoubleBBox &box, int &x1,int &x2, int &y1,int &y2)
+{
+	x1=(box.minx-bounds.minx)/cellw;
+	x2=(box.maxx-bounds.minx)/cellw;
+	y1=(box.miny-bounds.miny)/cellh;
+	y2=(box.maxy-bounds.miny)/cellh;
+	if (x1<0) x1=0; else if (x1>=gridw) x1=gridw-1;
+	if (x2<0) x2=0; else if (x2>=gridw) x2=gridw-1;
+	if (y1<0) y1=0; else if (y1>=gridh) y1=gridh-1;
+	if (y2<0) y2=0; else if (y2>=gridh) y2=gridh-1;
+}
+
+/*! Newton iterations to find mesh coordinates s,t of p, where s and t are in range [0..ncols],[0..nrows],
+ * as for PatchData::getPoint() with bysize. On entry, s,t is the first guess.
+ * Returns true if a point closer than tolerance to p was found, in which case s,t are set to it.
+ */
+static bool PatchNewton(PatchRenderContext *cache, int ncols, int nrows, flatpoint p, double &s, double &t, double tolerance)
+{
+	double S[4], T[4], dS[4], dT[4];
+	double CxT[4], CyT[4], CxdT[4], CydT[4];
+	double ss,tt, det, ds,dt;
+	flatpoint pp, ps, pt, d;
+	int c,r;
+
+	for (int iteration=0; ; iteration++) {
+		c=(int)floor(s);
+		r=(int)floor(t);
+		if (c<0) c=0; else if (c>=ncols) c=ncols-1;
+		if (r<0) r=0; else if (r>=nrows) r=nrows-1;
+		ss=s-c;
+		tt=t-r;
+
+		getT(S,ss);
+		getT(T,tt);
+		dS[0]=3*ss*ss; dS[1]=2*ss; dS[2]=1; dS[3]=0;
+		dT[0]=3*tt*tt; dT[1]=2*tt; dT[2]=1; dT[3]=0;
+
+		PatchRenderContext &context=cache[r*ncols+c];
+		m_times_v(context.Cx,T,CxT);
+		m_times_v(context.Cy,T,CyT);
+		m_times_v(context.Cx,dT,CxdT);
+		m_times_v(context.Cy,dT,CydT);
+
+		pp.set(dot(S,CxT),  dot(S,CyT));  //point
+		ps.set(dot(dS,CxT), dot(dS,CyT)); //d/ds
+		pt.set(dot(S,CxdT), dot(S,CydT)); //d/dt
+
+		d=p-pp;
+		if (d.norm() < tolerance*1e-6 || iteration==16) break;
+
+		 //solve [ps pt] * (ds,dt) = d
+		det=ps.x*pt.y - ps.y*pt.x;
+		if (fabs(det)<1e-30) return false;
+		ds=( d.x*pt.y - d.y*pt.x)/det;
+		dt=(-d.x*ps.y + d.y*ps.x)/det;
+
+		 //don't let wild steps leave the mesh
+		if (ds>1) ds=1; else if (ds<-1) ds=-1;
+		if (dt>1) dt=1; else if (dt<-1) dt=-1;
+
+		s+=ds;
+		t+=dt;
+		if (s<0) s=0; else if (s>ncols) s=ncols;
+		if (t<0) t=0; else if (t>nrows) t=nrows;
+	}
+
+	return d.norm() < tolerance;
+}
+
+
 //-------------------------------------- PatchData -----------------------
 
 /*! \class PatchData
@@ -366,6 +481,7 @@ PatchData::PatchData()
 	cache  = NULL;
 	ncache = 0;
 	needtorecache.set(0, 0, -1, -1);
+	reverse_grid = NULL;
 }
 
 //! Creates a new patch in rect xx,yy,ww,hh with nr rows and nc columns.
@@ -384,6 +500,7 @@ PatchData::PatchData(double xx,double yy,double ww,double hh,int nr,int nc,unsig
 	cache  = NULL;
 	ncache = 0;
 	needtorecache.set(0, 0, -1, -1);
+	reverse_grid = NULL;
 }
 
 PatchData::~PatchData()
@@ -392,6 +509,7 @@ PatchData::~PatchData()
 	if (boundary_outline) delete[] boundary_outline;
 	if (base_path) base_path->dec_count();
 	delete[] cache;
+	delete reverse_grid;
 }
 
 /*! When modified, specify what mesh matrices need to be updated.
@@ -417,7 +535,7 @@ void PatchData::NeedToUpdateCache(int mincol,int maxcol, int minrow,int maxrow)
 /*! Update mesh matrices for faster getpoint(). */
 void PatchData::UpdateCache()
 {
-	if (!cache) NeedToUpdateCache(0,-1,0,-1);
+	if (!cache || ncache<(xsize/3)*(ysize/3)) NeedToUpdateCache(0,-1,0,-1);
 	if (needtorecache.width==0 || needtorecache.height==0) return;
 
 	int mincol=needtorecache.x;
@@ -464,6 +582,7 @@ void PatchData::UpdateCache()
 	}
 
 	needtorecache.set(0,0,0,0);
+	if (reverse_grid) reverse_grid->needtorebuild=true;
 }
 
 ///*! Return 1 for success, or 0 for could not compute, due to row,col out of range.
@@ -815,12 +934,14 @@ void PatchData::Set(double xx,double yy,double ww,double hh,int nr,int nc,unsign
  *
  * If the point is not in the mesh, then error_ret gets 0, else 1.
  *
- * Note this uses inSubPatch() for the actual work.
+ * This updates the lookup grid if necessary, then uses getPointReverseFromCache(). For many points,
+ * use getPointsReverse(). Only if there is no grid, such as for an empty mesh, is the much
+ * slower inSubPatch() used.
  */
 flatpoint PatchData::getPointReverse(double x,double y, int *error_ret)
 {
-	if ((xsize/3)*(ysize/3)>ncache) NeedToUpdateCache(0,-1,0,-1);
-	UpdateCache();
+	UpdateReverseCache();
+	if (reverse_grid && !reverse_grid->needtorebuild) return getPointReverseFromCache(x,y, error_ret);
 
 	flatpoint fp(x,y);
 	int rr=-1,cc=-1;
@@ -837,6 +958,189 @@ flatpoint PatchData::getPointReverse(double x,double y, int *error_ret)
 	return p;
 }
 
+/*! Build the lookup grid for getPointReverseFromCache(), if the mesh has changed since the last build.
+ * This calls UpdateCache() first.
+ */
+void PatchData::UpdateReverseCache()
+{
+	UpdateCache();
+	if (!cache) return;
+
+	if (!reverse_grid) reverse_grid=new PatchReverseGrid;
+	PatchReverseGrid *grid=reverse_grid;
+	if (!grid->needtorebuild) return;
+
+	grid->ncols=xsize/3;
+	grid->nrows=ysize/3;
+	grid->qcols=grid->ncols*grid->subdiv;
+	grid->qrows=grid->nrows*grid->subdiv;
+
+	 //flatten the mesh
+	int w=grid->qcols+1;
+	grid->samples.resize(w*(grid->qrows+1));
+	grid->bounds.ClearBBox();
+	for (int r=0; r<=grid->qrows; r++) {
+		for (int c=0; c<=grid->qcols; c++) {
+			flatpoint p=getPointFromCache(c/(double)grid->subdiv, r/(double)grid->subdiv, true);
+			grid->samples[r*w+c]=p;
+			grid->bounds.addtobounds(p);
+		}
+	}
+
+	 //quad bounds are enlarged to allow for curves bulging past the flattened edges
+	double bw=grid->bounds.maxx-grid->bounds.minx;
+	double bh=grid->bounds.maxy-grid->bounds.miny;
+	double margin=.05*(bw>bh ? bw : bh);
+	if (margin<=0) margin=1e-10;
+	grid->bounds.minx-=margin;  grid->bounds.maxx+=margin;
+	grid->bounds.miny-=margin;  grid->bounds.maxy+=margin;
+	bw+=2*margin;
+	bh+=2*margin;
+
+	 //aim for about one quad per cell
+	int nquads=grid->qcols*grid->qrows;
+	grid->gridw=ceil(sqrt(nquads*bw/bh));
+	if (grid->gridw<1) grid->gridw=1; else if (grid->gridw>1024) grid->gridw=1024;
+	grid->gridh=ceil(nquads/(double)grid->gridw);
+	if (grid->gridh<1) grid->gridh=1; else if (grid->gridh>1024) grid->gridh=1024;
+	grid->cellw=bw/grid->gridw;
+	grid->cellh=bh/grid->gridh;
+
+	 //bucket quads into cells, first counting, then filling
+	grid->cellstart.assign(grid->gridw*grid->gridh+1, 0);
+	std::vector<int> fill;
+	DoubleBBox box;
+	int x1,x2,y1,y2;
+
+	for (int pass=0; pass<2; pass++) {
+		for (int q=0; q<nquads; q++) {
+			int i=(q/grid->qcols)*w + q%grid->qcols;
+			box.ClearBBox();
+			box.addtobounds(grid->samples[i]);
+			box.addtobounds(grid->samples[i+1]);
+			box.addtobounds(grid->samples[i+w]);
+			box.addtobounds(grid->samples[i+w+1]);
+			double m=.25*box.MaxDimension();
+			box.minx-=m;  box.maxx+=m;
+			box.miny-=m;  box.maxy+=m;
+
+			grid->CellRange(box, x1,x2, y1,y2);
+			for (int y=y1; y<=y2; y++) {
+				for (int x=x1; x<=x2; x++) {
+					if (pass==0) grid->cellstart[y*grid->gridw+x+1]++;
+					else grid->quads[fill[y*grid->gridw+x]++]=q;
+				}
+			}
+		}
+
+		if (pass==0) {
+			for (unsigned int c=1; c<grid->cellstart.size(); c++) grid->cellstart[c]+=grid->cellstart[c-1];
+			grid->quads.resize(grid->cellstart.back());
+			fill=grid->cellstart;
+		}
+	}
+
+	grid->needtorebuild=false;
+}
+
+/*! Like getPointReverse(), but assumes UpdateReverseCache() has already been called. This does not
+ * change anything in the patch, so it is safe to call from several threads at once, as long as
+ * nothing is modifying the patch at the same time.
+ *
+ * Quads in x,y's grid cell that contain x,y are used as first guesses for Newton iterations,
+ * then any other quads in the cell.
+ */
+flatpoint PatchData::getPointReverseFromCache(double x,double y, int *error_ret)
+{
+	PatchReverseGrid *grid=reverse_grid;
+	flatpoint p(x,y);
+	if (error_ret) *error_ret=0;
+
+	int cell=grid->Cell(p);
+	if (cell<0) return flatpoint(-1,-1);
+
+	 //closeness is relative to the whole mesh, as in getPointReverse()
+	double tolerance=(grid->bounds.maxx-grid->bounds.minx)/1000;
+	double tol2=(grid->bounds.maxy-grid->bounds.miny)/1000;
+	if (tol2>tolerance) tolerance=tol2;
+
+	int w=grid->qcols+1;
+	int subdiv=grid->subdiv;
+	flatpoint pts[4];
+	double s,t;
+	int contained=-1;
+
+	for (int pass=0; pass<2; pass++) {
+		for (int c=grid->cellstart[cell]; c<grid->cellstart[cell+1]; c++) {
+			int q=grid->quads[c];
+			int qr=q/grid->qcols, qc=q%grid->qcols;
+			int i=qr*w+qc;
+			pts[0]=grid->samples[i];
+			pts[1]=grid->samples[i+1];
+			pts[2]=grid->samples[i+w+1];
+			pts[3]=grid->samples[i+w];
+
+			bool in=point_is_in(p,pts,4);
+			if ((pass==0 && !in) || (pass==1 && in)) continue;
+			if (in && contained<0) contained=q;
+
+			s=(qc+.5)/subdiv;
+			t=(qr+.5)/subdiv;
+			if (PatchNewton(cache, grid->ncols,grid->nrows, p, s,t, tolerance)) {
+				if (error_ret) *error_ret=1;
+				return flatpoint(s/grid->ncols, t/grid->nrows);
+			}
+		}
+	}
+
+	if (contained<0) return flatpoint(-1,-1);
+
+	 //Newton wandered off, as can happen on badly folded meshes, so
+	 //try again from the closest of a grid of samples in the containing quad
+	int qr=contained/grid->qcols, qc=contained%grid->qcols;
+	double mind=1e+300, d;
+	flatpoint pp;
+	for (int r=0; r<=8; r++) {
+		for (int c=0; c<=8; c++) {
+			pp=getPointFromCache((qc+c/8.)/subdiv, (qr+r/8.)/subdiv, true);
+			d=norm2(pp-p);
+			if (d<mind) { mind=d; s=(qc+c/8.)/subdiv; t=(qr+r/8.)/subdiv; }
+		}
+	}
+	double s0=s, t0=t;
+	if (PatchNewton(cache, grid->ncols,grid->nrows, p, s,t, tolerance)) {
+		if (error_ret) *error_ret=1;
+		return flatpoint(s/grid->ncols, t/grid->nrows);
+	}
+	if (sqrt(mind)<tolerance && error_ret) *error_ret=1;
+	return flatpoint(s0/grid->ncols, t0/grid->nrows);
+}
+
+/*! Batch version of getPointReverse(). For each of n points, put the mesh coordinates in st_ret,
+ * and if status_ret!=NULL, 1 for found or 0 for not in the mesh, as for getPointReverse().
+ * The lookup grid is updated once, then the points are split over the default ThreadPool.
+ */
+void PatchData::getPointsReverse(int n, const flatpoint *points, flatpoint *st_ret, int *status_ret)
+{
+	if (n<=0) return;
+
+	UpdateReverseCache();
+	if (!reverse_grid || reverse_grid->needtorebuild) {
+		for (int c=0; c<n; c++) st_ret[c]=getPointReverse(points[c].x,points[c].y, status_ret ? status_ret+c : NULL);
+		return;
+	}
+
+	const int chunk=256;
+	int nchunks=(n+chunk-1)/chunk;
+
+	ThreadPool::GetDefault()->ParallelFor(0, nchunks, [&](int i, int thread) {
+		int end=(i+1)*chunk;
+		if (end>n) end=n;
+		for (int c=i*chunk; c<end; c++)
+			st_ret[c]=getPointReverseFromCache(points[c].x,points[c].y, status_ret ? status_ret+c : NULL);
+	});
+}
+
 /*! Compute the object point from (s,t) and (s+.001,t) or a similar point in bounds,
  * and return (object length)/(s,t length).
  */
@@ -853,13 +1157,14 @@ double PatchData::getScaling(double s,double t, bool bysize)
 /*! Return the point corresponding to (s,t).
  * If !bysize, s and t are in range [0..1]. s for column, t for row.
  * If bysize, s and t are in range [0..xsize/3],[0..ysize/3]
- *  Please note that this is useful only for one time lookup. The matrices involved are
- * currently not cached for repeated use.
+ *
+ * This will update the subpatch matrices first if necessary. For many points, use getPoints(),
+ * or call UpdateCache() once and then getPointFromCache() for each.
  */
 flatpoint PatchData::getPoint(double s,double t, bool bysize)
 {
-	if ((xsize/3)*(ysize/3)>ncache) NeedToUpdateCache(0,-1,0,-1);
 	UpdateCache();
+	if (cache) return getPointFromCache(s,t, bysize);
 
 	double ss,tt;
 	int c,r;
@@ -877,10 +1182,8 @@ flatpoint PatchData::getPoint(double s,double t, bool bysize)
 	if (r<0) { tt+=r; r=0; } else if (r>=ysize/3) { r=ysize/3-1; tt=t-r; }
 
 	//DBG cerr<<" resolve ("<<s<<","<<t<<") to patch: c,ss:"<<c<<":"<<ss<<"  r,tt:"<<r<<':'<<tt;
-	if (cache) return cache[r*(xsize/3)+c].getPoint(ss,tt);
 
-	
-	//else default to manual...
+	 //no cache, default to manual...
 
 	 // getpoint for s,t, which is:
 	 //   S^t * B * Gt * B * T     (remember B==B^t)
@@ -909,6 +1212,67 @@ flatpoint PatchData::getPoint(double s,double t, bool bysize)
 	return pp;
 }
 
+/*! Like getPoint(), but assumes UpdateCache() has already been called, and never changes the cache.
+ * Since this only reads the subpatch matrices, it is safe to call from several threads at
+ * once, as long as nothing is modifying the patch at the same time.
+ */
+flatpoint PatchData::getPointFromCache(double s,double t, bool bysize)
+{
+	double ss,tt;
+	int c,r;
+
+	if (bysize) {
+		c=(int)floor(s);
+		r=(int)floor(t);
+		ss=s-c;
+		tt=t-r;
+
+	} else resolveToSubpatch(s,t, c,ss,r,tt);
+
+	if (c<0) { ss+=c; c=0; } else if (c>=xsize/3) { c=xsize/3-1; ss=s-c; }
+	if (r<0) { tt+=r; r=0; } else if (r>=ysize/3) { r=ysize/3-1; tt=t-r; }
+
+	const PatchRenderContext &context=cache[r*(xsize/3)+c];
+
+	 //p = S^t * C * T, with S=[s^3,s^2,s,1], T=[t^3,t^2,t,1]
+	double t2=tt*tt, s2=ss*ss;
+	double T[4] = { t2*tt, t2, tt, 1 };
+	double S[4] = { s2*ss, s2, ss, 1 };
+	const double *Cx=context.Cx, *Cy=context.Cy;
+	flatpoint p;
+
+	for (int i=0; i<4; i++) {
+		p.x += S[i]*(Cx[i*4]*T[0] + Cx[i*4+1]*T[1] + Cx[i*4+2]*T[2] + Cx[i*4+3]*T[3]);
+		p.y += S[i]*(Cy[i*4]*T[0] + Cy[i*4+1]*T[1] + Cy[i*4+2]*T[2] + Cy[i*4+3]*T[3]);
+	}
+
+	return p;
+}
+
+/*! Batch version of getPoint(). For each of n points in st, put getPoint(st[i].x, st[i].y, bysize)
+ * in points_ret, which must be allocated for at least n points. The subpatch matrices are updated
+ * once, then the points are split over the default ThreadPool.
+ */
+void PatchData::getPoints(int n, const flatpoint *st, flatpoint *points_ret, bool bysize)
+{
+	if (n<=0) return;
+
+	UpdateCache();
+	if (!cache) {
+		for (int c=0; c<n; c++) points_ret[c]=getPoint(st[c].x,st[c].y, bysize);
+		return;
+	}
+
+	const int chunk=1024;
+	int nchunks=(n+chunk-1)/chunk;
+
+	ThreadPool::GetDefault()->ParallelFor(0, nchunks, [&](int i, int thread) {
+		int end=(i+1)*chunk;
+		if (end>n) end=n;
+		for (int c=i*chunk; c<end; c++) points_ret[c]=getPointFromCache(st[c].x,st[c].y, bysize);
+	});
+}
+
 //! From a point s,t (range 0..1), return the subpatch r,c plus offset into that subpatch.
 /*! WARNING!! If s,t are bad, then the returned values will be bad!
  */
@@ -2464,20 +2828,298 @@ int PatchData::hasColorData()
 int PatchData::WhatColor(double s,double t,ScreenColor *color_ret)
 { return 1; }
 
+//------------------------------- tiled patch rendering ----------------------------------
+
+//! A piece of a subpatch, small enough that it touches only a few render tiles.
+class PatchRenderBlock
+{
+  public:
+	double Cx[16],Cy[16]; //power basis coefficients for the block, mapping [0..1] to buffer coordinates
+	double cs0, cds, ct0, cdt; //block's range in color space, see PatchRenderContext::s0, etc
+	int ns, nt; //number of forward difference steps in each direction
+	int minx,maxx, miny,maxy; //pixel bounds, clamped to buffer
+};
+
+#define PATCH_RENDER_TILE      64
+#define PATCH_RENDER_MAX_STEP  .7
+#define PATCH_RENDER_MAX_DEPTH 12
+
+/*! Find the control net bounds of the block with power basis Cx,Cy, and the longest
+ * hull edge along each direction. Return the bounds in bbox, and edge lengths in ls, lt.
+ */
+static void PatchBlockNet(double *Cx, double *Cy, DoubleBBox &bbox, double &ls, double &lt)
+{
+	double tmp[16], Gx[16], Gy[16];
+	m_times_m(Binv, Cx, tmp);
+	m_times_m(tmp, Binv, Gx);
+	m_times_m(Binv, Cy, tmp);
+	m_times_m(tmp, Binv, Gy);
+
+	bbox.ClearBBox();
+	ls = lt = 0;
+	double d;
+	for (int r=0; r<4; r++) {
+		for (int c=0; c<4; c++) {
+			bbox.addtobounds(flatpoint(Gx[r*4+c], Gy[r*4+c]));
+			if (r<3) {
+				d = norm(flatpoint(Gx[(r+1)*4+c] - Gx[r*4+c], Gy[(r+1)*4+c] - Gy[r*4+c]));
+				if (d > ls) ls = d;
+			}
+			if (c<3) {
+				d = norm(flatpoint(Gx[r*4+c+1] - Gx[r*4+c], Gy[r*4+c+1] - Gy[r*4+c]));
+				if (d > lt) lt = d;
+			}
+		}
+	}
+}
+
+/*! Recursively split the part of a subpatch in [s1,s2]x[t1,t2] until it is no bigger than a render tile,
+ * dropping any parts that are completely off the buffer. Cx and Cy are the power basis matrices for the
+ * whole subpatch, in buffer coordinates.
+ */
+static void PatchSplitBlocks(PatchRenderContext *context, double s1,double t1, double s2,double t2, int depth,
+							 int bufw, int bufh, std::vector<PatchRenderBlock> &blocks)
+{
+	PatchRenderBlock block;
+	double Ms[16], Mt[16], tmp[16];
+
+	 //reparameterize to the block: C' = Ms^t C Mt, where S = Ms U, T = Mt V
+	getPolyT(Ms, 1./(s2-s1), s1);
+	getPolyT(Mt, 1./(t2-t1), t1);
+	m_transpose(Ms);
+	m_times_m(Ms, context->Cx, tmp);
+	m_times_m(tmp, Mt, block.Cx);
+	m_times_m(Ms, context->Cy, tmp);
+	m_times_m(tmp, Mt, block.Cy);
+
+	DoubleBBox bbox;
+	double ls, lt;
+	PatchBlockNet(block.Cx, block.Cy, bbox, ls, lt);
+
+	if (bbox.maxx < -1 || bbox.maxy < -1 || bbox.minx > bufw || bbox.miny > bufh) return;
+
+	if (depth < PATCH_RENDER_MAX_DEPTH
+			&& (bbox.maxx-bbox.minx > PATCH_RENDER_TILE || bbox.maxy-bbox.miny > PATCH_RENDER_TILE)) {
+		double sm = (s1+s2)/2, tm = (t1+t2)/2;
+		PatchSplitBlocks(context, s1,t1, sm,tm, depth+1, bufw,bufh, blocks);
+		PatchSplitBlocks(context, sm,t1, s2,tm, depth+1, bufw,bufh, blocks);
+		PatchSplitBlocks(context, s1,tm, sm,t2, depth+1, bufw,bufh, blocks);
+		PatchSplitBlocks(context, sm,tm, s2,t2, depth+1, bufw,bufh, blocks);
+		return;
+	}
+
+	 //derivative along an edge of a bezier is bounded by 3 * longest control net edge
+	block.ns = (int)ceil(3*ls / PATCH_RENDER_MAX_STEP);
+	block.nt = (int)ceil(3*lt / PATCH_RENDER_MAX_STEP);
+	if (block.ns < 1) block.ns = 1;
+	if (block.nt < 1) block.nt = 1;
+
+	block.cs0 = context->s0 + context->ds * s1;
+	block.cds = context->ds * (s2-s1);
+	block.ct0 = context->t0 + context->dt * t1;
+	block.cdt = context->dt * (t2-t1);
+
+	block.minx = (int)floor(bbox.minx);  if (block.minx < 0) block.minx = 0;
+	block.miny = (int)floor(bbox.miny);  if (block.miny < 0) block.miny = 0;
+	block.maxx = (int)ceil (bbox.maxx);  if (block.maxx >= bufw) block.maxx = bufw-1;
+	block.maxy = (int)ceil (bbox.maxy);  if (block.maxy >= bufh) block.maxy = bufh-1;
+
+	blocks.push_back(block);
+}
+
+/*! Set up forward differences for a cubic a u^3 + b u^2 + c u + d with step h.
+ */
+static inline void PatchForwardDiff(const double *coef, double h, double *fd)
+{
+	double h2 = h*h, h3 = h2*h;
+	fd[0] = coef[3];
+	fd[1] = coef[0]*h3 + coef[1]*h2 + coef[2]*h;
+	fd[2] = 6*coef[0]*h3 + 2*coef[1]*h2;
+	fd[3] = 6*coef[0]*h3;
+}
+
+static inline void PatchForwardStep(double *fd)
+{
+	fd[0] += fd[1];
+	fd[1] += fd[2];
+	fd[2] += fd[3];
+}
+
+/*! Rasterize the points of block that land in the pixel rectangle [x1,x2]x[y1,y2] (inclusive).
+ * Used from renderToBuffer().
+ *
+ * Rows of constant t are walked by forward differencing the row coefficients S-wise,
+ * and the row coefficients themselves are forward differenced T-wise.
+ */
+void PatchData::RenderBlockToBuffer(PatchRenderBlock *block, unsigned char *buffer, int bufw, int bufh, int bufstride,
+									int x1, int y1, int x2, int y2)
+{
+	 //row coefficients: x(u) = sum_i rowx[i] u^(3-i), and each rowx[i] is a cubic in v
+	double fdx[4][4], fdy[4][4]; //fd?[i] are forward differences of coefficient i along v
+	double coef[4], rowx[4], rowy[4], px[4], py[4];
+	double hs = 1./block->ns, ht = 1./block->nt;
+
+	for (int i=0; i<4; i++) {
+		for (int j=0; j<4; j++) coef[j] = block->Cx[i*4+j];
+		PatchForwardDiff(coef, ht, fdx[i]);
+		for (int j=0; j<4; j++) coef[j] = block->Cy[i*4+j];
+		PatchForwardDiff(coef, ht, fdy[i]);
+	}
+
+	ScreenColor color;
+	int r, c, i, lasti;
+	double cs, ct;
+
+	for (int tt=0; tt <= block->nt; tt++) {
+		for (int j=0; j<4; j++) { rowx[j] = fdx[j][0]; rowy[j] = fdy[j][0]; }
+		PatchForwardDiff(rowx, hs, px);
+		PatchForwardDiff(rowy, hs, py);
+
+		ct = block->ct0 + block->cdt * tt * ht;
+		lasti = -1;
+
+		for (int ss=0; ss <= block->ns; ss++) {
+			if (px[0] >= 0 && px[0] < bufw && py[0] >= 0 && py[0] < bufh) {
+				r = int(py[0]+.5);
+				c = int(px[0]+.5);
+				if (c >= bufw) c = bufw-1;
+				if (r >= bufh) r = bufh-1;
+
+				if (c >= x1 && c <= x2 && r >= y1 && r <= y2) {
+					i = r*bufstride + c*4;
+					if (i != lasti) {
+						cs = block->cs0 + block->cds * ss * hs;
+						WhatColor(cs, ct, &color);
+						buffer[i+3] = (color.alpha&0xff00)>>8;
+						buffer[i+2] = (color.red  &0xff00)>>8;
+						buffer[i+1] = (color.green&0xff00)>>8;
+						buffer[i+0] = (color.blue &0xff00)>>8;
+						lasti = i;
+					}
+				}
+			}
+			PatchForwardStep(px);
+			PatchForwardStep(py);
+		}
+
+		for (int j=0; j<4; j++) {
+			PatchForwardStep(fdx[j]);
+			PatchForwardStep(fdy[j]);
+		}
+	}
+}
+
 //! Write to buffer assuming samples are 8 bit ARGB.
 /*! Blanks out the buffer, then renders the patch into it, if any.
  * 
  * Currently, buffer is width x height pixels, and must be 8bit ARGB.
  *
- * Subclasses need not redefine this function, rpatchpoint(), or patchpoint(). They need only
- * redefine WhatColor().
+ * Subclasses need not redefine this function. They need only redefine WhatColor(),
+ * which must be safe to call from several threads at once.
  *
- * \todo *** this is EXTREMELY innefficient
+ * Each subpatch is split into blocks no bigger than a render tile, and the buffer is cut
+ * into PATCH_RENDER_TILE square tiles, which are rendered in parallel with ThreadPool::GetDefault().
+ * Each tile only writes pixels inside itself, and renders blocks in the same patch order
+ * as renderToBufferRecursive(), so overlapping patches still stack the same way. Points are
+ * sampled at most PATCH_RENDER_MAX_STEP pixels apart, which is a little denser than
+ * the recursive renderer.
  */
 int PatchData::renderToBuffer(unsigned char *buffer, int bufw, int bufh, int bufstride, int bufdepth, int bufchannels)
 {
 	if (!buffer) return 1;
 
+	if (bufdepth!=8 || bufchannels!=4) {
+		cerr <<" *** must implement PatchData::renderToBuffer() for non 8 bit rgba!!"<<endl;
+		return 1;
+	}
+	if (bufstride==0) bufstride=bufw*bufdepth/8*bufchannels;
+	for (int r=0; r<bufh; r++) memset(buffer + r*bufstride, 0, bufw*4); //make it totally transparent
+
+	if (!hasColorData()) return 0; //blank out the buffer, but don't try to render if there is no color data!!
+	if (xsize < 4 || ysize < 4 || bufw <= 0 || bufh <= 0) return 0;
+
+	 //create transform taking object space to buffer space
+	double a=(maxx-minx)/bufw,
+		   d=(miny-maxy)/bufh;
+	double m[6];
+	m[0]=1/a;
+	m[1]=0;
+	m[2]=0;
+	m[3]=1/d;
+	m[4]=-minx/a;
+	m[5]=-maxy/d;
+
+	 //build render blocks, in patch order
+	std::vector<PatchRenderBlock> blocks;
+	PatchRenderContext context;
+	double C[16],Gty[16],Gtx[16];
+	flatpoint fp;
+
+	for (int roff=0; roff<ysize/3; roff++) {
+		for (int coff=0; coff<xsize/3; coff++) {
+			getGt(Gtx,roff*3,coff*3,0);
+			getGt(Gty,roff*3,coff*3,1);
+			for (int c=0; c<16; c++) {
+				fp = transform_point(m, flatpoint(Gtx[c],Gty[c]));
+				Gtx[c] = fp.x;
+				Gty[c] = fp.y;
+			}
+
+			m_times_m(B,Gty,C);
+			m_times_m(C,B,context.Cy);
+			m_times_m(B,Gtx,C);
+			m_times_m(C,B,context.Cx);  //Cx = B Gtx B
+
+			context.s0=coff*3./(xsize-1); //point in range [0..1]
+			context.ds=3./(xsize-1);      //portion of [0..1] occupied by a single mesh square
+			context.t0=roff*3./(ysize-1);
+			context.dt=3./(ysize-1);
+
+			PatchSplitBlocks(&context, 0,0, 1,1, 0, bufw,bufh, blocks);
+		}
+	}
+	if (!blocks.size()) return 0;
+
+	 //bin blocks into tiles
+	int tilesx = (bufw + PATCH_RENDER_TILE-1) / PATCH_RENDER_TILE;
+	int tilesy = (bufh + PATCH_RENDER_TILE-1) / PATCH_RENDER_TILE;
+	std::vector<std::vector<int>> tiles(tilesx * tilesy);
+
+	for (int b=0; b<(int)blocks.size(); b++) {
+		PatchRenderBlock &block = blocks[b];
+		for (int ty = block.miny / PATCH_RENDER_TILE; ty <= block.maxy / PATCH_RENDER_TILE; ty++) {
+			for (int tx = block.minx / PATCH_RENDER_TILE; tx <= block.maxx / PATCH_RENDER_TILE; tx++) {
+				tiles[ty*tilesx + tx].push_back(b);
+			}
+		}
+	}
+
+	 //render each tile
+	ThreadPool::GetDefault()->ParallelFor(0, tiles.size(), [&](int tile, int thread) {
+			int x1 = (tile % tilesx) * PATCH_RENDER_TILE;
+			int y1 = (tile / tilesx) * PATCH_RENDER_TILE;
+			int x2 = x1 + PATCH_RENDER_TILE - 1;  if (x2 >= bufw) x2 = bufw-1;
+			int y2 = y1 + PATCH_RENDER_TILE - 1;  if (y2 >= bufh) y2 = bufh-1;
+
+			for (int b : tiles[tile]) {
+				RenderBlockToBuffer(&blocks[b], buffer, bufw,bufh, bufstride, x1,y1, x2,y2);
+			}
+		});
+
+	return 0;
+}
+
+//! The old single threaded renderer, kept for reference and comparison with renderToBuffer().
+/*! Blanks out the buffer, then renders the patch into it with rpatchpoint(), if any.
+ * 
+ * Currently, buffer is width x height pixels, and must be 8bit ARGB.
+ *
+ * \todo *** this is EXTREMELY innefficient
+ */
+int PatchData::renderToBufferRecursive(unsigned char *buffer, int bufw, int bufh, int bufstride, int bufdepth, int bufchannels)
+{
+	if (!buffer) return 1;
+
 	//DBG cerr <<"...Render "<<whattype()<<" to buffer, w,h:"<<bufw<<','<<bufh<<" rdepth="<<renderdepth<<endl;
 
 	if (bufdepth!=8 || bufchannels!=4) {
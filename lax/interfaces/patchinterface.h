@@ -84,6 +84,9 @@ class PatchRenderContext
 
 //------------------------------ PatchData ---------------------
 
+class PatchRenderBlock;
+class PatchReverseGrid;
+
 //goes in PatchData::style:
 enum PatchDataStyles {
 	PATCH_SMOOTH    =(1<<0),
@@ -116,6 +119,10 @@ class PatchData : virtual public SomeData, virtual public Laxkit::PointCollectio
 	virtual void NeedToUpdateCache(int mincol,int maxcol, int minrow,int maxrow);
 	virtual void UpdateCache();
 
+	 //flattened subpatches for faster getPointReverse(), rebuilt whenever cache is
+	PatchReverseGrid *reverse_grid;
+	virtual void UpdateReverseCache();
+
 	 //cached outline for convenience, updated in FindBBox()
 	int npoints_boundary;
 	Laxkit::flatpoint *boundary_outline;
@@ -136,7 +143,11 @@ class PatchData : virtual public SomeData, virtual public Laxkit::PointCollectio
 	virtual int MeshHeight() { return ysize/3; }
 	virtual Laxkit::flatpoint getControlPoint(int r,int c);
 	virtual Laxkit::flatpoint getPoint(double s,double t, bool bysize);
+	virtual Laxkit::flatpoint getPointFromCache(double s,double t, bool bysize);
+	virtual void getPoints(int n, const Laxkit::flatpoint *st, Laxkit::flatpoint *points_ret, bool bysize);
 	virtual Laxkit::flatpoint getPointReverse(double x,double y, int *error_ret);
+	virtual Laxkit::flatpoint getPointReverseFromCache(double x,double y, int *error_ret);
+	virtual void getPointsReverse(int n, const Laxkit::flatpoint *points, Laxkit::flatpoint *st_ret, int *status_ret);
 	virtual double getScaling(double s,double t, bool bysize);
 	virtual Laxkit::flatpoint *bezAtEdge(Laxkit::flatpoint *p,int i,int row);
 	virtual Laxkit::flatpoint *bezCrossSection(Laxkit::flatpoint *p,int i,double t,int row);
@@ -173,6 +184,9 @@ class PatchData : virtual public SomeData, virtual public Laxkit::PointCollectio
 	/*! \name Rendering Functions */
 	//@{
 	virtual int renderToBuffer(unsigned char *buffer, int bufw, int bufh, int bufstride, int bufdepth, int bufchannels);
+	virtual int renderToBufferRecursive(unsigned char *buffer, int bufw, int bufh, int bufstride, int bufdepth, int bufchannels);
+	virtual void RenderBlockToBuffer(PatchRenderBlock *block, unsigned char *buffer, int bufw, int bufh, int bufstride,
+									 int x1, int y1, int x2, int y2);
 	virtual void rpatchpoint(PatchRenderContext *context,
 								Laxkit::flatpoint ul,Laxkit::flatpoint ur,Laxkit::flatpoint ll,Laxkit::flatpoint lr,
 								double s1,double t1, double s2,double t2,int which);
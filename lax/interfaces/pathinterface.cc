@@ -38,6 +38,9 @@
 
 #include <lax/vectors-out.h>
 
+#include <vector>
+#include <algorithm>
+
 using namespace Laxkit;
 
 #include <iostream>
@@ -2719,16 +2722,18 @@ void Path::Transform(const double *mm)
  * If pathi == -1, then check all paths. If pathi == -1 and !self_path_only, then
  * also check for intersections between all paths.
  *
+ * Both segments of each crossing get a new vertex. Crossings at existing vertices are skipped.
+ * Candidate segment pairs come from bez_overlap_pairs(), so this is fast even for paths
+ * with very many segments.
+ *
  * Return value is number of vertices added.
  */
 int PathsData::AddAtIntersections(bool segment_loops, bool self_path_only, int pathi)
 {
 	flatpoint pts1[4];
-	flatpoint pts2[4];
 	flatpoint pret[10];
 	double foundt1[9], foundt2[9];
 	Coordinate *start1, *p1, *p1next, *c1, *c2;
-	Coordinate *start2, *p2, *p2next;
 	int isline;
 	double threshhold = 1e-5;
 	double maxdepth = 0;
@@ -2809,74 +2814,81 @@ int PathsData::AddAtIntersections(bool segment_loops, bool self_path_only, int p
 		}
 	}
 
-	NumStack<double> tvals;
+	// now check for intersections between whole segments.
+	// First gather all the segments, then only do the expensive
+	// bez_intersect_bez() on pairs with overlapping bounds.
+	std::vector<flatpoint> segpoints; //4 per segment
+	std::vector<int> segpath; //path index of each segment
+	std::vector<int> segindex; //integer part of path t at start of segment
+	std::vector<Coordinate*> segstart; //starting vertex of each segment
 
-	// now check for intersections between whole segments
 	for (int c3 = 0; c3 < paths.n; c3++) {
 		if (!paths.e[c3]->path) continue;
 		if (pathi != -1 && pathi != c3) continue;
 
 		start1 = p1 = paths.e[c3]->path;
-		double t_p1 = 0;
-		double t_p2 = 0;
+		int index = 0;
 
-		do { //foreach segment in path1
+		do { //foreach segment in path
 			pts1[0] = p1->p();
 			if (p1->getNext(pts1[1], pts1[2], p1next, isline) != 0) break;
 			pts1[3] = p1next->p();
 
-			for (int c4 = c3; c4 < paths.n; c4++) { //foreach path in pathsdata2
-				if (!paths.e[c4]->path) continue;
-				if (pathi != -1 && pathi != c4) continue;
-
-				start2 = p2 = paths.e[c4]->path;
-				t_p2 = 0;
-
-				do { //foreach segment in path2
-					pts2[0] = p2->p();
-					if (p2->getNext(pts2[1], pts2[2], p2next, isline) != 0) break;
-					pts2[3] = p2next->p();
-
-					if (p2 == p1) continue; // don't intersect identical segments
-
-					//pts2[0] = m2to1.transformPoint(pts2[0]);
-					//pts2[1] = m2to1.transformPoint(pts2[1]);
-					//pts2[2] = m2to1.transformPoint(pts2[2]);
-					//pts2[3] = m2to1.transformPoint(pts2[3]);
-
-					int num = 0;
-					//DBG cerr <<"---at bez t1: "<<t_p1<<" t2: "<<t_p2<<endl;
-					bez_intersect_bez(
-							pts1[0], pts1[1], pts1[2], pts1[3],
-							pts2[0], pts2[1], pts2[2], pts2[3],
-							pret, foundt1, foundt2, num,
-							threshhold,
-							0,0,1,
-							1, maxdepth
-						);
-
-					for (int c5 = 0; c5 < num; c5++) {
-						DBG cerr << "bez_intersect: t1: "<<(t_p1 + foundt1[c5])<<" t2: "<<(t_p2 + foundt2[c5])<<endl;
-
-						tvals.push(t_p1 + foundt1[c5]);
-						//p1->SliceSegment(foundt1, num);
-					}
-					DBG if (num == 0) cerr <<"bez_intersect: No intersections"<<endl;
-
-					p2 = p2next;
-					t_p2 += 1;
-				} while (p2 && p2 != start2);
-			}
+			segpoints.insert(segpoints.end(), pts1, pts1+4);
+			segpath.push_back(c3);
+			segindex.push_back(index);
+			segstart.push_back(p1);
 
 			p1 = p1next;
-			t_p1 += 1;
+			index++;
 		} while (p1 && p1 != start1);
+	}
 
-		if (tvals.n > 0) {
-			paths.e[c3]->AddAt(tvals.e, tvals.n, nullptr);
-			num_slices += tvals.n;
-			tvals.flush();
-		}
+	NumStack<int> pairs;
+	bez_overlap_pairs(segpoints.data(), segpath.size(), pairs);
+
+	std::vector<std::pair<int,double>> cuts; //(segment, t within segment)
+	for (int c = 0; c < pairs.n; c += 2) {
+		int a = pairs.e[c], b = pairs.e[c+1];
+		if (self_path_only && segpath[a] != segpath[b]) continue;
+
+		const flatpoint *s1 = segpoints.data() + 4*a;
+		const flatpoint *s2 = segpoints.data() + 4*b;
+		int num = 0;
+		bez_intersect_bez(
+				s1[0], s1[1], s1[2], s1[3],
+				s2[0], s2[1], s2[2], s2[3],
+				pret, foundt1, foundt2, num,
+				threshhold,
+				0,0,1,
+				1, maxdepth
+			);
+
+		 //intersections at segment ends already have a vertex there
+		for (int c5 = 0; c5 < num; c5++) {
+			DBG cerr << "bez_intersect: seg "<<a<<" t1: "<<foundt1[c5]<<"  seg "<<b<<" t2: "<<foundt2[c5]<<endl;
+			if (foundt1[c5] > 1e-6 && foundt1[c5] < 1-1e-6) cuts.push_back(std::make_pair(a, foundt1[c5]));
+			if (foundt2[c5] > 1e-6 && foundt2[c5] < 1-1e-6) cuts.push_back(std::make_pair(b, foundt2[c5]));
+		}
+	}
+
+	 // Add points from the end of each path backwards, so that t values and segment
+	 // starts not yet used are not disturbed by earlier additions.
+	std::sort(cuts.begin(), cuts.end(), [](const std::pair<int,double> &c1, const std::pair<int,double> &c2) {
+			return c1.first > c2.first || (c1.first == c2.first && c1.second > c2.second);
+		});
+	int lastseg = -1;
+	double lastt = 1;
+	for (auto &cut : cuts) {
+		int seg = cut.first;
+		if (seg != lastseg) lastt = 1;
+		else if (lastt - cut.second < 1e-6) continue; //duplicate of a point just added
+		lastseg = seg;
+
+		 //the segment now only extends to the previous cut in it
+		double tt = cut.second / lastt;
+		lastt = cut.second;
+		if (paths.e[segpath[seg]]->AddAt(segstart[seg], segindex[seg] + tt)) num_slices++;
 	}
 
 	return num_slices;
@@ -3192,6 +3204,15 @@ int Path::AddAt(double *t, int n, double *t_ret)
 Coordinate *Path::AddAt(double t)
 {
 	Coordinate *p1=GetCoordinate(t);
+	if (!p1) return NULL;
+	return AddAt(p1, t);
+}
+
+/*! Same as AddAt(double), but p1 must be the vertex at the start of the segment containing t,
+ * which saves walking the path to find it.
+ */
+Coordinate *Path::AddAt(Coordinate *p1, double t)
+{
 	if (!p1) return NULL;
 	int index=t;
 	double tt=t-(int)t;
@@ -3215,8 +3236,8 @@ Coordinate *Path::AddAt(double t)
 	if (c2!=p2) c2->p(pts[4]);
 	Coordinate *np, *cp;
 	if (c1==p1 && c2==p2) {
-		 //add segment point, not bez
-		np=new Coordinate(pts[2],POINT_VERTEX|BEZ_NSTIFF_NEQUAL,NULL);
+		 //add segment point, not bez. t is linear along the segment, as in Coordinate::getNext()
+		np=new Coordinate(p1->p() + tt*(p2->p() - p1->p()),POINT_VERTEX|BEZ_NSTIFF_NEQUAL,NULL);
 		cp=np;
 	} else {
 		 //add bez
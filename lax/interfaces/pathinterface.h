@@ -141,6 +141,7 @@ class Path : virtual public Laxkit::anObject,
 	virtual int openAt(Coordinate *curvertex, int after);
 	virtual int CutSegment(Coordinate *curvertex, int after, Path **remainder);
 	virtual Coordinate *AddAt(double t);
+	virtual Coordinate *AddAt(Coordinate *p1, double t);
 	virtual int AddAt(double *t, int n, double *t_ret);
 	virtual int AddAt(Coordinate *curvertex, Coordinate *np, int after);
 	virtual int CutAt(double t, Path **new_path_ret);
@@ -608,14 +608,37 @@ flatpoint PerspectiveTransform::transformInverse(flatpoint p)
 	return pp;
 }
 
+//! result = a * b, for row major 3x3 matrices. result must not be a or b.
+static void m3_times_m3(const double *a, const double *b, double *result)
+{
+	for (int r=0; r<3; r++) {
+		for (int c=0; c<3; c++) {
+			result[r*3+c] = a[r*3]*b[c] + a[r*3+1]*b[3+c] + a[r*3+2]*b[6+c];
+		}
+	}
+}
+
+//! Convert a 6 member affine transform to a row major 3x3 matrix.
+static void affine_to_m3(const double *m, double *result)
+{
+	result[0] = m[0];  result[1] = m[2];  result[2] = m[4];
+	result[3] = m[1];  result[4] = m[3];  result[5] = m[5];
+	result[6] = 0;     result[7] = 0;     result[8] = 1;
+}
+
 /*! Transform an image or reverse transform(if direction==-1).
  * This will map images to bounding boxes of the corner control points.
+ * initial fits the bounds of obj, and persped fits the bounds of the destination points.
+ *
+ * The whole pixel chain (persped pixel, perspective inverse, obj inverse, initial pixel) is
+ * collapsed into a single homography, which is handed to WarpImage() to render with filter
+ * across threads. When direction==-1, persped is mapped back into initial instead.
  *
  * Return 0 for success, or 1 if transform is invalid.
  *
  * Note: only works on 8 bit bgra for now.
  */
-int PerspectiveTransform::MapImage(SomeData *obj, LaxImage *initial, LaxImage *persped, int direction) //todo: , int oversample)
+int PerspectiveTransform::MapImage(SomeData *obj, LaxImage *initial, LaxImage *persped, int direction, int filter)
 {
 	if (!IsValid()) return 1;
 
@@ -626,66 +649,79 @@ int PerspectiveTransform::MapImage(SomeData *obj, LaxImage *initial, LaxImage *p
 	}
 	box1.setbounds(obj);
 
-	unsigned char *buffer1 = initial->getImageBuffer(); //bgra
-	unsigned char *buffer2 = persped->getImageBuffer();
-
 	int iw = initial->w(), ih = initial->h();
 	int pw = persped->w(), ph = persped->h();
-
-	double xx,yy, px,py;
-	int iix,iiy;
 	double box1w = box1.boxwidth(), box1h = box1.boxheight();
 	double box2w = box2.boxwidth(), box2h = box2.boxheight();
-	int i1, i2;
-	flatpoint o;
+	if (box1w <= 0 || box1h <= 0 || box2w <= 0 || box2h <= 0) return 1;
+
+	 //Image buffers have y flipped relative to real space, so buffer row r holds real y (h-r) in pixel units.
+	double m[9], tmp[9], H[9];
 
 	if (direction == -1) {
 		 //map persped back to initial
 
+		 //initial pixel to obj space
+		double initial_to_obj[9] = {
+				box1w/iw, 0,         box1.minx,
+				0,       -box1h/ih,  box1.miny + box1h,
+				0,        0,         1 };
+
+		 //obj to parent space
+		double obj_to_parent[9];
+		affine_to_m3(obj->m(), obj_to_parent);
+
+		 //perspective transform
+		double persp[9];
+		memcpy(persp, coeffs, 9*sizeof(double));
+
+		 //persped real space to persped pixel
+		double real_to_persped[9] = {
+				pw/box2w, 0,        -box2.minx*pw/box2w,
+				0,       -ph/box2h,  ph + box2.miny*ph/box2h,
+				0,        0,         1 };
+
+		m3_times_m3(obj_to_parent, initial_to_obj, tmp);
+		m3_times_m3(persp, tmp, m);
+		m3_times_m3(real_to_persped, m, H);
+
 	} else {
 		 //map initial to persped
-		for (int y = 0; y<ph; y++) {
-			for (int x = 0; x<pw; x++) {
-				 // *** note: this can skip 4*, 4/, 4+- by constructing a more direct persp transform
-				//map persp image space to real space
-				px = x*box2w/pw + box2.minx;
-				py = y*box2h/ph + box2.miny;
-
-				//perspective inverse transform
-				xx = (this->coeffsInv[0]*px + this->coeffsInv[1]*py + this->coeffsInv[2]) / (this->coeffsInv[6]*px + this->coeffsInv[7]*py + 1);
-				yy = (this->coeffsInv[3]*px + this->coeffsInv[4]*py + this->coeffsInv[5]) / (this->coeffsInv[6]*px + this->coeffsInv[7]*py + 1);
-
-				// xx,yy now in obj parent space
-				o = obj->transformPointInverse(flatpoint(xx,yy));
-				xx = o.x;
-				yy = o.y;
-
-				//map real space to initial image space, which is preview image that
-				//fits snuggly in the bounding box of the object
-				iix = (xx - box1.minx)*iw/box1w;
-				iiy = (yy - box1.miny)*ih/box1h;
-
-				i2 = 4*((ph-y-1)*pw + x);
-				//i2 = 4*(y*pw + x);
-
-				if (iix>=0 && iix<iw && iiy>=0 && iiy<ih) {
-					i1 = 4*((ih-iiy-1)*iw + iix);
-					//i1 = 4*(iiy*iw + iix);
-					buffer2[i2  ] = buffer1[i1  ];
-					buffer2[i2+1] = buffer1[i1+1];
-					buffer2[i2+2] = buffer1[i1+2];
-					buffer2[i2+3] = buffer1[i1+3];
-				} else {
-					 //out of bounds, so transparent
-					buffer2[i2  ] = 0;
-					buffer2[i2+1] = 0;
-					buffer2[i2+2] = 0;
-					buffer2[i2+3] = 0;
-				}
-			}
-		}
+
+		 //persped pixel to persped real space
+		double persped_to_real[9] = {
+				box2w/pw, 0,         box2.minx,
+				0,       -box2h/ph,  box2.miny + box2h,
+				0,        0,         1 };
+
+		 //perspective inverse transform, to obj parent space
+		double persp_inv[9];
+		memcpy(persp_inv, coeffsInv, 9*sizeof(double));
+
+		 //obj parent space to obj space
+		double parent_to_obj[9], mi[6];
+		transform_invert(mi, obj->m());
+		affine_to_m3(mi, parent_to_obj);
+
+		 //obj space to initial image space, which is preview image that
+		 //fits snuggly in the bounding box of the object
+		double obj_to_initial[9] = {
+				iw/box1w, 0,        -box1.minx*iw/box1w,
+				0,       -ih/box1h,  ih + box1.miny*ih/box1h,
+				0,        0,         1 };
+
+		m3_times_m3(persp_inv, persped_to_real, tmp);
+		m3_times_m3(parent_to_obj, tmp, m);
+		m3_times_m3(obj_to_initial, m, H);
 	}
 
+	ProjectiveWarpMapping mapping(H);
+
+	unsigned char *buffer1 = initial->getImageBuffer(); //bgra
+	unsigned char *buffer2 = persped->getImageBuffer();
+
+	if (direction == -1) WarpImage(buffer2, pw, ph, 4*pw,  buffer1, iw, ih, 4*iw,  &mapping, filter);
+	else                 WarpImage(buffer1, iw, ih, 4*iw,  buffer2, pw, ph, 4*pw,  &mapping, filter);
 
 	initial->doneWithBuffer(buffer1);
 	persped->doneWithBuffer(buffer2);
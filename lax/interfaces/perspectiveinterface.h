@@ -23,6 +23,7 @@
 #define _LAX_PERSPECTIVEINTERFACE_H
 
 #include <lax/interfaces/aninterface.h>
+#include <lax/bitmaputils.h>
 
 
 namespace LaxInterfaces { 
@@ -70,7 +71,7 @@ class PerspectiveTransform : public Laxkit::anObject
 	Laxkit::flatpoint transformInverse(double x,double y);
 	Laxkit::flatpoint transformInverse(Laxkit::flatpoint p);
 
-	virtual int MapImage(SomeData *obj, Laxkit::LaxImage *initial, Laxkit::LaxImage *persped, int direction);
+	virtual int MapImage(SomeData *obj, Laxkit::LaxImage *initial, Laxkit::LaxImage *persped, int direction, int filter = Laxkit::WARP_Bilinear);
 
     virtual void dump_out(FILE *f,int indent,int what,Laxkit::DumpContext *context);
     virtual Laxkit::Attribute *dump_out_atts(Laxkit::Attribute *att,int what, Laxkit::DumpContext *context);
@@ -25,6 +25,7 @@
 #include <lax/interfaces/interfacemanager.h>
 
 #include <lax/interfaces/somedata.h>
+#include <lax/interfaces/somedatatree.h>
 #include <lax/transformmath.h>
 #include <lax/misc.h>
 #include <lax/strmanip.h>
@@ -123,6 +124,7 @@ SomeData::SomeData(double nminx,double nmaxx,double nminy,double nmaxy)
 
 SomeData::~SomeData()
 {
+	for (auto tree : indexed_in) tree->Forget(this);
 	delete[] nameid;
 }
 
@@ -407,9 +409,42 @@ int SomeData::renderToBufferImage(LaxImage *image)
 void SomeData::touchContents()
 { 
 	Previewable::touchContents();
+	NotifyIndexes();
 	if (GetParent()) GetParent()->touchContents();
 }
 
+//! Tell any SomeDataTree this is in that it has moved.
+void SomeData::TransformChanged()
+{
+	NotifyIndexes();
+}
+
+//! Tell any SomeDataTree this is in to check this object on its next Sync().
+void SomeData::NotifyIndexes()
+{
+	for (auto tree : indexed_in) tree->Touched(this);
+}
+
+/*! Called by SomeDataTree when this is put in tree, so that tree will hear about changes
+ * from touchContents() and changes to the matrix.
+ */
+void SomeData::AddIndex(SomeDataTree *tree)
+{
+	for (auto t : indexed_in) if (t == tree) return;
+	indexed_in.push_back(tree);
+}
+
+//! Called by SomeDataTree when this is no longer in tree.
+void SomeData::RemoveIndex(SomeDataTree *tree)
+{
+	for (unsigned int c=0; c<indexed_in.size(); c++) {
+		if (indexed_in[c] == tree) {
+			indexed_in.erase(indexed_in.begin() + c);
+			return;
+		}
+	}
+}
+
 //! If usepreview==1 and preview, then return preview.
 /*! If previewtime>modtime, then call GeneratePreview(-1,-1) before returning preview.
  */
@@ -421,8 +456,7 @@ Laxkit::LaxImage *SomeData::GetPreview()
 	// }
 	// return NULL;
 
-	if (previewtime < modtime || !preview || (modtime == 0 && previewtime == 0)) GeneratePreview(-1,-1);
-	return preview;
+	return Previewable::GetPreview();
 }
 
 //! Dump in an Attribute, then call dump_in_atts(thatatt,0).
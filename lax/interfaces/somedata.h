@@ -37,11 +37,15 @@
 
 #include <cstdio>
 #include <ctime>
+#include <vector>
 
 
 namespace LaxInterfaces {
 
 
+class SomeDataTree;
+
+
 //for SomeData::flags:
 enum SomeDataFlags {
 	SOMEDATA_KEEP_ASPECT    = (1<<0),
@@ -81,6 +85,9 @@ class SomeData :  virtual public Laxkit::Resourceable,
 				  virtual public Laxkit::DumpUtility
 {
   protected:
+	std::vector<SomeDataTree*> indexed_in; //trees to tell when this moves or changes
+	virtual void TransformChanged();
+	virtual void NotifyIndexes();
 
   public:
 	 //preview mechanism
@@ -140,6 +147,8 @@ class SomeData :  virtual public Laxkit::Resourceable,
 	virtual Laxkit::Affine GetTransforms(int depth, bool invert);
 	virtual Laxkit::Affine GetTransforms(SomeData *ancestor, bool invert);
 	virtual int NestedDepth();
+	virtual void AddIndex(SomeDataTree *tree);
+	virtual void RemoveIndex(SomeDataTree *tree);
 
 	virtual void FlipH();
 	virtual void FlipV();
@@ -0,0 +1,300 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+
+
+#include <lax/interfaces/somedatatree.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include <iostream>
+using namespace std;
+#define DBG
+
+
+using namespace Laxkit;
+
+
+namespace LaxInterfaces {
+
+
+//---------------------------- SomeDataTree --------------------------------------
+/*! \class SomeDataTree
+ * \brief Spatial index over a stack of SomeData, for finding objects near points and boxes.
+ *
+ * Leaves are each object's bounds transformed by its matrix, so they are in the
+ * same space as the stack's container. Sync() matches the index to the current contents
+ * of a stack.
+ *
+ * Objects in the tree tell it when they change, either from anObject::touchContents(),
+ * or from any change to their matrix (see Affine::TransformChanged()). Sync() then only
+ * rechecks those objects, so keeping the tree current costs nothing when nothing has changed.
+ * Note this means that code changing an object's bounds must call touchContents() on it,
+ * which editing interfaces do anyway.
+ *
+ * Whoever owns the stack must call StackChanged() when objects are added, removed or
+ * reordered, as GroupData and ViewportWithStack do. A change in the number of objects
+ * is noticed regardless. Only then is the whole stack compared, and objects that
+ * come or go are added or removed, so the tree is never rebuilt from scratch.
+ *
+ * Objects with invalid bounds cannot be placed in the tree, and are always returned
+ * by queries, so that their own pointin() can decide.
+ *
+ * See ViewportWithStack and GroupData.
+ */
+
+
+SomeDataTree::SomeDataTree()
+{
+	num_unbounded = 0;
+	stack_changed = false;
+}
+
+SomeDataTree::~SomeDataTree()
+{
+	Flush();
+}
+
+void SomeDataTree::Flush()
+{
+	for (auto &entry : entries) {
+		if (entry.obj) entry.obj->RemoveIndex(this);
+	}
+	tree.Flush();
+	entries.clear();
+	lookup.clear();
+	dirty.clear();
+	num_unbounded = 0;
+	stack_changed = false;
+}
+
+/*! Return whether obj has changed since entry was last stamped.
+ */
+bool SomeDataTree::Stale(Entry &entry)
+{
+	SomeData *obj = entry.obj;
+	if (obj->modtime != entry.modtime) return true;
+	if (memcmp(obj->m(), entry.m, 6*sizeof(double))) return true;
+	return obj->minx != entry.bounds[0] || obj->maxx != entry.bounds[1]
+		|| obj->miny != entry.bounds[2] || obj->maxy != entry.bounds[3];
+}
+
+/*! Record the current state of entry.obj, and put it in the tree at its current bounds.
+ */
+void SomeDataTree::Stamp(Entry &entry, int index)
+{
+	SomeData *obj = entry.obj;
+	entry.modtime = obj->modtime;
+	memcpy(entry.m, obj->m(), 6*sizeof(double));
+	entry.bounds[0] = obj->minx;
+	entry.bounds[1] = obj->maxx;
+	entry.bounds[2] = obj->miny;
+	entry.bounds[3] = obj->maxy;
+
+	DoubleBBox box;
+	if (obj->validbounds()) box.addtobounds(obj->m(), obj);
+
+	if (!box.validbounds()) {
+		if (entry.proxy >= 0) {
+			tree.Remove(entry.proxy);
+			entry.proxy = -1;
+		}
+		return;
+	}
+
+	if (entry.proxy >= 0) tree.Update(entry.proxy, box);
+	else entry.proxy = tree.Add(box, obj);
+	tree.Info(entry.proxy, index);
+}
+
+/*! Called by objects in the tree when they change. They are rechecked on the next Sync().
+ */
+void SomeDataTree::Touched(SomeData *obj)
+{
+	auto found = lookup.find(obj);
+	if (found == lookup.end()) return;
+
+	Entry &entry = entries[found->second];
+	if (entry.queued) return;
+	entry.queued = true;
+	dirty.push_back(found->second);
+}
+
+/*! Called by objects in the tree when they are being destroyed.
+ */
+void SomeDataTree::Forget(SomeData *obj)
+{
+	auto found = lookup.find(obj);
+	if (found == lookup.end()) return;
+
+	Entry &entry = entries[found->second];
+	if (entry.proxy >= 0) tree.Remove(entry.proxy);
+	else num_unbounded--;
+	entry.obj = nullptr;
+	entry.proxy = -1;
+	lookup.erase(found);
+	stack_changed = true;
+}
+
+/*! Restamp entry at index if it has changed, keeping num_unbounded current.
+ */
+void SomeDataTree::Check(int index)
+{
+	Entry &entry = entries[index];
+	entry.queued = false;
+	if (!entry.obj || !Stale(entry)) return;
+
+	bool wasbounded = (entry.proxy >= 0);
+	Stamp(entry, index);
+	if (wasbounded && entry.proxy < 0) num_unbounded++;
+	else if (!wasbounded && entry.proxy >= 0) num_unbounded--;
+}
+
+/*! Match entries to objects, then check every object. This is only done when the stack has changed.
+ */
+void SomeDataTree::Resync(RefPtrStack<SomeData> &objects)
+{
+	bool sameorder = ((int)entries.size() == objects.n);
+
+	for (int c=0; sameorder && c<objects.n; c++) {
+		if (entries[c].obj != objects.e[c]) sameorder = false;
+	}
+
+	if (!sameorder) {
+		 //reuse old leaves for objects still around, drop the rest
+		std::unordered_map<SomeData*, Entry> old;
+		for (auto &entry : entries) {
+			if (!entry.obj) continue;
+			auto found = old.find(entry.obj);
+			if (found != old.end() && found->second.proxy >= 0) tree.Remove(found->second.proxy); //was in stack twice
+			old[entry.obj] = entry;
+		}
+
+		entries.resize(objects.n);
+		lookup.clear();
+		for (int c=0; c<objects.n; c++) {
+			auto found = old.find(objects.e[c]);
+			if (found != old.end()) {
+				entries[c] = found->second;
+				old.erase(found);
+				if (entries[c].proxy >= 0) tree.Info(entries[c].proxy, c);
+			} else {
+				entries[c] = Entry();
+				entries[c].obj = objects.e[c];
+				entries[c].obj->AddIndex(this);
+				Stamp(entries[c], c);
+			}
+			lookup.emplace(objects.e[c], c);
+		}
+
+		for (auto &gone : old) {
+			if (gone.second.proxy >= 0) tree.Remove(gone.second.proxy);
+			gone.first->RemoveIndex(this);
+		}
+	}
+
+	dirty.clear();
+	num_unbounded = 0;
+	for (int c=0; c<(int)entries.size(); c++) {
+		entries[c].queued = false;
+		if (Stale(entries[c])) Stamp(entries[c], c);
+		if (entries[c].proxy < 0) num_unbounded++;
+	}
+	stack_changed = false;
+}
+
+/*! Make the index match objects. Returns the number of objects rechecked.
+ *
+ * If StackChanged() has not been called, and objects has as many objects as last time,
+ * then only objects that have said they changed since the last Sync() are looked at.
+ */
+int SomeDataTree::Sync(RefPtrStack<SomeData> &objects)
+{
+	if (stack_changed || (int)entries.size() != objects.n) {
+		Resync(objects);
+		return objects.n;
+	}
+
+	int numchecked = dirty.size();
+	for (int index : dirty) Check(index);
+	dirty.clear();
+	return numchecked;
+}
+
+/*! Update the object at index if it has changed, without checking the rest of the stack.
+ * Return true if the object's place in the tree was updated.
+ */
+bool SomeDataTree::Refit(int index)
+{
+	if (index < 0 || index >= (int)entries.size() || !entries[index].obj) return false;
+	if (!Stale(entries[index])) return false;
+
+	bool wasbounded = (entries[index].proxy >= 0);
+	Stamp(entries[index], index);
+	if (wasbounded && entries[index].proxy < 0) num_unbounded++;
+	else if (!wasbounded && entries[index].proxy >= 0) num_unbounded--;
+	return true;
+}
+
+/*! Push onto indices_ret the stack index of each object whose bounds might contain p,
+ * from top of the stack down. p must be in the same space as the objects' matrices.
+ * Returns the number found.
+ */
+int SomeDataTree::FindAt(flatpoint p, NumStack<int> &indices_ret)
+{
+	indices_ret.flush_n();
+	tree.PointQuery(p, [&](int proxy, void *data) {
+			indices_ret.push(tree.Info(proxy));
+			return true;
+		});
+
+	if (num_unbounded) {
+		for (int c=0; c<(int)entries.size(); c++) if (entries[c].proxy < 0 && entries[c].obj) indices_ret.push(c);
+	}
+
+	std::sort(indices_ret.e, indices_ret.e + indices_ret.n, [](int a, int b) { return a > b; });
+	return indices_ret.n;
+}
+
+/*! Push onto indices_ret the stack index of each object whose bounds might touch box,
+ * from top of the stack down. Returns the number found.
+ */
+int SomeDataTree::FindIn(const DoubleBBox &box, NumStack<int> &indices_ret)
+{
+	indices_ret.flush_n();
+	tree.BoxQuery(box, [&](int proxy, void *data) {
+			indices_ret.push(tree.Info(proxy));
+			return true;
+		});
+
+	if (num_unbounded) {
+		for (int c=0; c<(int)entries.size(); c++) if (entries[c].proxy < 0 && entries[c].obj) indices_ret.push(c);
+	}
+
+	std::sort(indices_ret.e, indices_ret.e + indices_ret.n, [](int a, int b) { return a > b; });
+	return indices_ret.n;
+}
+
+
+} //namespace LaxInterfaces
+
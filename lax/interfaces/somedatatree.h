@@ -0,0 +1,86 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+#ifndef _LAX_SOMEDATATREE_H
+#define _LAX_SOMEDATATREE_H
+
+
+#include <lax/interfaces/somedata.h>
+#include <lax/boxtree.h>
+#include <lax/refptrstack.h>
+
+#include <vector>
+#include <unordered_map>
+
+
+namespace LaxInterfaces {
+
+
+//---------------------------- SomeDataTree --------------------------------------
+class SomeDataTree
+{
+  protected:
+	class Entry
+	{
+	  public:
+		SomeData *obj;
+		int proxy; //-1 for objects without valid bounds
+		bool queued; //whether index is in dirty
+		std::clock_t modtime;
+		double m[6];
+		double bounds[4];
+		Entry() { obj = nullptr; proxy = -1; queued = false; modtime = 0; }
+	};
+
+	Laxkit::BoxTree tree;
+	std::vector<Entry> entries; //parallel to the synced stack
+	std::unordered_map<SomeData*, int> lookup; //object -> index in entries
+	std::vector<int> dirty; //entries to check on next Sync()
+	bool stack_changed;
+	int num_unbounded;
+
+	virtual bool Stale(Entry &entry);
+	virtual void Stamp(Entry &entry, int index);
+	virtual void Check(int index);
+	virtual void Resync(Laxkit::RefPtrStack<SomeData> &objects);
+
+  public:
+	SomeDataTree();
+	virtual ~SomeDataTree();
+
+	virtual int Sync(Laxkit::RefPtrStack<SomeData> &objects);
+	virtual bool Refit(int index);
+	virtual void Flush();
+	virtual int NumObjects() { return entries.size(); }
+
+	virtual void Touched(SomeData *obj);
+	virtual void Forget(SomeData *obj);
+	virtual void StackChanged() { stack_changed = true; }
+
+	virtual int FindAt(Laxkit::flatpoint p, Laxkit::NumStack<int> &indices_ret);
+	virtual int FindIn(const Laxkit::DoubleBBox &box, Laxkit::NumStack<int> &indices_ret);
+};
+
+
+} //namespace LaxInterfaces
+
+#endif
+
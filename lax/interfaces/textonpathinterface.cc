@@ -37,6 +37,7 @@
 #include <lax/utf8utils.h>
 #include <lax/laxutils.h>
 #include <lax/fontdialog.h>
+#include <lax/shapedtextcache.h>
 #include <lax/colorevents.h>
 #include <lax/laxutils.h>
 #include <lax/language.h>
@@ -704,22 +705,10 @@ int TextOnPath::Remap()
 		return 0;
 	}
 
-	 //set up freetype and hb fonts
+	 //set up freetype and shaping
 	FontManager *fontmanager = InterfaceManager::GetDefault()->GetFontManager();
-
-	FT_Face ft_face;
 	FT_Library *ft_library = fontmanager->GetFreetypeLibrary();
 
-	FT_New_Face (*ft_library, font->FontFile(), font->FontIndex(), &ft_face);
-	FT_Set_Char_Size (ft_face, scale_correction*font->Msize()*64, scale_correction*font->Msize()*64, 0, 0);
-
-	hb_font_t *hb_font;
-	hb_font = hb_ft_font_create (ft_face, NULL);
-
-
-	 //figure out direction, language, and script
-	hb_segment_properties_t seg_properties;
-
 
 	 //Figure out direction, if any
 	hb_direction_t dir = HB_DIRECTION_INVALID;
@@ -745,145 +734,11 @@ int TextOnPath::Remap()
 	if (script) hbscript = hb_script_from_string(script, strlen(script));
 
 
-	 //now figure out lines as necessary
-
-
-	 //create buffer and add text
-	hb_buffer_t *hb_buffer;
-	hb_buffer = hb_buffer_create ();
-	hb_buffer_add_utf8 (hb_buffer, text+start, end-start, 0, -1);
-
-
-	 //set direction, language, and script
-	if (dir==HB_DIRECTION_INVALID || hblang==NULL || hbscript==HB_SCRIPT_UNKNOWN) {
-		 //at least one of these things we know, so we have to manually set again
-		hb_buffer_guess_segment_properties (hb_buffer); //guesses direction, script, language
-		hb_buffer_get_segment_properties (hb_buffer, &seg_properties);
-
-		if (dir!=HB_DIRECTION_INVALID)   seg_properties.direction = dir;      else dir      = seg_properties.direction;
-		if (hblang!=NULL)                seg_properties.language  = hblang;   else hblang   = seg_properties.language;
-		if (hbscript!=HB_SCRIPT_UNKNOWN) seg_properties.script    = hbscript; else hbscript = seg_properties.script;
-
-		hb_buffer_set_segment_properties (hb_buffer, &seg_properties);
-
-	} else {
-		 //we know them all so...
-		seg_properties.direction = dir;
-		seg_properties.language  = hblang;
-		seg_properties.script    = hbscript;
-		hb_buffer_set_segment_properties (hb_buffer, &seg_properties);
-	}
-
-
-	 //set features
-	hb_face_t *hb_face;
-	hb_face = hb_ft_face_create_referenced(ft_face);
-
-	//*** foreach (feature in feature_string) set for hb_font
-	//hb_ot_layout_language_get_feature_tags()
-	//
-
-	unsigned int lang_index=0;
-	unsigned int script_index=0;
-
-	//hb_tag_t script_tag1;
-	//hb_tag_t lang_tag;
-	//unsigned int n_script_tags = 1;
-	//unsigned int n_lang_tags = 1;
-	//hb_ot_tags_from_script_and_language(hbscript, hblang, &n_script_tags, &script_tag1, &n_lang_tags, &lang_tag);
-	//hb_ot_layout_table_find_script (hb_face, HB_OT_TAG_GSUB, script_tag1, &script_index);
-	//
-	//hb_ot_layout_script_select_language (hb_face, HB_OT_TAG_GSUB, script_index, 1, &lang_tag, &lang_index);
-
-#ifdef HARFBUZZ_BELOW_2_0
-		hb_tag_t script_tag1, script_tag2;
-		hb_ot_tags_from_script(hbscript, &script_tag1, &script_tag2);
-
-		hb_tag_t lang_tag = hb_ot_tag_from_language (hblang);
-		hb_ot_layout_script_find_language (hb_face, HB_OT_TAG_GSUB, script_index, lang_tag, &lang_index);
-
-#else
-		hb_tag_t lang_tag;
-		hb_tag_t script_tag1;
-		unsigned int n_script_tags = 1;
-		unsigned int n_lang_tags = 1;
-
-		hb_ot_tags_from_script_and_language(hbscript, hblang, &n_script_tags, &script_tag1, &n_lang_tags, &lang_tag);
-
-		hb_ot_layout_table_find_script (hb_face, HB_OT_TAG_GSUB, script_tag1, &script_index);
-
-		hb_ot_layout_script_select_language (hb_face, HB_OT_TAG_GSUB, script_index, 1, &lang_tag, &lang_index);
-#endif
-
-
-	unsigned int count = 80;
-	hb_tag_t myResult[count];
-	//hb_ot_layout_table_get_feature_tags(hb_font_get_face(hb_font), HB_OT_TAG_GSUB, 0, &count, myResult)
-	//hb_ot_layout_table_get_feature_tags(hb_font_get_face(hb_font), HB_OT_TAG_GPOS, 0, &count, myResult)
-	//
-	//
-	//- hb_ot_layout_table_get_script_tags() to get all scripts for this font;
-	//- for each script index get all languages supported for this script with
-	//hb_ot_layout_script_get_language_tags();
-	//- at this point it's two dimensional - (script index, language index),
-	//now get feature set for this pair with:
-
-	hb_ot_layout_language_get_feature_tags(hb_face, HB_OT_TAG_GSUB, script_index, lang_index, 0, &count, myResult);
-	
-	DBG cerr <<"for font :"<<font->FontFile()<<":"<<endl;
-	DBG cerr <<" All the GSUB features for cur lang+script:  ";
-	DBG char tagstr[5]; tagstr[4]='\0';
-	DBG for (int cc=0; cc<(int)count; cc++) {
-	DBG 	hb_tag_to_string(myResult[cc], tagstr);
-	DBG 	cerr <<tagstr<<"  ";
-	DBG }
-	DBG cerr << endl;
-
-	hb_ot_layout_language_get_feature_tags(hb_face, HB_OT_TAG_GPOS, script_index, lang_index, 0, &count, myResult);
-	
-	DBG cerr <<" All the GPOS features for cur lang+script:  ";
-	DBG for (int cc=0; cc<(int)count; cc++) {
-	DBG 	hb_tag_to_string(myResult[cc], tagstr);
-	DBG 	cerr <<tagstr<<"  ";
-	DBG }
-	DBG cerr << endl;
-
-
-	  //Shape it!
-	hb_shape (hb_font, hb_buffer, NULL, 0);
-
-
-	 // get positioning
-	 //
-	//struct hb_glyph_info_t {
-	//  hb_codepoint_t codepoint;
-	//  hb_mask_t      mask;
-	//  uint32_t       cluster;
-	//}
-	//
-	//struct hb_glyph_position_t {
-	//  hb_position_t  x_advance;
-	//  hb_position_t  y_advance;
-	//  hb_position_t  x_offset; //shift from current position based on advances
-	//  hb_position_t  y_offset;
-	//}
-	//
-	//hb_segment_properties_t {
-	//  hb_direction_t  direction;
-	//  hb_script_t     script;
-	//  hb_language_t   language;
-	//}
-	//
-	//cairo_glyph_t {
-	//  unsigned long        index;
-	//  double               x;
-	//  double               y;
-	//}
-	//
-
-	int nglyphs              = hb_buffer_get_length (hb_buffer); //glyphs wide
-	hb_glyph_info_t *info    = hb_buffer_get_glyph_infos (hb_buffer, NULL);     //points to inside hb_buffer
-	hb_glyph_position_t *pos = hb_buffer_get_glyph_positions (hb_buffer, NULL); //points to inside hb_buffer
+	 //shape it, or get the text as already shaped
+	ShapedRun *run = ShapedTextCache::GetDefault()->Shape(ft_library, font, scale_correction*font->Msize(),
+														  dir, hblang, hbscript, text+start, end-start);
+	if (!run) cerr << " *** could not shape with font "<<(font->FontFile() ? font->FontFile() : "(none)")<<endl;
+	int nglyphs = (run ? run->glyphs.size() : 0);
 
 	 //reallocate glyphs, pos, rotation if necessary
 	if (glyphs.Allocated() < nglyphs) {
@@ -891,44 +746,31 @@ int TextOnPath::Remap()
 	}
 	numglyphs = nglyphs;
 
-	double current_x = 0;
-	double current_y = 0;
-	double width     = 0;
-	double widthy    = 0;
+	double width = 0;
 
 	OnPathGlyph *glyph;
 
-	//convert basic info from the harfbuzz shaping
+	//convert basic info from the shaped run
 	for (int i = 0; i < numglyphs; i++) {
 		glyph = glyphs.e[i];
+		GlyphPlace &place = run->glyphs[i];
 
-		glyph->index     = info[i].codepoint;
-		glyph->cluster   = info[i].cluster;
-		glyph->x_advance = pos[i].x_advance / 64. / scale_correction;
-		glyph->y_advance = pos[i].y_advance / 64. / scale_correction;
-		glyph->x         =   current_x + pos[i].x_offset / 64. / scale_correction;
-		glyph->y         = -(current_y + pos[i].y_offset / 64. / scale_correction);
-		glyph->numchars  = get_num_chars(text+start, end-start, glyph->cluster, i==numglyphs-1 ? end-start : glyphs.e[i+1]->cluster);
-
-		width     += glyph->x_advance;
-		widthy    += glyph->y_advance;
+		glyph->index     = place.index;
+		glyph->cluster   = place.cluster;
+		glyph->numchars  = place.numchars;
+		glyph->x_advance = place.x_advance / scale_correction;
+		glyph->y_advance = place.y_advance / scale_correction;
+		glyph->x         = place.x / scale_correction;
+		glyph->y         = place.y / scale_correction;
 
-		current_x += glyph->x_advance;
-		current_y += glyph->y_advance;
+		width += glyph->x_advance;
 
 		DBG fprintf(stderr, "index: %4d   cluster: %2u   at: %f, %f\n", glyph->index, glyph->cluster, glyph->x, glyph->y);
-		//DBG cerr <<"index: "<<g[i].index<<"  cluster: "<<g[i].cluster<<"  at: "<<g[i].x<<","<<g[i].y<<endl;
 	}
 
 	DBG cerr <<endl;
 
 	textpathlen = width / 72;
-	
-
-	 //cleanup hb and freetype stuff
-	hb_buffer_destroy (hb_buffer);
-	hb_font_destroy (hb_font);
-	FT_Done_Face (ft_face);
 
 
 	 //now we have glyphs laid out along a straight line,
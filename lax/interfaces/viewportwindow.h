@@ -208,7 +208,7 @@ class ViewportWindow : public Laxkit::PanUser, public Laxkit::anXWindow
 	virtual int CharInput(unsigned int ch, const char *buffer,int len,unsigned int state,const Laxkit::LaxKeyboard *d);
 	virtual int PerformAction(int action);
 	virtual int Needtodraw();
-	virtual void Needtodraw(int ntd) { needtodraw=ntd; }
+	virtual void Needtodraw(int ntd) { anXWindow::Needtodraw(ntd); }
 	virtual int Event(const Laxkit::EventData *e,const char *mes);
 	virtual int MoveResize(int nx,int ny,int nw,int nh);
 	virtual int Resize(int nw,int nh);
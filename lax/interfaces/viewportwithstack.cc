@@ -243,23 +243,37 @@ int ViewportWithStack::FindObject(int x,int y, const char *dtype,
 	if (nextindex<0) nextindex=firstobj->i;
 	if (start==0) if (++nextindex>n) nextindex=0;
 	flatpoint p=dp->screentoreal(x,y);
-	for (c=nextindex; c>=0; c--) {
-		if (c==firstobj->i && start==0) break;
-		maybe=datastack.e[c];
+
+	 //only objects whose bounds contain p need pointin(), the rest are skipped over
+	 //exactly as if pointin() had failed, so search order and firstobj are unaffected
+	objecttree.Sync(datastack);
+	objecttree.FindAt(p, candidates);
+
+	int stopat=-1;
+	if (start==0 && firstobj->i>=0 && firstobj->i<=nextindex) stopat=firstobj->i;
+	c=stopat;
+	for (int k=0; k<candidates.n; k++) {
+		int i=candidates.e[k];
+		if (i>nextindex) continue;
+		if (i<=stopat) break;
+		maybe=datastack.e[i];
 		if (maybe==exclude) continue;
 		if (maybe->pointin(p)) {
-			if (searchtype && !strcmp(maybe->whattype(),searchtype)) break; //found right type
-			if (!foundobj->obj) foundobj->set(c,maybe);
+			if (searchtype && !strcmp(maybe->whattype(),searchtype)) { c=i; break; } //found right type
+			if (!foundobj->obj) foundobj->set(i,maybe);
 		}
 	}
 	 // if item not found, then continue search from top of datastack.
 	if (c==-1) {
-		for (c=datastack.n-1; c>firstobj->i; c--) {
-			maybe=datastack.e[c];
+		c=firstobj->i;
+		for (int k=0; k<candidates.n; k++) {
+			int i=candidates.e[k];
+			if (i<=firstobj->i) break;
+			maybe=datastack.e[i];
 			if (maybe==exclude) continue;
 			if (maybe->pointin(p)) {
-				if (searchtype && !strcmp(maybe->whattype(),searchtype)) break; //found right type
-				if (!foundobj->obj) foundobj->set(c,maybe);
+				if (searchtype && !strcmp(maybe->whattype(),searchtype)) { c=i; break; } //found right type
+				if (!foundobj->obj) foundobj->set(i,maybe);
 			}
 		}
 		if (c==firstobj->i) { // no more to search for.
@@ -282,6 +296,7 @@ int ViewportWithStack::FindObject(int x,int y, const char *dtype,
 			return 0;
 		}
 	}
+	maybe=datastack.e[c];
 	foundobj->set(c,maybe);
 	foundtypeobj->set(c,maybe);
 	if (oc) *oc=foundtypeobj;
@@ -290,11 +305,65 @@ int ViewportWithStack::FindObject(int x,int y, const char *dtype,
 	return 1;
 }
 
+//! Return a list of all the objects whose bounds touch box.
+/*! See ViewportWindow::FindObjects() for details. ascurobj is ignored, since there is only
+ * the one level of objects here.
+ */
+int ViewportWithStack::FindObjects(Laxkit::DoubleBBox *box, char real, char ascurobj,
+								SomeData ***data_ret, ObjectContext ***c_ret)
+{
+	if (data_ret) *data_ret=NULL;
+	if (c_ret) *c_ret=NULL;
+	if (!box || !box->validbounds() || datastack.n==0) return 0;
+
+	DoubleBBox realbox;
+	if (real) realbox.setbounds(box);
+	else {
+		realbox.addtobounds(dp->screentoreal(box->minx,box->miny));
+		realbox.addtobounds(dp->screentoreal(box->maxx,box->miny));
+		realbox.addtobounds(dp->screentoreal(box->maxx,box->maxy));
+		realbox.addtobounds(dp->screentoreal(box->minx,box->maxy));
+	}
+
+	objecttree.Sync(datastack);
+	objecttree.FindIn(realbox, candidates);
+
+	 //candidates are only near box, check actual bounds, keeping stack order
+	NumStack<int> found;
+	for (int k=candidates.n-1; k>=0; k--) {
+		SomeData *obj=datastack.e[candidates.e[k]];
+		if (realbox.intersect(obj->m(), obj)) found.push(candidates.e[k]);
+	}
+	if (found.n==0) return 0;
+
+	if (data_ret) {
+		*data_ret=new SomeData*[found.n+1];
+		for (int c=0; c<found.n; c++) (*data_ret)[c]=datastack.e[found.e[c]];
+		(*data_ret)[found.n]=NULL;
+	}
+	if (c_ret) {
+		*c_ret=new ObjectContext*[found.n+1];
+		for (int c=0; c<found.n; c++) (*c_ret)[c]=new ObjectContext(found.e[c],datastack.e[found.e[c]]);
+		(*c_ret)[found.n]=NULL;
+	}
+	return found.n;
+}
+
+//! Objects never change context here, but the object's place in the search index is updated.
+/*! Always returns NULL.
+ */
+ObjectContext *ViewportWithStack::ObjectMoved(ObjectContext *oc, int modifyoc)
+{
+	if (oc && oc->i>=0 && oc->i<datastack.n && oc->obj==datastack.e[oc->i]) objecttree.Refit(oc->i);
+	return NULL;
+}
+
 //! Drop a new object at screen coordinates x,y.
 int ViewportWithStack::DropObject(SomeData *d, double x,double y)
 {
 	d->origin(flatpoint(x,y));
 	datastack.push(d);
+	objecttree.StackChanged();
 	int c=datastack.n-1;
 	curobj->i=c;
 	curobj->SetObject(d);
@@ -314,6 +383,7 @@ int ViewportWithStack::NewData(SomeData *d,ObjectContext **oc_ret, bool clear_se
 
 	curobj->SetObject(d);
 	datastack.push(d);
+	objecttree.StackChanged();
 	c=datastack.n-1; 
 	curobj->i=c;
 
@@ -334,6 +404,7 @@ int ViewportWithStack::DeleteObject()
 	if (!todel) return -1;
 	for (int c=0; c<interfaces.n; c++) interfaces.e[c]->Clear(todel);
 	datastack.remove(datastack.findindex(todel));
+	objecttree.StackChanged();
 	curobj->clear();
 	
 	//ClearSearch();
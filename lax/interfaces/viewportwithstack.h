@@ -23,6 +23,7 @@
 #define _LAX_VIEWPORTWITHSTACK_H
 
 #include <lax/interfaces/viewportwindow.h>
+#include <lax/interfaces/somedatatree.h>
 
 namespace LaxInterfaces {
 
@@ -36,16 +37,19 @@ class ViewportWithStack : public ViewportWindow
 	int vpwsfirsttime;
 	ObjectContext *foundobj,*foundtypeobj,*firstobj; //obj just before firstobj should be the last one searched.
 	ObjectContext *curobj;
+	SomeDataTree objecttree; //spatial index of datastack, see FindObject()
+	Laxkit::NumStack<int> candidates;
 	virtual void ClearSearch();
 
  public:
 	bool draw_axes;
 	bool draw_bounding_boxes;
 
-	Laxkit::RefPtrStack<SomeData> datastack;
+	Laxkit::RefPtrStack<SomeData> datastack; //call DataStackChanged() after reordering directly
  	ViewportWithStack(anXWindow *parnt,const char *nname,const char *ntitle,unsigned long nstyle,
 					int xx,int yy,int ww,int hh,int brder,Laxkit::Displayer *ndp=NULL);
 	virtual ~ViewportWithStack();
+	virtual void DataStackChanged() { objecttree.StackChanged(); }
 	virtual void Refresh();
 	virtual int Event(const Laxkit::EventData *e,const char *mes);
 	virtual int MouseMove(int x,int y,unsigned int state,const Laxkit::LaxMouse *d);
@@ -57,6 +61,9 @@ class ViewportWithStack : public ViewportWindow
 	virtual int FindObject(int x,int y, const char *dtype, 
 						   SomeData *exclude, int start,
 						   ObjectContext **oc, int searcharea);
+	virtual int FindObjects(Laxkit::DoubleBBox *box, char real, char ascurobj,
+							SomeData ***data_ret, ObjectContext ***c_ret);
+	virtual ObjectContext *ObjectMoved(ObjectContext *oc, int modifyoc);
 	virtual int ChangeObject(ObjectContext *oc, int switchtool);
 	virtual int ChangeContext(int x,int y,ObjectContext **oc);
 	virtual int SelectObject(int i);
@@ -252,7 +252,7 @@ int IOBuffer::GetLine(char **lineptr, size_t *n)
 	else nextnl++;
 	size_t linel = nextnl - (s+curpos);
 
-	if (linel > *n) {
+	if (!*lineptr || linel+1 > *n) {
 		 //reallocate line
 		//delete[] *lineptr;
 		//*lineptr = new char[linel+20];
@@ -27,6 +27,7 @@
 #include <errno.h>
 
 #include <lax/laximages-cairo.h>
+#include <lax/imagecache.h>
 #include <lax/strmanip.h>
 #include <lax/vectors.h>
 #include <lax/transformmath.h>
@@ -552,6 +553,7 @@ int LaxCairoImage::doneWithBuffer(unsigned char *bbuffer)
  * 8 bit ARGB happens to be compatible with both Imlib2 and cairo.
  *
  * The data is copied to a new buffer, which is stored within the object.
+ * Any old image is replaced, but filename is kept.
  *
  * Returns 0 for success, or 1 for error in processing, for instance, if the stride
  * is not a reasonable value.
@@ -559,8 +561,9 @@ int LaxCairoImage::doneWithBuffer(unsigned char *bbuffer)
 int LaxCairoImage::createFromData_ARGB8(int nwidth, int nheight, int stride, const unsigned char *data, bool not_premultiplied)
 {
 	if (!data) return 1;
-	clear();
 
+	 //replace old pixels, but keep filename, since this is how importers LoadToMemory()
+	if (image) cairo_surface_destroy(image);
 	image  = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, nwidth,nheight);
 	width  = nwidth;
 	height = nheight;
@@ -664,9 +667,46 @@ unsigned int LaxCairoImage::imagestate()
  */
 void LaxCairoImage::doneForNow()
 {
-	if (!image || flag) return;
+	bool idle;
+	{
+		std::lock_guard<std::recursive_mutex> lock(pixels_mutex);
+		if (!image || flag) return;
 
-	if (display_count>0) display_count--;
+		if (display_count>0) display_count--;
+		idle = (display_count == 0);
+	}
+
+	 //not while locked, since the cache locks itself first, then images
+	if (idle) {
+		ImageCache *cache = ImageCache::GetDefault(false);
+		if (cache) cache->DoneForNow(this);
+	}
+}
+
+//! Bytes in the surface, plus any buffer from getImageBuffer().
+long LaxCairoImage::MemoryUsed()
+{
+	std::lock_guard<std::recursive_mutex> lock(pixels_mutex);
+	long size = cache_buffer ? cache_buffer_size : 0;
+	if (image) size += (long)cairo_image_surface_get_stride(image) * cairo_image_surface_get_height(image);
+	return size;
+}
+
+/*! Free the surface and any buffer, keeping width and height. Only done when not being
+ * displayed, and there is an importer to reload from filename. This can be called while
+ * other threads use Image(), since they agree through pixels_mutex.
+ */
+int LaxCairoImage::FreePixels()
+{
+	std::lock_guard<std::recursive_mutex> lock(pixels_mutex);
+	if (!image || flag || display_count > 0 || !filename || !importer) return 1;
+
+	cairo_surface_destroy(image);
+	image = nullptr;
+	delete[] cache_buffer;
+	cache_buffer = nullptr;
+	cache_buffer_size = 0;
+	return 0;
 }
 
 //! Return the image. Loads from filename if !image.
@@ -683,6 +723,9 @@ void LaxCairoImage::doneForNow()
  */
 cairo_surface_t *LaxCairoImage::Image()
 {
+	 //recursive, since importers might call Image() from LoadToMemory()
+	std::lock_guard<std::recursive_mutex> lock(pixels_mutex);
+
 	if (!image) {
 		if (importer) {
 			importer->LoadToMemory(this);
@@ -32,6 +32,8 @@
 
 #include <cairo/cairo-xlib.h>
 
+#include <mutex>
+
 namespace Laxkit {
 
 
@@ -42,6 +44,7 @@ class LaxCairoImage : public LaxImage
  protected:
 	char flag;
 	int display_count;
+	std::recursive_mutex pixels_mutex; //guards image and display_count, so FreePixels() is safe while others draw
 
  public:
 	cairo_surface_t *image;
@@ -67,6 +70,8 @@ class LaxCairoImage : public LaxImage
 	virtual unsigned char *getImageBuffer();
 	virtual int doneWithBuffer(unsigned char *buffer);
 	virtual LaxImage *Crop(int x, int y, int width, int height, bool return_new);
+	virtual long MemoryUsed();
+	virtual int FreePixels();
 
 	virtual void Set(double r, double g, double b, double a);
 	virtual int Save(const char *tofile = nullptr, const char *format = nullptr); //format==null guess from extension
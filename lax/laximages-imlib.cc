@@ -21,6 +21,7 @@
 //
 
 #include <lax/laximages-imlib.h>
+#include <lax/imagecache.h>
 #include <lax/strmanip.h>
 #include <lax/vectors.h>
 #include <lax/transformmath.h>
@@ -258,11 +259,22 @@ unsigned int LaxImlibImage::imagestate()
  */
 void LaxImlibImage::doneForNow()
 {
-	if (!image || flag) return;
+	if (FreePixels() != 0) return;
+
+	ImageCache *cache = ImageCache::GetDefault(false);
+	if (cache) cache->DoneForNow(this);
+}
+
+/*! Free image, which Image() will reload from filename. Return 0 if freed.
+ */
+int LaxImlibImage::FreePixels()
+{
+	if (!image || flag) return 1;
 	imlib_context_set_image(image);
 	imlib_free_image();
 	image=NULL;
 	whichimage=0;
+	return 0;
 }
 
 //! Return the image. Loads from filename if !image.
@@ -626,8 +638,8 @@ int ImlibLoader::LoadToMemory(LaxImage *img)
 		unsigned char *data = (unsigned char *)imlib_image_get_data(); //this data is ARGB ARGB...
 		cimg->createFromData_ARGB8(cimg->width, cimg->height, 4*cimg->width, data, true);
 		imlib_image_put_back_data((DATA32 *)data);
+		imlib_free_image();
 
-		cimg->Image(); //incs cimg->display_count++;
 		return 0;
 	}
 #endif
@@ -60,6 +60,8 @@ class LaxImlibImage : public LaxImage
 	virtual unsigned char *getImageBuffer();
 	virtual int doneWithBuffer(unsigned char *buffer);
 	virtual LaxImage *Crop(int x, int y, int width, int height, bool return_new);
+	virtual long MemoryUsed() { return image ? 4L*width*height : 0; }
+	virtual int FreePixels();
 
 	virtual int Save(const char *tofile = nullptr, const char *format = nullptr); //format==null guess from extension
 	virtual void Set(double r, double g, double b, double a);
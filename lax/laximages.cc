@@ -26,6 +26,7 @@
 #include <unistd.h>
 
 #include <lax/laximages.h>
+#include <lax/imagecache.h>
 #include <lax/strmanip.h>
 #include <lax/fileutils.h>
 #include <lax/vectors.h>
@@ -207,6 +208,17 @@ int CacheManager::Remove(MemCachedObject *obj)
 /*! \fn void LaxImage::doneForNow()
  * \brief This might free the image to make room in a cache, for instance.
  */
+/*! \fn long LaxImage::MemoryUsed()
+ * \brief Return about how many bytes of pixel data are currently in memory.
+ *
+ * This is used by ImageCache to keep within its budget. Default is to return 0.
+ */
+/*! \fn int LaxImage::FreePixels()
+ * \brief Free pixel data that can be reloaded from filename later, keeping metrics.
+ *
+ * Return 0 if freed, or nonzero if there was nothing to free, or it can't be reloaded,
+ * or it is currently in use. Default is to return 1.
+ */
 /*! \fn void LaxImage::clear()
  * \brief Clear all data contained in this image.
  *
@@ -797,6 +809,11 @@ LaxImage *ImageLoader::LoadImage(const char *file, int index)
 	return LoadImage(file, nullptr,0,0,nullptr, 0, LAX_IMAGE_DEFAULT, nullptr, true, index);
 }
 
+/*! If there is a default ImageCache, no preview is asked for, required_state is 0, and ping_only
+ * is true, then the image comes from ImageCache::Load(), and may be shared with other code that
+ * loaded the same file. Such images should not be modified. Otherwise, this is the same as
+ * LoadImageUncached(), since the cache only keeps images loaded that way.
+ */
 LaxImage *ImageLoader::LoadImage(const char *file,
 								 const char *previewfile, int maxw,int maxh, LaxImage **preview_ret,
 								 int required_state, //!< Or'd combo of LaxImageState
@@ -807,6 +824,31 @@ LaxImage *ImageLoader::LoadImage(const char *file,
 {
 	if (!file) return NULL;
 
+	if (!previewfile && !preview_ret && required_state == 0 && ping_only) {
+		ImageCache *cache = ImageCache::GetDefault(false);
+		if (cache) {
+			LaxImage *image = cache->Load(file, index, 0,0, target_format);
+			if (image && actual_format) *actual_format = image->imagetype();
+			return image;
+		}
+	}
+
+	return LoadImageUncached(file, previewfile,maxw,maxh,preview_ret, required_state, target_format, actual_format, ping_only, index);
+}
+
+/*! Load file with the first loader that can, bypassing any ImageCache.
+ * The returned image is new, and not shared with anything else.
+ */
+LaxImage *ImageLoader::LoadImageUncached(const char *file,
+								 const char *previewfile, int maxw,int maxh, LaxImage **preview_ret,
+								 int required_state,
+								 int target_format,
+								 int *actual_format,
+								 bool ping_only,
+								 int index)
+{
+	if (!file) return NULL;
+
 	DBG cerr <<"ImageLoader::LoadImage()..."<<file<<endl;
 
 	if (target_format<=0 || target_format == LAX_IMAGE_DEFAULT) target_format = default_image_type();
@@ -86,7 +86,8 @@ class LaxImage : public anObject
 	virtual int SetAttribute(const char *key, const char *value);
 	virtual char *GetAttribute(const char *key);
 
-	//virtual int MaxMemoryUsed();
+	virtual long MemoryUsed() { return 0; }
+	virtual int FreePixels() { return 1; }
 	//virtual int dec_count();
 
 	virtual void Set(double r, double g, double b, double a) = 0;
@@ -150,6 +151,13 @@ class ImageLoader : public anObject
                                bool ping_only,
                                int index);
 	static LaxImage *LoadImage(const char *file, int index = 0);
+	static LaxImage *LoadImageUncached(const char *file,
+                               const char *previewfile, int maxw,int maxh, LaxImage **preview_ret,
+                               int required_state,
+                               int target_format,
+                               int *actual_format,
+                               bool ping_only,
+                               int index);
 	static int Ping(const char *file, int *width, int *height, long *filesize, int *subfiles); //return 0 for success. subfiles is number of "frames" in file
 	static LaxImage *NewImage(int width, int height, int format = LAX_IMAGE_DEFAULT);
 	static LaxImage *NewImageFromBuffer(unsigned char *data, int width, int height, int stride, int format = LAX_IMAGE_DEFAULT);
@@ -313,7 +313,7 @@ void LineEdit::Qualifier(const char *nqualifier)
 int LineEdit::Modified(int m)//m=1
 {	
 	int v=valid;
-	if (thetext && thetext[0]!='\0') {
+	if (thetext && textlen) {
 		if (win_style&LINEEDIT_INT) {
 			char *e=NULL;
 			strtol(GetCText(),&e,10);
@@ -327,10 +327,11 @@ int LineEdit::Modified(int m)//m=1
 			if (*e!='\0') v=0; else v=1;
 			
 		} else if (win_style&(LINEEDIT_FILESAVE|LINEEDIT_FILE|LINEEDIT_DIRECTORY)) {
-			char tmp[(thetext?strlen(thetext):0) + 1 + (qualifier?strlen(qualifier):0) + 1];
-			if (thetext[0]=='/') sprintf(tmp,"%s",thetext);
-			else if (qualifier) sprintf(tmp,"%s/%s",qualifier,thetext);
-			else sprintf(tmp,"%s",thetext);
+			const char *text=GetCText();
+			char tmp[strlen(text) + 1 + (qualifier?strlen(qualifier):0) + 1];
+			if (text[0]=='/') sprintf(tmp,"%s",text);
+			else if (qualifier) sprintf(tmp,"%s/%s",qualifier,text);
+			else sprintf(tmp,"%s",text);
 
 			int type=file_exists(tmp,1,NULL);
 			if ((win_style&LINEEDIT_FILE)!=0 && S_ISREG(type)) v=1;
@@ -403,9 +404,10 @@ void LineEdit::ControlActivation(int on)
 double LineEdit::GetDouble(int *error_ret)
 { 
 	if (thetext) { 
+		const char *text=GetCText();
 		char *endptr;
-		double d=strtod(thetext,&endptr);
-		if (endptr!=thetext) {
+		double d=strtod(text,&endptr);
+		if (endptr!=text) {
 			while (isspace(*endptr)) endptr++;
 			if (*endptr=='\0') {
 				if (error_ret) *error_ret=0;
@@ -425,9 +427,10 @@ double LineEdit::GetDouble(int *error_ret)
 long LineEdit::GetLong(int *error_ret)
 {
 	if (thetext) { 
+		const char *text=GetCText();
 		char *endptr;
-		long d=strtol(thetext,&endptr,10);
-		if (endptr!=thetext) {
+		long d=strtol(text,&endptr,10);
+		if (endptr!=text) {
 			while (isspace(*endptr)) endptr++;
 			if (*endptr=='\0') {
 				if (error_ret) *error_ret=0;
@@ -605,7 +608,7 @@ int LineEdit::CharInput(unsigned int ch,const char *buffer,int len,unsigned int
 		 //insert the character
 		if (sellen) replacesel(ch);
 		else inschar(ch);
-		DBG cerr <<"text: "<<thetext<<endl;
+		DBG cerr <<"text: "<<GetCText()<<endl;
 		return 0;
 	}
 	DBG if (state&ControlMask && ch>=32) cerr <<"cntl-"<<ch<<endl;
@@ -811,7 +811,7 @@ int PtrStack<T>::Allocate(int newmax)
 	delete[] e; e = nullptr;
 	e = newt;
 
-	char *templ = new char[max];
+	char *templ = new char[newmax];
 	if (n) memcpy(templ,islocal,n*sizeof(char));
 	delete[] islocal;
 	islocal = templ;
@@ -1019,7 +1019,7 @@ int MultiLineEdit::CharInput(unsigned int ch,const char *buffer,int len,unsigned
 				if (curline<0) makeinwindow();
 			} else {
 				curpos=prevpos(curpos);
-				DBG cerr <<" --go left to "<<curpos<<" char:"<<thetext[curpos]<<endl;
+				DBG cerr <<" --go left to "<<curpos<<" char:"<<textchar(curpos)<<endl;
 				if (curpos<linestats[curline].start) {
 					DBG cerr <<" --left go up a line"<<endl;
 					curline--;
@@ -1027,9 +1027,9 @@ int MultiLineEdit::CharInput(unsigned int ch,const char *buffer,int len,unsigned
 					findcaret();
 				} else {
 					//if (onlf(curpos)==2) curpos--; ***this never happens here?
-					if (thetext[curpos]=='\t' && textstyle&TEXT_TABS_STOPS)
+					if (textchar(curpos)=='\t' && textstyle&TEXT_TABS_STOPS)
 						cx=GetExtent(linestats[curline].start,curpos,0,linestats[curline+1].start)-curlineoffset;
-					else cx-=charwidth(thetext[curpos]);
+					else cx-=charwidth(textchar(curpos));
 				}
 			}
 			if (state&ShiftMask) sellen=curpos-selstart;
@@ -1057,9 +1057,9 @@ int MultiLineEdit::CharInput(unsigned int ch,const char *buffer,int len,unsigned
 					cy+=textheight;
 					cx=-curlineoffset;
 				} else {
-					if (thetext[curpos-1]=='\t' && textstyle&TEXT_TABS_STOPS)
+					if (textchar(curpos-1)=='\t' && textstyle&TEXT_TABS_STOPS)
 						cx=GetExtent(linestats[curline].start,curpos,0,linestats[curline+1].start)-curlineoffset;
-					else cx+=charwidth(thetext[curpos-1]);
+					else cx+=charwidth(textchar(curpos-1));
 				}
 			}
 			if (state&ShiftMask) sellen=curpos-selstart;
@@ -1267,7 +1267,7 @@ int MultiLineEdit::LBDown(int x,int y, unsigned int state,int count,const LaxMou
 	if (state&ShiftMask) { if (sellen==0) selstart=curpos; }
 	else { sellen=0; }
 	findpos(y,x); // this sets curpos and findscaret
-	DBG cerr <<' '<<thetext[curpos]<<':'<<(int)thetext[curpos]<<' ';
+	DBG cerr <<' '<<textchar(curpos)<<':'<<(int)textchar(curpos)<<' ';
 	if (state&ShiftMask) sellen=curpos-selstart;
 	//needtodraw|=makeinwindow()|4;
 	makeinwindow();
@@ -1291,14 +1291,14 @@ int MultiLineEdit::LBDblClick(int x,int y, unsigned int state,const LaxMouse *d)
 	}
 	selstart=curpos;
 
-	if (isalnum(thetext[selstart])) { // find word
+	if (isalnum(textchar(selstart))) { // find word
 		while (selstart>0 && isword(selstart-1)) selstart=prevpos(selstart);
 		while (curpos<textlen && isword(curpos)) curpos=nextpos(curpos);
 
 	} else { // find block of whitespace
 		while (selstart>0 && c<10 && !isword(selstart-1) && !onlf(selstart-1))
 			{ selstart=prevpos(selstart); c++; }
-		while (curpos<textlen && c<10 && !isword(thetext[curpos]) && !onlf(curpos))
+		while (curpos<textlen && c<10 && !isword(textchar(curpos)) && !onlf(curpos))
 			{ curpos=nextpos(curpos); c++; }
 	}
 	findcaret();
@@ -1396,7 +1396,7 @@ int MultiLineEdit::Idle(int tid, double delta)
 
 //! Return whether position pos is part of a word. Default is alphanumeric or a period.
 int MultiLineEdit::isword(long pos)
-{  	return isalnum(thetext[pos]) || thetext[pos]=='.'; }
+{  	return isalnum(textchar(pos)) || textchar(pos)=='.'; }
 
 /*! Returns pos of start of next potential screen line after ls, assumes ilsofar set right
  * updates ilsofar which basically becomes pixlen of line with ls.
@@ -1445,9 +1445,8 @@ long MultiLineEdit::findlinestart(long pos)//pos=-1 means use curpos
 {
 	if (pos<0) pos=curpos;
 	if (pos>textlen) pos=textlen;
-	long npos=pos,onpos=pos;
+	long npos=TextEditBaseUtf8::findlinestart(pos),onpos=pos;
 	int l=0;
-	while (npos>0 && !onlf(npos-1))	npos=prevpos(npos);
 	do { onpos=npos; npos=findline(npos,l); } while (npos<pos);
 	return (npos==pos?npos:onpos);
 }
@@ -1652,7 +1651,7 @@ void MultiLineEdit::Refresh()
 		dp->NewFG(coloravg(win_themestyle->bg,win_themestyle->fg));
 
 		int nl=numlines;
-		if (!onlf(thetext[textlen-1])) nl++;
+		if (!onlf(textchar(textlen-1))) nl++;
 
 		for (int c=0; c<nl; c++) {
 			dp->drawnum(textrect.x/2, textrect.y + pady*textheight + c*th + th/2, c+1);
@@ -21,7 +21,10 @@
 //
 
 #include <lax/pointset.h>
+#include <lax/threadpool.h>
 
+#include <algorithm>
+#include <cmath>
 
 #include <iostream>
 using namespace std;
@@ -31,15 +34,221 @@ using namespace std;
 namespace Laxkit {
 
 	
+//---------------------------------- PointKDTree ---------------------------------
+
+/*! \class PointKDTree
+ * \brief Static 2-d tree over a copy of some points, for nearest and k nearest lookups.
+ *
+ * The tree is implicit. Points are reordered so that the node for any range [lo,hi)
+ * is the median at (lo+hi)/2, splitting on whichever axis the range is widest in.
+ * Queries return indices into the array passed to Build(). They only read the tree,
+ * so they are safe from several threads at once.
+ */
+
+//! Build for n points. Old contents are discarded.
+void PointKDTree::Build(const flatpoint *points, int n)
+{
+	nodes.resize(n);
+	axis.resize(n);
+	for (int c=0; c<n; c++) {
+		nodes[c].p = points[c];
+		nodes[c].index = c;
+	}
+	Build(0, n);
+}
+
+void PointKDTree::Build(int lo, int hi)
+{
+	if (hi - lo < 2) {
+		if (hi > lo) axis[lo] = 0;
+		return;
+	}
+
+	double minx = nodes[lo].p.x, maxx = minx, miny = nodes[lo].p.y, maxy = miny;
+	for (int c=lo+1; c<hi; c++) {
+		const flatpoint &p = nodes[c].p;
+		if      (p.x < minx) minx = p.x;
+		else if (p.x > maxx) maxx = p.x;
+		if      (p.y < miny) miny = p.y;
+		else if (p.y > maxy) maxy = p.y;
+	}
+	char a = (maxy - miny > maxx - minx) ? 1 : 0;
+
+	int mid = (lo + hi) / 2;
+	std::nth_element(nodes.begin() + lo, nodes.begin() + mid, nodes.begin() + hi, [a](const Node &n1, const Node &n2) {
+			return a ? n1.p.y < n2.p.y : n1.p.x < n2.p.x;
+		});
+
+	axis[mid] = a;
+	Build(lo, mid);
+	Build(mid+1, hi);
+}
+
+void PointKDTree::Clear()
+{
+	nodes.clear();
+	axis.clear();
+}
+
+void PointKDTree::Closest(int lo, int hi, flatpoint p, int &best, double &bestd) const
+{
+	if (lo >= hi) return;
+
+	int mid = (lo + hi) / 2;
+	double d = norm2(nodes[mid].p - p);
+	if (d < bestd) { bestd = d; best = mid; }
+
+	double delta = axis[mid] ? p.y - nodes[mid].p.y : p.x - nodes[mid].p.x;
+	if (delta < 0) {
+		Closest(lo, mid, p, best, bestd);
+		if (delta*delta < bestd) Closest(mid+1, hi, p, best, bestd);
+	} else {
+		Closest(mid+1, hi, p, best, bestd);
+		if (delta*delta < bestd) Closest(lo, mid, p, best, bestd);
+	}
+}
+
+/*! Return the index of the point closest to p, or -1 if there are no points.
+ * If dist2_ret, return the square of the distance there.
+ */
+int PointKDTree::Closest(flatpoint p, double *dist2_ret) const
+{
+	int best = -1;
+	double bestd = 1e+300;
+	Closest(0, nodes.size(), p, best, bestd);
+	if (dist2_ret) *dist2_ret = bestd;
+	return best >= 0 ? nodes[best].index : -1;
+}
+
+//! heap is a max heap of (distance squared, tree position), no bigger than k.
+void PointKDTree::KClosest(int lo, int hi, flatpoint p, int k, std::vector<std::pair<double,int>> &heap) const
+{
+	if (lo >= hi) return;
+
+	int mid = (lo + hi) / 2;
+	double d = norm2(nodes[mid].p - p);
+	if ((int)heap.size() < k) {
+		heap.push_back(std::pair<double,int>(d, mid));
+		std::push_heap(heap.begin(), heap.end());
+	} else if (d < heap.front().first) {
+		std::pop_heap(heap.begin(), heap.end());
+		heap.back() = std::pair<double,int>(d, mid);
+		std::push_heap(heap.begin(), heap.end());
+	}
+
+	double delta = axis[mid] ? p.y - nodes[mid].p.y : p.x - nodes[mid].p.x;
+	int lo2 = mid+1, hi2 = hi;
+	if (delta < 0) KClosest(lo, mid, p, k, heap);
+	else { KClosest(mid+1, hi, p, k, heap); lo2 = lo; hi2 = mid; }
+	if ((int)heap.size() < k || delta*delta < heap.front().first) KClosest(lo2, hi2, p, k, heap);
+}
+
+/*! Find up to k points closest to p, nearest first. indices_ret and dist2_ret, if not null,
+ * must have room for k. dist2_ret gets squared distances. Returns the number found.
+ */
+int PointKDTree::KClosest(flatpoint p, int k, int *indices_ret, double *dist2_ret) const
+{
+	if (k <= 0) return 0;
+
+	std::vector<std::pair<double,int>> heap;
+	heap.reserve(k+1);
+	KClosest(0, nodes.size(), p, k, heap);
+	std::sort_heap(heap.begin(), heap.end());
+
+	for (unsigned int c=0; c<heap.size(); c++) {
+		if (indices_ret) indices_ret[c] = nodes[heap[c].second].index;
+		if (dist2_ret)   dist2_ret[c]   = heap[c].first;
+	}
+	return heap.size();
+}
+
+void PointKDTree::WithinRadius(int lo, int hi, flatpoint p, double r2, std::vector<int> &indices_ret) const
+{
+	if (lo >= hi) return;
+
+	int mid = (lo + hi) / 2;
+	if (norm2(nodes[mid].p - p) <= r2) indices_ret.push_back(nodes[mid].index);
+
+	double delta = axis[mid] ? p.y - nodes[mid].p.y : p.x - nodes[mid].p.x;
+	if (delta <= 0 || delta*delta <= r2) WithinRadius(lo, mid, p, r2, indices_ret);
+	if (delta >= 0 || delta*delta <= r2) WithinRadius(mid+1, hi, p, r2, indices_ret);
+}
+
+/*! Append to indices_ret all points no further than radius from p, in no particular order.
+ * Returns the number appended.
+ */
+int PointKDTree::WithinRadius(flatpoint p, double radius, std::vector<int> &indices_ret) const
+{
+	int n = indices_ret.size();
+	WithinRadius(0, nodes.size(), p, radius*radius, indices_ret);
+	return indices_ret.size() - n;
+}
+
+
+//---------------------------------- PointGrid ---------------------------------
+
+/*! Uniform grid bucketing of points, for neighbor loops within a cutoff distance.
+ * Rebuilt from scratch whenever points move, which is cheap compared to the loops it saves.
+ */
+class PointGrid
+{
+  public:
+	DoubleBBox box;
+	double cell;
+	int width, height;
+	std::vector<int> cellstart; //index into order for each cell, plus one past the end
+	std::vector<int> order;     //point indices sorted by cell
+	std::vector<flatpoint> pts; //point positions in the same order, for cache friendly loops
+
+	void Build(PtrStack<PointSet::PointObj> &points, double cellsize);
+	int CellX(double x) { int i = (x - box.minx) / cell; return i < 0 ? 0 : (i >= width  ? width-1  : i); }
+	int CellY(double y) { int i = (y - box.miny) / cell; return i < 0 ? 0 : (i >= height ? height-1 : i); }
+};
+
+void PointGrid::Build(PtrStack<PointSet::PointObj> &points, double cellsize)
+{
+	box.ClearBBox();
+	for (int c=0; c<points.n; c++) box.addtobounds(points.e[c]->p);
+
+	 //keep the number of cells reasonable, even when points are spread out way past cutoff
+	cell = cellsize;
+	double maxcells = 4.0 * points.n + 16;
+	while ((box.boxwidth()/cell + 1) * (box.boxheight()/cell + 1) > maxcells) cell *= 2;
+
+	width  = box.boxwidth()/cell  + 1;
+	height = box.boxheight()/cell + 1;
+
+	std::vector<int> cellof(points.n);
+	cellstart.assign(width*height + 1, 0);
+	for (int c=0; c<points.n; c++) {
+		cellof[c] = CellY(points.e[c]->p.y)*width + CellX(points.e[c]->p.x);
+		cellstart[cellof[c]+1]++;
+	}
+	for (int c=1; c<(int)cellstart.size(); c++) cellstart[c] += cellstart[c-1];
+
+	std::vector<int> fill(cellstart.begin(), cellstart.end()-1);
+	order.resize(points.n);
+	for (int c=0; c<points.n; c++) order[fill[cellof[c]]++] = c;
+
+	pts.resize(points.n);
+	for (int c=0; c<points.n; c++) pts[c] = points.e[order[c]]->p;
+}
+
+
 //---------------------------------- class PointSet ---------------------------------
 
 
 /*! \class PointSet
  * Base class for things that contain numerous points.
+ *
+ * Closest(), KClosest() and WithinRadius() use a PointKDTree that is rebuilt on demand after
+ * any change made through PointSet functions. If you change points.e[i]->p directly, call
+ * InvalidateIndex() afterwards. To query from several threads at once, call UpdateIndex() first.
  */
 
 PointSet::PointSet()
 {
+	index_dirty = true;
 }
 
 PointSet::~PointSet()
@@ -92,6 +301,7 @@ int PointSet::CopyFrom(PointSet *set, int with_info, int copy_method)
 		while (points.n > set->points.n) points.remove(points.n-1);
 	}
 
+	InvalidateIndex();
 	return n;
 }
 
@@ -150,11 +360,13 @@ static int cmp_YDescending(const void *v1,const void *v2)
 void PointSet::SortX(bool ascending)
 {
 	qsort(points.e, points.n, sizeof(PointSet::PointObj*), ascending ? cmp_XAscending : cmp_XDescending);
+	InvalidateIndex();
 }
 
 void PointSet::SortY(bool ascending)
 {
 	qsort(points.e, points.n, sizeof(PointSet::PointObj*), ascending ? cmp_YAscending : cmp_YDescending);
+	InvalidateIndex();
 }
 
 void PointSet::CreateRandomPoints(int num, int seed, double minx, double maxx, double miny, double maxy)
@@ -311,6 +523,7 @@ flatpoint PointSet::Point(flatpoint newPos, int index, ...)
 {
 	if (index < 0 || index >= points.n) return flatpoint();
 	points.e[index]->p = newPos;
+	InvalidateIndex();
 	return newPos;
 }
 
@@ -328,6 +541,7 @@ int PointSet::Map(std::function<int(const flatpoint &p, flatpoint &newp)> adjust
 			n++;
 		}
 	}
+	if (n) InvalidateIndex();
 	return n;
 }
 
@@ -336,16 +550,19 @@ int PointSet::Map(std::function<int(const flatpoint &p, flatpoint &newp)> adjust
 
 int PointSet::Insert(int where, flatpoint p, anObject *data, bool absorb, double weight, double radius)
 {
+	InvalidateIndex();
 	return points.push(newPointObj(p,data,absorb,weight,radius), -1, where);
 }
 
 int PointSet::AddPoint(flatpoint p, anObject *data, bool absorb, double weight, double radius)
 {
+	InvalidateIndex();
 	return points.push(newPointObj(p,data,absorb,weight,radius));
 }
 
 int PointSet::Remove(int index)
 {
+	InvalidateIndex();
 	return points.remove(index);
 }
 
@@ -417,6 +634,7 @@ flatpoint PointSet::Pop(int which, anObject **data_ret)
 		*data_ret = points.e[which]->info;
 		if (*data_ret) (*data_ret)->inc_count();
 		points.remove(which);
+		InvalidateIndex();
 	}
 
 	return p;
@@ -426,6 +644,7 @@ int PointSet::Swap(int index1, int index2)
 {
 	if (index1<0 || index1 >= points.n || index2 < 0 || index2 >= points.n) return 1;
 	points.swap(index1, index2);
+	InvalidateIndex();
 	return 0;
 }
 
@@ -433,29 +652,55 @@ int PointSet::Slide(int index1, int index2)
 {
 	if (index1<0 || index1 >= points.n || index2 < 0 || index2 >= points.n) return 1;
 	points.slide(index1, index2);
+	InvalidateIndex();
 	return 0;
 }
 
 void PointSet::Flush()
 {
 	points.flush();
+	InvalidateIndex();
 }
 
 //--------------------------- Info ---------------------
 
+//! Rebuild the k-d tree used for point queries, if points have changed since the last build.
+void PointSet::UpdateIndex()
+{
+	if (!index_dirty) return;
+
+	std::vector<flatpoint> pts(points.n);
+	for (int c=0; c<points.n; c++) pts[c] = points.e[c]->p;
+	kdtree.Build(pts.data(), points.n);
+	index_dirty = false;
+}
+
+//! Return the index of the point closest to to_this, or -1 if there are no points.
 int PointSet::Closest(flatpoint to_this)
 {
-	double d=1e+100;
-	double dd;
-	int i = -1;
-	for (int c=0; c<points.n; c++) {
-		dd = norm2(points.e[c]->p - to_this);
-		if (dd < d) {
-			d = dd;
-			i = c;
-		}
-	}
-	return i;
+	UpdateIndex();
+	return kdtree.Closest(to_this);
+}
+
+/*! Find up to k points closest to to_this, nearest first, putting their indices in indices_ret,
+ * and their distances in dists_ret if not null. Both must have room for k.
+ * Returns the number found.
+ */
+int PointSet::KClosest(flatpoint to_this, int k, int *indices_ret, double *dists_ret)
+{
+	UpdateIndex();
+	int n = kdtree.KClosest(to_this, k, indices_ret, dists_ret);
+	if (dists_ret) for (int c=0; c<n; c++) dists_ret[c] = sqrt(dists_ret[c]);
+	return n;
+}
+
+/*! Append to indices_ret the indices of all points within radius of p, in no particular order.
+ * Returns the number appended.
+ */
+int PointSet::WithinRadius(flatpoint p, double radius, std::vector<int> &indices_ret)
+{
+	UpdateIndex();
+	return kdtree.WithinRadius(p, radius, indices_ret);
 }
 
 /*! Return evenly weighted average of all the points.
@@ -480,106 +725,206 @@ void PointSet::GetBBox(DoubleBBox &box)
 
 //------------------ Operations ----------------------------
 
+//! Push on a point from another that is v away, as used by Relax(). first is whether the point comes first in the set.
+static inline flatpoint relax_force(flatpoint v, bool first, double mindist, double damp)
+{
+	flatpoint force;
+	double dd = norm(v);
+	if (dd < 1e-7) { dd = 1e-7; v.set(first ? 1 : -1, 0); }
+	else v /= dd;
+
+	 // apply strong force
+	if (dd < mindist) force += (mindist - dd) * damp * v;
+
+	 // apply "gravity" force: G m1 m2 / r^2
+	if (dd > mindist/2) force += damp * mindist*mindist*mindist *1. / (dd*dd) * v;
+
+	return force;
+}
+
 /*! Relax trying to maintain at least mindist between points, but also try to
  * stay contained within original bounding box.
+ *
+ * Each pair of points pushes apart, strongly within mindist, and with a weaker 1/d^2 force
+ * past mindist/2. Forces are computed per point across the default ThreadPool.
+ *
+ * If cutoff<=0, every pair interacts, which takes O(n^2) per iteration. If cutoff>0, only pairs
+ * closer than cutoff interact, found with a uniform grid of cutoff sized cells, so each iteration
+ * is about linear in the number of points. This leaves out the small push from far points,
+ * so results differ from the unlimited version. Something like 4*mindist works well.
  */
-void PointSet::Relax(int maxiterations, double mindist, double damp, DoubleBBox box)
+void PointSet::Relax(int maxiterations, double mindist, double damp, DoubleBBox box, double cutoff)
 {
 	if (points.n < 1) return;
 
-	flatpoint p1,p2, v, force;
-	double dd;
+	std::vector<flatpoint> forces(points.n);
 
-	// double ff=1; //force multiplier
-	
-	// DoubleBBox box;
-	// GetBBox(box);
-	// flatpoint pts[4];
-	// pts[0] = flatpoint(box.minx, box.miny);
-	// pts[1] = flatpoint(box.maxx, box.miny);
-	// pts[2] = flatpoint(box.maxx, box.maxy);
-	// pts[3] = flatpoint(box.minx, box.maxy);
-
-	flatpoint cc1,cc2;
-	flatpoint d;
-	// double w,h; //, w2,h2;
-	flatpoint dims[points.n];
-	// flatpoint centers[points.n];
-	flatpoint forces[points.n];
-	// double distbtwn;
+	ThreadPool *threads = ThreadPool::GetDefault();
+	int grain = points.n/(8*(threads->NumThreads()+1));
+	if (grain < 1) grain = 1;
 
-	for (int c=0; c<points.n; c++) {
-		dims[c].x = dims[c].y = 0;
-		// centers[c] = points.e[c]->p;
-	}
-	
-	for (int iterations=0; iterations<maxiterations; iterations++) {
-		for (int c=0; c<points.n; c++) forces[c].set(0,0);
+	if (cutoff <= 0) {
+		std::vector<flatpoint> pts(points.n);
 
-		for (int c=0; c<points.n; c++) {
-			cc1 = points.e[c]->p;
-			// w   = dims[c].x;
-			// h   = dims[c].y;
-			d.x = d.y = 0;
-
-			force = flatpoint(0, 0);
-			// p1    = cc1 - flatpoint(w / 2, h / 2);
-			// p2    = cc1 + flatpoint(w / 2, h / 2);
-
-
-			for (int c2 = c+1; c2<points.n; c2++) {
-				force.set(0,0);
-
-				// WidthHeight(selection->e(c2), flatpoint(1, 0), flatpoint(0, 1), &w2, &h2, &cc2);
-				cc2 = points.e[c2]->p;
-				v   = cc1 - cc2;
-				dd  = norm(v);
-				v.normalize();
-				if (dd < 1e-7) { dd = 1e-7; v.set(1,0); }
-
-				// distbtwn = rect_radius(cc1, w, h, dist) + rect_radius(cc2, w2, h2, dist);
-				// distbtwn = dd;
-				// if (dd < 2 * (mindist + distbtwn)) force -= ff * v / (dd * dd);
-				// if (dd < (mindist + distbtwn)) force -= 3 * (ff * v / (dd * dd));
-				
-				// apply strong force
-				if (dd < mindist) force += (mindist - dd) * damp * v;
-
-				// apply "gravity" force: G m1 m2 / r^2
-				if (dd > mindist/2) force += damp * mindist*mindist*mindist *1. / (dd*dd) * v;
-				//----
-				// double fd = (2 * mindist - dd) * damp;
-				// if (fd > 0) force += fd * v;
-				
-				forces[c]  += force;
-				forces[c2] -= force;
-			}
+		for (int iterations=0; iterations<maxiterations; iterations++) {
+			for (int c=0; c<points.n; c++) pts[c] = points.e[c]->p;
 
-			// // go toward original bounding box if outside
-			//  *** this sucks because bounding box changes each time this func called
-			// if (!point_is_in(cc1, pts,4)) {
-			// 	// if (cc1.x < box.minx) force += flatpoint(box.minx - cc1.x, 0);
-			// 	// else if (cc1.x > box.maxx) force += flatpoint(box.maxx - cc1.x, 0);
-			// 	// if (cc1.y < box.miny) force += flatpoint(0, box.miny - cc1.y);
-			// 	// else if (cc1.y > box.maxy) force += flatpoint(0, box.maxy - cc1.y);
-			// 	//------
-			// 	v = datac - cc1;
-			// 	forces[c] += v / norm(v) * damp;
-			// }
+			if (threads->NumThreads() == 0) {
+				 //no other threads, so do each pair only once
+				for (int c=0; c<points.n; c++) forces[c].set(0,0);
+				for (int c=0; c<points.n; c++) {
+					for (int c2=c+1; c2<points.n; c2++) {
+						flatpoint force = relax_force(pts[c] - pts[c2], true, mindist, damp);
+						forces[c]  += force;
+						forces[c2] -= force;
+					}
+				}
+
+			} else threads->ParallelFor(0, points.n, [&](int c, int thread) {
+				flatpoint cc1 = pts[c];
+				flatpoint force;
+				for (int c2=0; c2<points.n; c2++) {
+					if (c2 != c) force += relax_force(cc1 - pts[c2], c < c2, mindist, damp);
+				}
+				forces[c] = force;
+			}, grain);
 
+			for (int c=0; c<points.n; c++) {
+				points.e[c]->p += forces[c];
+			}
 		}
 
+		InvalidateIndex();
+		return;
+	}
+
+	double cutoff2 = cutoff*cutoff;
+	PointGrid grid;
+
+	for (int iterations=0; iterations<maxiterations; iterations++) {
+		grid.Build(points, cutoff);
+		int reach = ceil(cutoff / grid.cell);
+
+		 //go in grid order, so neighboring threads work on neighboring cells
+		threads->ParallelFor(0, points.n, [&](int o, int thread) {
+			int c = grid.order[o];
+			flatpoint cc1 = grid.pts[o];
+			flatpoint force, v;
+			int cx = grid.CellX(cc1.x), cy = grid.CellY(cc1.y);
+
+			for (int y = cy-reach; y <= cy+reach; y++) {
+				if (y < 0 || y >= grid.height) continue;
+				for (int x = cx-reach; x <= cx+reach; x++) {
+					if (x < 0 || x >= grid.width) continue;
+
+					int cl = y*grid.width + x;
+					for (int i = grid.cellstart[cl]; i < grid.cellstart[cl+1]; i++) {
+						if (i == o) continue;
+
+						v = cc1 - grid.pts[i];
+						if (norm2(v) > cutoff2) continue;
+						force += relax_force(v, c < grid.order[i], mindist, damp);
+					}
+				}
+			}
+
+			forces[c] = force;
+		}, grain);
+
 		for (int c=0; c<points.n; c++) {
 			points.e[c]->p += forces[c];
 		}
 	}
+
+	InvalidateIndex();
 }
 
 /*! Make points be point->weight radius away from each other. Optional boundary.
+ *
+ * Each point has radius weightscale * point->weight. Overlapping pairs push each other apart by
+ * damp times half the overlap per iteration. If nboundary>2, points that leave the boundary
+ * polygon are pulled back onto its closest edge. Pairs are found with a uniform grid like Relax().
  */
 void PointSet::RelaxWeighted(int maxiterations, double weightscale, double damp, flatpoint *boundary, int nboundary)
 {
-	cerr << " *** IMPLEMENT PointSet::RelaxWeighted()!!!"<<endl;
+	if (points.n < 1) return;
+
+	double maxr = 0;
+	for (int c=0; c<points.n; c++) {
+		double r = fabs(weightscale * points.e[c]->weight);
+		if (r > maxr) maxr = r;
+	}
+	if (maxr <= 0) return;
+
+	std::vector<flatpoint> moves(points.n);
+	PointGrid grid;
+
+	ThreadPool *threads = ThreadPool::GetDefault();
+	int grain = points.n/(8*(threads->NumThreads()+1));
+	if (grain < 1) grain = 1;
+
+	for (int iterations=0; iterations<maxiterations; iterations++) {
+		grid.Build(points, 2*maxr);
+		int reach = ceil(2*maxr / grid.cell);
+
+		threads->ParallelFor(0, points.n, [&](int o, int thread) {
+			int c = grid.order[o];
+			flatpoint cc1 = grid.pts[o];
+			double r1 = fabs(weightscale * points.e[c]->weight);
+			flatpoint move, v;
+			double dd, target;
+			int cx = grid.CellX(cc1.x), cy = grid.CellY(cc1.y);
+
+			for (int y = cy-reach; y <= cy+reach; y++) {
+				if (y < 0 || y >= grid.height) continue;
+				for (int x = cx-reach; x <= cx+reach; x++) {
+					if (x < 0 || x >= grid.width) continue;
+
+					int cl = y*grid.width + x;
+					for (int i = grid.cellstart[cl]; i < grid.cellstart[cl+1]; i++) {
+						if (i == o) continue;
+						int c2 = grid.order[i];
+
+						v  = cc1 - grid.pts[i];
+						target = r1 + fabs(weightscale * points.e[c2]->weight);
+						dd = norm2(v);
+						if (dd >= target*target) continue;
+						dd = sqrt(dd);
+						if (dd < 1e-7) { dd = 1e-7; v.set(c < c2 ? 1 : -1, 0); }
+						else v /= dd;
+
+						move += (target - dd) / 2 * damp * v;
+					}
+				}
+			}
+
+			moves[c] = move;
+		}, grain);
+
+		for (int c=0; c<points.n; c++) {
+			flatpoint p = points.e[c]->p + moves[c];
+
+			if (nboundary > 2 && !point_is_in(p, boundary, nboundary)) {
+				 //snap to closest point on boundary
+				double d = 1e+300, dd;
+				flatpoint closest = p, pp;
+				for (int b=0; b<nboundary; b++) {
+					flatpoint a = boundary[b], v = boundary[(b+1)%nboundary] - a;
+					double len2 = norm2(v);
+					double t = len2 > 0 ? ((p - a) * v) / len2 : 0;
+					if (t < 0) t = 0; else if (t > 1) t = 1;
+					pp = a + t*v;
+					dd = norm2(p - pp);
+					if (dd < d) { d = dd; closest = pp; }
+				}
+				p = closest;
+			}
+
+			points.e[c]->p = p;
+		}
+	}
+
+	InvalidateIndex();
 }
 
 void PointSet::MovePoints(double dx, double dy)
@@ -594,14 +939,64 @@ void PointSet::Shuffle()
 		i = c * (double)random()/RAND_MAX;
 		points.swap(c,i);
 	}
+	InvalidateIndex();
 }
 
-/*! For each point p, set p->info to the index of next hull point, or -1 if not a hull point.
+/*! Append the convex hull of the points to add_to_this, or to a new PointSet if add_to_this is null.
+ * Hull points are counterclockwise (with +y up), starting from the point with the lowest x,
+ * and carry the same info, weight, and radius as the originals. Collinear points along
+ * hull edges are left out, and of coincident points only the first is used, so if all points
+ * are in the same place, the hull is a single point.
+ *
+ * This uses Andrew's monotone chain, so takes O(n log n).
+ * Returns the set added to, or nullptr if there are no points.
  */
 PointSet *PointSet::ConvexHull(PointSet *add_to_this)
 {
-	cerr << " *** IMPLEMENT PointSet::ConvexHull()!!!"<<endl;
-	return nullptr;
+	if (points.n < 1) return nullptr;
+
+	std::vector<int> sorted(points.n);
+	for (int c=0; c<points.n; c++) sorted[c] = c;
+	std::stable_sort(sorted.begin(), sorted.end(), [&](int i1, int i2) {
+			const flatpoint &p1 = points.e[i1]->p, &p2 = points.e[i2]->p;
+			return p1.x < p2.x || (p1.x == p2.x && p1.y < p2.y);
+		});
+
+	 //keep only the first of coincident points, else they end up on the hull more than once
+	sorted.erase(std::unique(sorted.begin(), sorted.end(), [&](int i1, int i2) {
+			return points.e[i1]->p == points.e[i2]->p;
+		}), sorted.end());
+	int n = sorted.size();
+
+	 //z of (b-a)x(c-a), positive for a left turn
+	auto cross = [&](int a, int b, int c) {
+		flatpoint pa = points.e[a]->p;
+		flatpoint v1 = points.e[b]->p - pa, v2 = points.e[c]->p - pa;
+		return v1.x*v2.y - v1.y*v2.x;
+	};
+
+	std::vector<int> hull(2*n);
+	int k = 0;
+
+	 //lower hull
+	for (int c=0; c<n; c++) {
+		while (k >= 2 && cross(hull[k-2], hull[k-1], sorted[c]) <= 0) k--;
+		hull[k++] = sorted[c];
+	}
+
+	 //upper hull
+	for (int c=n-2, t=k+1; c>=0; c--) {
+		while (k >= t && cross(hull[k-2], hull[k-1], sorted[c]) <= 0) k--;
+		hull[k++] = sorted[c];
+	}
+	if (k > 1) k--; //last point is the same as the first
+
+	PointSet *set = add_to_this ? add_to_this : new PointSet();
+	for (int c=0; c<k; c++) {
+		PointObj *o = points.e[hull[c]];
+		set->AddPoint(o->p, o->info, false, o->weight, o->radius);
+	}
+	return set;
 }
 
 int PointSet::LoadCSV(const char *file, bool has_headers, const char *xcolumn, const char *ycolumn)
@@ -32,6 +32,7 @@
 #include <lax/colors.h>
 
 #include <functional>
+#include <vector>
 
 
 namespace Laxkit {
@@ -102,6 +103,33 @@ class PointCollection
 };
 
 
+//---------------------------------- PointKDTree ---------------------------------
+
+class PointKDTree
+{
+  protected:
+	struct Node {
+		flatpoint p;
+		int index; //into the points passed to Build()
+	};
+	std::vector<Node> nodes; //tree order, node for range [lo,hi) is at (lo+hi)/2
+	std::vector<char> axis;  //split axis of each node, 0 for x, 1 for y
+
+	void Build(int lo, int hi);
+	void Closest(int lo, int hi, flatpoint p, int &best, double &bestd) const;
+	void KClosest(int lo, int hi, flatpoint p, int k, std::vector<std::pair<double,int>> &heap) const;
+	void WithinRadius(int lo, int hi, flatpoint p, double r2, std::vector<int> &indices_ret) const;
+
+  public:
+	void Build(const flatpoint *points, int n);
+	void Clear();
+	int NumPoints() const { return nodes.size(); }
+	int Closest(flatpoint p, double *dist2_ret = nullptr) const;
+	int KClosest(flatpoint p, int k, int *indices_ret, double *dist2_ret = nullptr) const;
+	int WithinRadius(flatpoint p, double radius, std::vector<int> &indices_ret) const;
+};
+
+
 //---------------------------------- class PointSet ---------------------------------
 
 
@@ -126,6 +154,12 @@ class PointSet : public PointCollection, virtual public anObject, virtual public
 
 	Laxkit::PtrStack<PointObj> points;
 
+  protected:
+	PointKDTree kdtree; //built on demand by UpdateIndex()
+	bool index_dirty;
+
+  public:
+
 	Utf8String name; //user made descriptive name, different than Id()
 
 	PointSet();
@@ -151,6 +185,10 @@ class PointSet : public PointCollection, virtual public anObject, virtual public
 
 	// info
 	virtual int Closest(flatpoint to_this);
+	virtual int KClosest(flatpoint to_this, int k, int *indices_ret, double *dists_ret = nullptr);
+	virtual int WithinRadius(flatpoint p, double radius, std::vector<int> &indices_ret);
+	virtual void UpdateIndex();
+	virtual void InvalidateIndex() { index_dirty = true; }
 	virtual flatpoint Barycenter();
 	virtual void GetBBox(DoubleBBox &box);
 
@@ -180,7 +218,7 @@ class PointSet : public PointCollection, virtual public anObject, virtual public
 	virtual void SamplePoissonPoints(int seed, LaxImage *img, bool invert, double min_radius, double max_radius);
 
 	// operations
-	virtual void Relax(int maxiterations, double mindist, double damp, DoubleBBox box);
+	virtual void Relax(int maxiterations, double mindist, double damp, DoubleBBox box, double cutoff = 0);
 	virtual void RelaxWeighted(int maxiterations, double weightscale, double damp, flatpoint *boundary, int nboundary);
 	virtual void MovePoints(double dx, double dy);
 	virtual void Shuffle();
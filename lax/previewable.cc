@@ -21,6 +21,7 @@
 //
 
 #include <lax/previewable.h>
+#include <lax/previewqueue.h>
 
 #include <iostream>
 using namespace std;
@@ -41,6 +42,7 @@ Previewable::Previewable()
 {
 	preview    = NULL;
 	previewtime= 0; //times() at which preview was last rendered
+	preview_queued = false;
     modtime    = 0; //times() of most recent modification that should trigger a preview rerender
 }
 
@@ -51,33 +53,66 @@ Previewable::~Previewable()
 
 /*! Call this whenever there's reason to think the preview needs to be updated.
  * Sets modtime to be the current time, but does NOT actually do a preview render.
+ * Any queued preview render is cancelled, since it would be out of date.
  */
 void Previewable::touchContents()
 {
     previewtime = 0;
     tms tms_;
     modtime     = times(&tms_);
+
+	if (preview_queued) {
+		PreviewQueue *queue = PreviewQueue::GetDefault(false);
+		if (queue) queue->Cancel(this);
+		else preview_queued = false;
+	}
 }
 
+/*! Return preview, rendering a new one first if it is out of date.
+ *
+ * If there is a default PreviewQueue and CanRenderPreviewAsync(), then the render is
+ * queued instead, and the old preview is returned, or the queue's placeholder if there
+ * is no old preview.
+ */
 LaxImage *Previewable::GetPreview()
 {
-	if (previewtime < modtime || !preview || (modtime == 0 && previewtime == 0)) GeneratePreview(-1,-1);
+	if (previewtime < modtime || !preview || (modtime == 0 && previewtime == 0)) {
+		PreviewQueue *queue = CanRenderPreviewAsync() ? PreviewQueue::GetDefault(false) : nullptr;
+		if (queue) {
+			queue->Queue(this, -1,-1);
+			if (!preview) return queue->Placeholder();
+		} else GeneratePreview(-1,-1);
+	}
     return preview;
 }
 
+/*! Return a new copy of this object for a PreviewQueue job to render on a worker thread,
+ * so that the event thread is free to change or delete this one meanwhile. Called on the
+ * event thread. The queue dec_counts the copy when the job is done.
+ *
+ * Default is to return duplicate(), if that is a Previewable. Return nullptr to have
+ * the queue render this object on the event thread instead.
+ */
+Previewable *Previewable::PreviewSnapshot()
+{
+	anObject *obj = duplicate();
+	if (!obj) return nullptr;
+
+	Previewable *snapshot = dynamic_cast<Previewable*>(obj);
+	if (!snapshot) obj->dec_count();
+	return snapshot;
+}
+
 int Previewable::maxPreviewSize()
 {
 	return 256;
 } 
 
-/*! Set up a LaxImage to hold a preview, then call renderToBufferImage() to
- * actually render the preview.
+/*! Adjust width and height to the size a new preview should be. Either may be <= 0,
+ * to be figured out from the bounds and maxPreviewSize().
  */
-int Previewable::GeneratePreview(int ww, int hh)
+void Previewable::PreviewDimensions(int &w, int &h)
 {
-	int w = ww;
-	int h = hh;
-
     int maxdim = maxPreviewSize();
 	if (w <= 0 && h <= 0) {
         if (maxx - minx > maxy - miny) w = maxdim;
@@ -116,6 +151,16 @@ int Previewable::GeneratePreview(int ww, int hh)
 		w = maxdim * aspect;
 		if (w <= 0) w = 1;
 	}
+}
+
+/*! Set up a LaxImage to hold a preview, then call renderToBufferImage() to
+ * actually render the preview.
+ */
+int Previewable::GeneratePreview(int ww, int hh)
+{
+	int w = ww;
+	int h = hh;
+	PreviewDimensions(w, h);
 
 	//if (preview && (w!=preview->w() || h!=preview->h())) {
     if (preview && ((float)w/preview->w()>1.05 || (float)w/preview->w()<.95 ||
@@ -40,12 +40,16 @@ class Previewable : virtual public anObject, virtual public DoubleBBox
 
 	LaxImage *preview;
 	std::clock_t previewtime;
+	bool preview_queued; //!< Whether the default PreviewQueue has a job for this object
 
 	virtual void touchContents();
 	virtual bool HasOldPreview() { return modtime > previewtime; }
 	virtual bool CanRenderPreview() { return false; } // whether renderToBufferImage() should work
+	virtual bool CanRenderPreviewAsync() { return false; } // whether renderToBufferImage() is safe on a worker thread
+	virtual Previewable *PreviewSnapshot();
 	virtual LaxImage *GetPreview();
 	virtual int GeneratePreview(int width, int height);
+	virtual void PreviewDimensions(int &width, int &height);
 
 	virtual int renderToBufferImage(LaxImage *image) = 0; //return 0 for success
 	virtual int maxPreviewSize();
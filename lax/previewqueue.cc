@@ -0,0 +1,376 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+
+#include <lax/previewqueue.h>
+#include <lax/anxapp.h>
+
+#include <sys/times.h>
+#include <cstring>
+
+#include <iostream>
+using namespace std;
+#define DBG
+
+
+namespace Laxkit {
+
+
+//! Displayer for the preview job running on this thread, if any.
+static thread_local Displayer *job_displayer = nullptr;
+
+
+//---------------------------- PreviewJob --------------------------------------
+
+PreviewQueue::PreviewJob::PreviewJob(Previewable *obj, int w, int h, unsigned long notify_object)
+{
+	object    = obj;
+	snapshot  = nullptr;
+	image     = nullptr;
+	dp        = nullptr;
+	width     = w;
+	height    = h;
+	notify    = notify_object;
+	cancelled = false;
+	status    = -1;
+
+	object->inc_count();
+}
+
+PreviewQueue::PreviewJob::~PreviewJob()
+{
+	if (image) image->dec_count();
+	if (snapshot) snapshot->dec_count();
+	object->dec_count();
+}
+
+
+//---------------------------- PreviewQueue --------------------------------------
+/*! \class PreviewQueue
+ * \brief Render Previewable::preview images on worker threads.
+ *
+ * Previewable::GetPreview() uses the default queue when one exists, and the object's
+ * CanRenderPreviewAsync() returns true. Instead of rendering right away, the object is
+ * queued, and GetPreview() returns the last good preview, or Placeholder() if there is none yet.
+ *
+ * Each job renders into its own new LaxImage. Workers never touch the queued object itself.
+ * When the job starts, the object is copied with Previewable::PreviewSnapshot() on the event
+ * thread, and the worker renders the copy, which is released when the job is collected.
+ * Objects that can't make a snapshot are rendered on the event thread when their job starts.
+ * Objects that draw with a Displayer should use JobDisplayer(), which is a Displayer
+ * private to the job. At most max_running jobs
+ * are handed to the ThreadPool at once, so the rest can be dropped cheaply when
+ * Previewable::touchContents() cancels them.
+ *
+ * Finished jobs are collected on the event thread, via a "previewDone" message to
+ * the queue itself, or by calling ProcessFinished() when there is no anXApp. If not
+ * cancelled, the new image replaces the object's preview, and a SimpleMessage "previewReady"
+ * is sent to the job's notify object and every listener, with the Previewable as its object.
+ *
+ * Aside from JobDisplayer(), everything here must be called from the event thread.
+ */
+
+
+PreviewQueue *PreviewQueue::default_queue = nullptr;
+
+/*! Return the process wide queue, creating it if necessary and create_if_null.
+ * Note that Previewable::GetPreview() only checks for an existing default, so previews
+ * render synchronously until something creates one.
+ */
+PreviewQueue *PreviewQueue::GetDefault(bool create_if_null)
+{
+	if (!default_queue && create_if_null) {
+		default_queue = new PreviewQueue;
+	}
+	return default_queue;
+}
+
+/*! If you pass in NULL, it will dec_count the old one.
+ * The count on nqueue will be incremented.
+ */
+void PreviewQueue::SetDefault(PreviewQueue *nqueue)
+{
+	if (nqueue == default_queue) return;
+
+	if (default_queue) default_queue->dec_count();
+	default_queue = nqueue;
+	if (default_queue) default_queue->inc_count();
+}
+
+/*! Return the Displayer to use for the preview job running in the current thread,
+ * or nullptr if the current thread is not running a preview job.
+ */
+Displayer *PreviewQueue::JobDisplayer()
+{
+	return job_displayer;
+}
+
+/*! If npool is null, use ThreadPool::GetDefault(). If nmax_running <= 0, allow as many
+ * jobs at once as the pool has threads.
+ */
+PreviewQueue::PreviewQueue(ThreadPool *npool, int nmax_running)
+{
+	pool = npool ? npool : ThreadPool::GetDefault();
+	pool->inc_count();
+
+	max_running = nmax_running > 0 ? nmax_running : pool->NumThreads();
+	if (max_running <= 0) max_running = 1;
+	running = 0;
+
+	placeholder = nullptr;
+}
+
+/*! Waits for jobs already running to finish, then discards everything.
+ */
+PreviewQueue::~PreviewQueue()
+{
+	for (auto &entry : jobs) entry.first->preview_queued = false;
+	jobs.clear();
+	for (auto job : waiting) Release(job);
+	waiting.clear();
+
+	{
+		std::unique_lock<std::mutex> lock(finished_mutex);
+		finished_changed.wait(lock, [this] { return (int)finished.size() == running; });
+	}
+	for (auto job : finished) Release(job);
+	finished.clear();
+	running = 0;
+
+	for (auto dp : idle_displayers) dp->dec_count();
+	if (placeholder) placeholder->dec_count();
+	pool->dec_count();
+}
+
+int PreviewQueue::Event(const EventData *data, const char *mes)
+{
+	if (!strcmp(mes, "previewDone")) {
+		ProcessFinished();
+		return 0;
+	}
+
+	return EventReceiver::Event(data, mes);
+}
+
+/*! Queue up a render of obj's preview, at width x height, adjusted as for
+ * Previewable::GeneratePreview(). When done, notify_object, if any, is sent a "previewReady"
+ * in addition to any listeners.
+ *
+ * If obj already has a job that has not been cancelled, nothing new is queued.
+ *
+ * Return 0 for queued, 1 for already queued, or -1 for obj can't render previews.
+ */
+int PreviewQueue::Queue(Previewable *obj, int width, int height, unsigned long notify_object)
+{
+	if (!obj || !obj->CanRenderPreview()) return -1;
+
+	auto found = jobs.find(obj);
+	if (found != jobs.end()) {
+		if (notify_object && !found->second->notify) found->second->notify = notify_object;
+		return 1;
+	}
+
+	obj->PreviewDimensions(width, height);
+
+	PreviewJob *job = new PreviewJob(obj, width, height, notify_object);
+	jobs[obj] = job;
+	waiting.push_back(job);
+	obj->preview_queued = true;
+
+	StartJobs();
+	return 0;
+}
+
+/*! Stop any job for obj. A job that is already rendering is allowed to finish, but
+ * its image will be thrown away.
+ * Returns 1 if there was a job to cancel, else 0.
+ */
+int PreviewQueue::Cancel(Previewable *obj)
+{
+	obj->preview_queued = false;
+
+	auto found = jobs.find(obj);
+	if (found == jobs.end()) return 0;
+	found->second->cancelled = true;
+	jobs.erase(found);
+	return 1;
+}
+
+//! Whether obj has an uncancelled job waiting or running.
+bool PreviewQueue::IsPending(Previewable *obj)
+{
+	return jobs.find(obj) != jobs.end();
+}
+
+/*! Hand waiting jobs to the pool, up to max_running at once. Cancelled jobs are discarded.
+ * Jobs whose object has no PreviewSnapshot() are rendered and delivered right here.
+ */
+void PreviewQueue::StartJobs()
+{
+	while (running < max_running && waiting.size()) {
+		PreviewJob *job = waiting.front();
+		waiting.pop_front();
+
+		if (job->cancelled) {
+			Release(job);
+			continue;
+		}
+
+		 //image and displayer are made here, since making them may not be thread safe
+		job->image = ImageLoader::NewImage(job->width, job->height);
+		if (!job->image) {
+			Cancel(job->object);
+			Release(job);
+			continue;
+		}
+
+		job->snapshot = job->object->PreviewSnapshot();
+		if (!job->snapshot) {
+			job->status = job->object->renderToBufferImage(job->image);
+			Deliver(job);
+			continue;
+		}
+
+		if (idle_displayers.size()) {
+			job->dp = idle_displayers.back();
+			idle_displayers.pop_back();
+		} else {
+			if (!newDisplayer) SetNewDisplayerFunc(nullptr);
+			job->dp = newDisplayer ? newDisplayer(nullptr) : nullptr;
+		}
+
+		running++;
+		unsigned long queue_id = object_id;
+
+		pool->Submit([this, job, queue_id]() {
+			if (!job->cancelled) {
+				job_displayer = job->dp;
+				job->status = job->snapshot->renderToBufferImage(job->image);
+				job_displayer = nullptr;
+			}
+
+			bool wasempty;
+			{
+				std::lock_guard<std::mutex> lock(finished_mutex);
+				wasempty = finished.empty();
+				finished.push_back(job);
+				finished_changed.notify_all();
+			}
+
+			 //don't touch this past here, the queue might be gone
+			if (wasempty && anXApp::app) {
+				anXApp::app->SendMessage(new SimpleMessage(), queue_id, "previewDone", 0);
+			}
+		});
+	}
+}
+
+/*! Collect finished jobs, installing new previews, and notifying anyone interested.
+ * This is done automatically on "previewDone" messages. Returns number of previews delivered.
+ */
+int PreviewQueue::ProcessFinished()
+{
+	std::vector<PreviewJob*> done;
+	{
+		std::lock_guard<std::mutex> lock(finished_mutex);
+		done.swap(finished);
+		running -= done.size();
+	}
+
+	int n = 0;
+	for (auto job : done) {
+		if (!job->cancelled && job->status == 0) n++;
+		Deliver(job);
+	}
+
+	StartJobs();
+	return n;
+}
+
+/*! Install job's image as the object's preview, unless cancelled or failed. Job is then released.
+ */
+void PreviewQueue::Deliver(PreviewJob *job)
+{
+	Previewable *obj = job->object;
+
+	auto found = jobs.find(obj);
+	if (found != jobs.end() && found->second == job) {
+		jobs.erase(found);
+		obj->preview_queued = false;
+	}
+
+	if (!job->cancelled && job->status == 0) {
+		if (obj->preview) obj->preview->dec_count();
+		obj->preview = job->image;
+		job->image = nullptr;
+		tms tms_;
+		obj->previewtime = times(&tms_);
+
+		if (anXApp::app) {
+			for (int c=0; c<listeners.n; c++) {
+				anXApp::app->SendMessage(new SimpleMessage(obj), listeners.e[c], "previewReady", object_id);
+			}
+			if (job->notify && listeners.findindex(job->notify) < 0) {
+				anXApp::app->SendMessage(new SimpleMessage(obj), job->notify, "previewReady", object_id);
+			}
+		}
+
+	} else if (!job->cancelled) {
+		DBG cerr << "PreviewQueue: preview render failed for "<<obj->whattype()<<", status "<<job->status<<endl;
+	}
+
+	Release(job);
+}
+
+//! Return job's displayer to the idle list, and delete job.
+void PreviewQueue::Release(PreviewJob *job)
+{
+	if (job->dp) idle_displayers.push_back(job->dp);
+	job->dp = nullptr;
+	delete job;
+}
+
+/*! Send "previewReady" to the object with id whenever a preview is delivered.
+ */
+void PreviewQueue::AddListener(unsigned long id)
+{
+	listeners.pushnodup(id);
+}
+
+void PreviewQueue::RemoveListener(unsigned long id)
+{
+	listeners.remove(listeners.findindex(id));
+}
+
+/*! Set the image returned by Previewable::GetPreview() while an object has no preview yet.
+ * Count of nplaceholder is incremented. Null means return nullptr instead.
+ */
+void PreviewQueue::Placeholder(LaxImage *nplaceholder)
+{
+	if (nplaceholder == placeholder) return;
+	if (placeholder) placeholder->dec_count();
+	placeholder = nplaceholder;
+	if (placeholder) placeholder->inc_count();
+}
+
+
+} //namespace Laxkit
+
@@ -0,0 +1,107 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+#ifndef _LAX_PREVIEWQUEUE_H
+#define _LAX_PREVIEWQUEUE_H
+
+
+#include <lax/previewable.h>
+#include <lax/displayer.h>
+#include <lax/threadpool.h>
+#include <lax/events.h>
+#include <lax/lists.h>
+
+#include <atomic>
+#include <unordered_map>
+
+
+namespace Laxkit {
+
+
+//---------------------------- PreviewQueue --------------------------------------
+class PreviewQueue : public EventReceiver
+{
+  private:
+	static PreviewQueue *default_queue;
+
+  protected:
+	class PreviewJob
+	{
+	  public:
+		Previewable *object;
+		Previewable *snapshot; //what the worker renders, so object may change meanwhile
+		LaxImage *image;
+		Displayer *dp;
+		int width, height;
+		unsigned long notify;
+		std::atomic<bool> cancelled;
+		int status;
+
+		PreviewJob(Previewable *obj, int w, int h, unsigned long notify_object);
+		~PreviewJob();
+	};
+
+	ThreadPool *pool;
+	int max_running;
+	int running; //jobs submitted to pool, but not yet delivered
+
+	std::unordered_map<Previewable*, PreviewJob*> jobs; //newest job per object, waiting or running
+	std::deque<PreviewJob*> waiting;
+	std::vector<Displayer*> idle_displayers;
+	NumStack<unsigned long> listeners;
+	LaxImage *placeholder;
+
+	 //finished is filled by workers, and emptied on the event thread
+	std::vector<PreviewJob*> finished;
+	std::mutex finished_mutex;
+	std::condition_variable finished_changed;
+
+	virtual void StartJobs();
+	virtual void Deliver(PreviewJob *job);
+	virtual void Release(PreviewJob *job);
+
+  public:
+	static PreviewQueue *GetDefault(bool create_if_null=true);
+	static void SetDefault(PreviewQueue *nqueue);
+	static Displayer *JobDisplayer();
+
+	PreviewQueue(ThreadPool *npool = nullptr, int nmax_running = 0);
+	virtual ~PreviewQueue();
+	virtual const char *whattype() { return "PreviewQueue"; }
+	virtual int Event(const EventData *data, const char *mes);
+
+	virtual int Queue(Previewable *obj, int width, int height, unsigned long notify_object = 0);
+	virtual int Cancel(Previewable *obj);
+	virtual bool IsPending(Previewable *obj);
+	virtual int NumPending() { return jobs.size(); }
+	virtual int ProcessFinished();
+
+	virtual void AddListener(unsigned long id);
+	virtual void RemoveListener(unsigned long id);
+	virtual LaxImage *Placeholder() { return placeholder; }
+	virtual void Placeholder(LaxImage *nplaceholder);
+};
+
+
+} //namespace Laxkit
+
+#endif
+
@@ -132,7 +132,7 @@ int PromptEdit::ProcessInput(const char *thisexpression)
 	newentry->inputstart=start;
 	newentry->inputlen=textlen-start;
 
-	if (thisexpression==NULL) thisexpression=thetext+start;
+	if (thisexpression==NULL) thisexpression=GetCText()+start;
 	//int local;
 	char *outexpres=process(thisexpression);
 
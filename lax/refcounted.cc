@@ -34,6 +34,9 @@ namespace Laxkit {
  *
  * Provides inc_count() and dec_count() for reference counting.
  * Objects are created with a count of 1.
+ *
+ * The count is atomic, so different threads can inc_count() and dec_count() the same object.
+ * Nothing else about the object is made thread safe by this.
  */
 	
 /*! \var int RefCounted::_count
@@ -50,6 +53,20 @@ RefCounted::RefCounted()
 	_count=1; 
 }
 
+//! A copy is a new object, so starts with a count of 1.
+RefCounted::RefCounted(const RefCounted &other)
+{
+	suppress_debug=other.suppress_debug;
+	_count=1;
+}
+
+//! Keeps this object's count.
+RefCounted &RefCounted::operator=(const RefCounted &other)
+{
+	suppress_debug=other.suppress_debug;
+	return *this;
+}
+
 
 //! Empty virtual destructor.
 RefCounted::~RefCounted()
@@ -63,11 +80,11 @@ RefCounted::~RefCounted()
  */
 int RefCounted::inc_count()
 {
-	_count++;
+	int c = ++_count;
 	DBG if (!suppress_debug) {
-	DBG   cerr <<"refcounted inc count, now: "<<_count<<endl;
+	DBG   cerr <<"refcounted inc count, now: "<<c<<endl;
 	DBG }
-	return _count; 
+	return c;
 }
 
 //! Decrement the count of the data, deleting if count is less than or equal to 0.
@@ -76,17 +93,18 @@ int RefCounted::inc_count()
  */
 int RefCounted::dec_count()
 {
-	_count--;
+	 //other threads might delete this as soon as the count goes down, so say so first
 	DBG if (!suppress_debug) {
-	DBG   cerr <<"refcounted dec count, now: "<<_count<<(_count==0?", deleting":"")<<endl;
+	DBG   int c = _count-1;
+	DBG   cerr <<"refcounted dec count, now: "<<c<<(c==0?", deleting":"")<<endl;
 	DBG }
 
-	if (_count<=0) {
-		int c=_count;
+	int c = --_count;
+	if (c<=0) {
 		delete this;
 		return c;
 	}
-	return _count; 
+	return c;
 }
 
 
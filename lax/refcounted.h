@@ -23,16 +23,21 @@
 #define _LAX_REFCOUNTED_H
 
 
+#include <atomic>
+
+
 namespace Laxkit {
 
 
 class RefCounted
 {
  protected:
-	int _count;
+	std::atomic<int> _count;
   public:
 	int suppress_debug;
 	RefCounted();
+	RefCounted(const RefCounted &other);
+	RefCounted &operator=(const RefCounted &other);
 	virtual ~RefCounted();
 	virtual int inc_count();
 	virtual int dec_count();
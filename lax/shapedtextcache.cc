@@ -0,0 +1,329 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+
+
+#include <lax/shapedtextcache.h>
+#include <lax/utf8utils.h>
+
+#include <harfbuzz/hb-ft.h>
+
+#include <cstring>
+
+#include <iostream>
+using namespace std;
+#define DBG
+
+
+namespace Laxkit {
+
+
+//---------------------------- ShapedRun --------------------------------------
+/*! \class ShapedRun
+ * \brief Glyphs for a single run of text, as held by a ShapedTextCache.
+ *
+ * Glyph x and y are positions relative to the start of the run, with harfbuzz offsets
+ * already applied, and y pointing down. x_offset and y_offset are left at 0.
+ */
+
+ShapedRun::ShapedRun()
+{
+	x_advance = y_advance = 0;
+	width = height = 0;
+	direction = HB_DIRECTION_INVALID;
+	language  = nullptr;
+	script    = HB_SCRIPT_UNKNOWN;
+}
+
+//! Approximate bytes used.
+long ShapedRun::Size()
+{
+	return sizeof(ShapedRun) + glyphs.capacity() * sizeof(GlyphPlace);
+}
+
+
+//---------------------------- ShapedTextCache --------------------------------------
+/*! \class ShapedTextCache
+ * \brief Least recently used cache of shaped glyph runs.
+ *
+ * Keys are binary strings built up with KeyAppend() and KeyFont(), and should include
+ * everything that the shaping depends on: font, size, variations, direction, and the text.
+ * Shape() builds such a key for harfbuzz shaping of a run and only shapes on a miss.
+ * Other users, like DisplayerCairo::textout_line(), can Find() and Add() their own runs,
+ * as long as their keys start with something distinct.
+ *
+ * Runs returned by Find(), Add() or Shape() are owned by the cache, and are only valid
+ * until the next Add(), Shape() or Flush(). Copy out what you need.
+ *
+ * When more than MaxBytes() are held, the least recently used runs are discarded.
+ * Hits() and Misses() count lookups since the last ResetStats().
+ *
+ * This is not thread safe. It is meant to be used from the event thread.
+ */
+
+
+ShapedTextCache *ShapedTextCache::default_cache = nullptr;
+
+/*! Return the process wide cache, creating it if necessary and create_if_null.
+ */
+ShapedTextCache *ShapedTextCache::GetDefault(bool create_if_null)
+{
+	if (!default_cache && create_if_null) {
+		default_cache = new ShapedTextCache;
+	}
+	return default_cache;
+}
+
+/*! If you pass in NULL, it will dec_count the old one.
+ * The count on ncache will be incremented.
+ */
+void ShapedTextCache::SetDefault(ShapedTextCache *ncache)
+{
+	if (ncache == default_cache) return;
+
+	if (default_cache) default_cache->dec_count();
+	default_cache = ncache;
+	if (default_cache) default_cache->inc_count();
+}
+
+ShapedTextCache::ShapedTextCache(long nmax_bytes)
+{
+	max_bytes = nmax_bytes;
+	bytes     = 0;
+	hits      = 0;
+	misses    = 0;
+
+	ft_face    = nullptr;
+	hb_font    = nullptr;
+	face_index = 0;
+	face_size  = 0;
+}
+
+ShapedTextCache::~ShapedTextCache()
+{
+	Flush();
+}
+
+//! Append raw bytes to key.
+void ShapedTextCache::KeyAppend(std::string &key, const void *data, int len)
+{
+	key.append((const char*)data, len);
+}
+
+//! Append font id, file, index, and any variations and features to key.
+void ShapedTextCache::KeyFont(std::string &key, LaxFont *font)
+{
+	int i = font->FontId();
+	KeyAppend(key, &i, sizeof(i));
+	i = font->FontIndex();
+	KeyAppend(key, &i, sizeof(i));
+	const char *file = font->FontFile();
+	if (file) KeyAppend(key, file, strlen(file) + 1);
+	else KeyAppend(key, "", 1);
+	font->VariationKey(key);
+}
+
+/*! Discard all runs, and release the shaping font.
+ */
+void ShapedTextCache::Flush()
+{
+	for (auto &entry : runs) delete entry.run;
+	runs.clear();
+	index.clear();
+	bytes = 0;
+
+	if (hb_font) { hb_font_destroy(hb_font); hb_font = nullptr; }
+	if (ft_face) { FT_Done_Face(ft_face);    ft_face = nullptr; }
+	face_file.SetToNone();
+}
+
+/*! Set maximum bytes to hold, discarding old runs if necessary.
+ */
+void ShapedTextCache::MaxBytes(long nmax_bytes)
+{
+	max_bytes = nmax_bytes;
+	Evict();
+}
+
+/*! Discard least recently used runs until under max_bytes. The most recent run is always kept.
+ */
+void ShapedTextCache::Evict()
+{
+	while (bytes > max_bytes && runs.size() > 1) {
+		Entry &entry = runs.back();
+		bytes -= entry.size;
+		index.erase(entry.key);
+		delete entry.run;
+		runs.pop_back();
+	}
+}
+
+/*! Return the run for key, or nullptr if not cached. Counts a hit or a miss.
+ */
+ShapedRun *ShapedTextCache::Find(const std::string &key)
+{
+	auto found = index.find(key);
+	if (found == index.end()) {
+		misses++;
+		return nullptr;
+	}
+
+	hits++;
+	if (found->second != runs.begin()) runs.splice(runs.begin(), runs, found->second);
+	return found->second->run;
+}
+
+/*! Take ownership of run, and store it for key, replacing any old run for key.
+ * Returns run.
+ */
+ShapedRun *ShapedTextCache::Add(const std::string &key, ShapedRun *run)
+{
+	auto found = index.find(key);
+	if (found != index.end()) {
+		bytes -= found->second->size;
+		delete found->second->run;
+		runs.erase(found->second);
+		index.erase(found);
+	}
+
+	Entry entry;
+	entry.key  = key;
+	entry.run  = run;
+	entry.size = run->Size() + 2*key.size() + 64; //key is in both runs and index
+	runs.push_front(entry);
+	index[key] = runs.begin();
+	bytes += entry.size;
+
+	Evict();
+	return run;
+}
+
+/*! Return a harfbuzz font for file at size, reusing the last one if possible.
+ */
+hb_font_t *ShapedTextCache::ShapingFont(FT_Library *ft_library, const char *file, int findex, double size)
+{
+	if (hb_font && face_file.Equals(file) && face_index == findex && face_size == size) return hb_font;
+
+	if (hb_font) { hb_font_destroy(hb_font); hb_font = nullptr; }
+	if (ft_face) { FT_Done_Face(ft_face);    ft_face = nullptr; }
+	face_file.SetToNone();
+
+	if (!ft_library || !file) return nullptr;
+	if (FT_New_Face(*ft_library, file, findex, &ft_face) != 0) {
+		ft_face = nullptr;
+		return nullptr;
+	}
+	FT_Set_Char_Size(ft_face, size*64, size*64, 0, 0);
+	hb_font = hb_ft_font_create(ft_face, nullptr);
+
+	face_file  = file;
+	face_index = findex;
+	face_size  = size;
+	return hb_font;
+}
+
+/*! Shape len bytes of utf8 text with harfbuzz, using font's file at size points,
+ * or return a previously cached run for the same.
+ *
+ * Any of dir, lang, or script that are HB_DIRECTION_INVALID, nullptr, or HB_SCRIPT_UNKNOWN
+ * are guessed from the text. What was actually used is stored in the run.
+ *
+ * Glyph positions and advances are in the same units as size. Returns nullptr if the
+ * font file could not be loaded.
+ */
+ShapedRun *ShapedTextCache::Shape(FT_Library *ft_library, LaxFont *font, double size,
+								  hb_direction_t dir, hb_language_t lang, hb_script_t script,
+								  const char *text, int len)
+{
+	if (!font || !text) return nullptr;
+	if (len < 0) len = strlen(text);
+
+	std::string key;
+	KeyAppend(key, "hb", 2);
+	KeyFont(key, font);
+	KeyAppend(key, &size,   sizeof(size));
+	KeyAppend(key, &dir,    sizeof(dir));
+	KeyAppend(key, &lang,   sizeof(lang));
+	KeyAppend(key, &script, sizeof(script));
+	KeyAppend(key, text, len);
+
+	ShapedRun *run = Find(key);
+	if (run) return run;
+
+	hb_font_t *hbfont = ShapingFont(ft_library, font->FontFile(), font->FontIndex(), size);
+	if (!hbfont) return nullptr;
+
+	 //create buffer and add text
+	hb_buffer_t *hb_buffer = hb_buffer_create();
+	hb_buffer_add_utf8(hb_buffer, text, len, 0, -1);
+
+	 //set direction, language, and script, guessing whatever we don't know
+	hb_segment_properties_t seg_properties;
+	if (dir == HB_DIRECTION_INVALID || lang == nullptr || script == HB_SCRIPT_UNKNOWN)
+		hb_buffer_guess_segment_properties(hb_buffer);
+	hb_buffer_get_segment_properties(hb_buffer, &seg_properties);
+	if (dir != HB_DIRECTION_INVALID) seg_properties.direction = dir;
+	if (lang != nullptr)             seg_properties.language  = lang;
+	if (script != HB_SCRIPT_UNKNOWN) seg_properties.script    = script;
+	hb_buffer_set_segment_properties(hb_buffer, &seg_properties);
+
+	 //Shape it!
+	hb_shape(hbfont, hb_buffer, nullptr, 0);
+
+	unsigned int numglyphs   = hb_buffer_get_length(hb_buffer);
+	hb_glyph_info_t *info    = hb_buffer_get_glyph_infos(hb_buffer, nullptr);     //points to inside hb_buffer
+	hb_glyph_position_t *pos = hb_buffer_get_glyph_positions(hb_buffer, nullptr); //points to inside hb_buffer
+
+	run = new ShapedRun;
+	run->direction = seg_properties.direction;
+	run->language  = seg_properties.language;
+	run->script    = seg_properties.script;
+	run->glyphs.resize(numglyphs);
+
+	double current_x = 0;
+	double current_y = 0;
+
+	for (unsigned int i = 0; i < numglyphs; i++) {
+		GlyphPlace &glyph = run->glyphs[i];
+
+		glyph.index     = info[i].codepoint;
+		glyph.cluster   = info[i].cluster;
+		glyph.x_advance = pos[i].x_advance / 64.;
+		glyph.y_advance = pos[i].y_advance / 64.;
+		glyph.x         =   current_x + pos[i].x_offset / 64.;
+		glyph.y         = -(current_y + pos[i].y_offset / 64.);
+		glyph.numchars  = get_num_chars(text, len, info[i].cluster, i == numglyphs-1 ? len : info[i+1].cluster);
+
+		current_x += glyph.x_advance;
+		current_y += glyph.y_advance;
+	}
+
+	run->x_advance = current_x;
+	run->y_advance = current_y;
+
+	hb_buffer_destroy(hb_buffer);
+
+	return Add(key, run);
+}
+
+
+} //namespace Laxkit
+
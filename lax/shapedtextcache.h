@@ -0,0 +1,117 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+#ifndef _LAX_SHAPEDTEXTCACHE_H
+#define _LAX_SHAPEDTEXTCACHE_H
+
+
+#include <lax/fontmanager.h>
+
+#include <string>
+#include <list>
+#include <unordered_map>
+
+
+namespace Laxkit {
+
+
+//---------------------------- ShapedRun --------------------------------------
+class ShapedRun
+{
+  public:
+	std::vector<GlyphPlace> glyphs;
+	double x_advance; //!< Sum of glyph advances
+	double y_advance;
+	double width;     //!< Ink extents, if known, else 0
+	double height;
+
+	 //segment properties used for shaping, which may have been guessed from the text
+	hb_direction_t direction;
+	hb_language_t  language;
+	hb_script_t    script;
+
+	ShapedRun();
+	long Size();
+};
+
+
+//---------------------------- ShapedTextCache --------------------------------------
+class ShapedTextCache : public anObject
+{
+  private:
+	static ShapedTextCache *default_cache;
+
+  protected:
+	struct Entry {
+		std::string key;
+		ShapedRun *run;
+		long size;
+	};
+	std::list<Entry> runs; //most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+	long max_bytes;
+	long bytes;
+	unsigned long hits;
+	unsigned long misses;
+
+	 //the last face shaped with, since consecutive runs usually use the same font
+	FT_Face ft_face;
+	hb_font_t *hb_font;
+	Utf8String face_file;
+	int face_index;
+	double face_size;
+
+	virtual hb_font_t *ShapingFont(FT_Library *ft_library, const char *file, int findex, double size);
+	virtual void Evict();
+
+  public:
+	static ShapedTextCache *GetDefault(bool create_if_null=true);
+	static void SetDefault(ShapedTextCache *ncache);
+
+	static void KeyAppend(std::string &key, const void *data, int len);
+	static void KeyFont(std::string &key, LaxFont *font);
+
+	ShapedTextCache(long nmax_bytes = 4*1024*1024);
+	virtual ~ShapedTextCache();
+	virtual const char *whattype() { return "ShapedTextCache"; }
+
+	virtual ShapedRun *Find(const std::string &key);
+	virtual ShapedRun *Add(const std::string &key, ShapedRun *run);
+	virtual ShapedRun *Shape(FT_Library *ft_library, LaxFont *font, double size,
+							 hb_direction_t dir, hb_language_t lang, hb_script_t script,
+							 const char *text, int len);
+	virtual void Flush();
+
+	virtual void MaxBytes(long nmax_bytes);
+	virtual long MaxBytes() { return max_bytes; }
+	virtual long Bytes() { return bytes; }
+	virtual int NumRuns() { return runs.size(); }
+	virtual unsigned long Hits() { return hits; }
+	virtual unsigned long Misses() { return misses; }
+	virtual void ResetStats() { hits = misses = 0; }
+};
+
+
+} //namespace Laxkit
+
+#endif
+
@@ -34,7 +34,7 @@ using namespace std;
 
 
 
- // thetext only reallocated when crossing block edges of size TEXTMEMBLOCK
+ // thetext grows by at least TEXTMEMBLOCK, or by half its current size for big texts
 #define TEXTMEMBLOCK 300
 
 
@@ -132,6 +132,20 @@ namespace Laxkit {
  * #define TEXT_CURS_PAST_NL        (1<<24)
  * \endcode
  *
+ * Besides the text itself, a sorted index of where the delimiters are is kept in linebreaks.
+ * This is updated incrementally with each insert or delete, so that WhichLine(), Getnlines(),
+ * GetNumLines() and findlinestart() are binary searches rather than scans of the whole text.
+ * Edits tend to cluster around the cursor, so the index keeps a pending offset (breakshift) for
+ * all breaks from breakshiftfrom onward, and only touches the entries between the old and new
+ * edit points. See UpdateLineBreaks().
+ *
+ * The text itself is kept as a gap buffer. The unused memory of thetext is a gap that sits where
+ * the last edit happened, so typing or deleting in one place only moves the bytes between the
+ * old and new edit points, not everything after the cursor. Use textchar() to read single bytes
+ * by position. Code that needs thetext as a plain char array up to some position must call
+ * MakeContiguous() first, which moves the gap past that position. GetCText() does this for
+ * the whole text.
+ *
  * \todo implement max/min textlen/numlines
  */
 
@@ -143,8 +157,10 @@ class TextUndo : public UndoData
   public:
 	int type; //add, remove
 	char *text;
+	long len;
 	long start,end;
 	TextUndo(Undoable *editor, int t,const char *str,long l, long s,long e);
+	TextUndo(Undoable *editor, int t,char *str,long l, long s,long e, int takestr);
 	virtual ~TextUndo();
 	virtual const char *Description() { return NULL; }
 };
@@ -152,7 +168,25 @@ class TextUndo : public UndoData
 TextUndo::TextUndo(Undoable *editor, int t,const char *str,long l, long s,long e)
 {
 	context=editor;
-	text=newnstr(str,l);
+	 //copy exactly l bytes, str points into the middle of the text and has no terminator nearby
+	text=new char[l+1];
+	memcpy(text,str,l);
+	text[l]='\0';
+	len=l;
+	start=s;
+	end=e;
+	type=t;
+}
+
+//! Take possession of str, which must be a new'd char[] with at least l+1 bytes.
+/*! This saves copying big blocks, such as the whole old text in SetText().
+ */
+TextUndo::TextUndo(Undoable *editor, int t,char *str,long l, long s,long e, int takestr)
+{
+	context=editor;
+	text=str;
+	text[l]='\0';
+	len=l;
 	start=s;
 	end=e;
 	type=t;
@@ -198,6 +232,11 @@ TextEditBaseUtf8::TextEditBaseUtf8(const char *newtext,unsigned long nstyle,unsi
 	cutbuffer = NULL;
 	thetext   = NULL;
 	textlen   = 0;
+	gapstart  = 0;
+	linebreaks     = NULL;
+	numlinebreaks  = maxlinebreaks = 0;
+	breakshiftfrom = breakshift = 0;
+	linebreakstyle = -1;
 	maxlines  = maxtextlen = mintextlen = minlines = 0;
 	if (ncntlchar<33) if (textstyle&TEXT_CNTL_BANG) cntlchar=(unsigned int) '!'; else cntlchar=(unsigned int) '\\';
 	else cntlchar = ncntlchar;
@@ -218,6 +257,7 @@ TextEditBaseUtf8::~TextEditBaseUtf8()
 	DBG cerr <<" ---- in texteditbase dest"<<endl;
 	delete[] thetext;
 	delete[] cutbuffer;
+	delete[] linebreaks;
 	DBG cerr <<" ----   dest done."<<endl;
 }
 
@@ -299,6 +339,7 @@ int TextEditBaseUtf8::Find(const char *str,int fromcurs) // fromcurs==1
 { 						  
 	if (!str) return 0;
 	char *it=NULL;
+	MakeContiguous();
 	if (fromcurs){
 		it=strstr(thetext+curpos,str);
 		if (!it) it=strstr(thetext,str); // wraps around
@@ -332,14 +373,14 @@ int TextEditBaseUtf8::Replace(const char *newstr,const char *,int which)
  */
 const char *TextEditBaseUtf8::GetCText()
 {
-	return thetext;
+	return MakeContiguous();
 }
 
 //! Return a new char[] copy of thetext
 char *TextEditBaseUtf8::GetText()
 {
 	char *txt=NULL;
-	makestr(txt,thetext);
+	makestr(txt,MakeContiguous());
 	return txt;
 }
 
@@ -349,7 +390,12 @@ int TextEditBaseUtf8::SetText(const char *newtext)
 	DBG if (newtext) cerr <<endl<<"TextEditBaseUtf8:: NewText"<<endl<<newtext<<endl;
 	DBG else cerr <<endl<<"TextEditBaseUtf8:: NewText=NULL"<<endl;
 
-	if (textlen) AddUndo(TEXTUNDO_Delete, thetext,textlen, 0,0);
+	if (textlen && undomode) {
+		 //hand the old buffer to the undo rather than copying it
+		MakeContiguous();
+		undomanager.AddUndo(new TextUndo(this, TEXTUNDO_Delete, thetext,textlen, 0,0, 1));
+		thetext=NULL;
+	}
 	if (newtext) AddUndo(TEXTUNDO_Insert, newtext,strlen(newtext), 0,0);
 
 	delete[] thetext;
@@ -363,7 +409,10 @@ int TextEditBaseUtf8::SetText(const char *newtext)
 		strcpy(thetext,newtext);
 	}
 	maxtextmem=textlen+TEXTMEMBLOCK-1;
+	thetext[maxtextmem]='\0';
+	gapstart=textlen;
 	curpos=sellen=0;
+	linebreakstyle=-1;
 	return 0;
 }
 
@@ -444,8 +493,8 @@ int TextEditBaseUtf8::CombineChars()
 	long i2=curpos-1;
 	if (i1<0 || i2<0) return 1;
 
-	int newch = composekey(thetext[i1],thetext[i2]);
-	if (newch==0 || newch==thetext[i2]) return 1;
+	int newch = composekey(textchar(i1),textchar(i2));
+	if (newch==0 || newch==textchar(i2)) return 1;
 
 	SetSelection(i1,curpos);
 	replacesel(newch); //puts curpos after inserted char
@@ -461,16 +510,16 @@ long TextEditBaseUtf8::nextpos(long l)
 {
 	if (l>=textlen) return textlen;
 	if (l<0) return 0;
-	if ((thetext[l]&128)==0) { //cur char is ascii
+	if ((textchar(l)&128)==0) { //cur char is ascii
 		++l;
 		if (onlf(l+1)==2) ++l;
 		return l;
 	}
-	if ((thetext[l]&192)==192) { //cur char is start of multibyte char
+	if ((textchar(l)&192)==192) { //cur char is start of multibyte char
 		l++;
 	}
 	 //is in middle of a utf8 char
-	while (l<textlen && (thetext[l]&192)==128) l++;
+	while (l<textlen && (textchar(l)&192)==128) l++;
 	return l;
 }
 
@@ -483,12 +532,12 @@ long TextEditBaseUtf8::prevpos(long l)
 	if (l<=0) return 0;
 	if (l>textlen) return textlen;
 	--l;
-	if ((thetext[l]&128)==0) { //prev char is ascii
+	if ((textchar(l)&128)==0) { //prev char is ascii
 		if (onlf(l)==2) --l;
 		return l;
 	}
 	 //l is within multibyte char, move to start of the char
-	while (l>0 && (thetext[l]&192)==128) l--;
+	while (l>0 && (textchar(l)&192)==128) l--;
 
 //---note: if char&192!=192, then thetext is corrupted utf8
 //	if ((thetext[l]&192)==192) { //l is start of multibyte char
@@ -504,7 +553,7 @@ void TextEditBaseUtf8::makevalidpos(long &l)
 	if (l<0) { l=0; return; }
 	if (l>textlen) { l=textlen; return; }
 	 // make point only to 1st byte of a utf8 char.
-	while (l && (thetext[l]&196)==128) l--;
+	while (l && (textchar(l)&196)==128) l--;
 	if (!(textstyle&TEXT_NLONLY)) {
 		if (onlf(l)==2) l--; // l had to be>0 for only==2
 	}
@@ -514,9 +563,16 @@ void TextEditBaseUtf8::makevalidpos(long &l)
 char *TextEditBaseUtf8::GetSelText()
 {
 	if (!sellen) return NULL;
-	char *blah=new char[(sellen>0?sellen:-sellen)+1];
-	strncpy(blah,thetext+(selstart<curpos?selstart:curpos),(sellen>0?sellen:-sellen));
-	blah[abs(sellen)]='\0';
+	long start=(selstart<curpos?selstart:curpos);
+	long len=(sellen>0?sellen:-sellen);
+	char *blah=new char[len+1];
+
+	 //copy the parts before and after the gap
+	long before=(start<gapstart ? gapstart-start : 0);
+	if (before>len) before=len;
+	memcpy(blah,thetext+start,before);
+	memcpy(blah+before,thetext+start+before+maxtextmem-textlen,len-before);
+	blah[len]='\0';
 	return blah;
 }
 
@@ -556,13 +612,54 @@ int TextEditBaseUtf8::readonly(long) // pos==-1
 }
 
 //! Extend the memory allocated for thetext.
+/*! This grows by half of the current size, so that typing into or pasting into big
+ * texts does not reallocate and copy the whole text every TEXTMEMBLOCK bytes.
+ * The gap stays at gapstart, and gets all the new memory.
+ */
 int TextEditBaseUtf8::extendtext() 
 { 
-	int imax=(int) maxtextmem;
-	extendstr(thetext,imax,TEXTMEMBLOCK); //***
-	maxtextmem=imax;
-	if (thetext) return 0;
-	return 1;
+	long n=maxtextmem/2;
+	if (n<TEXTMEMBLOCK) n=TEXTMEMBLOCK;
+
+	char *newtext=new char[maxtextmem+n+2];
+	long after=textlen-gapstart;
+	if (thetext) {
+		memcpy(newtext,thetext,gapstart);
+		memcpy(newtext+maxtextmem+n-after,thetext+maxtextmem-after,after);
+	}
+	delete[] thetext;
+	thetext=newtext;
+	maxtextmem+=n;
+	thetext[maxtextmem]='\0';
+	return 0;
+}
+
+//! Move the gap in thetext to start at pos.
+/*! This moves only the bytes between the old and new gap positions.
+ */
+void TextEditBaseUtf8::MoveGap(long pos)
+{
+	long gap=maxtextmem-textlen;
+	if (pos<gapstart) memmove(thetext+pos+gap,thetext+pos,gapstart-pos);
+	else if (pos>gapstart) memmove(thetext+gapstart,thetext+gapstart+gap,pos-gapstart);
+	gapstart=pos;
+}
+
+//! Make thetext a plain char array up to byte end, and return thetext.
+/*! After this, thetext[i] is the byte at position i for all i<end. If end<0 or end>=textlen,
+ * the gap is moved after the whole text, and thetext is also '\0' terminated.
+ *
+ * The gap is moved only as far as needed, so for instance drawing the visible part of
+ * a big text just after an edit only moves the bytes on screen.
+ */
+char *TextEditBaseUtf8::MakeContiguous(long end)
+{
+	if (!thetext) return thetext;
+	if (end<0 || end>=textlen) {
+		if (gapstart!=textlen) MoveGap(textlen);
+		thetext[textlen]='\0';
+	} else if (gapstart<end) MoveGap(end);
+	return thetext;
 }
 
 int TextEditBaseUtf8::Modified(int m)
@@ -581,19 +678,22 @@ int TextEditBaseUtf8::inschar(unsigned int ucs,char a) //a=1
 {
 	if (readonly()) return 1;
 	if (textlen+5>maxtextmem) extendtext();
+	MoveGap(curpos);
 	if (ucs==(unsigned int)'\n' && !(textstyle&TEXT_NLONLY)) {
-		memmove(thetext+curpos+2,thetext+curpos,textlen-curpos+1);
-		textlen+=2;
 		thetext[curpos]=newline; thetext[curpos+1]=newline2;
+		gapstart+=2;
+		textlen+=2;
+		UpdateLineBreaks(curpos,0,2);
 		
 		AddUndo(TEXTUNDO_Insert, thetext+curpos,2, curpos,0);
 
 		if (a) curpos+=2;
 	} else {
 		int clen=utf8bytes(ucs);
-		memmove(thetext+curpos+clen,thetext+curpos,textlen-curpos+1);
-		textlen+=clen;
 		utf8encode(ucs,thetext+curpos);
+		gapstart+=clen;
+		textlen+=clen;
+		UpdateLineBreaks(curpos,0,clen);
 
 		AddUndo(TEXTUNDO_Insert, thetext+curpos,clen, curpos,0);
 
@@ -620,10 +720,11 @@ int TextEditBaseUtf8::delchar(int bksp)
 	}
 	int clen=nextpos(curpos)-curpos;
 
-	AddUndo(TEXTUNDO_Delete, thetext+curpos,clen, curpos,curpos+clen);
-
-	memmove(thetext+curpos,thetext+curpos+clen,textlen-curpos-clen+1);
+	 //the deleted bytes are just after the gap, and join it
+	MoveGap(curpos);
+	AddUndo(TEXTUNDO_Delete, thetext+curpos+maxtextmem-textlen,clen, curpos,curpos+clen);
 	textlen-=clen;
+	UpdateLineBreaks(curpos,clen,0);
 	Modified();
 	return 0;
 }
@@ -640,9 +741,11 @@ int TextEditBaseUtf8::insstring(const char *blah,int after) // after==0
 
 	long l=strlen(blah);
 	while (textlen+l>=maxtextmem) extendtext();
-	memmove(thetext+curpos+l,thetext+curpos,textlen-curpos+1);
+	MoveGap(curpos);
 	memcpy(thetext+curpos,blah,l);
+	gapstart+=l;
 	textlen+=l;
+	UpdateLineBreaks(curpos,0,l);
 
 	AddUndo(TEXTUNDO_Insert, blah,l, curpos,0);
 
@@ -662,11 +765,11 @@ int TextEditBaseUtf8::delsel()
 	   else { rbegin=selstart; rend=curpos; curpos=rbegin; }
 	if (sellen<0) sellen=-sellen;
 
-	AddUndo(TEXTUNDO_Delete, thetext+rbegin,rend-rbegin, rbegin,rend);
-
-	memmove(thetext+rbegin,thetext+rend, textlen-rend+1);
+	MoveGap(rbegin);
+	AddUndo(TEXTUNDO_Delete, thetext+rbegin+maxtextmem-textlen,rend-rbegin, rbegin,rend);
 
 	textlen-=sellen;
+	UpdateLineBreaks(rbegin,rend-rbegin,0);
 	if (curpos>textlen) curpos=textlen;
 	sellen=0;
 	Modified();
@@ -695,12 +798,14 @@ int TextEditBaseUtf8::replacesel(const char *newt,int after) // after=0, newt=NU
 	if (sellen<0) sellen=-sellen;
 	while (textlen+l>=maxtextmem) extendtext();
 
-	AddUndo(TEXTUNDO_Delete, thetext+rbegin,rend-rbegin+1, rbegin,rend);
+	MoveGap(rbegin);
+	AddUndo(TEXTUNDO_Delete, thetext+rbegin+maxtextmem-textlen,rend-rbegin, rbegin,rend);
 	AddUndo(TEXTUNDO_Insert, newt,l, rbegin,0);
 
-	memmove(thetext+rbegin+l,thetext+rend,textlen-rend+1);
 	memcpy(thetext+rbegin,newt,l);
+	gapstart+=l;
 	textlen+=l-sellen;
+	UpdateLineBreaks(rbegin,rend-rbegin,l);
 	if (after) curpos=rbegin+l; 
 	if (curpos>textlen) curpos=textlen;
 	sellen=0;
@@ -727,8 +832,10 @@ int TextEditBaseUtf8::findword(long pos,long &start, long &end) //pos=-1
 int TextEditBaseUtf8::isword(long pos) //pos=-1
 { 
 	if (pos<0) pos=curpos;
+	char ch[4];
 	int len;
-	return isalnum(utf8decode(thetext+pos,thetext+textlen,&len)); 
+	for (len=0; len<4 && pos+len<textlen; len++) ch[len]=textchar(pos+len);
+	return isalnum(utf8decode(ch,ch+len,&len)); 
 }
 
 //! Return first place after the first newline before pos
@@ -736,23 +843,25 @@ long TextEditBaseUtf8::findlinestart(long pos) // pos=-1
 {
 	if (pos<0) pos=curpos;
 	if (pos>textlen) pos=textlen;
-	while (pos>0 && !onlf(pos-1)) pos=prevpos(pos);
-	return pos;
+	if (LineBreakStyle()!=linebreakstyle) BuildLineBreaks();
+
+	long i=FindLineBreak(pos); //first break at or after pos
+	if (i==0) return 0;
+	long start=linebreak(i-1) + ((textstyle&TEXT_NLONLY) ? 1 : 2);
+	return start<pos ? start : pos;
 }
 
 //! Return how many newlines before pos.
 /*! defaults to count from beginning,first line==0, one line per newline 
  *
  * \todo *** perhaps remove this from this class, it is not used here, and a 'line'
- *   is perhaps too much a many splendored thing. besides as implemented here is
- *   very inefficient.
+ *   is perhaps too much a many splendored thing.
  */
 long TextEditBaseUtf8::WhichLine(long pos)
 {
-	 //rather inefficient
-	int l=0;
-	while (pos>0) if (onlf(pos--)==1) l++;
-	return l;
+	if (pos<=0) return 0;
+	if (LineBreakStyle()!=linebreakstyle) BuildLineBreaks();
+	return FindLineBreak(pos);
 }
 
 //! Returns most characters wide in all of lines of thetext.
@@ -763,7 +872,7 @@ long TextEditBaseUtf8::Getcharswide()  /* # chars, not actual width */
 	while (temp<textlen) {
 		 //count temp2 out to newline
 		temp2=temp;
-		while (!onlf(temp2) && thetext[temp2]!='\0') temp2=nextpos(temp2);
+		while (!onlf(temp2) && textchar(temp2)!='\0') temp2=nextpos(temp2);
 		cw=temp2-temp;
 		if (cw>width) width=cw;
 		if (temp2==textlen) break;
@@ -791,9 +900,8 @@ long TextEditBaseUtf8::Getnlines(long s,long e) // s=e=-1
 		if (e>textlen) e=textlen;
 	}
 	if (s>e) { long t=s; s=e; e=t; }
-	long n=0;
-	for (long c=s; c<=e; c=nextpos(c)) if (onlf(c)==1) n++;
-	return n;
+	if (LineBreakStyle()!=linebreakstyle) BuildLineBreaks();
+	return FindLineBreak(e+1)-FindLineBreak(s);
 }
 
 //! Set the newline delimiter to "n1n2". n2==0 means use single character newline.
@@ -815,17 +923,121 @@ int TextEditBaseUtf8::onlf(long pos) // pos=-1
 {
 	if (pos<0) pos=curpos;
 	if (pos>=textlen) return 0;
-	if (textstyle&TEXT_NLONLY) return thetext[pos]==newline?1:0;
-	if (thetext[pos]==newline2) {
-		if (pos>0 && thetext[pos-1]==newline) return 2;
+	if (textstyle&TEXT_NLONLY) return textchar(pos)==newline?1:0;
+	if (textchar(pos)==newline2) {
+		if (pos>0 && textchar(pos-1)==newline) return 2;
 		else return 0;
 	}
-	if (thetext[pos]==newline) {
-		if (pos<textlen && thetext[pos+1]==newline2) return 1;
+	if (textchar(pos)==newline) {
+		if (pos<textlen && textchar(pos+1)==newline2) return 1;
 	}
 	return 0;
 }
 
+//! Return a key for the current delimiter settings, to tell when linebreaks needs rebuilding.
+/*! Derived classes sometimes change newline or TEXT_NLONLY directly, so this is checked
+ * rather than relying on SetDelimiter() to flush the index.
+ */
+long TextEditBaseUtf8::LineBreakStyle()
+{
+	return (long)(unsigned char)newline | ((long)(unsigned char)newline2<<8) | ((textstyle&TEXT_NLONLY) ? (1<<16) : 0);
+}
+
+//! Scan the whole text for delimiters.
+void TextEditBaseUtf8::BuildLineBreaks()
+{
+	numlinebreaks=0;
+	breakshiftfrom=breakshift=0;
+	linebreakstyle=LineBreakStyle();
+	if (!thetext || !newline) return;
+
+	 //scan the text before the gap, then after it
+	for (int part=0; part<2; part++) {
+		long offset=(part==0 ? 0 : maxtextmem-textlen); //from position to index in thetext
+		const char *p  =thetext+offset+(part==0 ? 0 : gapstart);
+		const char *end=thetext+offset+(part==0 ? gapstart : textlen);
+		while (p<end && (p=(const char*)memchr(p,newline,end-p))!=NULL) {
+			long pos=p-thetext-offset;
+			if (onlf(pos)==1) {
+				if (numlinebreaks==maxlinebreaks) {
+					maxlinebreaks = (maxlinebreaks ? 2*maxlinebreaks : 64);
+					long *nb=new long[maxlinebreaks];
+					if (numlinebreaks) memcpy(nb,linebreaks,numlinebreaks*sizeof(long));
+					delete[] linebreaks;
+					linebreaks=nb;
+				}
+				linebreaks[numlinebreaks++]=pos;
+			}
+			p++;
+		}
+	}
+}
+
+//! Return the index of the first line break at or after pos, or numlinebreaks if none.
+long TextEditBaseUtf8::FindLineBreak(long pos)
+{
+	long lo=0, hi=numlinebreaks;
+	while (lo<hi) {
+		long mid=(lo+hi)/2;
+		if (linebreak(mid)<pos) lo=mid+1; else hi=mid;
+	}
+	return lo;
+}
+
+//! Adjust linebreaks after thetext has had [pos,pos+oldlen) replaced with newlen bytes.
+/*! This must be called after thetext and textlen are updated. Breaks in the old range
+ * [pos-1,pos+oldlen] are dropped, and the new range [pos-1,pos+newlen] is rescanned,
+ * which catches 2 character delimiters made or broken at the edges.
+ *
+ * Breaks after the edit are not touched. Instead, breakshift is adjusted, and only the entries
+ * between the previous breakshiftfrom and this edit are folded, so typing in one area
+ * costs a binary search per character, not a pass over every line after the cursor.
+ */
+void TextEditBaseUtf8::UpdateLineBreaks(long pos, long oldlen, long newlen)
+{
+	if (linebreakstyle<0) return; //will be rebuilt when needed
+	if (linebreakstyle!=LineBreakStyle()) { linebreakstyle=-1; return; }
+
+	long first=FindLineBreak(pos-1);
+	long last =FindLineBreak(pos+oldlen+1);
+	long delta=newlen-oldlen;
+
+	 //move pending shift to start at first
+	if (breakshiftfrom<first) {
+		for (long c=breakshiftfrom; c<first; c++) linebreaks[c]+=breakshift;
+	} else {
+		for (long c=first; c<breakshiftfrom; c++) linebreaks[c]-=breakshift;
+	}
+	breakshiftfrom=first;
+
+	 //count breaks in the new range
+	long s=(pos>0 ? pos-1 : 0);
+	long e=pos+newlen;
+	if (e>textlen-1) e=textlen-1;
+	long n=0;
+	for (long c=s; c<=e; c++) if (textchar(c)==newline && onlf(c)==1) n++;
+
+	long newnum=numlinebreaks-(last-first)+n;
+	if (newnum>maxlinebreaks) {
+		maxlinebreaks = (newnum>2*maxlinebreaks ? newnum : 2*maxlinebreaks);
+		if (maxlinebreaks<64) maxlinebreaks=64;
+		long *nb=new long[maxlinebreaks];
+		if (first) memcpy(nb,linebreaks,first*sizeof(long));
+		if (numlinebreaks>last) memcpy(nb+first+n,linebreaks+last,(numlinebreaks-last)*sizeof(long));
+		delete[] linebreaks;
+		linebreaks=nb;
+	} else if (first+n!=last && numlinebreaks>last) {
+		memmove(linebreaks+first+n,linebreaks+last,(numlinebreaks-last)*sizeof(long));
+	}
+	numlinebreaks=newnum;
+
+	 //entries from first on are all stored relative to the new shift
+	breakshift+=delta;
+	for (long c=s, i=first; c<=e; c++) {
+		if (textchar(c)==newline && onlf(c)==1) linebreaks[i++]=c-breakshift;
+	}
+}
+
 
 //---------------Undo functions:
 
@@ -853,7 +1065,7 @@ int TextEditBaseUtf8::Undo(UndoData *data)
 	if (t->type==TEXTUNDO_Insert) {
 		 //need to delete
 		selstart=t->start;
-		sellen=strlen(t->text);
+		sellen=t->len;
 		curpos=selstart+sellen;
 		undomode=0;
 		delsel();
@@ -880,7 +1092,8 @@ int TextEditBaseUtf8::Redo(UndoData *data)
 	if (!t) return 2;
 
 	if (t->type==TEXTUNDO_Insert) {
-		if (sellen) sellen=0;
+		curpos=t->start;
+		sellen=0;
 		undomode=0;
 		insstring(t->text,1);
 		undomode=1;
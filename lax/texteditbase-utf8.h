@@ -88,8 +88,15 @@ class TextEditBaseUtf8 : virtual public Undoable
   protected:
 	char *thetext;
 	long textlen,maxtextmem;
+	long gapstart; //thetext has maxtextmem-textlen unused bytes here, see MakeContiguous()
 	unsigned long textstyle;
 
+	 //sorted positions of the first byte of each delimiter, see UpdateLineBreaks()
+	long *linebreaks;
+	long numlinebreaks,maxlinebreaks;
+	long breakshiftfrom,breakshift;
+	long linebreakstyle;
+
 	long curline,curpos,selstart,sellen;
 	long modpos;
 	int cntlmovedist;
@@ -100,9 +107,17 @@ class TextEditBaseUtf8 : virtual public Undoable
 	char modified;
 	long maxtextlen,mintextlen, maxcharswide,mincharswide, maxlines,minlines; // these must be implemented in derived classes
 	virtual int extendtext(); // overkill?
+	virtual void MoveGap(long pos);
+	virtual char *MakeContiguous(long end=-1);
+	char textchar(long pos) { return thetext[pos<gapstart ? pos : pos+maxtextmem-textlen]; }
 	virtual long nextpos(long l);
 	virtual long prevpos(long l);
 	virtual void makevalidpos(long &l);
+	virtual long LineBreakStyle();
+	virtual void BuildLineBreaks();
+	virtual void UpdateLineBreaks(long pos, long oldlen, long newlen);
+	long linebreak(long i) { return linebreaks[i] + (i>=breakshiftfrom ? breakshift : 0); }
+	long FindLineBreak(long pos);
 
 	friend class UndoManager;
 	int undomode; //1 for add undos, or 0 for ignore undos
@@ -266,13 +266,12 @@ int TextXEditBaseUtf8::Cut()
 int TextXEditBaseUtf8::Copy() 
 {
 	if (!sellen) return 0;
-	int sl=sellen,ss;
+	int sl=sellen;
 	if (sl<0) sl=-sl;
-	if (selstart<curpos) ss=selstart; else ss=curpos;
 
 	TextEditBaseUtf8::Copy(); //updates cutbuffer
 	selectionCopy(0);
-	app->CopytoBuffer(thetext+ss,sl);
+	app->CopytoBuffer(cutbuffer,sl);
 
 	return 0;
 }
@@ -614,6 +613,7 @@ double TextXEditBaseUtf8::DrawLineOfText(double x,double y,long pos,long len,cha
 	}
 
 	long temp = pos+len;
+	MakeContiguous(temp+1); //TextOut() needs plain pointers into thetext
 	//DBG cerr <<" len="<<len<<endl;
 	long selbegin = 0, selend = 0;
 	bool hl;
@@ -920,6 +920,7 @@ double TextXEditBaseUtf8::GetExtent(long pos, long end, double lsofar, long eof)
 	 //for right or center justified, or no tabs, return normal extents
 	double ww;
 	if ((textstyle&(TEXT_RIGHT|TEXT_CENTER)) || !(textstyle&TEXT_TABS_STOPS)) {
+		MakeContiguous(end);
 		ww = TextExtent(thetext+pos,end-pos);
 		lsofar += ww;
 		 //*** note that this is wrong: it does not take into account mapping of missing chars
@@ -937,14 +938,15 @@ double TextXEditBaseUtf8::GetExtent(long pos, long end, double lsofar, long eof)
 	char tabutf[6];
 	
 	 // put eot on next eol, eof, or at first tab after end
-	while (eot<eof && thetext[eot]!='\t' && !onlf(eot)) eot++;
+	while (eot<eof && textchar(eot)!='\t' && !onlf(eot)) eot++;
+	MakeContiguous(eot+1);
 	
 	//DBG cerr <<"pos<=eot: ";
 	while (pos <= eot) { 
 		//DBG cerr <<".";
 		 //find the char extent of the current tab segment,
 		 // makes ppos at end of current tab segment
-		while (ppos<eot && thetext[ppos]!='\t' && !onlf(ppos)) ppos++;
+		while (ppos<eot && textchar(ppos)!='\t' && !onlf(ppos)) ppos++;
 		ww = TextExtent(thetext+pos,ppos-pos);
 		slen = ww;
 
@@ -997,7 +999,7 @@ double TextXEditBaseUtf8::GetExtent(long pos, long end, double lsofar, long eof)
 		pos = ppos;
 
 		 // then get info for next tab
-		if (thetext[pos] == '\t') {
+		if (textchar(pos) == '\t') {
 			tabbedto = GetNextTab(lsofar,tabtype);
 			if (tabtype == CHAR_TAB) {
 				tabchar = GetTabChar(tabbedto);
@@ -1024,6 +1026,7 @@ long TextXEditBaseUtf8::GetPos(long pos, double pix, double lsofar,long eof) //l
 	long end=pos;
 	if (eof<0) eof=textlen;
 	while (end<eof && !onlf(end)) end=nextpos(end); // puts end on newline-1
+	MakeContiguous(end+1);
 	DBG cerr <<"textx-GetPos: pos="<<pos<<" end="<<end<<" pix="<<pix<<endl;
 
 	double ww,hh;
@@ -1069,7 +1072,7 @@ long TextXEditBaseUtf8::GetPos(long pos, double pix, double lsofar,long eof) //l
 			if (tabchar == '\0') tabtype = CENTER_TAB; 
 		}
 
-		while (eotabseg<eof && !onlf(eotabseg) && thetext[eotabseg]!='\t') eotabseg++;
+		while (eotabseg<eof && !onlf(eotabseg) && textchar(eotabseg)!='\t') eotabseg++;
 
 		if (tabtype==CHAR_TAB) {
 			char ch=thetext[eotabseg];
@@ -0,0 +1,213 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+
+#include <lax/threadpool.h>
+
+#include <atomic>
+#include <memory>
+
+#include <iostream>
+using namespace std;
+#define DBG
+
+
+namespace Laxkit {
+
+
+//---------------------------- ThreadPool --------------------------------------
+/*! \class ThreadPool
+ * \brief A fixed set of worker threads for splitting up heavy computations.
+ *
+ * Use GetDefault() to get a process wide pool, sized to the number of hardware threads.
+ * Jobs are either fire and forget with Submit(), or a blocking loop over an index
+ * range with ParallelFor().
+ *
+ * Nothing here knows about the event loop. Jobs that need to report back to windows
+ * should do so with anXApp::SendMessage(), which is safe to call from a worker.
+ */
+
+
+ThreadPool *ThreadPool::default_pool = nullptr;
+
+/*! Return the process wide pool, creating it if necessary and create_if_null.
+ */
+ThreadPool *ThreadPool::GetDefault(bool create_if_null)
+{
+	if (!default_pool && create_if_null) {
+		default_pool = new ThreadPool;
+	}
+	return default_pool;
+}
+
+/*! If you pass in NULL, it will dec_count the old one.
+ * The count on new_pool will be incremented.
+ */
+void ThreadPool::SetDefault(ThreadPool *new_pool)
+{
+	if (new_pool == default_pool) return;
+
+	if (default_pool) default_pool->dec_count();
+	default_pool = new_pool;
+	if (default_pool) default_pool->inc_count();
+}
+
+/*! Number of threads the hardware can run at once, or 1 if unknown.
+ */
+int ThreadPool::HardwareThreads()
+{
+	int n = std::thread::hardware_concurrency();
+	return n > 0 ? n : 1;
+}
+
+/*! If num_threads <= 0, then use HardwareThreads()-1, since the thread calling
+ * ParallelFor() also does work.
+ */
+ThreadPool::ThreadPool(int num_threads)
+{
+	stopping = false;
+	if (num_threads <= 0) num_threads = HardwareThreads() - 1;
+
+	for (int c=0; c<num_threads; c++) {
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+	}
+}
+
+/*! Jobs still waiting are discarded. Jobs in progress are allowed to finish.
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	job_ready.notify_all();
+	for (auto &worker : workers) worker.join();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(job_mutex);
+			job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+/*! Number of jobs waiting to be picked up by a worker.
+ */
+int ThreadPool::Pending()
+{
+	std::lock_guard<std::mutex> lock(job_mutex);
+	return jobs.size();
+}
+
+/*! Queue a job to be run on some worker thread at some point. If there are no
+ * worker threads, the job is run immediately.
+ */
+void ThreadPool::Submit(std::function<void()> job)
+{
+	if (workers.size() == 0) {
+		job();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		jobs.push_back(std::move(job));
+	}
+	job_ready.notify_one();
+}
+
+/*! Call func(index, thread) for each index in [start,end), spread over the workers
+ * and the calling thread. Returns when all indices are done.
+ *
+ * Indices are handed out grain at a time, in increasing order. thread is in
+ * range [0..NumThreads()], and is suitable for indexing per thread scratch space. The
+ * calling thread uses NumThreads().
+ *
+ * The calling thread takes part, so it is safe to call ParallelFor from within a job,
+ * even if all workers are busy.
+ */
+void ThreadPool::ParallelFor(int start, int end, std::function<void(int index, int thread)> func, int grain)
+{
+	if (end <= start) return;
+	if (grain < 1) grain = 1;
+
+	int nhelpers = (end - start + grain - 1) / grain - 1;
+	if (nhelpers > (int)workers.size()) nhelpers = workers.size();
+	if (nhelpers <= 0) {
+		for (int c=start; c<end; c++) func(c, workers.size());
+		return;
+	}
+
+	struct LoopState {
+		std::atomic<int> next;
+		std::atomic<int> active;
+		std::mutex done_mutex;
+		std::condition_variable done;
+	};
+	std::shared_ptr<LoopState> state = std::make_shared<LoopState>();
+	state->next   = start;
+	state->active = 0;
+
+	 //helpers may start after all the work is already claimed, in which case they
+	 //just drop out without touching func
+	auto run = [state, end, grain, &func](int thread) {
+		int i;
+		while ((i = state->next.fetch_add(grain)) < end) {
+			int iend = i + grain;
+			if (iend > end) iend = end;
+			for ( ; i < iend; i++) func(i, thread);
+		}
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(job_mutex);
+		for (int c=0; c<nhelpers; c++) {
+			int thread = c;
+			jobs.push_back([state, run, thread]() {
+				state->active++;
+				run(thread);
+				std::lock_guard<std::mutex> lock(state->done_mutex);
+				state->active--;
+				state->done.notify_all();
+			});
+		}
+	}
+	job_ready.notify_all();
+
+	run(workers.size());
+
+	 //everything is claimed, now wait for helpers that are still chewing on something
+	std::unique_lock<std::mutex> lock(state->done_mutex);
+	state->done.wait(lock, [&state] { return state->active == 0; });
+}
+
+
+} //namespace Laxkit
+
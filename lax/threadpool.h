@@ -0,0 +1,73 @@
+//
+//
+//    The Laxkit, a windowing toolkit
+//    Please consult https://github.com/Laidout/laxkit about where to send any
+//    correspondence about this software.
+//
+//    This library is free software; you can redistribute it and/or
+//    modify it under the terms of the GNU Library General Public
+//    License as published by the Free Software Foundation; either
+//    version 3 of the License, or (at your option) any later version.
+//
+//    This library is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//    Library General Public License for more details.
+//
+//    You should have received a copy of the GNU Library General Public
+//    License along with this library; If not, see <http://www.gnu.org/licenses/>.
+//
+//    Copyright (C) 2026 by Tom Lechner
+//
+#ifndef _LAX_THREADPOOL_H
+#define _LAX_THREADPOOL_H
+
+
+#include <lax/anobject.h>
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+
+namespace Laxkit {
+
+
+//---------------------------- ThreadPool --------------------------------------
+class ThreadPool : public anObject
+{
+  private:
+	static ThreadPool *default_pool;
+
+  protected:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex job_mutex;
+	std::condition_variable job_ready;
+	bool stopping;
+
+	virtual void WorkerLoop();
+
+  public:
+	static ThreadPool *GetDefault(bool create_if_null=true);
+	static void SetDefault(ThreadPool *new_pool);
+	static int HardwareThreads();
+
+	ThreadPool(int num_threads = 0);
+	virtual ~ThreadPool();
+	virtual const char *whattype() { return "ThreadPool"; }
+
+	virtual int NumThreads() { return workers.size(); }
+	virtual int Pending();
+	virtual void Submit(std::function<void()> job);
+	virtual void ParallelFor(int start, int end, std::function<void(int index, int thread)> func, int grain = 1);
+};
+
+
+} //namespace Laxkit
+
+#endif
+
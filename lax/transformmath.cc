@@ -66,6 +66,10 @@ namespace Laxkit {
 //------------------------------- Affine ----------------------------------------
 /*! \class An affine transform.
  */
+/*! \fn void Affine::TransformChanged()
+ * Called after the matrix is changed by any member function. Default is to do nothing.
+ * Note that code writing directly to _m must call this itself.
+ */
 
 Affine::Affine()
 { transform_identity(_m); }
@@ -95,6 +99,7 @@ Affine::Affine(double xx,double xy,double yx,double yy,double tx,double ty)
 Affine &Affine::operator=(Affine const &mm)
 {
 	memcpy(_m, mm.m(), 6*sizeof(double));
+	TransformChanged();
 	return *this;
 }
 
@@ -103,6 +108,7 @@ Affine &Affine::operator*=(Affine const &M)
 	double mm[6];
 	transform_mult(mm,_m,M.m());
 	transform_copy(_m,mm);
+	TransformChanged();
 	return *this;
 }
 
@@ -117,10 +123,16 @@ Affine::~Affine()
 {}
 
 void Affine::set(Affine const &a)
-{ transform_copy(_m,a.m()); }
+{
+	transform_copy(_m,a.m());
+	TransformChanged();
+}
 
 void Affine::setIdentity()
-{ transform_identity(_m); }
+{
+	transform_identity(_m);
+	TransformChanged();
+}
 
 #define EPSILON 1e-15
 
@@ -166,6 +178,7 @@ void Affine::setRotation(double angle)
 	_m[1]=-x*sin(angle);
 	_m[2]= y*cos(angle+aangle);
 	_m[3]=-y*sin(angle+aangle);
+	TransformChanged();
 }
 
 /*! Set angle of xaxis and yaxis..
@@ -180,6 +193,7 @@ void Affine::setShear(double anglex, double angley)
 	_m[1]=-x*sin(anglex);
 	_m[2]= y*cos(angley);
 	_m[3]=-y*sin(angley);
+	TransformChanged();
 }
 
 void Affine::setScale(double sx,double sy)
@@ -196,11 +210,13 @@ void Affine::setScale(double sx,double sy)
 void Affine::setBasis(flatpoint o, flatpoint x,flatpoint y)
 {
 	transform_from_basis(_m, o,x,y);
+	TransformChanged();
 }
 
 void Affine::setBasics(double x,double y,double sx,double sy,double angle,double shear)
 {
 	transform_from_basics(_m, x,y,sx,sy,angle,shear);
+	TransformChanged();
 }
 
 void Affine::getBasics(double *x,double *y,double *sx,double *sy,double *angle,double *shear)
@@ -271,6 +287,7 @@ void Affine::Translate(flatvector d)
 {
 	_m[4]+=d.x;
 	_m[5]+=d.y;
+	TransformChanged();
 }
 
 /*! angle in radians */
@@ -280,6 +297,7 @@ void Affine::Rotate(double angle)
 	transform_copy(mm,_m);
 	transform_rotate(mm,angle);
 	transform_copy(_m,mm);
+	TransformChanged();
 }
 
 /*! This basically translates around_point to origin, rotates, then translates back.
@@ -304,6 +322,7 @@ void Affine::Rotate(double angle, flatpoint around_point)
 	mm[4]+=around_point.x;
 	mm[5]+=around_point.y;
 	transform_copy(_m,mm);
+	TransformChanged();
 }
 
 void Affine::RotatePointed(flatpoint anchor1, flatpoint anchor2, flatpoint newanchor2)
@@ -333,6 +352,7 @@ void Affine::RotateScale(flatpoint anchor1, flatpoint anchor2, flatpoint newanch
 	transform_mult(N,T,M2);
 	transform_mult(T,_m,N);
 	transform_copy(_m,T);
+	TransformChanged();
 }
 
 /*! Scale and shear such that a random point off of (anchor2-anchor1) stays
@@ -384,6 +404,7 @@ void Affine::AnchorShear(flatpoint anchor1, flatpoint anchor2, flatpoint anchor3
 	transform_mult(N,T,M2);
 	transform_mult(T,_m,N);
 	transform_copy(_m,T);
+	TransformChanged();
 }
 
 void Affine::Scale(double s)
@@ -394,6 +415,7 @@ void Affine::Scale(double s)
 	_m[3]*=s;
 	_m[4]*=s;
 	_m[5]*=s;
+	TransformChanged();
 }
 
 void Affine::Scale(double sx, double sy)
@@ -404,6 +426,7 @@ void Affine::Scale(double sx, double sy)
 	_m[3]*=sy;
 	_m[4]*=sx;
 	_m[5]*=sy;
+	TransformChanged();
 }
 
 //! Scale around point o of parent space.
@@ -440,6 +463,7 @@ void Affine::FlipH()
 {
 	_m[0]=-_m[0];
 	_m[1]=-_m[1];
+	TransformChanged();
 }
 
 /*! Flips the y axis. Note that this does not flip within a bounding box.
@@ -448,6 +472,7 @@ void Affine::FlipV()
 {
 	_m[2]=-_m[2];
 	_m[3]=-_m[3];
+	TransformChanged();
 }
 
 //! Flip across the axis of f1 to f2.
@@ -463,6 +488,7 @@ void Affine::Flip(flatpoint f1,flatpoint f2)
 	transform_mult(tt, t,mf);
 	transform_mult(t, _m,tt);
 	transform_copy(_m,t);
+	TransformChanged();
 }
 
 //! this=this*m
@@ -471,6 +497,7 @@ void Affine::Multiply(const Affine &m)
 	double result[6];
 	transform_mult(result,_m,m.m());
 	transform_copy(_m,result);
+	TransformChanged();
 }
 
 //! this=this*m
@@ -479,6 +506,7 @@ void Affine::Multiply(const double *m)
 	double result[6];
 	transform_mult(result,_m,m);
 	transform_copy(_m,result);
+	TransformChanged();
 }
 
 //! this=m*this
@@ -487,6 +515,7 @@ void Affine::PreMultiply(const Affine &m)
 	double result[6];
 	transform_mult(result,m.m(),_m);
 	transform_copy(_m,result);
+	TransformChanged();
 }
 
 //! this=m*this
@@ -495,6 +524,7 @@ void Affine::PreMultiply(const double *m)
 	double result[6];
 	transform_mult(result,m,_m);
 	transform_copy(_m,result);
+	TransformChanged();
 }
 
 //! Return a new matrix that is the inverse of this, if possible.
@@ -511,6 +541,7 @@ void Affine::Invert()
 	double mm[6];
 	transform_invert(mm,_m);
 	transform_copy(_m,mm);
+	TransformChanged();
 }
 
 /*! Return whether the matrix is degenerate or not.
@@ -542,7 +573,10 @@ flatpoint Affine::transformVectorInverse(flatpoint p)
 }
 
 void Affine::m(const double *mm)
-{ memcpy(_m,mm, 6*sizeof(double)); }
+{
+	memcpy(_m,mm, 6*sizeof(double));
+	TransformChanged();
+}
 
 void Affine::m(double xx,double xy,double yx,double yy,double tx,double ty)
 {
@@ -552,6 +586,7 @@ void Affine::m(double xx,double xy,double yx,double yy,double tx,double ty)
 	_m[3]=yy;
 	_m[4]=tx;
 	_m[5]=ty;
+	TransformChanged();
 }
 
 
@@ -35,6 +35,7 @@ class Affine
 {
   protected:
 	double _m[6];
+	virtual void TransformChanged() {}
 
   public:
 	Affine();
@@ -89,7 +90,7 @@ class Affine
 	virtual void   m(const double *mm); //todo: this should be set(mm) because compiler has ridiculous complaint about ambiguous with m(int) const
 	virtual void   m(double xx,double xy,double yx,double yy,double tx,double ty);
 	virtual double m(int c) const { return _m[c]; }
-	virtual void   m(int c,double v) { _m[c]=v; }
+	virtual void   m(int c,double v) { _m[c]=v; TransformChanged(); }
 	virtual void Unshear(int preserve_x, int normalize);
 	virtual void Normalize();
 	virtual double GetIMagnification(double vx, double vy);
@@ -98,11 +99,11 @@ class Affine
 	virtual double GetMagnification(flatpoint v);
 
 	virtual flatpoint origin() { return flatpoint(_m[4],_m[5]); }
-	virtual void      origin(flatpoint o) { _m[4]=o.x; _m[5]=o.y; }
+	virtual void      origin(flatpoint o) { _m[4]=o.x; _m[5]=o.y; TransformChanged(); }
 	virtual flatpoint xaxis() { return flatpoint(_m[0],_m[1]); }
-	virtual void      xaxis(flatpoint x) { _m[0]=x.x; _m[1]=x.y; }
+	virtual void      xaxis(flatpoint x) { _m[0]=x.x; _m[1]=x.y; TransformChanged(); }
 	virtual flatpoint yaxis() { return flatpoint(_m[2],_m[3]); }
-	virtual void      yaxis(flatpoint y) { _m[2]=y.x; _m[3]=y.y; }
+	virtual void      yaxis(flatpoint y) { _m[2]=y.x; _m[3]=y.y; TransformChanged(); }
 };
 
 
@@ -24,6 +24,7 @@
 #include <lax/strmanip.h>
 #include <lax/anxapp.h>
 #include <lax/language.h>
+#include <lax/iobuffer.h>
 
 #include <sys/times.h>
 
@@ -84,6 +85,10 @@ UndoData::UndoData(int nisauto)
     context     = NULL;
     direction   = UNDOABLE;
     prev = next = NULL;
+
+	accounted_size = 0;
+	spill_offset   = -1;
+	spill_length   = 0;
 }
 
 /*! If prev==NULL, then delete next, else just remove *this from chain.
@@ -150,6 +155,7 @@ MetaUndoData::MetaUndoData(Undoable *context, int ntype, int nisauto, const char
   : UndoData(nisauto)
 {
 	type = ntype;
+	description = nullptr;
 	makestr(description, desc);
 	this->context = context;
 	if (context && dynamic_cast<anObject*>(context)) {
@@ -179,23 +185,345 @@ int MetaUndoData::Size() //in bytes of this whole undo instanc
 	return n;
 }
 
+/*! Move all of meta's subattributes to att, leaving meta empty. Returns 0 for success.
+ */
+int MetaUndoData::SpillOut(Attribute *att)
+{
+	if (!att || !meta.attributes.n) return 1;
+	while (meta.attributes.n) att->push(meta.attributes.pop(0), -1);
+	return 0;
+}
+
+/*! Take back what SpillOut() wrote. att is left empty. Returns 0 for success.
+ */
+int MetaUndoData::SpillIn(Attribute *att)
+{
+	if (!att) return 1;
+	while (att->attributes.n) meta.push(att->attributes.pop(0), -1);
+	return 0;
+}
+
 
 
 
 //--------------------------------------------- UndoManager ------------------------------------------
 /*! \class UndoManager
  * \brief Simple class to keep track of undoes.
+ *
+ * By default the undo stack grows without bound. Use SetBudget() to cap how many bytes
+ * (as reported by UndoData::Size()) and how many undo groups are kept. When over budget,
+ * the oldest undo groups are discarded. A group is a non-auto node plus any isauto nodes
+ * following it. The group of the most recent undo, and anything redoable, are never discarded.
+ *
+ * With SpillMode() on, before discarding anything, cold nodes (those more than a few steps
+ * back from current) are asked to UndoData::SpillOut() their state to an Attribute, which gets
+ * appended to an anonymous temp file. They are read back with UndoData::SpillIn() right before
+ * they are undone or redone. Only node types that implement SpillOut(), such as MetaUndoData,
+ * can be spilled.
  */
 
 	
 UndoManager::UndoManager()
 {
 	head=current=NULL;
+
+	max_bytes     = 0;
+	max_groups    = 0;
+	memory_used   = 0;
+	spilled_bytes = 0;
+	num_undos     = 0;
+	num_groups    = 0;
+
+	spill           = false;
+	spill_threshold = 0;
+	spill_keep      = 20;
+	num_spilled     = 0;
+	spill_file      = nullptr;
+	spill_file_bytes = 0;
 }
 
 UndoManager::~UndoManager()
 {
 	if (head) delete head;
+	if (spill_file) fclose(spill_file);
+}
+
+/*! Cap the undo stack to about bytes of UndoData::Size(), and at most groups undo groups.
+ * Use 0 for no limit. The oldest groups are discarded right away if over budget.
+ */
+void UndoManager::SetBudget(long bytes, int groups)
+{
+	max_bytes  = (bytes  > 0 ? bytes  : 0);
+	max_groups = (groups > 0 ? groups : 0);
+	Enforce();
+}
+
+/*! When on, nodes more than keep steps before current are spilled to a temp file while
+ * memory use is more than threshold_bytes. If threshold_bytes<=0, use half of the byte budget.
+ *
+ * Turning off does not reload nodes already spilled. They are reloaded as they are needed.
+ */
+void UndoManager::SpillMode(bool on, long threshold_bytes, int keep)
+{
+	spill           = on;
+	spill_threshold = threshold_bytes;
+	spill_keep      = (keep >= 0 ? keep : 0);
+	Enforce();
+}
+
+/*! Return the bytes of undo data held in memory. Optionally return how many bytes are in
+ * the spill file, how many undo nodes there are, and how many undo groups.
+ */
+long UndoManager::MemoryUse(long *spilled_ret, int *count_ret, int *groups_ret)
+{
+	if (spilled_ret) *spilled_ret = spilled_bytes;
+	if (count_ret)   *count_ret   = num_undos;
+	if (groups_ret)  *groups_ret  = num_groups;
+	return memory_used;
+}
+
+//! Add (sign>0) or remove (sign<0) data from the running totals.
+void UndoManager::Account(UndoData *data, int sign)
+{
+	if (sign > 0) {
+		data->accounted_size = data->Size();
+		memory_used += data->accounted_size;
+		num_undos++;
+		if (!data->isauto) num_groups++;
+
+	} else {
+		memory_used -= data->accounted_size;
+		num_undos--;
+		if (!data->isauto) num_groups--;
+		if (data->spill_offset >= 0) {
+			spilled_bytes -= data->spill_length;
+			num_spilled--;
+			data->spill_offset = -1;
+		}
+	}
+}
+
+//! Remove chain and every node after it from the running totals.
+void UndoManager::Unaccount(UndoData *chain)
+{
+	for ( ; chain; chain = chain->next) Account(chain, -1);
+	ReclaimSpill();
+}
+
+/*! Remove the oldest undo group from head. Returns 0 for something removed, or nonzero
+ * if there is nothing that may be removed.
+ */
+int UndoManager::DiscardOldest()
+{
+	if (!head || !current) return 1;
+
+	 //find end of head's group, refusing if it contains current
+	UndoData *end = head;
+	if (end == current) return 2;
+	while (end->next && end->next->isauto) {
+		end = end->next;
+		if (end == current) return 2;
+	}
+	if (!end->next) return 3;
+
+	UndoData *newhead = end->next;
+	end->next     = NULL;
+	newhead->prev = NULL;
+
+	UndoData *oldgroup = head;
+	head = newhead;
+	Unaccount(oldgroup);
+	delete oldgroup; //deletes whole detached group
+	return 0;
+}
+
+/*! Spill cold nodes if in spill mode, then discard oldest groups until within budget.
+ * Returns the number of groups discarded.
+ */
+int UndoManager::Enforce()
+{
+	if (spill) SpillCold();
+
+	int n = 0;
+	while ((max_bytes > 0 && memory_used > max_bytes) || (max_groups > 0 && num_groups > max_groups)) {
+		if (DiscardOldest() != 0) break;
+		n++;
+	}
+	return n;
+}
+
+/*! Spill nodes older than the spill_keep nodes right before current until memory use is under
+ * the spill threshold. Returns the number of nodes spilled.
+ */
+int UndoManager::SpillCold()
+{
+	long threshold = spill_threshold > 0 ? spill_threshold : max_bytes / 2;
+	if (threshold <= 0 || memory_used <= threshold || !current) return 0;
+
+	 //find the newest node that may be spilled
+	UndoData *last = current;
+	for (int c = 0; c < spill_keep && last; c++) last = last->prev;
+	if (!last) return 0;
+	last = last->prev; //don't spill current either
+	if (!last) return 0;
+
+	if (!spill_file) {
+		spill_file = tmpfile();
+		if (!spill_file) {
+			cerr << " *** could not open undo spill file, turning off spill mode"<<endl;
+			spill = false;
+			return 0;
+		}
+	}
+
+	 //walk back toward head, stopping at nodes already spilled or that refused before,
+	 //so that in the usual case only the one node that just went cold is looked at
+	int n = 0;
+	for (UndoData *node = last; node && memory_used > threshold; node = node->prev) {
+		if (node->spill_offset >= 0 || node->spill_length < 0) break;
+
+		Attribute att;
+		if (node->SpillOut(&att) != 0) {
+			node->spill_length = -1; //not spillable, don't ask again
+			break;
+		}
+
+		fseek(spill_file, 0, SEEK_END);
+		long offset = ftell(spill_file);
+		att.dump_out(spill_file, 0);
+		long length = ftell(spill_file) - offset;
+
+		if (ferror(spill_file) || length <= 0) {
+			 //could not write, put it back
+			cerr << " *** error writing undo spill file"<<endl;
+			node->SpillIn(&att);
+			clearerr(spill_file);
+			break;
+		}
+
+		memory_used -= node->accounted_size;
+		node->accounted_size = node->Size();
+		memory_used += node->accounted_size;
+
+		node->spill_offset = offset;
+		node->spill_length = length;
+		spill_file_bytes = offset + length;
+		spilled_bytes += length;
+		num_spilled++;
+		n++;
+	}
+
+	return n;
+}
+
+/*! If data was spilled, read it back in. Returns 0 for success or data not spilled, else nonzero.
+ */
+int UndoManager::Unspill(UndoData *data)
+{
+	if (data->spill_offset < 0) return 0;
+	if (!spill_file) return 1;
+
+	char *str = new char[data->spill_length + 1];
+	fseek(spill_file, data->spill_offset, SEEK_SET);
+	size_t n = fread(str, 1, data->spill_length, spill_file);
+	str[n] = '\0';
+	if ((long)n != data->spill_length) {
+		cerr << " *** error reading undo spill file"<<endl;
+		delete[] str;
+		clearerr(spill_file);
+		return 2;
+	}
+
+	IOBuffer in;
+	in.OpenCString(str);
+	Attribute att;
+	att.dump_in(in, 0);
+	in.Close();
+	delete[] str;
+	if (data->SpillIn(&att) != 0) return 3;
+
+	spilled_bytes -= data->spill_length;
+	num_spilled--;
+	data->spill_offset = -1;
+	data->spill_length = 0;
+
+	memory_used -= data->accounted_size;
+	data->accounted_size = data->Size();
+	memory_used += data->accounted_size;
+
+	ReclaimSpill();
+	return 0;
+}
+
+/*! Nodes that are reloaded or discarded leave dead regions in the spill file. When nothing
+ * is left in the file, it is closed. Otherwise, once dead bytes are more than the live ones
+ * (and more than a little), the live regions are copied to a fresh temp file, and the
+ * spill_offset of each spilled node is updated.
+ *
+ * Must be called only when every spilled node is in the chain from head.
+ * Returns 1 if the file was closed or compacted, else 0.
+ */
+int UndoManager::ReclaimSpill()
+{
+	if (!spill_file) return 0;
+
+	if (num_spilled == 0) {
+		 //nothing left in the file, start over
+		fclose(spill_file);
+		spill_file = nullptr;
+		spill_file_bytes = 0;
+		return 1;
+	}
+
+	long dead = spill_file_bytes - spilled_bytes;
+	if (dead < 65536 || dead <= spilled_bytes) return 0;
+
+	FILE *newfile = tmpfile();
+	if (!newfile) return 0;
+
+	long newbytes = 0;
+	long bufsize = 0;
+	char *buffer = nullptr;
+	bool ok = true;
+
+	UndoData *node;
+	for (node = head; node; node = node->next) {
+		if (node->spill_offset < 0) continue;
+
+		if (node->spill_length > bufsize) {
+			delete[] buffer;
+			bufsize = node->spill_length;
+			buffer = new char[bufsize];
+		}
+		fseek(spill_file, node->spill_offset, SEEK_SET);
+		if ((long)fread(buffer, 1, node->spill_length, spill_file) != node->spill_length
+				|| (long)fwrite(buffer, 1, node->spill_length, newfile) != node->spill_length) {
+			ok = false;
+			break;
+		}
+		newbytes += node->spill_length;
+	}
+	delete[] buffer;
+
+	if (!ok || newbytes != spilled_bytes || fflush(newfile) != 0) {
+		 //keep using the old file, nothing has been changed yet
+		cerr << " *** error compacting undo spill file"<<endl;
+		clearerr(spill_file);
+		fclose(newfile);
+		return 0;
+	}
+
+	newbytes = 0;
+	for (node = head; node; node = node->next) {
+		if (node->spill_offset < 0) continue;
+		node->spill_offset = newbytes;
+		newbytes += node->spill_length;
+	}
+
+	fclose(spill_file);
+	spill_file = newfile;
+	spill_file_bytes = newbytes;
+	return 1;
 }
 
 /*! Takes possession of data, and will delete it when done.
@@ -211,9 +539,11 @@ int UndoManager::AddUndo(UndoData *data)
      //if any after current, remove them
 	if (current) {
 		while (current->next && current->next->isRedoable()) {
+			Account(current->next, -1);
 			delete current->next;
 		}
-	} else if (head) { delete head; head=NULL; }
+		ReclaimSpill();
+	} else if (head) { UndoData *old = head; head=NULL; Unaccount(old); delete old; }
 
     if (current) {
 		current->next=data;
@@ -228,6 +558,8 @@ int UndoManager::AddUndo(UndoData *data)
 		} else head=current=data;
     }
 
+	Account(data, 1);
+	Enforce();
 	return 0;
 }
 
@@ -247,10 +579,11 @@ int UndoManager::Undo()
 
 	do {
 		isauto = current->isauto;
+		if (Unspill(current) != 0) return 4;
 		if (current->context->Undo(current)==0) {
 			msg = current->Description();
 			msg_id = current->undo_id;
-			msg_pos = current->GetUndoPosition();
+			if (anXApp::app) msg_pos = current->GetUndoPosition(); //walks whole stack, only needed for the message
 			current->direction = REDOABLE;
 			current = current->prev;
 		} else {
@@ -280,15 +613,20 @@ int UndoManager::Redo()
 	unsigned long msg_id = 0;
 	int msg_pos = 0;
 
+	if (Unspill(current) != 0) {
+		current = current->prev;
+		return 6;
+	}
+
 	if (current->context->Redo(current)==0) {
 		current->direction = UNDOABLE;
 		msg = current->Description();
 		msg_id = current->undo_id;
-		msg_pos = current->GetUndoPosition();
+		if (anXApp::app) msg_pos = current->GetUndoPosition(); //walks whole stack, only needed for the message
 
 		while (current->next && current->next->isauto) {
 			current = current->next;
-			if (current->context->Redo(current)==0) {
+			if (Unspill(current)==0 && current->context->Redo(current)==0) {
 				current->direction = UNDOABLE;
 			} else {
 				// *** uh oh! broken mid undo stream, a tragedy!
@@ -26,6 +26,7 @@
 #include <lax/anobject.h>
 #include <lax/attributes.h>
 #include <cstdlib>
+#include <cstdio>
 
 namespace Laxkit {
 
@@ -55,6 +56,10 @@ class UndoData
 
 	anObject *data;
 
+	int accounted_size; // Size() when UndoManager last counted it
+	long spill_offset;  // where in UndoManager's spill file, or -1 if not spilled
+	long spill_length;
+
     UndoData(int nisauto=0);
     virtual ~UndoData();
     virtual int isUndoable();
@@ -63,6 +68,8 @@ class UndoData
 	virtual const char *Script() { return NULL; }
 	virtual int GetUndoPosition();
 	virtual int Size(); //in bytes of this whole undo instance
+	virtual int SpillOut(Attribute *att) { return 1; } // move undo state to att and release it, return 0 for success
+	virtual int SpillIn(Attribute *att) { return 1; } // restore what SpillOut() wrote, return 0 for success
 };
 
 
@@ -78,6 +85,8 @@ class MetaUndoData : public UndoData
     virtual ~MetaUndoData();
     virtual const char *Description();
     virtual int Size(); //in bytes of this whole undo instance
+	virtual int SpillOut(Attribute *att);
+	virtual int SpillIn(Attribute *att);
 };
 
 
@@ -87,6 +96,29 @@ class UndoManager : public anObject
   protected:
     UndoData *head;
     UndoData *current; //points to either the current undoable, or NULL. There may be redoable ones in head!
+
+	long max_bytes;     // 0 for no limit
+	int  max_groups;    // 0 for no limit
+	long memory_used;   // sum of accounted_size for all nodes
+	long spilled_bytes;
+	int  num_undos;
+	int  num_groups;
+
+	bool spill;
+	long spill_threshold; // spill cold nodes while memory_used is more than this
+	int  spill_keep;      // never spill this many nodes before current
+	int  num_spilled;
+	FILE *spill_file;
+	long spill_file_bytes; // bytes written to spill_file, live or not
+
+	virtual void Account(UndoData *data, int sign);
+	virtual void Unaccount(UndoData *chain);
+	virtual int DiscardOldest();
+	virtual int Enforce();
+	virtual int SpillCold();
+	virtual int Unspill(UndoData *data);
+	virtual int ReclaimSpill();
+
   public:
 	UndoManager();
 	virtual ~UndoManager();
@@ -95,6 +127,10 @@ class UndoManager : public anObject
 
 	virtual int Undo();
 	virtual int Redo();
+
+	virtual void SetBudget(long bytes, int groups);
+	virtual void SpillMode(bool on, long threshold_bytes = 0, int keep = 20);
+	virtual long MemoryUse(long *spilled_ret = nullptr, int *count_ret = nullptr, int *groups_ret = nullptr);
 };
 
 